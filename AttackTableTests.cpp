@@ -0,0 +1,46 @@
+#include <iostream>
+#include <random>
+
+#include "BitboardOps.hpp"
+
+auto test_slider_table(bool rook) {
+    // compare table lookups against the slow ray walk for sparse and dense boards.
+    std::mt19937_64 rng(0xc0ffee);
+    for (auto i = 0; i < 100000; ++i) {
+        auto square = (Square)(i % 64);
+        Bitboard occupied = (i & 1) ? rng() & rng() : rng() | rng();
+        auto expected = rook
+            ? _sliding_attacks(square, occupied, std::array{-8, 8, -1, 1})
+            : _sliding_attacks(square, occupied, _DIAG);
+        auto result = rook
+            ? rook_attacks(square, occupied)
+            : bishop_attacks(square, occupied);
+        if (result != expected) {
+            std::cout << "square " << square << " occupied " << occupied << " ";
+            return false;
+        }
+    }
+    return true;
+}
+
+auto test_queen_attacks() {
+    // queen on d4 (bit 27), blocked on d6 and f4.
+    auto occupied = BB_D6 | BB_F4;
+    auto expected = (BB_D5 | BB_D6 | BB_D3 | BB_D2 | BB_D1 |
+                     BB_E4 | BB_F4 | BB_C4 | BB_B4 | BB_A4) |
+                    bishop_attacks((Square)27, occupied);
+    return queen_attacks((Square)27, occupied) == expected;
+}
+
+auto test_empty_board_rays() {
+    return rook_attacks((Square)0, BB_EMPTY) == ((BB_FILE_A | BB_RANK_1) & ~BB_A1) &&
+           bishop_attacks((Square)0, BB_EMPTY) == (0x8040201008040200ULL);
+}
+
+int main() {
+    std::cout << "test_rook_table:       " << (test_slider_table(true) ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_bishop_table:     " << (test_slider_table(false) ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_queen_attacks:    " << (test_queen_attacks() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_empty_board_rays: " << (test_empty_board_rays() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
@@ -3,25 +3,25 @@
 #include "ConstexprArrayGenerator.hpp"
 
 enum Square : int {
-    A1, A2, A3, A4, A5, A6, A7, A8,
-    B1, B2, B3, B4, B5, B6, B7, B8,
-    C1, C2, C3, C4, C5, C6, C7, C8,
-    D1, D2, D3, D4, D5, D6, D7, D8,
-    E1, E2, E3, E4, E5, E6, E7, E8,
-    F1, F2, F3, F4, F5, F6, F7, F8,
-    G1, G2, G3, G4, G5, G6, G7, G8,
-    H1, H2, H3, H4, H5, H6, H7, H8,
+    A1, B1, C1, D1, E1, F1, G1, H1,
+    A2, B2, C2, D2, E2, F2, G2, H2,
+    A3, B3, C3, D3, E3, F3, G3, H3,
+    A4, B4, C4, D4, E4, F4, G4, H4,
+    A5, B5, C5, D5, E5, F5, G5, H5,
+    A6, B6, C6, D6, E6, F6, G6, H6,
+    A7, B7, C7, D7, E7, F7, G7, H7,
+    A8, B8, C8, D8, E8, F8, G8, H8,
 };
 
-constexpr std::array SQUARES = {
-    Square::A1, Square::A2, Square::A3, Square::A4, Square::A5, Square::A6, Square::A7, Square::A8,
-    Square::B1, Square::B2, Square::B3, Square::B4, Square::B5, Square::B6, Square::B7, Square::B8,
-    Square::C1, Square::C2, Square::C3, Square::C4, Square::C5, Square::C6, Square::C7, Square::C8,
-    Square::D1, Square::D2, Square::D3, Square::D4, Square::D5, Square::D6, Square::D7, Square::D8,
-    Square::E1, Square::E2, Square::E3, Square::E4, Square::E5, Square::E6, Square::E7, Square::E8,
-    Square::F1, Square::F2, Square::F3, Square::F4, Square::F5, Square::F6, Square::F7, Square::F8,
-    Square::G1, Square::G2, Square::G3, Square::G4, Square::G5, Square::G6, Square::G7, Square::G8,
-    Square::H1, Square::H2, Square::H3, Square::H4, Square::H5, Square::H6, Square::H7, Square::H8,
+inline constexpr std::array SQUARES = {
+    Square::A1, Square::B1, Square::C1, Square::D1, Square::E1, Square::F1, Square::G1, Square::H1,
+    Square::A2, Square::B2, Square::C2, Square::D2, Square::E2, Square::F2, Square::G2, Square::H2,
+    Square::A3, Square::B3, Square::C3, Square::D3, Square::E3, Square::F3, Square::G3, Square::H3,
+    Square::A4, Square::B4, Square::C4, Square::D4, Square::E4, Square::F4, Square::G4, Square::H4,
+    Square::A5, Square::B5, Square::C5, Square::D5, Square::E5, Square::F5, Square::G5, Square::H5,
+    Square::A6, Square::B6, Square::C6, Square::D6, Square::E6, Square::F6, Square::G6, Square::H6,
+    Square::A7, Square::B7, Square::C7, Square::D7, Square::E7, Square::F7, Square::G7, Square::H7,
+    Square::A8, Square::B8, Square::C8, Square::D8, Square::E8, Square::F8, Square::G8, Square::H8,
 };
 
 using U64 = unsigned long long;
@@ -138,3 +138,42 @@ constexpr U64 BB_MIDDLE_RANKS = BB_RANK_4 | BB_RANK_5;
 constexpr U64 BB_PAWN_ATTACKS[2][64] = {
     {0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 2ULL, 5ULL, 10ULL, 20ULL, 40ULL, 80ULL, 160ULL, 64ULL, 512ULL, 1280ULL, 2560ULL, 5120ULL, 10240ULL, 20480ULL, 40960ULL, 16384ULL, 131072ULL, 327680ULL, 655360ULL, 1310720ULL, 2621440ULL, 5242880ULL, 10485760ULL, 4194304ULL, 33554432ULL, 83886080ULL, 167772160ULL, 335544320ULL, 671088640ULL, 1342177280ULL, 2684354560ULL, 1073741824ULL, 8589934592ULL, 21474836480ULL, 42949672960ULL, 85899345920ULL, 171798691840ULL, 343597383680ULL, 687194767360ULL, 274877906944ULL, 2199023255552ULL, 5497558138880ULL, 10995116277760ULL, 21990232555520ULL, 43980465111040ULL, 87960930222080ULL, 175921860444160ULL, 70368744177664ULL, 562949953421312ULL, 1407374883553280ULL, 2814749767106560ULL, 5629499534213120ULL, 11258999068426240ULL, 22517998136852480ULL, 45035996273704960ULL, 18014398509481984ULL},
     {512ULL, 1280ULL, 2560ULL, 5120ULL, 10240ULL, 20480ULL, 40960ULL, 16384ULL, 131072ULL, 327680ULL, 655360ULL, 1310720ULL, 2621440ULL, 5242880ULL, 10485760ULL, 4194304ULL, 33554432ULL, 83886080ULL, 167772160ULL, 335544320ULL, 671088640ULL, 1342177280ULL, 2684354560ULL, 1073741824ULL, 8589934592ULL, 21474836480ULL, 42949672960ULL, 85899345920ULL, 171798691840ULL, 343597383680ULL, 687194767360ULL, 274877906944ULL, 2199023255552ULL, 5497558138880ULL, 10995116277760ULL, 21990232555520ULL, 43980465111040ULL, 87960930222080ULL, 175921860444160ULL, 70368744177664ULL, 562949953421312ULL, 1407374883553280ULL, 2814749767106560ULL, 5629499534213120ULL, 11258999068426240ULL, 22517998136852480ULL, 45035996273704960ULL, 18014398509481984ULL, 144115188075855872ULL, 360287970189639680ULL, 720575940379279360ULL, 1441151880758558720ULL, 2882303761517117440ULL, 5764607523034234880ULL, 11529215046068469760ULL, 4611686018427387904ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL}};
+
+// multipliers for the fancy magic slider lookup in "BitboardOps.hpp", one per square.
+// found offline with the usual sparse random search; each one maps every blocker
+// subset of its square's mask to a collision-free index of 64 - popcount(mask) bits.
+constexpr U64 ROOK_MAGICS[64] = {
+    0x0280132180004001ULL, 0x0140001000200040ULL, 0x0880200010000880ULL, 0x2080080005801000ULL,
+    0x0200041020080200ULL, 0x0200041041084200ULL, 0x0400080081124410ULL, 0x2180042100004080ULL,
+    0x8000800099644000ULL, 0x0802003040820100ULL, 0x0105801001862000ULL, 0x0101002008100100ULL,
+    0x1000800400080080ULL, 0x0804800200040080ULL, 0x2001800200800900ULL, 0x00160004088204c1ULL,
+    0x228000c001402000ULL, 0x8510004000200050ULL, 0x3001848020029000ULL, 0x0280808010000801ULL,
+    0x0109010010040800ULL, 0x8000808004000200ULL, 0x8000040081021028ULL, 0x40040a0009004884ULL,
+    0x80c0004280008035ULL, 0x0010004040002000ULL, 0x1101200500410070ULL, 0x8410100080080080ULL,
+    0x000c080080800400ULL, 0x4012008080040002ULL, 0x4000040101000200ULL, 0x0061010200008044ULL,
+    0x0080804010800020ULL, 0x3000201008400040ULL, 0x4112008012002444ULL, 0x0848000880801000ULL,
+    0x00a8008008800400ULL, 0x200200280a00500cULL, 0x080a221024004801ULL, 0xc400008042000104ULL,
+    0x8000400080028022ULL, 0x0220008040018020ULL, 0x4000200011010040ULL, 0x10060040210a0010ULL,
+    0x40820020904a0004ULL, 0x0030040002008080ULL, 0x0200020801840010ULL, 0x0084c04100820004ULL,
+    0x4802010080c2a600ULL, 0x0000400080201880ULL, 0x2040801000200080ULL, 0x0180200842001200ULL,
+    0x0013510008000500ULL, 0x0182000c00808a80ULL, 0x1000524821302400ULL, 0x3800040108488200ULL,
+    0x104a004810210082ULL, 0x0004210010420082ULL, 0xc424110008200241ULL, 0x90101000a0088501ULL,
+    0x0182000420100802ULL, 0x4822001001080402ULL, 0x05d0080090012204ULL, 0x2008140089042846ULL};
+
+constexpr U64 BISHOP_MAGICS[64] = {
+    0x0420220228022c80ULL, 0x200208010c108000ULL, 0x1004010411040040ULL, 0x12a4040292002440ULL,
+    0x0804042082000850ULL, 0x0802020220010440ULL, 0x800401048260201aULL, 0x0041010800828800ULL,
+    0x4040641488080104ULL, 0x20002004016e0020ULL, 0x0c2c223a12420042ULL, 0x0100024081020220ULL,
+    0x0383211041025080ULL, 0x08c0030420160600ULL, 0x0c1000510808c00aULL, 0x40501a0084140280ULL,
+    0x40280040112c0088ULL, 0x4020040908110050ULL, 0x1028001008801412ULL, 0x0104220202020000ULL,
+    0x800a000400940010ULL, 0x0401000200512410ULL, 0x1082012100900408ULL, 0x0101402208440c00ULL,
+    0x00482104c01c1111ULL, 0x0310105008017101ULL, 0x0022010108080020ULL, 0x02300400104010a0ULL,
+    0x1401010011444000ULL, 0x1001020000405020ULL, 0x00010a0804480411ULL, 0x0419220010404400ULL,
+    0x0010020a00200820ULL, 0xa008280909040104ULL, 0x0210209010080020ULL, 0x3006110800040040ULL,
+    0x0800820200440090ULL, 0x0008100421810080ULL, 0x0028060093264800ULL, 0x0a08004088810080ULL,
+    0x3611100290442000ULL, 0x0241081282001001ULL, 0x11081108010d0800ULL, 0x002a102014420800ULL,
+    0x480002600a004500ULL, 0x8001010102000100ULL, 0x2008080810410883ULL, 0x0002080901101022ULL,
+    0x2800942420444080ULL, 0x2000840108024000ULL, 0x0000804844100040ULL, 0x1444120020884540ULL,
+    0x0004001002020c00ULL, 0x041041c801010049ULL, 0x0060045000850810ULL, 0x1003240c14820208ULL,
+    0x3010104a10100800ULL, 0x0280020101580200ULL, 0x1000000101081600ULL, 0x0644009800420200ULL,
+    0x0050040008102402ULL, 0x00000004601c8106ULL, 0x00088530040812a0ULL, 0x800218010102020cULL};
\ No newline at end of file
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <type_traits>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 #include "BitboardNames.hpp"
 #include "scan.hpp"
 
@@ -10,22 +16,18 @@ constexpr auto lsb(Bitboard bb) -> int {
 }
 
 constexpr auto msb(Bitboard bb) -> int {
-    return __builtin_clzll(bb);
+    return 63 - __builtin_clzll(bb);
 }
 
 constexpr auto popcount(Bitboard bb) -> int {
     return __builtin_popcountll(bb);
 }
 
-constexpr auto flip_vertical(Bitboard bb) -> Bitboard {
-    // https://www.chessprogramming.org/Flipping_Mirroring_and_Rotating#FlipVertically
-    bb = ((bb >> 8) & 0x00ff00ff00ff00ff) | ((bb & 0x00ff00ff00ff00ff) << 8);
-    bb = ((bb >> 16) & 0x0000ffff0000ffff) | ((bb & 0x0000ffff0000ffff) << 16);
-    bb = (bb >> 32) | ((bb & 0x00000000ffffffff) << 32);
-    return bb;
-}
-
-constexpr auto flip_horizontal(Bitboard bb) -> Bitboard {
+// the flips are delta swaps, shifts and masks only, so they are written over
+// any bitboard-like type B and BoardBatch can run them on whole vectors of
+// boards. the Bitboard versions below are the ones to pass to transform().
+template <typename B>
+constexpr auto _flip_horizontal(B bb) -> B {
     // https://www.chessprogramming.org/Flipping_Mirroring_and_Rotating#MirrorHorizontally
     bb = ((bb >> 1) & 0x5555555555555555) | ((bb & 0x5555555555555555) << 1);
     bb = ((bb >> 2) & 0x3333333333333333) | ((bb & 0x3333333333333333) << 2);
@@ -33,9 +35,10 @@ constexpr auto flip_horizontal(Bitboard bb) -> Bitboard {
     return bb;
 }
 
-constexpr auto flip_diagonal(Bitboard bb) -> Bitboard {
+template <typename B>
+constexpr auto _flip_diagonal(B bb) -> B {
     /// https://www.chessprogramming.org/Flipping_Mirroring_and_Rotating#FlipabouttheDiagonal
-    Bitboard t = (bb ^ (bb << 28)) & 0x0f0f0f0f00000000;
+    B t = (bb ^ (bb << 28)) & 0x0f0f0f0f00000000;
     bb = bb ^ (t ^ (t >> 28));
     t = (bb ^ (bb << 14)) & 0x3333000033330000;
     bb = bb ^ (t ^ (t >> 14));
@@ -44,9 +47,10 @@ constexpr auto flip_diagonal(Bitboard bb) -> Bitboard {
     return bb;
 }
 
-constexpr auto flip_anti_diagonal(Bitboard bb) -> Bitboard {
+template <typename B>
+constexpr auto _flip_anti_diagonal(B bb) -> B {
     // https://www.chessprogramming.org/Flipping_Mirroring_and_Rotating#FlipabouttheAntidiagonal
-    Bitboard t = bb ^ (bb << 36);
+    B t = bb ^ (bb << 36);
     bb = bb ^ ((t ^ (bb >> 36)) & 0xf0f0f0f00f0f0f0f);
     t = (bb ^ (bb << 18)) & 0xcccc0000cccc0000;
     bb = bb ^ (t ^ (t >> 18));
@@ -55,6 +59,67 @@ constexpr auto flip_anti_diagonal(Bitboard bb) -> Bitboard {
     return bb;
 }
 
+constexpr auto flip_vertical(Bitboard bb) -> Bitboard {
+    // # The ranks are the bytes, so this is one bswap.
+    return __builtin_bswap64(bb);
+}
+
+constexpr auto flip_horizontal(Bitboard bb) -> Bitboard {
+    return _flip_horizontal(bb);
+}
+
+constexpr auto flip_diagonal(Bitboard bb) -> Bitboard {
+    return _flip_diagonal(bb);
+}
+
+constexpr auto flip_anti_diagonal(Bitboard bb) -> Bitboard {
+    return _flip_anti_diagonal(bb);
+}
+
+constexpr auto rotate_180(Bitboard bb) -> Bitboard {
+    return flip_horizontal(flip_vertical(bb));
+}
+
+constexpr auto rotate_clockwise(Bitboard bb) -> Bitboard {
+    // # a1 goes to a8, h1 to a1.
+    return flip_vertical(flip_diagonal(bb));
+}
+
+constexpr auto rotate_anticlockwise(Bitboard bb) -> Bitboard {
+    return flip_diagonal(flip_vertical(bb));
+}
+
+// the eight symmetries of the board, for data augmentation. only IDENTITY and
+// FLIP_HORIZONTAL keep pawns moving along files in the same direction.
+enum class Dihedral {
+    IDENTITY,
+    FLIP_VERTICAL,
+    FLIP_HORIZONTAL,
+    ROTATE_180,
+    FLIP_DIAGONAL,
+    FLIP_ANTI_DIAGONAL,
+    ROTATE_CLOCKWISE,
+    ROTATE_ANTICLOCKWISE,
+};
+
+constexpr std::array<Dihedral, 8> DIHEDRALS = {
+    Dihedral::IDENTITY, Dihedral::FLIP_VERTICAL, Dihedral::FLIP_HORIZONTAL, Dihedral::ROTATE_180,
+    Dihedral::FLIP_DIAGONAL, Dihedral::FLIP_ANTI_DIAGONAL, Dihedral::ROTATE_CLOCKWISE, Dihedral::ROTATE_ANTICLOCKWISE,
+};
+
+constexpr auto dihedral_transform(Dihedral symmetry, Bitboard bb) -> Bitboard {
+    switch (symmetry) {
+        case Dihedral::FLIP_VERTICAL: return flip_vertical(bb);
+        case Dihedral::FLIP_HORIZONTAL: return flip_horizontal(bb);
+        case Dihedral::ROTATE_180: return rotate_180(bb);
+        case Dihedral::FLIP_DIAGONAL: return flip_diagonal(bb);
+        case Dihedral::FLIP_ANTI_DIAGONAL: return flip_anti_diagonal(bb);
+        case Dihedral::ROTATE_CLOCKWISE: return rotate_clockwise(bb);
+        case Dihedral::ROTATE_ANTICLOCKWISE: return rotate_anticlockwise(bb);
+        default: return bb;
+    }
+}
+
 constexpr auto shift_down(Bitboard b) -> Bitboard {
     return b >> 8;
 }
@@ -167,33 +232,190 @@ constexpr auto _edges(Square square) -> Bitboard {
 }
 
 constexpr std::array _DIAG = {-9, -7, 7, 9};
-const auto _DIAG_PAIR = _attack_table(_DIAG);
-const auto BB_DIAG_MASKS = _DIAG_PAIR.first;
-const auto BB_DIAG_ATTACKS = _DIAG_PAIR.second;
-
 constexpr std::array _FILE = {-8, 8};
-const auto _FILE_PAIR = _attack_table(_FILE);
-const auto BB_FILE_MASKS = _FILE_PAIR.first;
-const auto BB_FILE_ATTACKS = _FILE_PAIR.second;
-
 constexpr std::array _RANK = {-1, 1};
-const auto _RANK_PAIR = _attack_table(_RANK);
-const auto BB_RANK_MASKS = _RANK_PAIR.first;
-const auto BB_RANK_ATTACKS = _RANK_PAIR.second;
 
-auto _rays() {
-    std::array<std::array<Bitboard, 64>, 64> rays;
+constexpr auto BB_DIAG_MASKS = cag::make_array<64>([](int sq) {
+    return _sliding_attacks((Square)sq, 0, _DIAG) & ~_edges((Square)sq);
+});
+constexpr auto BB_FILE_MASKS = cag::make_array<64>([](int sq) {
+    return _sliding_attacks((Square)sq, 0, _FILE) & ~_edges((Square)sq);
+});
+constexpr auto BB_RANK_MASKS = cag::make_array<64>([](int sq) {
+    return _sliding_attacks((Square)sq, 0, _RANK) & ~_edges((Square)sq);
+});
+
+// Slider attacks live in one flat table shared by rooks and bishops. Every
+// square owns a slice of 2^popcount(mask) entries, indexed either by
+// pext(occupied, mask) on BMI2 builds or by a fancy magic multiply otherwise.
+// Define CHESS_NO_PEXT to keep magics on CPUs with slow microcoded pext.
+#if defined(__BMI2__) && !defined(CHESS_NO_PEXT)
+#define CHESS_USE_PEXT 1
+#else
+#define CHESS_USE_PEXT 0
+#endif
+
+constexpr auto _pext(Bitboard bb, Bitboard mask) -> Bitboard {
+#if CHESS_USE_PEXT
+    if (!std::is_constant_evaluated())
+        return _pext_u64(bb, mask);
+#endif
+    Bitboard out = 0;
+    for (Bitboard bit = 1; mask; mask &= mask - 1, bit <<= 1) {
+        if (bb & mask & -mask)
+            out |= bit;
+    }
+    return out;
+}
+
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    unsigned offset;
+    unsigned shift;
+
+    constexpr auto index(Bitboard occupied) const -> unsigned {
+#if CHESS_USE_PEXT
+        return offset + (unsigned)_pext(occupied, mask);
+#else
+        return offset + (unsigned)(((occupied & mask) * magic) >> shift);
+#endif
+    }
+};
+
+constexpr auto ROOK_TABLE_SIZE = 102400;
+constexpr auto BISHOP_TABLE_SIZE = 5248;
+
+constexpr auto _slider_masks(int sq) {
+    return std::make_pair(
+        BB_FILE_MASKS[sq] | BB_RANK_MASKS[sq],
+        BB_DIAG_MASKS[sq]);
+}
+
+constexpr auto _magic_offset(int sq, bool rook) -> unsigned {
+    // rook slices come first, then bishop slices.
+    unsigned offset = rook ? 0 : ROOK_TABLE_SIZE;
+    for (int i = 0; i < sq; ++i) {
+        auto [rook_mask, bishop_mask] = _slider_masks(i);
+        offset += 1U << popcount(rook ? rook_mask : bishop_mask);
+    }
+    return offset;
+}
+
+static_assert(_magic_offset(64, true) == ROOK_TABLE_SIZE);
+static_assert(_magic_offset(64, false) == ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE);
+
+constexpr auto ROOK_MAGIC_TABLE = cag::make_array<64>([](int sq) {
+    auto mask = _slider_masks(sq).first;
+    return Magic{mask, ROOK_MAGICS[sq], _magic_offset(sq, true), (unsigned)(64 - popcount(mask))};
+});
+constexpr auto BISHOP_MAGIC_TABLE = cag::make_array<64>([](int sq) {
+    auto mask = _slider_masks(sq).second;
+    return Magic{mask, BISHOP_MAGICS[sq], _magic_offset(sq, false), (unsigned)(64 - popcount(mask))};
+});
+
+// empty-board rays per direction: positive deltas first, then negative ones.
+constexpr std::array _RAY_DELTAS = {8, 1, 9, 7, -8, -1, -9, -7};
+
+constexpr auto BB_DIRECTION_RAYS = cag::make_array<8>([](int dir) {
+    return cag::make_array<64>([dir](int sq) {
+        return _sliding_attacks((Square)sq, BB_EMPTY, std::array{_RAY_DELTAS[dir]});
+    });
+});
+
+struct _SliderTable {
+    // a plain array rather than std::array: see _fill_slider_table().
+    Bitboard attacks[ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE];
+};
+
+constexpr void _fill_slider_table(
+    _SliderTable& table,
+    const std::array<Magic, 64>& magics,
+    std::array<int, 4> dirs) {
+    // this runs ~100k times at compile time and gcc's constexpr op budget
+    // is mostly spent on calls, std::array::operator[] included, so the
+    // rays are copied into plain arrays and the ray walk is kept inline.
+    Bitboard rays[4][64] = {};
+    bool positive[4] = {};
+    for (int i = 0; i < 4; ++i) {
+        positive[i] = _RAY_DELTAS[dirs[i]] > 0;
+        for (int sq = 0; sq < 64; ++sq)
+            rays[i][sq] = BB_DIRECTION_RAYS[dirs[i]][sq];
+    }
+
+    for (int sq = 0; sq < 64; ++sq) {
+        auto [mask, magic, offset, shift] = magics[sq];
+        auto subset = BB_EMPTY;
+        unsigned n = 0;
+        // carry-rippler over every blocker configuration of the mask. it
+        // visits subsets in increasing pext order, so n is the pext index.
+        do {
+            auto attacks = BB_EMPTY;
+            for (int i = 0; i < 4; ++i) {
+                // the ray stops at the first blocker, so cut off the ray behind it.
+                auto ray = rays[i][sq];
+                auto blockers = ray & subset;
+                if (blockers)
+                    ray ^= rays[i][positive[i] ? __builtin_ctzll(blockers) : 63 - __builtin_clzll(blockers)];
+                attacks |= ray;
+            }
+#if CHESS_USE_PEXT
+            auto& slot = table.attacks[offset + n];
+#else
+            auto& slot = table.attacks[offset + ((subset * magic) >> shift)];
+#endif
+            // sliders always attack something, so zero marks a free slot.
+            // a clash makes this throw, which fails constant evaluation.
+            if (slot && slot != attacks)
+                throw "magic collision";
+            slot = attacks;
+            subset = (subset - mask) & mask;
+            ++n;
+        } while (subset);
+    }
+}
+
+constexpr auto _slider_attack_table() {
+    _SliderTable table{};
+    // touch every slot in order first: gcc stores constexpr arrays sparsely,
+    // and scattered first writes into a huge array are quadratic to evaluate.
+    for (int i = 0; i < ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE; ++i)
+        table.attacks[i] = BB_EMPTY;
+    _fill_slider_table(table, ROOK_MAGIC_TABLE, {0, 1, 4, 5});
+    _fill_slider_table(table, BISHOP_MAGIC_TABLE, {2, 3, 6, 7});
+    return table;
+}
+
+constexpr auto BB_SLIDER_ATTACKS = _slider_attack_table();
+
+constexpr auto bishop_attacks(Square square, Bitboard occupied) -> Bitboard {
+    return BB_SLIDER_ATTACKS.attacks[BISHOP_MAGIC_TABLE[square].index(occupied)];
+}
+
+constexpr auto rook_attacks(Square square, Bitboard occupied) -> Bitboard {
+    return BB_SLIDER_ATTACKS.attacks[ROOK_MAGIC_TABLE[square].index(occupied)];
+}
+
+constexpr auto queen_attacks(Square square, Bitboard occupied) -> Bitboard {
+    return bishop_attacks(square, occupied) | rook_attacks(square, occupied);
+}
+
+constexpr auto _rays() {
+    std::array<std::array<Bitboard, 64>, 64> rays{};
     int a = 0;
     for (auto bb_a : BB_SQUARES) {
         auto& rays_row = rays[a];
+        auto diag_a = bishop_attacks((Square)a, BB_EMPTY);
+        auto rank_a = rook_attacks((Square)a, BB_EMPTY) & BB_RANKS[square_rank((Square)a)];
+        auto file_a = rook_attacks((Square)a, BB_EMPTY) & BB_FILES[square_file((Square)a)];
         int b = 0;
         for (auto bb_b : BB_SQUARES) {
-            if (BB_DIAG_ATTACKS[a].at(0) & bb_b) {
-                rays_row[b] = ((BB_DIAG_ATTACKS[a].at(0) & BB_DIAG_ATTACKS[b].at(0)) | bb_a | bb_b);
-            } else if (BB_RANK_ATTACKS[a].at(0) & bb_b) {
-                rays_row[b] = (BB_RANK_ATTACKS[a].at(0) | bb_a);
-            } else if (BB_FILE_ATTACKS[a].at(0) & bb_b) {
-                rays_row[b] = (BB_FILE_ATTACKS[a].at(0) | bb_a);
+            if (diag_a & bb_b) {
+                rays_row[b] = ((diag_a & bishop_attacks((Square)b, BB_EMPTY)) | bb_a | bb_b);
+            } else if (rank_a & bb_b) {
+                rays_row[b] = (rank_a | bb_a);
+            } else if (file_a & bb_b) {
+                rays_row[b] = (file_a | bb_a);
             } else {
                 rays_row[b] = (BB_EMPTY);
             }
@@ -204,13 +426,39 @@ auto _rays() {
     return rays;
 }
 
-const auto BB_RAYS = _rays();
+constexpr auto BB_RAYS = _rays();
+
+constexpr auto _between() {
+    std::array<std::array<Bitboard, 64>, 64> between{};
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            auto bb = BB_RAYS[a][b] & ((BB_ALL << a) ^ (BB_ALL << b));
+            between[a][b] = bb & (bb - 1);
+        }
+    }
+    return between;
+}
+
+constexpr auto BB_BETWEEN = _between();
 
 constexpr auto ray(Square a, Square b) -> Bitboard {
     return BB_RAYS[a][b];
 }
 
 constexpr auto between(Square a, Square b) -> Bitboard {
-    auto bb = BB_RAYS[a][b] & ((BB_ALL << a) ^ (BB_ALL << b));
-    return bb & (bb - 1);
-}
\ No newline at end of file
+    return BB_BETWEEN[a][b];
+}
+
+// Every lookup table in this file is a constant expression, so it is emitted
+// into .rodata and no table code runs before main. These checks only compile
+// if the compiler evaluated the tables itself.
+static_assert(SQUARES[H8] == 63 && BB_SQUARES[E4] == BB_E4);
+static_assert(BB_KNIGHT_ATTACKS[A1] == (BB_B3 | BB_C2));
+static_assert(BB_KING_ATTACKS[H8] == (BB_G8 | BB_G7 | BB_H7));
+// rows follow python-chess: 0 is black, 1 is white.
+static_assert(BB_PAWN_ATTACKS[1][E4] == (BB_D5 | BB_F5) && BB_PAWN_ATTACKS[0][E4] == (BB_D3 | BB_F3));
+static_assert(rook_attacks(A1, BB_A3 | BB_C1) == (BB_A2 | BB_A3 | BB_B1 | BB_C1));
+static_assert(bishop_attacks(C1, BB_E3) == (BB_B2 | BB_A3 | BB_D2 | BB_E3));
+static_assert(queen_attacks(H8, BB_ALL) == (BB_G8 | BB_G7 | BB_H7));
+static_assert(ray(A1, C3) == 0x8040201008040201ULL && ray(A1, B3) == BB_EMPTY);
+static_assert(between(B1, G1) == (BB_C1 | BB_D1 | BB_E1 | BB_F1) && between(A1, B2) == BB_EMPTY);
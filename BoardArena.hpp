@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string>
+
+#include "target.hpp"
+
+// a monotonic arena for the move stacks of short-lived boards, one per
+// worker thread. the first InlineBytes are carved out of the arena itself,
+// past that it takes blocks from *upstream*; nothing is freed until
+// release(), so a worker that plays out a position, drops its boards and
+// releases the arena never touches the global heap at all once warm.
+// boards from an arena must not outlive its next release(), and an arena,
+// like any monotonic_buffer_resource, must only be used by one thread.
+
+namespace Chess {
+
+template <std::size_t InlineBytes = 64 * 1024>
+class BoardArena {
+    alignas(std::max_align_t) std::array<std::byte, InlineBytes> buffer;
+    std::pmr::monotonic_buffer_resource resource;
+
+   public:
+    explicit BoardArena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : resource(buffer.data(), buffer.size(), upstream) {}
+
+    BoardArena(const BoardArena&) = delete;
+    auto operator=(const BoardArena&) -> BoardArena& = delete;
+
+    auto memory_resource() -> std::pmr::memory_resource* {
+        return &resource;
+    }
+
+    auto board(std::optional<std::string> fen = std::string(STARTING_FEN), bool chess960 = false) -> Board {
+        // """Creates a board that allocates from the arena."""
+        return Board(std::move(fen), chess960, &resource);
+    }
+
+    auto copy(const Board& board, bool stack = true) -> Board {
+        // """Copies *board*, and its move stack unless *stack* is false, into the arena."""
+        return board.copy(stack, &resource);
+    }
+
+    void release() {
+        // """
+        // Gives back everything allocated since the last release, keeping
+        // the inline buffer for reuse. Boards from the arena must be gone.
+        // """
+        resource.release();
+    }
+};
+
+}  // namespace Chess
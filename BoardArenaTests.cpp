@@ -0,0 +1,89 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+
+#include "BoardArena.hpp"
+
+// counts calls of the global operator new, to check that arena boards stay
+// off the global heap.
+static std::size_t global_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++global_allocations;
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+class CountingResource : public std::pmr::memory_resource {
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override {
+        return this == &other;
+    }
+
+   public:
+    int allocations = 0;
+};
+
+auto test_resource() {
+    CountingResource counting;
+    auto board = Chess::Board(std::string(Chess::STARTING_FEN), false, &counting);
+    for (auto uci : {"e2e4", "e7e5", "g1f3", "b8c6"})
+        board.push(Chess::Move::from_uci(uci));
+    auto pushed = counting.allocations;
+    auto copy = board.copy();
+    auto root = board.root();
+    auto elsewhere = board.copy(true, std::pmr::new_delete_resource());
+    auto plain = board;
+    return pushed > 0 && counting.allocations > pushed && copy.memory_resource() == &counting &&
+           root.memory_resource() == &counting && elsewhere.memory_resource() == std::pmr::new_delete_resource() &&
+           plain.memory_resource() == std::pmr::get_default_resource() && copy.move_stack == board.move_stack &&
+           copy.zobrist_hash() == board.zobrist_hash() && root.fen() == Chess::Board().fen() &&
+           board.copy(false).move_stack.empty() && board.copy(false).zobrist_hash() == board.zobrist_hash();
+}
+
+auto test_arena() {
+    // # A null upstream throws if the inline buffer ever runs out.
+    Chess::BoardArena<1 << 16> arena(std::pmr::null_memory_resource());
+    auto start = Chess::Board();
+    auto ok = true;
+    for (auto round = 0; round < 100; ++round) {
+        auto before = global_allocations;
+        {
+            auto board = arena.copy(start);
+            for (auto uci : {"d2d4", "d7d5", "c2c4", "e7e6", "b1c3", "g8f6"})
+                board.push(Chess::Move::from_uci(uci));
+            auto copy = arena.copy(board);
+            copy.pop();
+            auto root = copy.root();
+            ok = ok && copy.move_stack.size() == 5 && root.move_stack.empty() && !board.is_check();
+        }
+        ok = ok && global_allocations == before;
+        arena.release();
+    }
+    auto board = arena.board("8/8/8/8/8/8/8/K1k5 w - - 0 1");
+    return ok && board.memory_resource() == arena.memory_resource() && board.king(Chess::WHITE) == A1;
+}
+
+int main() {
+    std::cout << "test_resource: " << (test_resource() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_arena:    " << (test_arena() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
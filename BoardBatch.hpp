@@ -0,0 +1,468 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "target.hpp"
+
+// attack maps, mobility, checkers and pins for many positions at once. the
+// boards are stored as a struct of arrays, one bitboard array per piece type
+// and color, and every kernel runs a handful of boards per instruction.
+//
+// the kernels only shift and mask whole bitboards (kogge-stone fills for the
+// sliders), so they are written once over a lane type: a GCC vector of as
+// many bitboards as the widest enabled vector unit holds, which the compiler
+// lowers to AVX-512, AVX2, SSE2 or NEON, and plain Bitboard for the tail.
+
+namespace Chess {
+
+#if defined(__AVX512F__)
+constexpr std::size_t BATCH_LANES = 8;
+#elif defined(__AVX2__)
+constexpr std::size_t BATCH_LANES = 4;
+#else
+constexpr std::size_t BATCH_LANES = 2;
+#endif
+
+namespace batch {
+
+typedef Bitboard Lanes __attribute__((vector_size(BATCH_LANES * sizeof(Bitboard))));
+typedef unsigned char LaneBytes __attribute__((vector_size(BATCH_LANES * sizeof(Bitboard))));
+
+constexpr Bitboard NOT_FILE_A = ~BB_FILE_A;
+constexpr Bitboard NOT_FILE_H = ~BB_FILE_H;
+constexpr Bitboard NOT_FILE_AB = ~(BB_FILE_A | BB_FILES[1]);
+constexpr Bitboard NOT_FILE_GH = ~(BB_FILES[6] | BB_FILE_H);
+
+template <typename V>
+inline auto broadcast(Bitboard bb) -> V {
+    if constexpr (std::is_same_v<V, Bitboard>)
+        return bb;
+    else
+        return V{} | bb;
+}
+
+// all bits set in every lane whose bitboard is not empty.
+template <typename V>
+inline auto nonzero(V bb) -> V {
+    if constexpr (std::is_same_v<V, Bitboard>)
+        return -(Bitboard)(bb != 0);
+    else
+        return (V)(bb != 0);
+}
+
+template <typename V>
+inline auto popcount_to(V bb, int* out) {
+    if constexpr (std::is_same_v<V, Bitboard>) {
+        out[0] = popcount(bb);
+    } else {
+        for (std::size_t lane = 0; lane < BATCH_LANES; ++lane)
+            out[lane] = popcount(bb[lane]);
+    }
+}
+
+// a one step shift towards a neighbouring square, dropping what wraps
+// around the board edge.
+template <int Shift, Bitboard Wrap, typename V>
+inline auto step(V bb) -> V {
+    if constexpr (Shift > 0)
+        return (bb << Shift) & Wrap;
+    else
+        return (bb >> -Shift) & Wrap;
+}
+
+// # Kogge-Stone: everything *sliders* attack in one direction, through
+// # the *empty* squares and up to the first blocker.
+template <int Shift, Bitboard Wrap, typename V>
+inline auto ray(V sliders, V empty) -> V {
+    auto pro = empty & Wrap;
+    if constexpr (Shift > 0) {
+        sliders |= pro & (sliders << Shift);
+        pro &= pro << Shift;
+        sliders |= pro & (sliders << 2 * Shift);
+        pro &= pro << 2 * Shift;
+        sliders |= pro & (sliders << 4 * Shift);
+    } else {
+        sliders |= pro & (sliders >> -Shift);
+        pro &= pro >> -Shift;
+        sliders |= pro & (sliders >> -2 * Shift);
+        pro &= pro >> -2 * Shift;
+        sliders |= pro & (sliders >> -4 * Shift);
+    }
+    return step<Shift, Wrap>(sliders);
+}
+
+template <typename V>
+inline auto rook_attacks(V rooks, V empty) -> V {
+    return ray<8, BB_ALL>(rooks, empty) | ray<-8, BB_ALL>(rooks, empty) |
+           ray<1, NOT_FILE_A>(rooks, empty) | ray<-1, NOT_FILE_H>(rooks, empty);
+}
+
+template <typename V>
+inline auto bishop_attacks(V bishops, V empty) -> V {
+    return ray<9, NOT_FILE_A>(bishops, empty) | ray<7, NOT_FILE_H>(bishops, empty) |
+           ray<-7, NOT_FILE_A>(bishops, empty) | ray<-9, NOT_FILE_H>(bishops, empty);
+}
+
+template <typename V>
+inline auto pawn_attacks(V pawns, Color color) -> V {
+    if (color == WHITE)
+        return step<9, NOT_FILE_A>(pawns) | step<7, NOT_FILE_H>(pawns);
+    return step<-7, NOT_FILE_A>(pawns) | step<-9, NOT_FILE_H>(pawns);
+}
+
+template <typename V>
+inline auto knight_attacks(V knights) -> V {
+    return step<17, NOT_FILE_A>(knights) | step<15, NOT_FILE_H>(knights) |
+           step<10, NOT_FILE_AB>(knights) | step<6, NOT_FILE_GH>(knights) |
+           step<-15, NOT_FILE_A>(knights) | step<-17, NOT_FILE_H>(knights) |
+           step<-6, NOT_FILE_AB>(knights) | step<-10, NOT_FILE_GH>(knights);
+}
+
+template <typename V>
+inline auto king_attacks(V kings) -> V {
+    return step<8, BB_ALL>(kings) | step<-8, BB_ALL>(kings) |
+           step<1, NOT_FILE_A>(kings) | step<-1, NOT_FILE_H>(kings) |
+           step<9, NOT_FILE_A>(kings) | step<7, NOT_FILE_H>(kings) |
+           step<-7, NOT_FILE_A>(kings) | step<-9, NOT_FILE_H>(kings);
+}
+
+// the friendly pieces on the only square between *king* and an enemy
+// slider in one direction.
+template <int Shift, Bitboard Wrap, typename V>
+inline auto pinned(V king, V empty, V ours, V sliders) -> V {
+    auto blocker = ray<Shift, Wrap>(king, empty) & ours;
+    auto pinner = ray<Shift, Wrap>(blocker, empty) & sliders;
+    return blocker & nonzero(pinner);
+}
+
+// ranks are bytes, so a vertical flip reverses the bytes of every lane: one
+// shuffle, like the bswap it is for a single bitboard.
+template <typename V>
+inline auto flip_vertical(V bb) -> V {
+    if constexpr (std::is_same_v<V, Bitboard>) {
+        return ::flip_vertical(bb);
+    } else {
+        LaneBytes order;
+        for (std::size_t i = 0; i < sizeof(LaneBytes); ++i)
+            order[i] = (unsigned char)((i & ~7) | (7 - (i & 7)));
+        return (V)__builtin_shuffle((LaneBytes)bb, order);
+    }
+}
+
+template <Dihedral Symmetry, typename V>
+inline auto dihedral(V bb) -> V {
+    if constexpr (Symmetry == Dihedral::FLIP_VERTICAL)
+        return flip_vertical<V>(bb);
+    else if constexpr (Symmetry == Dihedral::FLIP_HORIZONTAL)
+        return _flip_horizontal<V>(bb);
+    else if constexpr (Symmetry == Dihedral::ROTATE_180)
+        return _flip_horizontal<V>(flip_vertical<V>(bb));
+    else if constexpr (Symmetry == Dihedral::FLIP_DIAGONAL)
+        return _flip_diagonal<V>(bb);
+    else if constexpr (Symmetry == Dihedral::FLIP_ANTI_DIAGONAL)
+        return _flip_anti_diagonal<V>(bb);
+    else if constexpr (Symmetry == Dihedral::ROTATE_CLOCKWISE)
+        return flip_vertical<V>(_flip_diagonal<V>(bb));
+    else if constexpr (Symmetry == Dihedral::ROTATE_ANTICLOCKWISE)
+        return _flip_diagonal<V>(flip_vertical<V>(bb));
+    else
+        return bb;
+}
+
+}  // namespace batch
+
+class BoardBatch {
+    // """
+    // A struct of arrays holding the pieces of many boards, for computing
+    // features of all of them in bulk. Only the piece placement and the side
+    // to move are kept.
+
+    // The kernels write one result per board, in the order the boards were
+    // added, to *out*, which must have room for
+    // :func:`~chess.BoardBatch.size()` values.
+    // """
+   public:
+    std::vector<Bitboard> pawns;
+    std::vector<Bitboard> knights;
+    std::vector<Bitboard> bishops;
+    std::vector<Bitboard> rooks;
+    std::vector<Bitboard> queens;
+    std::vector<Bitboard> kings;
+    std::array<std::vector<Bitboard>, 2> occupied_co;
+    std::vector<Color> turn;
+
+    BoardBatch() = default;
+
+    explicit BoardBatch(const std::vector<Board>& boards) {
+        reserve(boards.size());
+        for (auto& board : boards)
+            push_back(board);
+    }
+
+    auto size() const -> std::size_t {
+        return pawns.size();
+    }
+
+    void reserve(std::size_t n) {
+        for (auto array : {&pawns, &knights, &bishops, &rooks, &queens, &kings, &occupied_co[WHITE], &occupied_co[BLACK]})
+            array->reserve(n);
+        turn.reserve(n);
+    }
+
+    void clear() {
+        for (auto array : {&pawns, &knights, &bishops, &rooks, &queens, &kings, &occupied_co[WHITE], &occupied_co[BLACK]})
+            array->clear();
+        turn.clear();
+    }
+
+    void push_back(const BaseBoard& board, Color turn) {
+        pawns.push_back(board.pawns);
+        knights.push_back(board.knights);
+        bishops.push_back(board.bishops);
+        rooks.push_back(board.rooks);
+        queens.push_back(board.queens);
+        kings.push_back(board.kings);
+        occupied_co[WHITE].push_back(board.occupied_co[WHITE]);
+        occupied_co[BLACK].push_back(board.occupied_co[BLACK]);
+        this->turn.push_back(turn);
+    }
+
+    void push_back(const Board& board) {
+        push_back(board, board.turn);
+    }
+
+    void pieces(PieceType piece_type, Color color, Bitboard* out) const {
+        // """Gets the pieces of the given type and color on every board."""
+        auto& by_type = _pieces(piece_type);
+        for (std::size_t i = 0; i < size(); ++i)
+            out[i] = by_type[i] & occupied_co[color][i];
+    }
+
+    void attacks(Color color, Bitboard* out) const {
+        // """Gets every square attacked by the given side on every board."""
+        _run([&](auto& lanes, std::size_t i) {
+            using V = std::decay_t<decltype(lanes.pawns)>;
+            _store(out + i, _attacks<V>(lanes, color));
+        });
+    }
+
+    void mobility(Color color, int* out) const {
+        // """
+        // Counts the squares the given side attacks that are not occupied by
+        // its own pieces, on every board.
+        // """
+        _run([&](auto& lanes, std::size_t i) {
+            using V = std::decay_t<decltype(lanes.pawns)>;
+            auto ours = color == WHITE ? lanes.white : lanes.black;
+            batch::popcount_to(_attacks<V>(lanes, color) & ~ours, out + i);
+        });
+    }
+
+    void attackers(Color color, Square square, Bitboard* out) const {
+        // """Gets the pieces of the given side attacking *square* on every board."""
+        _run([&](auto& lanes, std::size_t i) {
+            using V = std::decay_t<decltype(lanes.pawns)>;
+            _store(out + i, _attackers<V>(lanes, color, batch::broadcast<V>(BB_SQUARES[square])));
+        });
+    }
+
+    void checkers(Bitboard* out) const {
+        // """Gets the pieces giving check to the side to move on every board."""
+        _run([&](auto& lanes, std::size_t i) {
+            using V = std::decay_t<decltype(lanes.pawns)>;
+            auto white_to_move = batch::nonzero<V>(lanes.turn);
+            auto white = _attackers<V>(lanes, BLACK, lanes.kings & lanes.white);
+            auto black = _attackers<V>(lanes, WHITE, lanes.kings & lanes.black);
+            _store(out + i, (white & white_to_move) | (black & ~white_to_move));
+        });
+    }
+
+    void pinned(Bitboard* out) const {
+        // """
+        // Gets the pieces of the side to move that are absolutely pinned to
+        // their king, on every board.
+        // """
+        _run([&](auto& lanes, std::size_t i) {
+            using V = std::decay_t<decltype(lanes.pawns)>;
+            auto white_to_move = batch::nonzero<V>(lanes.turn);
+            auto ours = (lanes.white & white_to_move) | (lanes.black & ~white_to_move);
+            auto theirs = (lanes.white | lanes.black) & ~ours;
+            auto king = lanes.kings & ours;
+            auto empty = ~(lanes.white | lanes.black);
+            auto rooks = (lanes.rooks | lanes.queens) & theirs;
+            auto bishops = (lanes.bishops | lanes.queens) & theirs;
+            using namespace batch;
+            _store(out + i,
+                   batch::pinned<8, BB_ALL>(king, empty, ours, rooks) | batch::pinned<-8, BB_ALL>(king, empty, ours, rooks) |
+                   batch::pinned<1, NOT_FILE_A>(king, empty, ours, rooks) | batch::pinned<-1, NOT_FILE_H>(king, empty, ours, rooks) |
+                   batch::pinned<9, NOT_FILE_A>(king, empty, ours, bishops) | batch::pinned<7, NOT_FILE_H>(king, empty, ours, bishops) |
+                   batch::pinned<-7, NOT_FILE_A>(king, empty, ours, bishops) | batch::pinned<-9, NOT_FILE_H>(king, empty, ours, bishops));
+        });
+    }
+
+    void apply_symmetry(Dihedral symmetry) {
+        // """
+        // Maps every board onto one of the eight symmetries of the board.
+        // The side to move is kept.
+        // """
+        _apply_symmetry(symmetry, 0, size());
+    }
+
+    void apply_mirror() {
+        // """
+        // Mirrors every board vertically, swaps the piece colors and passes
+        // the move to the other side, so that each position is equivalent
+        // modulo color.
+        // """
+        _apply_symmetry<Dihedral::FLIP_VERTICAL>(0, size());
+        std::swap(occupied_co[WHITE], occupied_co[BLACK]);
+        for (auto& color : turn)
+            color = (Color)!color;
+    }
+
+    auto symmetries() const -> BoardBatch {
+        // """
+        // Gets every board under each of the eight symmetries, in the order
+        // of :data:`DIHEDRALS`: board *i* under ``DIHEDRALS[k]`` is at
+        // ``k * size() + i``.
+        // """
+        BoardBatch all;
+        all.reserve(8 * size());
+        for (std::size_t k = 0; k < DIHEDRALS.size(); ++k) {
+            all._append(*this);
+            all._apply_symmetry(DIHEDRALS[k], k * size(), (k + 1) * size());
+        }
+        return all;
+    }
+
+   private:
+    template <typename V>
+    struct _Lanes {
+        V pawns, knights, bishops, rooks, queens, kings, white, black, turn;
+    };
+
+    auto _pieces(PieceType piece_type) const -> const std::vector<Bitboard>& {
+        switch (piece_type) {
+            case PieceType::PAWN: return pawns;
+            case PieceType::KNIGHT: return knights;
+            case PieceType::BISHOP: return bishops;
+            case PieceType::ROOK: return rooks;
+            case PieceType::QUEEN: return queens;
+            default: return kings;
+        }
+    }
+
+    template <typename V>
+    static auto _load(const Bitboard* in) -> V {
+        V lanes;
+        std::memcpy(&lanes, in, sizeof(V));
+        return lanes;
+    }
+
+    template <typename V>
+    static void _store(Bitboard* out, V lanes) {
+        std::memcpy(out, &lanes, sizeof(V));
+    }
+
+    template <typename V>
+    auto _gather(std::size_t i) const -> _Lanes<V> {
+        _Lanes<V> lanes;
+        lanes.pawns = _load<V>(&pawns[i]);
+        lanes.knights = _load<V>(&knights[i]);
+        lanes.bishops = _load<V>(&bishops[i]);
+        lanes.rooks = _load<V>(&rooks[i]);
+        lanes.queens = _load<V>(&queens[i]);
+        lanes.kings = _load<V>(&kings[i]);
+        lanes.white = _load<V>(&occupied_co[WHITE][i]);
+        lanes.black = _load<V>(&occupied_co[BLACK][i]);
+        // # Colors are single bytes; widen them to a lane each.
+        if constexpr (std::is_same_v<V, Bitboard>) {
+            lanes.turn = turn[i];
+        } else {
+            for (std::size_t lane = 0; lane < BATCH_LANES; ++lane)
+                lanes.turn[lane] = turn[i + lane];
+        }
+        return lanes;
+    }
+
+    // maps the boards from *begin* to *end* in place.
+    template <Dihedral Symmetry>
+    void _apply_symmetry(std::size_t begin, std::size_t end) {
+        for (auto array : {&pawns, &knights, &bishops, &rooks, &queens, &kings, &occupied_co[WHITE], &occupied_co[BLACK]}) {
+            auto bbs = array->data();
+            auto i = begin;
+            for (; i + BATCH_LANES <= end; i += BATCH_LANES)
+                _store(bbs + i, batch::dihedral<Symmetry>(_load<batch::Lanes>(bbs + i)));
+            for (; i < end; ++i)
+                bbs[i] = batch::dihedral<Symmetry>(bbs[i]);
+        }
+    }
+
+    void _apply_symmetry(Dihedral symmetry, std::size_t begin, std::size_t end) {
+        switch (symmetry) {
+            case Dihedral::FLIP_VERTICAL: _apply_symmetry<Dihedral::FLIP_VERTICAL>(begin, end); break;
+            case Dihedral::FLIP_HORIZONTAL: _apply_symmetry<Dihedral::FLIP_HORIZONTAL>(begin, end); break;
+            case Dihedral::ROTATE_180: _apply_symmetry<Dihedral::ROTATE_180>(begin, end); break;
+            case Dihedral::FLIP_DIAGONAL: _apply_symmetry<Dihedral::FLIP_DIAGONAL>(begin, end); break;
+            case Dihedral::FLIP_ANTI_DIAGONAL: _apply_symmetry<Dihedral::FLIP_ANTI_DIAGONAL>(begin, end); break;
+            case Dihedral::ROTATE_CLOCKWISE: _apply_symmetry<Dihedral::ROTATE_CLOCKWISE>(begin, end); break;
+            case Dihedral::ROTATE_ANTICLOCKWISE: _apply_symmetry<Dihedral::ROTATE_ANTICLOCKWISE>(begin, end); break;
+            default: break;
+        }
+    }
+
+    void _append(const BoardBatch& other) {
+        for (auto [to, from] : {std::pair{&pawns, &other.pawns}, {&knights, &other.knights}, {&bishops, &other.bishops},
+                                {&rooks, &other.rooks}, {&queens, &other.queens}, {&kings, &other.kings},
+                                {&occupied_co[WHITE], &other.occupied_co[WHITE]}, {&occupied_co[BLACK], &other.occupied_co[BLACK]}})
+            to->insert(to->end(), from->begin(), from->end());
+        turn.insert(turn.end(), other.turn.begin(), other.turn.end());
+    }
+
+    // runs *kernel* on whole vectors of boards, then on the rest one by one.
+    template <typename Kernel>
+    void _run(Kernel kernel) const {
+        std::size_t i = 0;
+        for (; i + BATCH_LANES <= size(); i += BATCH_LANES) {
+            auto lanes = _gather<batch::Lanes>(i);
+            kernel(lanes, i);
+        }
+        for (; i < size(); ++i) {
+            auto lanes = _gather<Bitboard>(i);
+            kernel(lanes, i);
+        }
+    }
+
+    template <typename V>
+    static auto _attacks(const _Lanes<V>& lanes, Color color) -> V {
+        auto ours = color == WHITE ? lanes.white : lanes.black;
+        auto empty = ~(lanes.white | lanes.black);
+        return batch::pawn_attacks<V>(lanes.pawns & ours, color) |
+               batch::knight_attacks<V>(lanes.knights & ours) |
+               batch::king_attacks<V>(lanes.kings & ours) |
+               batch::rook_attacks<V>((lanes.rooks | lanes.queens) & ours, empty) |
+               batch::bishop_attacks<V>((lanes.bishops | lanes.queens) & ours, empty);
+    }
+
+    // the pieces of *color* attacking any of the *targets*, by looking from
+    // the targets with each piece's attack pattern.
+    template <typename V>
+    static auto _attackers(const _Lanes<V>& lanes, Color color, V targets) -> V {
+        auto ours = color == WHITE ? lanes.white : lanes.black;
+        auto empty = ~(lanes.white | lanes.black);
+        return ((batch::pawn_attacks<V>(targets, (Color)!color) & lanes.pawns) |
+                (batch::knight_attacks<V>(targets) & lanes.knights) |
+                (batch::king_attacks<V>(targets) & lanes.kings) |
+                (batch::rook_attacks<V>(targets, empty) & (lanes.rooks | lanes.queens)) |
+                (batch::bishop_attacks<V>(targets, empty) & (lanes.bishops | lanes.queens))) &
+               ours;
+    }
+};
+
+}  // namespace Chess
@@ -0,0 +1,140 @@
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "BoardBatch.hpp"
+
+// a few hundred positions from pseudo-random games, plus some with pins
+// and checks on every line. the count is not a multiple of the lane width,
+// so the scalar tail runs too.
+auto make_boards() {
+    std::vector<Chess::Board> boards = {
+        Chess::Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"),
+        Chess::Board("rnb1k2r/ppp2ppp/5n2/3q4/1b1P4/2N5/PP3PPP/R1BQKBNR w KQkq - 3 7"),
+        Chess::Board("k3r3/8/8/1b5b/8/3NRN2/r1B1K1Qq/3r4 w - - 0 1"),
+        Chess::Board("4k3/8/8/8/8/8/3n4/R3K2r w - - 0 1"),
+    };
+    auto board = Chess::Board();
+    std::uint64_t seed = 3;
+    while (boards.size() < 203) {
+        auto moves = board.generate_legal_moves();
+        if (moves.empty() || board.fullmove_number > 60) {
+            board.reset();
+            continue;
+        }
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        board.push(moves[(seed >> 33) % moves.size()]);
+        boards.push_back(board);
+    }
+    return boards;
+}
+
+auto test_attacks() {
+    auto boards = make_boards();
+    auto batch = Chess::BoardBatch(boards);
+    std::vector<Bitboard> attacks(batch.size());
+    std::vector<int> mobility(batch.size());
+    for (auto color : {Chess::WHITE, Chess::BLACK}) {
+        batch.attacks(color, attacks.data());
+        batch.mobility(color, mobility.data());
+        for (std::size_t i = 0; i < boards.size(); ++i) {
+            Bitboard expected = BB_EMPTY;
+            for (auto square : scan_forward(boards[i].occupied_co[color]))
+                expected |= boards[i].attacks_mask(square);
+            if (attacks[i] != expected || mobility[i] != popcount(expected & ~boards[i].occupied_co[color])) {
+                std::cout << boards[i].fen() << " ";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto test_attackers() {
+    auto boards = make_boards();
+    auto batch = Chess::BoardBatch(boards);
+    std::vector<Bitboard> attackers(batch.size());
+    for (auto color : {Chess::WHITE, Chess::BLACK}) {
+        for (auto square : {A1, E4, D5, H8, F7}) {
+            batch.attackers(color, square, attackers.data());
+            for (std::size_t i = 0; i < boards.size(); ++i) {
+                if (attackers[i] != boards[i].attackers_mask(color, square))
+                    return false;
+            }
+        }
+    }
+    std::vector<Bitboard> knights(batch.size());
+    batch.pieces(Chess::PieceType::KNIGHT, Chess::BLACK, knights.data());
+    for (std::size_t i = 0; i < boards.size(); ++i) {
+        if (knights[i] != boards[i].pieces_mask(Chess::PieceType::KNIGHT, Chess::BLACK))
+            return false;
+    }
+    return true;
+}
+
+auto test_checkers_and_pins() {
+    auto boards = make_boards();
+    auto batch = Chess::BoardBatch(boards);
+    std::vector<Bitboard> checkers(batch.size());
+    std::vector<Bitboard> pinned(batch.size());
+    batch.checkers(checkers.data());
+    batch.pinned(pinned.data());
+    auto any_pin = false;
+    for (std::size_t i = 0; i < boards.size(); ++i) {
+        auto& board = boards[i];
+        Bitboard expected = BB_EMPTY;
+        for (auto square : scan_forward(board.occupied_co[board.turn] & ~board.kings)) {
+            if (board.is_pinned(board.turn, square))
+                expected |= BB_SQUARES[square];
+        }
+        if (checkers[i] != board.checkers_mask() || pinned[i] != expected) {
+            std::cout << board.fen() << " ";
+            return false;
+        }
+        any_pin |= expected != BB_EMPTY;
+    }
+    // # The third board pins five pieces, on every kind of line.
+    return any_pin && popcount(pinned[2]) == 5;
+}
+
+auto test_symmetries() {
+    auto boards = make_boards();
+    auto batch = Chess::BoardBatch(boards);
+    auto all = batch.symmetries();
+    auto n = boards.size();
+    if (all.size() != 8 * n)
+        return false;
+    for (std::size_t k = 0; k < 8; ++k) {
+        auto symmetry = DIHEDRALS[k];
+        for (std::size_t i = 0; i < n; ++i) {
+            auto& board = boards[i];
+            auto j = k * n + i;
+            auto f = [=](Bitboard bb) { return dihedral_transform(symmetry, bb); };
+            if (all.pawns[j] != f(board.pawns) || all.knights[j] != f(board.knights) ||
+                all.bishops[j] != f(board.bishops) || all.rooks[j] != f(board.rooks) ||
+                all.queens[j] != f(board.queens) || all.kings[j] != f(board.kings) ||
+                all.occupied_co[Chess::WHITE][j] != f(board.occupied_co[Chess::WHITE]) ||
+                all.occupied_co[Chess::BLACK][j] != f(board.occupied_co[Chess::BLACK]) || all.turn[j] != board.turn) {
+                std::cout << board.fen() << " " << k << " ";
+                return false;
+            }
+        }
+    }
+    batch.apply_mirror();
+    for (std::size_t i = 0; i < n; ++i) {
+        auto mirrored = boards[i].mirror();
+        if (batch.pawns[i] != mirrored.pawns || batch.kings[i] != mirrored.kings ||
+            batch.occupied_co[Chess::WHITE][i] != mirrored.occupied_co[Chess::WHITE] ||
+            batch.occupied_co[Chess::BLACK][i] != mirrored.occupied_co[Chess::BLACK] || batch.turn[i] == boards[i].turn)
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "test_attacks:           " << (test_attacks() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_attackers:         " << (test_attackers() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_checkers_and_pins: " << (test_checkers_and_pins() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_symmetries:        " << (test_symmetries() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
@@ -0,0 +1,755 @@
+#pragma once
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "target.hpp"
+
+extern char** environ;
+
+// a port of the analysis side of chess.engine for UCI engines. an
+// EnginePool starts a number of engine processes and drives all of them
+// from one epoll loop on the calling thread. an engine is handed the next
+// queued position the moment it prints its bestmove, so the only round trip
+// per position is the one the protocol needs, and no engine sits idle while
+// there is work. info lines are parsed as they arrive and streamed to a
+// callback.
+//
+// each engine talks over a socketpair rather than two pipes: one
+// non-blocking descriptor per engine, and writes can ask not to raise
+// SIGPIPE when the engine has died.
+
+namespace Chess::engine {
+
+struct EngineError : std::runtime_error {
+    // """Runtime error caused by a misbehaving engine or incorrect usage."""
+    using std::runtime_error::runtime_error;
+};
+
+struct EngineTerminatedError : EngineError {
+    // """The engine process exited unexpectedly."""
+    using EngineError::EngineError;
+};
+
+struct Limit {
+    // """Search-termination condition. At least one field must be set."""
+
+    std::optional<double> time = std::nullopt;
+    // """Search exactly *time* seconds."""
+
+    std::optional<int> depth = std::nullopt;
+    // """Search *depth* ply only."""
+
+    std::optional<long long> nodes = std::nullopt;
+    // """Search only a limited number of *nodes*."""
+
+    std::optional<int> mate = std::nullopt;
+    // """Search for a mate in *mate* moves."""
+};
+
+struct Score {
+    // """
+    // A score from the point of view of one side: either *cp* centipawns,
+    // or a mate in *mate* moves, negative if that side is getting mated.
+    // """
+    std::optional<int> cp;
+    std::optional<int> mate;
+
+    auto is_mate() const -> bool {
+        // """Tests if this is a mate score."""
+        return mate.has_value();
+    }
+
+    auto score(std::optional<int> mate_score = std::nullopt) const -> std::optional<int> {
+        // """
+        // Returns the centipawn score as an integer or ``std::nullopt``.
+
+        // Mate scores are converted to *mate_score* minus the number of
+        // moves to mate, if given.
+        // """
+        if (cp || !mate_score)
+            return cp;
+        return *mate > 0 ? *mate_score - *mate : -*mate_score - *mate;
+    }
+
+    auto operator-() const -> Score {
+        return cp ? Score{-*cp, std::nullopt} : Score{std::nullopt, -*mate};
+    }
+
+    auto operator==(const Score&) const -> bool = default;
+};
+
+struct PovScore {
+    // """A relative :class:`Score` and the point of view."""
+
+    Score relative;
+    // """The relative :class:`Score`."""
+
+    Color turn;
+    // """The point of view (``WHITE`` or ``BLACK``)."""
+
+    auto pov(Color color) const -> Score {
+        // """Gets the score from the point of view of the given *color*."""
+        return color == turn ? relative : -relative;
+    }
+
+    auto white() const -> Score {
+        // """Gets the score from White's point of view."""
+        return pov(WHITE);
+    }
+
+    auto black() const -> Score {
+        // """Gets the score from Black's point of view."""
+        return pov(BLACK);
+    }
+};
+
+struct Info {
+    // """
+    // The fields of an ``info`` line. Fields the engine did not send are
+    // empty. Moves in :data:`pv` that are not legal end it.
+    // """
+    std::optional<PovScore> score;
+    bool lowerbound = false;
+    bool upperbound = false;
+    std::vector<Move> pv;
+    std::optional<int> depth;
+    std::optional<int> seldepth;
+    std::optional<int> multipv;
+    std::optional<double> time;
+    std::optional<long long> nodes;
+    std::optional<long long> nps;
+    std::optional<long long> tbhits;
+    std::optional<int> hashfull;
+    std::optional<Move> currmove;
+    std::optional<int> currmovenumber;
+    std::optional<std::string> string;
+
+    void update(const Info& other) {
+        // """Takes over every field set in *other*."""
+        if (other.score) {
+            score = other.score;
+            lowerbound = other.lowerbound;
+            upperbound = other.upperbound;
+        }
+        if (!other.pv.empty())
+            pv = other.pv;
+        for (auto [to, from] : {std::pair{&depth, &other.depth}, {&seldepth, &other.seldepth}, {&multipv, &other.multipv},
+                                {&hashfull, &other.hashfull}, {&currmovenumber, &other.currmovenumber}}) {
+            if (*from)
+                *to = *from;
+        }
+        for (auto [to, from] : {std::pair{&nodes, &other.nodes}, {&nps, &other.nps}, {&tbhits, &other.tbhits}}) {
+            if (*from)
+                *to = *from;
+        }
+        if (other.time)
+            time = other.time;
+        if (other.currmove)
+            currmove = other.currmove;
+        if (other.string)
+            string = other.string;
+    }
+};
+
+struct AnalysisResult {
+    // """The outcome of one analysis."""
+
+    Move move = Move::null();
+    // """The best move, or a null move if the engine had none."""
+
+    std::optional<Move> ponder;
+    // """The response that the engine expects after :data:`move`."""
+
+    std::vector<Info> info;
+    // """
+    // The latest fields of every principal variation, the first at index 0.
+    // """
+};
+
+inline auto _split(std::string_view line) -> std::vector<std::string_view> {
+    std::vector<std::string_view> tokens;
+    std::size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && std::isspace((unsigned char)line[i]))
+            ++i;
+        auto start = i;
+        while (i < line.size() && !std::isspace((unsigned char)line[i]))
+            ++i;
+        if (i > start)
+            tokens.push_back(line.substr(start, i - start));
+    }
+    return tokens;
+}
+
+template <typename T>
+inline auto _parse_number(std::string_view token) -> std::optional<T> {
+    T value{};
+    auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (error != std::errc() || end != token.data() + token.size())
+        return std::nullopt;
+    return value;
+}
+
+inline auto _parse_move(Board& board, std::string_view token) -> std::optional<Move> {
+    // # Castling comes as the king taking its rook only in chess960.
+    auto move = Move::null();
+    try {
+        move = Move::from_uci(std::string(token));
+    } catch (const std::invalid_argument&) {
+        return std::nullopt;
+    }
+    if (!move.__bool__() || move.drop || move.from_square >= 64 || move.to_square >= 64 ||
+        (move.promotion && (*move.promotion < PieceType::KNIGHT || *move.promotion > PieceType::QUEEN)))
+        return std::nullopt;
+    move = board._to_chess960(move);
+    move = board._from_chess960(board.chess960, move.from_square, move.to_square, move.promotion, move.drop);
+    if (!board.is_legal(move))
+        return std::nullopt;
+    return move;
+}
+
+constexpr std::array<std::string_view, 17> _INFO_KEYS = {
+    "depth", "seldepth", "time", "nodes", "pv", "multipv", "score", "currmove", "currmovenumber",
+    "hashfull", "nps", "tbhits", "cpuload", "refutation", "currline", "ebf", "string",
+};
+
+inline auto _parse_info(std::string_view line, Board& board) -> Info {
+    // """
+    // Parses an ``info`` line sent in the position of *board*. Unknown and
+    // malformed fields are skipped.
+    // """
+    Info info;
+    auto tokens = _split(line);
+    std::size_t i = tokens.size() && tokens[0] == "info" ? 1 : 0;
+    auto next = [&]() -> std::string_view { return i < tokens.size() ? tokens[i++] : std::string_view(); };
+    while (i < tokens.size()) {
+        auto key = tokens[i++];
+        if (key == "string") {
+            // # The rest of the line.
+            auto start = i < tokens.size() ? (std::size_t)(tokens[i].data() - line.data()) : line.size();
+            info.string = std::string(line.substr(start));
+            break;
+        } else if (key == "depth") {
+            info.depth = _parse_number<int>(next());
+        } else if (key == "seldepth") {
+            info.seldepth = _parse_number<int>(next());
+        } else if (key == "multipv") {
+            info.multipv = _parse_number<int>(next());
+        } else if (key == "hashfull") {
+            info.hashfull = _parse_number<int>(next());
+        } else if (key == "currmovenumber") {
+            info.currmovenumber = _parse_number<int>(next());
+        } else if (key == "nodes") {
+            info.nodes = _parse_number<long long>(next());
+        } else if (key == "nps") {
+            info.nps = _parse_number<long long>(next());
+        } else if (key == "tbhits") {
+            info.tbhits = _parse_number<long long>(next());
+        } else if (key == "time") {
+            if (auto ms = _parse_number<long long>(next()))
+                info.time = *ms / 1000.0;
+        } else if (key == "currmove") {
+            info.currmove = _parse_move(board, next());
+        } else if (key == "score") {
+            auto kind = next();
+            auto value = _parse_number<int>(next());
+            if (value && (kind == "cp" || kind == "mate"))
+                info.score = PovScore{kind == "cp" ? Score{value, std::nullopt} : Score{std::nullopt, value}, board.turn};
+            for (; i < tokens.size() && (tokens[i] == "lowerbound" || tokens[i] == "upperbound"); ++i)
+                (tokens[i] == "lowerbound" ? info.lowerbound : info.upperbound) = true;
+        } else if (key == "pv") {
+            // # Moves are played out to parse the next one, then taken back.
+            for (; i < tokens.size(); ++i) {
+                auto move = _parse_move(board, tokens[i]);
+                if (!move)
+                    break;
+                info.pv.push_back(*move);
+                board.push(*move);
+            }
+            for (std::size_t k = 0; k < info.pv.size(); ++k)
+                board.pop();
+            // # An illegal move ends the line, and what follows it up to the
+            // # next field is not a move either.
+            while (i < tokens.size() && std::find(_INFO_KEYS.begin(), _INFO_KEYS.end(), tokens[i]) == _INFO_KEYS.end())
+                ++i;
+        }
+    }
+    return info;
+}
+
+class EnginePool {
+    // """
+    // A pool of UCI engine processes that analyses queued positions.
+
+    // Not thread-safe: everything runs on the thread that calls
+    // :func:`~chess.engine.EnginePool.run()`.
+    // """
+   public:
+    using InfoCallback = std::function<void(std::size_t job, const Info& info)>;
+
+   private:
+    enum class State { UCI, READY, IDLE, THINKING };
+
+    struct _Engine {
+        pid_t pid = -1;
+        int fd = -1;
+        State state = State::UCI;
+        // what has been read but is not yet a whole line, and what is still
+        // to be written.
+        std::string in;
+        std::string out;
+        bool writing = false;
+        std::optional<std::size_t> job;
+        std::string name;
+        std::set<std::string> options;
+        int multipv = 1;
+        bool chess960 = false;
+    };
+
+    struct _Job {
+        Board board;
+        std::string command;
+        int multipv;
+        AnalysisResult result;
+    };
+
+    std::vector<_Engine> engines;
+    std::vector<_Job> jobs;
+    std::deque<std::size_t> queue;
+    std::size_t running = 0;
+    std::map<std::string, std::string> config;
+    int epoll_fd = -1;
+    bool terminated = false;
+
+    static auto _lower(std::string s) -> std::string {
+        for (auto& c : s)
+            c = (char)std::tolower((unsigned char)c);
+        return s;
+    }
+
+    static auto _reap(pid_t pid, std::chrono::milliseconds grace) -> int {
+        // # Gives the process *grace* to exit, then kills it.
+        int status = 0;
+        auto deadline = std::chrono::steady_clock::now() + grace;
+        while (waitpid(pid, &status, WNOHANG) == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return WIFEXITED(status) ? WEXITSTATUS(status) : WIFSIGNALED(status) ? -WTERMSIG(status) : 0;
+    }
+
+    void _spawn(const std::vector<std::string>& command) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+            throw std::runtime_error("cannot create engine socket: "s + std::strerror(errno));
+        // # The child gets its end as stdin and stdout, which also clears
+        // # close-on-exec on the copies.
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+        std::vector<char*> argv;
+        for (auto& arg : command)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        pid_t pid;
+        auto error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(fds[1]);
+        if (error) {
+            close(fds[0]);
+            throw std::runtime_error("cannot start engine " + command[0] + ": " + std::strerror(error));
+        }
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        auto& engine = engines.emplace_back();
+        engine.pid = pid;
+        engine.fd = fds[0];
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = engines.size() - 1;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, engine.fd, &event);
+    }
+
+    [[noreturn]] void _terminated(std::size_t i) {
+        auto& engine = engines[i];
+        close(engine.fd);
+        engine.fd = -1;
+        auto code = _reap(engine.pid, std::chrono::milliseconds(1000));
+        engine.pid = -1;
+        terminated = true;
+        throw EngineTerminatedError("engine process died unexpectedly (exit code: " + std::to_string(code) + ")");
+    }
+
+    void _send(std::size_t i, const std::string& text) {
+        engines[i].out += text;
+        _flush(i);
+    }
+
+    void _flush(std::size_t i) {
+        auto& engine = engines[i];
+        std::size_t sent = 0;
+        while (sent < engine.out.size()) {
+            auto n = send(engine.fd, engine.out.data() + sent, engine.out.size() - sent, MSG_NOSIGNAL);
+            if (n >= 0)
+                sent += n;
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            else if (errno != EINTR)
+                _terminated(i);
+        }
+        engine.out.erase(0, sent);
+        // # Only wait for the socket to drain while something is left.
+        if (engine.writing != !engine.out.empty()) {
+            engine.writing = !engine.out.empty();
+            epoll_event event{};
+            event.events = EPOLLIN | (engine.writing ? (std::uint32_t)EPOLLOUT : 0);
+            event.data.u64 = i;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, engine.fd, &event);
+        }
+    }
+
+    void _read(std::size_t i, const InfoCallback& on_info) {
+        auto& engine = engines[i];
+        char buffer[1 << 16];
+        while (true) {
+            auto n = read(engine.fd, buffer, sizeof(buffer));
+            if (n > 0)
+                engine.in.append(buffer, n);
+            else if (n == 0)
+                _terminated(i);
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            else if (errno != EINTR)
+                _terminated(i);
+        }
+        // # Lines are taken off the buffer as they are handled, so that a
+        // # throwing callback does not see them again.
+        std::size_t start = 0;
+        try {
+            for (auto end = engine.in.find('\n'); end != std::string::npos; end = engine.in.find('\n', start)) {
+                auto line = std::string(engine.in, start, end - start);
+                start = end + 1;
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                _line(i, line, on_info);
+            }
+        } catch (...) {
+            engine.in.erase(0, start);
+            throw;
+        }
+        engine.in.erase(0, start);
+    }
+
+    void _line(std::size_t i, std::string_view line, const InfoCallback& on_info) {
+        auto& engine = engines[i];
+        auto tokens = _split(line);
+        if (tokens.empty())
+            return;
+        auto command = tokens[0];
+        if (engine.state == State::UCI) {
+            if (command == "id" && tokens.size() > 2 && tokens[1] == "name") {
+                engine.name = std::string(line.substr(tokens[2].data() - line.data()));
+            } else if (command == "option" && tokens.size() > 2 && tokens[1] == "name") {
+                // # Option names may have spaces, up to the type.
+                std::string name;
+                for (std::size_t k = 2; k < tokens.size() && tokens[k] != "type"; ++k)
+                    name += (name.empty() ? "" : " ") + std::string(tokens[k]);
+                engine.options.insert(_lower(name));
+            } else if (command == "uciok") {
+                std::string setup;
+                for (auto& [name, value] : config) {
+                    if (!engine.options.count(_lower(name)))
+                        throw EngineError("engine does not support option " + name);
+                    setup += "setoption name " + name + " value " + value + "\n";
+                }
+                engine.state = State::READY;
+                _send(i, setup + "isready\n");
+            }
+        } else if (engine.state == State::READY) {
+            if (command == "readyok") {
+                engine.state = State::IDLE;
+                _dispatch(i);
+            }
+        } else if (engine.state == State::THINKING) {
+            auto id = *engine.job;
+            auto& job = jobs[id];
+            if (command == "info") {
+                auto info = _parse_info(line, job.board);
+                auto multipv = info.multipv.value_or(1);
+                if (1 <= multipv && multipv <= 256) {
+                    if (job.result.info.size() < (std::size_t)multipv)
+                        job.result.info.resize(multipv);
+                    job.result.info[multipv - 1].update(info);
+                }
+                if (on_info)
+                    on_info(id, info);
+            } else if (command == "bestmove") {
+                auto best = tokens.size() > 1 ? tokens[1] : std::string_view("(none)");
+                if (best != "(none)" && best != "0000") {
+                    auto move = _parse_move(job.board, best);
+                    if (!move)
+                        throw EngineError("illegal bestmove " + std::string(best) + " in " + job.board.fen());
+                    job.result.move = *move;
+                    if (tokens.size() > 3 && tokens[2] == "ponder") {
+                        job.board.push(*move);
+                        job.result.ponder = _parse_move(job.board, tokens[3]);
+                        job.board.pop();
+                    }
+                }
+                --running;
+                engine.job.reset();
+                engine.state = State::IDLE;
+                _dispatch(i);
+            }
+        }
+    }
+
+    void _dispatch(std::size_t i) {
+        // """Starts the next queued analysis on engine *i*, if it is idle."""
+        auto& engine = engines[i];
+        if (engine.state != State::IDLE || queue.empty())
+            return;
+        auto id = queue.front();
+        queue.pop_front();
+        auto& job = jobs[id];
+        std::string text;
+        if (job.multipv != engine.multipv)
+            text += "setoption name MultiPV value " + std::to_string(job.multipv) + "\n";
+        if (job.board.chess960 != engine.chess960)
+            text += "setoption name UCI_Chess960 value "s + (job.board.chess960 ? "true" : "false") + "\n";
+        engine.multipv = job.multipv;
+        engine.chess960 = job.board.chess960;
+        engine.job = id;
+        engine.state = State::THINKING;
+        _send(i, text + job.command);
+    }
+
+    void _poll(const InfoCallback& on_info) {
+        epoll_event events[64];
+        auto n = epoll_wait(epoll_fd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                return;
+            throw std::runtime_error("cannot wait for engines: "s + std::strerror(errno));
+        }
+        for (auto k = 0; k < n; ++k) {
+            auto i = (std::size_t)events[k].data.u64;
+            if (events[k].events & EPOLLOUT)
+                _flush(i);
+            if (events[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                _read(i, on_info);
+        }
+    }
+
+    void _check() const {
+        if (terminated)
+            throw EngineTerminatedError("an engine of the pool has terminated");
+    }
+
+    void _shutdown() {
+        for (auto& engine : engines) {
+            if (engine.fd >= 0) {
+                send(engine.fd, "quit\n", 5, MSG_NOSIGNAL | MSG_DONTWAIT);
+                close(engine.fd);
+                engine.fd = -1;
+            }
+        }
+        for (auto& engine : engines) {
+            if (engine.pid > 0)
+                _reap(engine.pid, std::chrono::milliseconds(1000));
+            engine.pid = -1;
+        }
+        if (epoll_fd >= 0)
+            close(epoll_fd);
+        epoll_fd = -1;
+    }
+
+   public:
+    explicit EnginePool(const std::vector<std::string>& command, std::size_t processes = 1,
+                        const std::map<std::string, std::string>& options = {})
+        : config(options) {
+        // """
+        // Starts *processes* copies of the engine *command* and waits until
+        // each has set its *options* and is ready.
+
+        // :raises: :exc:`std::runtime_error` if the engine cannot be started,
+        //     :exc:`~chess.engine.EngineError` if it does not support one of
+        //     the *options*.
+        // """
+        if (command.empty() || processes == 0)
+            throw std::invalid_argument("an engine pool needs a command and at least one process");
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            throw std::runtime_error("cannot create epoll instance: "s + std::strerror(errno));
+        try {
+            engines.reserve(processes);
+            for (std::size_t i = 0; i < processes; ++i)
+                _spawn(command);
+            for (std::size_t i = 0; i < processes; ++i)
+                _send(i, "uci\n");
+            auto ready = [&] {
+                for (auto& engine : engines) {
+                    if (engine.state != State::IDLE)
+                        return false;
+                }
+                return true;
+            };
+            while (!ready())
+                _poll(nullptr);
+        } catch (...) {
+            _shutdown();
+            throw;
+        }
+    }
+
+    EnginePool(const EnginePool&) = delete;
+    auto operator=(const EnginePool&) -> EnginePool& = delete;
+
+    ~EnginePool() {
+        _shutdown();
+    }
+
+    auto size() const -> std::size_t {
+        // """Gets the number of engine processes."""
+        return engines.size();
+    }
+
+    auto name() const -> const std::string& {
+        // """Gets the name the engine gave in ``id name``."""
+        return engines[0].name;
+    }
+
+    auto submit(const Board& board, const Limit& limit, int multipv = 1) -> std::size_t {
+        // """
+        // Queues an analysis of *board*, starting it at once if an engine
+        // is idle. The moves of *board* are sent along with its root
+        // position, so the engine can see repetitions.
+
+        // Returns the index of the result in
+        // :func:`~chess.engine.EnginePool.take_results()`.
+
+        // :raises: :exc:`std::invalid_argument` if *limit* is empty or
+        //     *multipv* is not positive.
+        // """
+        _check();
+        if (!limit.time && !limit.depth && !limit.nodes && !limit.mate)
+            throw std::invalid_argument("an analysis needs a limit");
+        if (multipv < 1)
+            throw std::invalid_argument("multipv must be positive: " + std::to_string(multipv));
+
+        auto root = board.copy().root();
+        auto fen = root.fen(board.chess960);
+        auto command = !board.chess960 && fen == STARTING_FEN ? "position startpos"s : "position fen " + fen;
+        if (!board.move_stack.empty()) {
+            command += " moves";
+            for (auto move : board.move_stack)
+                command += " " + move.uci();
+        }
+        command += "\ngo";
+        if (limit.time)
+            command += " movetime " + std::to_string((long long)(*limit.time * 1000));
+        if (limit.depth)
+            command += " depth " + std::to_string(*limit.depth);
+        if (limit.nodes)
+            command += " nodes " + std::to_string(*limit.nodes);
+        if (limit.mate)
+            command += " mate " + std::to_string(*limit.mate);
+        command += "\n";
+
+        // # Parsing info lines plays moves on the board, which does not need
+        // # its history.
+        jobs.push_back(_Job{board.copy(false), std::move(command), multipv, {}});
+        queue.push_back(jobs.size() - 1);
+        ++running;
+        for (std::size_t i = 0; i < engines.size() && !queue.empty(); ++i)
+            _dispatch(i);
+        return jobs.size() - 1;
+    }
+
+    void run(const InfoCallback& on_info = nullptr) {
+        // """
+        // Runs the engines until every submitted analysis is done, calling
+        // *on_info* with the index of the analysis for each info line.
+
+        // :raises: :exc:`~chess.engine.EngineTerminatedError` if an engine
+        //     dies, after which the pool cannot be used any more.
+        // """
+        _check();
+        while (running)
+            _poll(on_info);
+    }
+
+    auto take_results() -> std::vector<AnalysisResult> {
+        // """
+        // Gets the results of every analysis submitted since the last call,
+        // in the order they were submitted.
+        // """
+        if (running)
+            throw EngineError("cannot take results while analyses are running");
+        std::vector<AnalysisResult> results;
+        results.reserve(jobs.size());
+        for (auto& job : jobs)
+            results.push_back(std::move(job.result));
+        jobs.clear();
+        return results;
+    }
+
+    auto analyse_many(const std::vector<Board>& boards, const Limit& limit, int multipv = 1,
+                      const InfoCallback& on_info = nullptr) -> std::vector<AnalysisResult> {
+        // """
+        // Analyses all of *boards* across the pool, returning the results in
+        // the same order. Earlier submissions run too, and their results are
+        // left for :func:`~chess.engine.EnginePool.take_results()`.
+        // """
+        auto first = jobs.size();
+        for (auto& board : boards)
+            submit(board, limit, multipv);
+        run([&](std::size_t job, const Info& info) {
+            if (on_info && job >= first)
+                on_info(job - first, info);
+        });
+        std::vector<AnalysisResult> results;
+        results.reserve(boards.size());
+        for (auto job = first; job < jobs.size(); ++job)
+            results.push_back(std::move(jobs[job].result));
+        jobs.erase(jobs.begin() + first, jobs.end());
+        return results;
+    }
+
+    auto analyse(const Board& board, const Limit& limit, int multipv = 1) -> AnalysisResult {
+        // """Analyses one position and waits for the result."""
+        return std::move(analyse_many({board}, limit, multipv).front());
+    }
+};
+
+}  // namespace Chess::engine
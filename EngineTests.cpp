@@ -0,0 +1,184 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Engine.hpp"
+
+// the engine is a shell script that speaks just enough UCI: it works out the
+// side to move from the position command, and answers e2e4 for white and e7e5
+// for black.
+
+const std::string FAKE_ENGINE = R"(
+multipv=1
+while read -r line; do
+    case "$line" in
+        uci)
+            echo "id name Fake Engine 1.0"
+            echo "option name Hash type spin default 16 min 1 max 64"
+            echo "option name MultiPV type spin default 1 min 1 max 8"
+            echo "option name Skill Level type spin default 20 min 0 max 20"
+            echo "uciok" ;;
+        isready)
+            echo "readyok" ;;
+        "setoption name MultiPV value "*)
+            multipv=${line##* } ;;
+        position*)
+            set -- $line
+            if [ "$2" = fen ]; then turn=$4; else turn=w; fi
+            seen=0
+            for word in "$@"; do
+                if [ $seen = 1 ]; then
+                    if [ $turn = w ]; then turn=b; else turn=w; fi
+                fi
+                if [ "$word" = moves ]; then seen=1; fi
+            done ;;
+        go*)
+            if [ $turn = w ]; then
+                echo "info depth 1 currmove e2e4 currmovenumber 1"
+                echo "info depth 1 seldepth 3 multipv 1 score cp 31 nodes 40 nps 2000 time 20 pv e2e4 e7e5"
+                if [ $multipv = 2 ]; then echo "info depth 1 multipv 2 score cp 12 pv d2d4"; fi
+                echo "info string thinking about e2e4"
+                echo "bestmove e2e4 ponder e7e5"
+            else
+                echo "info depth 2 score mate -3 lowerbound pv e7e5"
+                echo "bestmove e7e5"
+            fi ;;
+        quit)
+            exit 0 ;;
+    esac
+done
+)";
+
+auto make_directory() -> std::string {
+    char path[] = "/tmp/engine_tests_XXXXXX";
+    return mkdtemp(path);
+}
+
+auto write_script(const std::string& directory, const std::string& name, const std::string& script) {
+    auto file = std::fopen((directory + "/" + name).c_str(), "w");
+    std::fputs(script.c_str(), file);
+    std::fclose(file);
+    return std::vector<std::string>{"sh", directory + "/" + name};
+}
+
+auto remove_scripts(const std::string& directory) {
+    for (auto name : {"fake.sh", "dies.sh"})
+        std::remove((directory + "/" + name).c_str());
+    std::remove(directory.c_str());
+}
+
+auto test_parse_info() {
+    auto board = Chess::Board("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    auto fen = board.fen();
+    auto info = Chess::engine::_parse_info(
+        "info depth 20 seldepth 25 multipv 1 score cp -15 upperbound nodes 123456 nps 1000000 hashfull 10 "
+        "tbhits 0 time 1234 pv e7e5 g1f3 b8c6 string hello  world",
+        board);
+    auto ok = info.depth == 20 && info.seldepth == 25 && info.multipv == 1 && info.nodes == 123456 &&
+              info.nps == 1000000 && info.hashfull == 10 && info.tbhits == 0 && info.time == 1.234 &&
+              info.upperbound && !info.lowerbound && info.score->relative == Chess::engine::Score{-15, std::nullopt} &&
+              info.score->white() == Chess::engine::Score{15, std::nullopt} && info.pv.size() == 3 &&
+              info.pv[2] == Chess::Move(B8, C6) && info.string == "hello  world" && board.fen() == fen &&
+              board.move_stack.empty();
+    // # An illegal move ends the line, but the fields after it are read.
+    info = Chess::engine::_parse_info("info pv e7e5 e7e5 a2a3 depth 3 score mate 2", board);
+    ok = ok && info.pv.size() == 1 && info.depth == 3 && info.score->relative.mate == 2 && board.fen() == fen;
+    // # Chess960 castling is the king taking its rook, standard castling is not.
+    auto castling = Chess::Board("4k3/8/8/8/8/8/8/4K2R w K - 0 1");
+    info = Chess::engine::_parse_info("info currmove e1g1 pv e1h1", castling);
+    ok = ok && info.currmove == Chess::Move(E1, G1) && info.pv.size() == 1 && info.pv[0] == Chess::Move(E1, G1);
+    auto mate = Chess::engine::Score{std::nullopt, -3};
+    return ok && mate.score(100000) == -99997 && (-mate).score(100000) == 99997 && !mate.score() &&
+           mate.is_mate() && (-mate).mate == 3;
+}
+
+auto test_pool() {
+    auto directory = make_directory();
+    auto command = write_script(directory, "fake.sh", FAKE_ENGINE);
+    auto ok = true;
+    {
+        Chess::engine::EnginePool pool(command, 3, {{"Hash", "32"}, {"skill level", "10"}});
+        std::vector<Chess::Board> boards;
+        for (auto i = 0; i < 40; ++i) {
+            auto board = Chess::Board();
+            if (i % 2)
+                board.push(Chess::Move(G1, F3));
+            if (i % 4 == 3)
+                board = Chess::Board(board.fen());
+            boards.push_back(board);
+        }
+        std::vector<int> infos(boards.size());
+        auto results = pool.analyse_many(boards, Chess::engine::Limit{.depth = 1}, 1,
+                                         [&](std::size_t job, const Chess::engine::Info&) { ++infos[job]; });
+        ok = pool.size() == 3 && pool.name() == "Fake Engine 1.0" && results.size() == boards.size();
+        for (std::size_t i = 0; ok && i < boards.size(); ++i) {
+            auto& result = results[i];
+            auto& info = result.info.at(0);
+            if (i % 2 == 0) {
+                ok = result.move == Chess::Move(E2, E4) && result.ponder == Chess::Move(E7, E5) && infos[i] == 3 &&
+                     info.score->white().cp == 31 && info.pv.size() == 2 && info.string == "thinking about e2e4" &&
+                     info.currmove == Chess::Move(E2, E4) && info.time == 0.02;
+            } else {
+                ok = result.move == Chess::Move(E7, E5) && !result.ponder && infos[i] == 1 &&
+                     info.score->white().mate == 3 && info.lowerbound && info.depth == 2;
+            }
+        }
+
+        // # Submissions run in the background until they are taken.
+        auto first = pool.submit(Chess::Board(), Chess::engine::Limit{.time = 0.1});
+        auto multipv = pool.analyse(Chess::Board(), Chess::engine::Limit{.nodes = 1000}, 2);
+        auto taken = pool.take_results();
+        ok = ok && first == 0 && taken.size() == 1 && taken[0].move == Chess::Move(E2, E4) &&
+             multipv.info.size() == 2 && multipv.info[1].pv.at(0) == Chess::Move(D2, D4) &&
+             multipv.info[1].score->relative.cp == 12 && pool.take_results().empty();
+    }
+    remove_scripts(directory);
+    return ok;
+}
+
+auto test_errors() {
+    auto ok = true;
+    auto directory = make_directory();
+    auto fake = write_script(directory, "fake.sh", FAKE_ENGINE);
+    auto dies = write_script(directory, "dies.sh", "read line; echo uciok; read line; echo readyok; read line; read line; exit 3\n");
+    try {
+        Chess::engine::EnginePool pool(fake, 1, {{"Threads", "2"}});
+        ok = false;
+    } catch (const Chess::engine::EngineError& error) {
+        ok = ok && std::string(error.what()) == "engine does not support option Threads";
+    }
+    try {
+        Chess::engine::EnginePool pool({"no/such/engine"});
+        ok = false;
+    } catch (const std::runtime_error&) {
+    }
+    Chess::engine::EnginePool pool(fake);
+    try {
+        pool.analyse(Chess::Board(), Chess::engine::Limit{});
+        ok = false;
+    } catch (const std::invalid_argument&) {
+    }
+    Chess::engine::EnginePool dying(dies);
+    try {
+        dying.analyse(Chess::Board(), Chess::engine::Limit{.depth = 1});
+        ok = false;
+    } catch (const Chess::engine::EngineTerminatedError& error) {
+        ok = ok && std::string(error.what()) == "engine process died unexpectedly (exit code: 3)";
+    }
+    try {
+        dying.submit(Chess::Board(), Chess::engine::Limit{.depth = 1});
+        ok = false;
+    } catch (const Chess::engine::EngineTerminatedError&) {
+    }
+    remove_scripts(directory);
+    return ok && pool.analyse(Chess::Board(), Chess::engine::Limit{.depth = 1}).move == Chess::Move(E2, E4);
+}
+
+int main() {
+    std::cout << "test_parse_info: " << (test_parse_info() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_pool:       " << (test_pool() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_errors:     " << (test_errors() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
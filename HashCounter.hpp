@@ -1,28 +1,105 @@
 #pragma once
 
-#include <unordered_map>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// counts 64-bit keys, such as zobrist hashes, in one flat open-addressing
+// table with linear probing. the first InlineCapacity distinct keys live in
+// the counter itself, so a counter on the stack never allocates; past that
+// the table moves to the heap and doubles whenever it is half full.
 
 namespace hscnt {
-template <typename Hashable>
+template <std::size_t InlineCapacity = 128>
 class HashCounter {
-    std::unordered_map<Hashable, int> hash_map;
+    struct Slot {
+        std::uint64_t key;
+        int count;  // 0 marks an empty slot
+    };
+
+    static constexpr std::size_t INLINE_SLOTS = std::bit_ceil(2 * InlineCapacity);
+
+    std::array<Slot, INLINE_SLOTS> inline_slots{};
+    std::unique_ptr<Slot[]> heap_slots;
+    std::size_t mask = INLINE_SLOTS - 1;
+    std::size_t distinct = 0;
+
+    auto slots() const -> const Slot* {
+        return heap_slots ? heap_slots.get() : inline_slots.data();
+    }
+
+    auto slots() -> Slot* {
+        return heap_slots ? heap_slots.get() : inline_slots.data();
+    }
+
+    static constexpr auto home(std::uint64_t key, std::size_t mask) -> std::size_t {
+        // # Fibonacci hashing, so keys that are not already well mixed
+        // # spread out too.
+        return (std::size_t)((key * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+    }
+
+    auto find(std::uint64_t key) const -> std::size_t {
+        // the slot holding *key*, or the empty slot where it would go.
+        auto table = slots();
+        auto i = home(key, mask);
+        while (table[i].count && table[i].key != key)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    void grow() {
+        auto old = slots();
+        auto old_size = mask + 1;
+        auto bigger = std::make_unique<Slot[]>(2 * old_size);
+        auto bigger_mask = 2 * old_size - 1;
+        for (std::size_t i = 0; i < old_size; ++i) {
+            if (!old[i].count)
+                continue;
+            auto j = home(old[i].key, bigger_mask);
+            while (bigger[j].count)
+                j = (j + 1) & bigger_mask;
+            bigger[j] = old[i];
+        }
+        heap_slots = std::move(bigger);
+        mask = bigger_mask;
+    }
+
    public:
     HashCounter() = default;
 
-    void add(Hashable key) {
-        if (hash_map.contains(key)) {
-            hash_map[key]++;
-        } else {
-            hash_map[key] = 0;
+    auto add(std::uint64_t key) -> int {
+        // """Counts *key* once more, and returns how often it has been seen."""
+        auto i = find(key);
+        auto table = slots();
+        if (table[i].count)
+            return ++table[i].count;
+        if (2 * (distinct + 1) > mask + 1) {
+            grow();
+            i = find(key);
+            table = slots();
         }
+        ++distinct;
+        table[i] = {key, 1};
+        return 1;
     }
 
-    auto count(Hashable key) -> int {
-        if (hash_map.contains(key)) {
-            return hash_map[key];
-        } else {
-            return 0;
-        }
+    auto count(std::uint64_t key) const -> int {
+        return slots()[find(key)].count;
+    }
+
+    auto size() const -> std::size_t {
+        // """Gets the number of distinct keys."""
+        return distinct;
+    }
+
+    void clear() {
+        // """Forgets every key, and gives back any heap memory."""
+        heap_slots.reset();
+        inline_slots.fill({});
+        mask = INLINE_SLOTS - 1;
+        distinct = 0;
     }
 };
-}
\ No newline at end of file
+}
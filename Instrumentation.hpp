@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// call counts and time spent in the hot board functions, kept per thread and
+// summed on demand. define CHESS_INSTRUMENT to turn it on, e.g.
+// make bench ARCH=-DCHESS_INSTRUMENT: without it CHESS_PROBE() expands to
+// nothing, so not even a thread_local is touched. times are timestamp counter
+// ticks and include nested probes, so a push() made by is_legal() counts
+// towards both.
+
+namespace instr {
+
+#if defined(CHESS_INSTRUMENT)
+constexpr auto ENABLED = true;
+#else
+constexpr auto ENABLED = false;
+#endif
+
+enum class Probe {
+    push,
+    pop,
+    push_fast,
+    pop_fast,
+    generate_legal_moves,
+    is_pseudo_legal,
+    is_legal,
+    attackers_mask,
+    pin_mask,
+    set_fen,
+    parse_san,
+    COUNT,
+};
+
+constexpr auto PROBE_COUNT = (std::size_t)Probe::COUNT;
+
+constexpr std::array<std::string_view, PROBE_COUNT> PROBE_NAMES = {
+    "push", "pop", "push_fast", "pop_fast", "generate_legal_moves", "is_pseudo_legal",
+    "is_legal", "attackers_mask", "pin_mask", "set_fen", "parse_san",
+};
+
+struct Stat {
+    std::uint64_t calls = 0;
+    std::uint64_t ticks = 0;
+};
+
+using Stats = std::array<Stat, PROBE_COUNT>;
+
+inline auto ticks() -> std::uint64_t {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// one thread's counters. only the owning thread writes them, so a relaxed
+// load and store is enough and no locked instruction is needed; they are
+// atomic only so that snapshot() can read them from another thread.
+struct Counter {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> ticks{0};
+
+    void add(std::uint64_t elapsed) {
+        calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        ticks.store(ticks.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+    }
+};
+
+struct ThreadCounters;
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> live;
+    // what threads that have exited had counted
+    Stats retired{};
+};
+
+inline auto registry() -> Registry& {
+    static Registry registry;
+    return registry;
+}
+
+struct ThreadCounters {
+    std::array<Counter, PROBE_COUNT> counters;
+
+    ThreadCounters() {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.push_back(this);
+    }
+
+    ThreadCounters(const ThreadCounters&) = delete;
+    auto operator=(const ThreadCounters&) -> ThreadCounters& = delete;
+
+    ~ThreadCounters() {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        for (std::size_t i = 0; i < PROBE_COUNT; ++i) {
+            r.retired[i].calls += counters[i].calls.load(std::memory_order_relaxed);
+            r.retired[i].ticks += counters[i].ticks.load(std::memory_order_relaxed);
+        }
+        std::erase(r.live, this);
+    }
+};
+
+inline auto local() -> ThreadCounters& {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+class ScopedProbe {
+    // counts one call of *probe*, timed from construction to destruction.
+    Counter& counter;
+    std::uint64_t start;
+
+   public:
+    explicit ScopedProbe(Probe probe) : counter(local().counters[(std::size_t)probe]), start(ticks()) {}
+
+    ScopedProbe(const ScopedProbe&) = delete;
+    auto operator=(const ScopedProbe&) -> ScopedProbe& = delete;
+
+    ~ScopedProbe() {
+        counter.add(ticks() - start);
+    }
+};
+
+inline auto snapshot() -> Stats {
+    // """
+    // Sums the counters of every thread, running or exited. Counts from
+    // threads still running may be a few calls behind.
+    // """
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    auto stats = r.retired;
+    for (auto counters : r.live) {
+        for (std::size_t i = 0; i < PROBE_COUNT; ++i) {
+            stats[i].calls += counters->counters[i].calls.load(std::memory_order_relaxed);
+            stats[i].ticks += counters->counters[i].ticks.load(std::memory_order_relaxed);
+        }
+    }
+    return stats;
+}
+
+inline void reset() {
+    // """
+    // Zeroes every counter. Call it while no instrumented function runs,
+    // or counts made at the same time may survive.
+    // """
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    r.retired = {};
+    for (auto counters : r.live) {
+        for (auto& counter : counters->counters) {
+            counter.calls.store(0, std::memory_order_relaxed);
+            counter.ticks.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+inline auto to_json(const Stats& stats) -> std::string {
+    // """Formats *stats* as ``{"push": {"calls": 1, "ticks": 40}, ...}``."""
+    std::ostringstream out;
+    out << "{";
+    for (std::size_t i = 0; i < PROBE_COUNT; ++i) {
+        out << (i ? ", " : "") << "\"" << PROBE_NAMES[i] << "\": {\"calls\": " << stats[i].calls
+            << ", \"ticks\": " << stats[i].ticks << "}";
+    }
+    out << "}";
+    return out.str();
+}
+
+inline auto to_prometheus(const Stats& stats) -> std::string {
+    // """Formats *stats* in the Prometheus text exposition format."""
+    std::ostringstream out;
+    out << "# HELP chess_calls_total Calls of instrumented board functions.\n"
+        << "# TYPE chess_calls_total counter\n";
+    for (std::size_t i = 0; i < PROBE_COUNT; ++i)
+        out << "chess_calls_total{function=\"" << PROBE_NAMES[i] << "\"} " << stats[i].calls << "\n";
+    out << "# HELP chess_ticks_total Timestamp counter ticks spent in instrumented board functions.\n"
+        << "# TYPE chess_ticks_total counter\n";
+    for (std::size_t i = 0; i < PROBE_COUNT; ++i)
+        out << "chess_ticks_total{function=\"" << PROBE_NAMES[i] << "\"} " << stats[i].ticks << "\n";
+    return out.str();
+}
+
+}  // namespace instr
+
+#if defined(CHESS_INSTRUMENT)
+#define CHESS_PROBE(name) instr::ScopedProbe _chess_probe(instr::Probe::name)
+#else
+#define CHESS_PROBE(name) ((void)0)
+#endif
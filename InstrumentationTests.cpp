@@ -0,0 +1,71 @@
+#ifndef CHESS_INSTRUMENT
+#define CHESS_INSTRUMENT
+#endif
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "target.hpp"
+
+auto calls(const instr::Stats& stats, instr::Probe probe) {
+    return stats[(std::size_t)probe].calls;
+}
+
+auto test_counts() {
+    instr::reset();
+    auto board = Chess::Board();
+    for (auto san : {"e4", "e5", "Nf3", "Nc6"})
+        board.push_san(san);
+    board.pop();
+    auto moves = board.generate_legal_moves();
+    Chess::UndoRecord undo;
+    board.push_fast(moves[0], undo);
+    board.pop_fast(undo);
+    board.set_fen("8/8/8/8/k2p3R/8/4P3/4K3 w - - 0 1");
+    board.is_legal(Chess::Move(E2, E4));
+
+    auto stats = instr::snapshot();
+    return calls(stats, instr::Probe::push) == 4 && calls(stats, instr::Probe::pop) == 1 &&
+           calls(stats, instr::Probe::parse_san) == 4 && calls(stats, instr::Probe::push_fast) == 1 &&
+           calls(stats, instr::Probe::pop_fast) == 1 && calls(stats, instr::Probe::set_fen) == 1 &&
+           calls(stats, instr::Probe::is_legal) == 1 && calls(stats, instr::Probe::is_pseudo_legal) >= 1 &&
+           calls(stats, instr::Probe::generate_legal_moves) >= 1 && calls(stats, instr::Probe::attackers_mask) >= 1 &&
+           stats[(std::size_t)instr::Probe::push].ticks > 0;
+}
+
+auto test_threads() {
+    // # Counts from finished threads are kept after they exit.
+    instr::reset();
+    auto work = [] {
+        auto board = Chess::Board();
+        for (auto i = 0; i < 100; ++i) {
+            board.push(Chess::Move(G1, F3));
+            board.pop();
+        }
+    };
+    std::thread a(work), b(work);
+    a.join();
+    b.join();
+    work();
+    return calls(instr::snapshot(), instr::Probe::push) == 300;
+}
+
+auto test_dumps() {
+    instr::reset();
+    auto board = Chess::Board();
+    board.push(Chess::Move(E2, E4));
+    auto stats = instr::snapshot();
+    auto json = instr::to_json(stats);
+    auto prometheus = instr::to_prometheus(stats);
+    return json.front() == '{' && json.back() == '}' && json.find("\"push\": {\"calls\": 1, \"ticks\": ") != std::string::npos &&
+           prometheus.find("# TYPE chess_calls_total counter\n") != std::string::npos &&
+           prometheus.find("chess_calls_total{function=\"push\"} 1\n") != std::string::npos &&
+           prometheus.find("chess_calls_total{function=\"pop\"} 0\n") != std::string::npos;
+}
+
+int main() {
+    std::cout << "test_counts:  " << (test_counts() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_threads: " << (test_threads() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_dumps:   " << (test_dumps() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
@@ -0,0 +1,447 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Perft.hpp"
+#include "MovePicker.hpp"
+#include "target.hpp"
+
+auto perft(Chess::Board& board, int depth) -> long long {
+    Chess::MoveList moves;
+    board.generate_legal_moves_into(moves);
+    if (depth == 1)
+        return (long long)moves.size();
+
+    long long nodes = 0;
+    for (auto move : moves) {
+        board.push(move);
+        nodes += perft(board, depth - 1);
+        board.pop();
+    }
+    return nodes;
+}
+
+auto perft_fast(Chess::Board& board, int depth) -> long long {
+    Chess::MoveList moves;
+    board.generate_legal_moves_into(moves);
+    if (depth == 1)
+        return (long long)moves.size();
+
+    long long nodes = 0;
+    Chess::UndoRecord undo;
+    for (auto move : moves) {
+        board.push_fast(move, undo);
+        nodes += perft_fast(board, depth - 1);
+        board.pop_fast(undo);
+    }
+    return nodes;
+}
+
+auto same_position(const Chess::Board& a, const Chess::Board& b) {
+    return a.pawns == b.pawns && a.knights == b.knights && a.bishops == b.bishops &&
+           a.rooks == b.rooks && a.queens == b.queens && a.kings == b.kings &&
+           a.occupied_co == b.occupied_co && a.occupied == b.occupied && a.promoted == b.promoted &&
+           a.turn == b.turn && a.castling_rights == b.castling_rights && a.ep_square == b.ep_square &&
+           a.halfmove_clock == b.halfmove_clock && a.fullmove_number == b.fullmove_number &&
+           a.zobrist_hash() == b.zobrist_hash() && a._hash_history == b._hash_history &&
+           a._reversible_plies == b._reversible_plies && a._mailbox == b._mailbox;
+}
+
+auto walk_fast(Chess::Board& fast, Chess::Board& slow, int depth) -> bool {
+    // push_fast() must land on exactly the position push() does, and pop_fast() must get back.
+    if (depth == 0)
+        return true;
+    Chess::MoveList moves;
+    slow.generate_legal_moves_into(moves);
+    for (auto move : moves) {
+        Chess::UndoRecord undo;
+        fast.push_fast(move, undo);
+        slow.push(move);
+        auto ok = same_position(fast, slow) && walk_fast(fast, slow, depth - 1);
+        slow.pop();
+        fast.pop_fast(undo);
+        if (!ok || !same_position(fast, slow)) {
+            std::cout << move.uci() << " ";
+            return false;
+        }
+    }
+    return true;
+}
+
+struct PerftCase {
+    std::string fen;
+    std::vector<long long> expected;
+};
+
+auto test_perft() {
+    // the usual chessprogramming.org suite: startpos, kiwipete and positions 3 to 6.
+    std::vector<PerftCase> cases = {
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", {20, 400, 8902, 197281}},
+        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", {48, 2039, 97862}},
+        {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", {14, 191, 2812, 43238}},
+        {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", {6, 264, 9467}},
+        {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", {44, 1486, 62379}},
+        {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", {46, 2079, 89890}},
+    };
+    for (auto& c : cases) {
+        auto board = Chess::Board(c.fen);
+        for (auto depth = 1; depth <= (int)c.expected.size(); ++depth) {
+            auto nodes = perft(board, depth);
+            if (nodes != c.expected[depth - 1]) {
+                std::cout << c.fen << " depth " << depth << " got " << nodes << " ";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto test_push_fast() {
+    std::vector<std::string> fens = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "1r2k2r/8/8/8/8/8/8/R3K1R1 w GAhb - 0 1",
+    };
+    for (auto& fen : fens) {
+        auto fast = Chess::Board(fen, fen.find("GAhb") != std::string::npos);
+        auto slow = fast;
+        if (!walk_fast(fast, slow, 3)) {
+            std::cout << fen << " ";
+            return false;
+        }
+    }
+    // and the fast path counts the same as perft with push()/pop().
+    auto board = Chess::Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    return perft_fast(board, 3) == 97862;
+}
+
+auto test_parallel_perft() {
+    // the threaded, table-backed perft must agree with the plain one, with and without splitting.
+    auto kiwipete = Chess::Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    auto position3 = Chess::Board("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    if (Chess::perft(kiwipete, 4, 4) != 4085603 || Chess::perft(kiwipete, 3, 2, 0) != 97862)
+        return false;
+    if (Chess::perft(position3, 5, 8) != 674624 || Chess::perft(position3, 0, 4) != 1)
+        return false;
+
+    // divide gives each root move its own subtree count.
+    auto divide = Chess::perft_divide(kiwipete, 3, 3);
+    if (divide.size() != 48)
+        return false;
+    for (auto& [move, count] : divide) {
+        auto child = kiwipete.copy(false);
+        child.push(move);
+        if ((long long)count != perft(child, 2)) {
+            std::cout << move.uci() << " ";
+            return false;
+        }
+    }
+    return true;
+}
+
+auto test_legal_matches_filtered() {
+    // the masked generator must agree with filtering pseudo-legal moves one by one.
+    std::vector<std::string> fens = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/8/8/2k5/3Pp3/8/8/4K2R b K d3 0 1",
+        "8/8/8/K2pP2r/8/8/8/7k w - d6 0 2",
+        "4k3/8/8/8/1b6/8/3P4/4K3 w - - 0 1",
+        "4k3/8/8/8/8/8/4r3/R3K2q w Q - 0 1",
+        // # Every piece class pinned on ranks, files and diagonals.
+        "k3r3/8/8/1b5b/8/3NRN2/r1B1K1Qq/3r4 w - - 0 1",
+        "4k3/8/8/b6b/1P3Q2/2BKP2r/3R4/3q4 w - - 0 1",
+        "7k/8/8/2b5/3Pp3/8/5K2/8 b - d3 0 1",
+        "4k3/4r3/8/8/1q6/2P5/3PP3/4K3 w - - 0 1",
+    };
+    for (auto& fen : fens) {
+        auto board = Chess::Board(fen);
+        auto legal = board.generate_legal_moves();
+        decltype(legal) filtered;
+        for (auto move : board.generate_pseudo_legal_moves()) {
+            if (!board.is_into_check(move))
+                filtered.push_back(move);
+        }
+        if (legal.size() != filtered.size()) {
+            std::cout << fen << " got " << legal.size() << " expected " << filtered.size() << " ";
+            return false;
+        }
+        for (auto move : filtered) {
+            if (!legal.contains(move)) {
+                std::cout << fen << " missing " << move.uci() << " ";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto test_move_list_capacity() {
+    // 218 moves is the known maximum for a legal position.
+    auto board = Chess::Board("R6R/3Q4/1Q4Q1/4Q3/2Q4Q/Q4Q2/pp1Q4/kBNN1KB1 w - - 0 1");
+    return board.generate_legal_moves().size() == 218;
+}
+
+auto test_packed_move_round_trip() {
+    // every generated move, a drop and the null move must survive packing.
+    auto board = Chess::Board("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    std::vector<Chess::Move> moves;
+    for (auto move : board.generate_pseudo_legal_moves()) moves.push_back(move);
+    board.push(Chess::Move::from_uci("a7b8q"));
+    for (auto move : board.generate_pseudo_legal_moves()) moves.push_back(move);
+    moves.push_back(Chess::Move::from_uci("N@e4"));
+    moves.push_back(Chess::Move::null());
+
+    for (auto move : moves) {
+        if (Chess::PackedMove(move).to_move() != move) {
+            std::cout << move.uci() << " ";
+            return false;
+        }
+    }
+    return !Chess::PackedMove(Chess::Move::null()).__bool__() && board.peek() == Chess::Move::from_uci("a7b8q");
+}
+
+auto test_move_picker() {
+    // the picker hands out every legal move once, stage by stage.
+    auto board = Chess::Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    auto hash_move = Chess::Move::from_uci("e2a6");
+    auto killer = Chess::Move::from_uci("a2a3");
+    Chess::MovePicker picker(board, hash_move, {killer, Chess::Move::from_uci("c3b1")});
+
+    Chess::Move move = Chess::Move::null();
+    std::vector<Chess::Move> picked;
+    if (!picker.next(move) || move != hash_move || picker.stage() != Chess::MovePicker::Stage::GENERATE_CAPTURES)
+        return false;
+    picked.push_back(move);
+    auto last_score = 100;
+    while (picker.next(move) && picker.stage() == Chess::MovePicker::Stage::CAPTURES) {
+        // # Captures come most valuable victim first.
+        auto score = (int)*board.piece_type_at(move.to_square);
+        if (!board.is_capture(move) || score > last_score)
+            return false;
+        last_score = score;
+        picked.push_back(move);
+    }
+    if (move != killer || picker.stage() != Chess::MovePicker::Stage::KILLERS)
+        return false;
+    do {
+        if (board.is_capture(move))
+            return false;
+        picked.push_back(move);
+    } while (picker.next(move));
+
+    auto legal = board.generate_legal_moves();
+    if (picked.size() != legal.size())
+        return false;
+    for (auto m : legal) {
+        if (std::count(picked.begin(), picked.end(), m) != 1)
+            return false;
+    }
+
+    // # A quiescence search only wants the captures.
+    Chess::MovePicker captures(board);
+    captures.skip_quiets();
+    std::size_t count = 0;
+    while (captures.next(move))
+        count += board.is_capture(move);
+    if (count != 8 || captures.stage() != Chess::MovePicker::Stage::DONE)
+        return false;
+
+    // # Skipping in the middle of the quiet moves stops them there.
+    auto start = Chess::Board();
+    Chess::MovePicker quiets(start);
+    if (!quiets.next(move) || quiets.stage() != Chess::MovePicker::Stage::QUIETS)
+        return false;
+    quiets.skip_quiets();
+    if (quiets.next(move) || quiets.stage() != Chess::MovePicker::Stage::DONE)
+        return false;
+
+    // # The queen promotion comes with the captures, the others last.
+    auto promotion = Chess::Board("3r4/2P5/8/8/8/8/k7/4K3 w - - 0 1");
+    Chess::MovePicker promotions(promotion);
+    std::vector<std::string> order;
+    while (promotions.next(move) && promotions.stage() == Chess::MovePicker::Stage::CAPTURES)
+        order.push_back(move.uci());
+    if (order != std::vector<std::string>{"c7d8q", "c7d8r", "c7d8b", "c7d8n", "c7c8q"})
+        return false;
+    std::vector<std::string> rest;
+    do {
+        if (move.promotion)
+            rest.push_back(move.uci());
+    } while (promotions.next(move));
+    return rest == std::vector<std::string>{"c7c8r", "c7c8b", "c7c8n"};
+}
+
+auto test_gives_check() {
+    // gives_check() must agree with playing the move, for every move of
+    // positions with direct, discovered, en passant, promotion and castling checks.
+    std::vector<std::string> fens = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/8/8/KPp4k/8/8/8/8 w - c6 0 1",
+        "3k4/1P6/8/8/8/8/8/R3K3 w Q - 0 1",
+        "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+        "k7/8/8/3N4/8/1B6/8/4K3 w - - 0 1",
+        "4k3/8/8/8/1b6/8/3P4/4K3 w - - 0 1",
+    };
+    for (auto& fen : fens) {
+        auto board = Chess::Board(fen);
+        auto info = board.check_info();
+        for (auto move : board.generate_legal_moves()) {
+            board.push(move);
+            auto check = board.is_check();
+            board.pop();
+            if (board.gives_check(move, info) != check || board.gives_check(move) != check) {
+                std::cout << fen << " " << move.uci() << " ";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto test_see() {
+    // # A free pawn, and a pawn defended by a rook behind a knight.
+    auto free = Chess::Board("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+    auto rxe5 = Chess::Move::from_uci("e1e5");
+    if (free.see(rxe5) != 100 || !free.see_ge(rxe5, 100) || free.see_ge(rxe5, 101))
+        return false;
+    auto defended = Chess::Board("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1");
+    auto nxe5 = Chess::Move::from_uci("d3e5");
+    if (defended.see(nxe5) != -200 || defended.see_ge(nxe5, 0) || !defended.see_ge(nxe5, -200))
+        return false;
+    // # The king may not take back on a defended square.
+    auto king = Chess::Board("3rk3/8/8/8/8/2b5/3q4/3RK3 w - - 0 1");
+    auto rxd2 = Chess::Move::from_uci("d1d2");
+    return king.see(rxd2) == 400 && king.see_ge(rxd2, 400) && !king.see_ge(rxd2, 401);
+}
+
+auto mailbox_coherent(const Chess::BaseBoard& board) {
+    auto rebuilt = board;
+    rebuilt._rebuild_mailbox();
+    return board._mailbox == rebuilt._mailbox && board._compute_zobrist_pieces() == board._zobrist_pieces;
+}
+
+auto walk_mailbox(Chess::Board& board, int depth) -> bool {
+    if (!mailbox_coherent(board))
+        return false;
+    if (depth == 0)
+        return true;
+    Chess::MoveList moves;
+    board.generate_legal_moves_into(moves);
+    for (auto move : moves) {
+        // # The captured piece is gone from the bitboards after the move.
+        auto captured = board.captured_piece(move);
+        auto them = board.occupied_co[!board.turn];
+        board.push(move);
+        auto lost = them & ~board.occupied_co[board.turn];
+        auto ok = walk_mailbox(board, depth - 1) && captured.has_value() == (bool)lost &&
+                  (!captured || captured->color == board.turn);
+        board.pop();
+        if (!ok) {
+            std::cout << board.fen() << " " << move.uci() << " ";
+            return false;
+        }
+    }
+    return mailbox_coherent(board);
+}
+
+auto test_mailbox() {
+    for (auto fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                     "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+                     "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"}) {
+        auto board = Chess::Board(fen);
+        if (!walk_mailbox(board, 3))
+            return false;
+        // # root() restores the saved state into an empty board.
+        board.push(board.generate_legal_moves()[0]);
+        board.push(board.generate_legal_moves()[0]);
+        auto root = board.root();
+        if (!mailbox_coherent(root) || root.fen() != fen)
+            return false;
+    }
+    auto board = Chess::Board("1r2k1r1/pppppppp/8/8/8/8/PPPPPPPP/RR2K3 w Bg - 0 1", true);
+    board.apply_transform(flip_vertical);
+    if (!mailbox_coherent(board) || board.piece_at(B8)->symbol() != "R")
+        return false;
+    // # Mirroring is a vertical flip with the colors swapped, hash included.
+    auto mirrored = Chess::Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1").mirror();
+    auto flipped = Chess::BaseBoard("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R").transform(flip_vertical);
+    std::swap(flipped.occupied_co[Chess::WHITE], flipped.occupied_co[Chess::BLACK]);
+    if (!mailbox_coherent(mirrored) || mirrored.board_fen() != "r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R" ||
+        mirrored.occupied_co[Chess::WHITE] != flipped.occupied_co[Chess::WHITE] ||
+        mirrored._compute_zobrist_pieces() != mirrored._zobrist_pieces)
+        return false;
+    // # The rotations turn a1 to a8 and to h1.
+    if (rotate_clockwise(BB_A1) != BB_A8 || rotate_anticlockwise(BB_A1) != BB_H1 || rotate_180(BB_A1 | BB_B1) != (BB_H8 | BB_G8) ||
+        rotate_clockwise(BB_A8) != BB_H8 || rotate_anticlockwise(rotate_clockwise(BB_RANK_2)) != BB_RANK_2 ||
+        rotate_clockwise(BB_RANK_1) != BB_FILE_A)
+        return false;
+    for (auto symmetry : DIHEDRALS) {
+        auto bb = BB_A1 | BB_B3 | BB_E4 | BB_H7;
+        if (popcount(dihedral_transform(symmetry, bb)) != 4)
+            return false;
+    }
+    // # En passant takes a pawn from another square; castling takes nothing.
+    board = Chess::Board("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPP2PPP/RNBQK2R w KQkq f6 0 3");
+    auto ep = board.captured_piece(Chess::Move(E5, F6));
+    return ep && ep->piece_type == Chess::PieceType::PAWN && ep->color == Chess::BLACK &&
+           !board.captured_piece(board.parse_san("O-O")) && !board.captured_piece(Chess::Move(E5, E6)) &&
+           board.captured_piece(Chess::Move(D1, D5))->piece_type == Chess::PieceType::PAWN;
+}
+
+auto walk_snapshot(Chess::Board& board, Chess::Snapshot snapshot, int depth) -> bool {
+    // # The snapshot is played alongside the board it was taken from.
+    if (snapshot != board.snapshot() || snapshot.to_board().fen() != board.fen() ||
+        snapshot.generate_legal_moves().size() != board.generate_legal_moves().size() ||
+        snapshot.is_check() != board.is_check())
+        return false;
+    if (depth == 0)
+        return true;
+    for (auto move : board.generate_legal_moves()) {
+        auto child = snapshot;
+        child.push(move);
+        board.push(move);
+        auto ok = walk_snapshot(board, child, depth - 1);
+        board.pop();
+        if (!ok) {
+            std::cout << board.fen() << " " << move.uci() << " ";
+            return false;
+        }
+    }
+    return true;
+}
+
+auto test_snapshot() {
+    static_assert(std::is_trivially_copyable_v<Chess::Snapshot> && sizeof(Chess::Snapshot) <= 112);
+    for (auto fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                     "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+                     "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"}) {
+        auto board = Chess::Board(fen);
+        if (!walk_snapshot(board, board.snapshot(), 2))
+            return false;
+    }
+    // # Taken mid-game, the history is left behind.
+    auto board = Chess::Board("1r2k1r1/pppppppp/8/8/8/8/PPPPPPPP/RR2K3 w Bg - 0 1", true);
+    board.push(Chess::Move::from_uci("b1a1"));
+    auto snapshot = board.snapshot();
+    auto restored = Chess::Board(snapshot);
+    return restored.move_stack.empty() && restored.chess960 && restored.fen() == board.fen() &&
+           restored.zobrist_hash() == board.zobrist_hash() && mailbox_coherent(restored) &&
+           snapshot.is_legal(Chess::Move::from_uci("g8h8"));
+}
+
+int main() {
+    std::cout << "test_perft:                  " << (test_perft() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_push_fast:              " << (test_push_fast() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_parallel_perft:         " << (test_parallel_perft() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_legal_matches_filtered: " << (test_legal_matches_filtered() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_move_list_capacity:     " << (test_move_list_capacity() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_packed_move_round_trip: " << (test_packed_move_round_trip() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_move_picker:            " << (test_move_picker() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_gives_check:            " << (test_gives_check() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_see:                    " << (test_see() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_mailbox:                " << (test_mailbox() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_snapshot:               " << (test_snapshot() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
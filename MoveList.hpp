@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mvlist {
+
+// no legal chess position has more than 218 moves, so 256 leaves headroom
+// for pseudo-legal lists and variants.
+constexpr std::size_t MAX_MOVES = 256;
+
+// a fixed-capacity list of moves that lives on the stack.
+// the slots are left uninitialised until something is pushed into them,
+// so declaring a MoveList in a perft or search loop costs nothing.
+template <typename MoveType, std::size_t Capacity = MAX_MOVES>
+class MoveList {
+    static_assert(std::is_trivially_copyable_v<MoveType>);
+    static_assert(std::is_trivially_destructible_v<MoveType>);
+
+    union Storage {
+        Storage() {}
+        MoveType moves[Capacity];
+    };
+
+    Storage storage;
+    std::size_t length = 0;
+
+   public:
+    using value_type = MoveType;
+    using iterator = MoveType*;
+    using const_iterator = const MoveType*;
+
+    MoveList() = default;
+
+    MoveList(const MoveList& other) : length(other.length) {
+        std::uninitialized_copy_n(other.begin(), length, begin());
+    }
+
+    auto operator=(const MoveList& other) -> MoveList& {
+        if (this == &other)
+            return *this;
+        length = other.length;
+        std::uninitialized_copy_n(other.begin(), length, begin());
+        return *this;
+    }
+
+    void push_back(const MoveType& move) {
+        assert(length < Capacity);
+        new (&storage.moves[length++]) MoveType(move);
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        assert(length < Capacity);
+        new (&storage.moves[length++]) MoveType(std::forward<Args>(args)...);
+    }
+
+    void pop_back() {
+        assert(length > 0);
+        --length;
+    }
+
+    void clear() {
+        length = 0;
+    }
+
+    // shrink the list back to a previous size, dropping everything after it.
+    void truncate(std::size_t size) {
+        assert(size <= length);
+        length = size;
+    }
+
+    auto size() const -> std::size_t {
+        return length;
+    }
+
+    auto empty() const -> bool {
+        return length == 0;
+    }
+
+    static constexpr auto capacity() -> std::size_t {
+        return Capacity;
+    }
+
+    auto contains(const MoveType& move) const -> bool {
+        return std::find(begin(), end(), move) != end();
+    }
+
+    auto operator[](std::size_t i) -> MoveType& {
+        return storage.moves[i];
+    }
+
+    auto operator[](std::size_t i) const -> const MoveType& {
+        return storage.moves[i];
+    }
+
+    auto front() -> MoveType& { return storage.moves[0]; }
+    auto back() -> MoveType& { return storage.moves[length - 1]; }
+
+    auto begin() -> iterator { return storage.moves; }
+    auto end() -> iterator { return storage.moves + length; }
+    auto begin() const -> const_iterator { return storage.moves; }
+    auto end() const -> const_iterator { return storage.moves + length; }
+};
+
+}  // namespace mvlist
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "target.hpp"
+
+// staged move generation for alpha-beta search. a search that cuts off on
+// the hash move or the first good capture never pays for generating the
+// quiet moves, because each stage is only generated when it is reached.
+
+namespace Chess {
+
+class MovePicker {
+    // """
+    // Hands out the legal moves of *board* one at a time: the hash move,
+    // then captures and queen promotions from the most valuable victim and
+    // least valuable attacker down, then the killer moves, then the
+    // remaining quiet moves, underpromotions included, in generation order.
+    // No move is handed out twice.
+
+    // The board may be changed between calls to
+    // :func:`~chess.MovePicker.next()`, as long as it is back in the same
+    // position for the next call.
+    // """
+   public:
+    enum class Stage {
+        HASH_MOVE,
+        GENERATE_CAPTURES,
+        CAPTURES,
+        KILLERS,
+        GENERATE_QUIETS,
+        QUIETS,
+        DONE,
+    };
+
+    MovePicker(Board& board, Move hash_move = Move::null(), std::array<Move, 2> killers = {Move::null(), Move::null()})
+        : board(board), hash_move(hash_move), killers(killers) {}
+
+    auto next(Move& move) -> bool {
+        // """
+        // Sets *move* to the next move and returns ``true``, or returns
+        // ``false`` once every move has been handed out.
+        // """
+        switch (_stage) {
+            case Stage::HASH_MOVE:
+                _stage = Stage::GENERATE_CAPTURES;
+                if (hash_move.__bool__() && board.is_legal(hash_move)) {
+                    move = hash_move;
+                    return true;
+                }
+                [[fallthrough]];
+
+            case Stage::GENERATE_CAPTURES:
+                _stage = Stage::CAPTURES;
+                _generate_captures();
+                [[fallthrough]];
+
+            case Stage::CAPTURES:
+                while (_current < moves.size()) {
+                    // # Selection sort: a cut-off after a few captures leaves
+                    // # the rest unsorted.
+                    auto best = _current;
+                    for (auto i = _current + 1; i < moves.size(); ++i) {
+                        if (scores[i] > scores[best])
+                            best = i;
+                    }
+                    std::swap(moves[_current], moves[best]);
+                    std::swap(scores[_current], scores[best]);
+                    move = moves[_current++];
+                    if (move != hash_move)
+                        return true;
+                }
+                if (_skip_quiets) {
+                    _stage = Stage::DONE;
+                    return false;
+                }
+                _stage = Stage::KILLERS;
+                [[fallthrough]];
+
+            case Stage::KILLERS:
+                while (_killer < killers.size()) {
+                    move = killers[_killer++];
+                    if (_skip_quiets)
+                        break;
+                    if (move.__bool__() && move != hash_move && (_killer == 1 || move != killers[0]) &&
+                        !_is_tactical(move) && board.is_legal(move))
+                        return true;
+                }
+                _stage = Stage::GENERATE_QUIETS;
+                [[fallthrough]];
+
+            case Stage::GENERATE_QUIETS:
+                if (_skip_quiets) {
+                    _stage = Stage::DONE;
+                    return false;
+                }
+                _stage = Stage::QUIETS;
+                moves.clear();
+                _current = 0;
+                // # Castling is generated to the square of the rook, so our
+                // # own pieces stay in the mask.
+                board.generate_legal_moves_into(moves, BB_ALL, ~board.occupied_co[!board.turn]);
+                [[fallthrough]];
+
+            case Stage::QUIETS:
+                // # skip_quiets() may come at any point of this stage.
+                while (!_skip_quiets && _current < moves.size()) {
+                    move = moves[_current++];
+                    // # En passant and queen promotions land on empty
+                    // # squares, but were handed out with the captures.
+                    if (move != hash_move && move != killers[0] && move != killers[1] && !_is_tactical(move))
+                        return true;
+                }
+                _stage = Stage::DONE;
+                [[fallthrough]];
+
+            case Stage::DONE:
+                break;
+        }
+        return false;
+    }
+
+    void skip_quiets() {
+        // """
+        // Hands out no more quiet moves or killers, as in a quiescence
+        // search, from the next call on. Captures and queen promotions
+        // still to come are kept.
+        // """
+        _skip_quiets = true;
+    }
+
+    auto stage() const -> Stage {
+        return _stage;
+    }
+
+   private:
+    Board& board;
+    Move hash_move;
+    std::array<Move, 2> killers;
+
+    MoveList moves;
+    std::array<int, mvlist::MAX_MOVES> scores;
+    std::size_t _current = 0;
+    std::size_t _killer = 0;
+    Stage _stage = Stage::HASH_MOVE;
+    bool _skip_quiets = false;
+
+    auto _is_tactical(Move move) -> bool {
+        return board.is_capture(move) || move.promotion == PieceType::QUEEN;
+    }
+
+    void _generate_captures() {
+        board.generate_legal_moves_into(moves, BB_ALL, board.occupied_co[!board.turn]);
+        board.generate_legal_ep_into(moves);
+        // # Quiet promotions come four at a time; only the queen is kept.
+        auto captures = moves.size();
+        board.generate_legal_moves_into(moves, board.pawns, BB_BACKRANKS & ~board.occupied);
+        auto end = captures;
+        for (auto i = captures; i < moves.size(); ++i) {
+            if (moves[i].promotion == PieceType::QUEEN)
+                moves[end++] = moves[i];
+        }
+        moves.truncate(end);
+        for (std::size_t i = 0; i < moves.size(); ++i) {
+            auto& move = moves[i];
+            auto victim = board.piece_type_at(move.to_square);
+            auto attacker = board.piece_type_at(move.from_square);
+            // # MVV-LVA; en passant takes a pawn from an empty square.
+            scores[i] = 8 * (victim ? (int)*victim : board.is_en_passant(move) ? (int)PieceType::PAWN : 0) - (int)*attacker;
+            if (move.promotion)
+                scores[i] += 8 * (int)*move.promotion;
+        }
+    }
+};
+
+}  // namespace Chess
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "target.hpp"
+
+const std::vector<std::string> FENS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+};
+
+auto test_fen_round_trip() {
+    for (auto& fen : FENS) {
+        auto board = Chess::Board(fen);
+        if (board.fen() != fen) {
+            std::cout << board.fen() << " != " << fen << " ";
+            return false;
+        }
+    }
+    // an ep square nobody can capture on is dropped by default, but kept with "fen".
+    auto board = Chess::Board("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    return board.fen() == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1" &&
+           board.fen(false, Chess::_EnPassantSpec::fen) == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1" &&
+           board.shredder_fen() == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b HAha - 0 1";
+}
+
+auto test_fen_fields() {
+    // a pawn beside the ep square that may not capture drops it as well.
+    auto pinned = Chess::Board("4k3/8/8/r2pP2K/8/8/8/8 w - d6 0 1");
+    // promoted pieces are only marked on request, on any square.
+    auto promoted = Chess::Board("Q~3k3/8/8/8/8/8/8/4K2Q~ w - - 0 1");
+    auto castling = Chess::Board("r3k2r/8/8/8/8/8/8/R3K1R1 w KQkq - 0 1");
+    return pinned.fen() == "4k3/8/8/r2pP2K/8/8/8/8 w - - 0 1" &&
+           pinned.fen(false, Chess::_EnPassantSpec::xfen) == "4k3/8/8/r2pP2K/8/8/8/8 w - d6 0 1" &&
+           promoted.fen() == "Q3k3/8/8/8/8/8/8/4K2Q w - - 0 1" &&
+           promoted.fen(false, Chess::_EnPassantSpec::legal, true) == "Q~3k3/8/8/8/8/8/8/4K2Q~ w - - 0 1" &&
+           castling.fen() == "r3k2r/8/8/8/8/8/8/R3K1R1 w Qkq - 0 1";
+}
+
+auto test_fen_errors() {
+    using Chess::FenError;
+    auto cases = std::vector<std::pair<std::string, FenError>>{
+        {"", FenError::empty},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1", FenError::board_rows},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR/8 w KQkq - 0 1", FenError::board_rows},
+        {"rnbqkbnr/ppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenError::board_columns},
+        {"rnbqkbnr/pppppppp/44/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenError::board_digits},
+        {"~nbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenError::board_tilde},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1", FenError::board_character},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", FenError::turn},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkqK - 0 1", FenError::castling},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w kqKQ - 0 1", FenError::castling},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e9 0 1", FenError::en_passant},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1", FenError::halfmove_clock},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - -1 1", FenError::negative_halfmove_clock},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1x", FenError::fullmove_number},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 -1", FenError::negative_fullmove_number},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 1", FenError::too_many_parts},
+    };
+    auto board = Chess::Board(FENS[1]);
+    for (auto& [fen, expected] : cases) {
+        auto error = board.try_set_fen(fen);
+        if (error != expected) {
+            std::cout << fen << ": " << Chess::fen_error_message(error) << " ";
+            return false;
+        }
+    }
+    // a failed parse leaves the board alone, and set_fen() still throws.
+    if (board.fen() != FENS[1])
+        return false;
+    try {
+        board.set_fen("8/8/8/8 w - - 0 1");
+        return false;
+    } catch (const std::invalid_argument&) {
+    }
+    // missing trailing fields take their defaults.
+    return board.try_set_fen("  8/8/8/8/8/8/8/4K2k   b ") == FenError::ok && board.fen() == "8/8/8/8/8/8/8/4K2k b - - 0 1";
+}
+
+auto test_fen_buffer() {
+    char buffer[Chess::MAX_FEN_LENGTH];
+    for (auto& fen : FENS) {
+        auto board = Chess::Board(fen);
+        auto length = board.write_fen(buffer, sizeof(buffer));
+        if (std::string(buffer) != fen || length != fen.size())
+            return false;
+        // one byte short of room for the terminator must fail cleanly.
+        if (board.write_fen(buffer, fen.size()) != 0 || board.write_fen(buffer, fen.size() + 1) != fen.size())
+            return false;
+    }
+    auto board = Chess::Board();
+    auto length = board.write_epd(buffer, sizeof(buffer));
+    return std::string(buffer, length) == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -";
+}
+
+auto test_set_epd() {
+    auto board = Chess::Board();
+    auto operations = board.set_epd("r3k2r/8/8/8/8/8/8/R3K2R b Kq - id \"castling; test\"; hmvc 12; fmvn 40;");
+    return operations == "id \"castling; test\"; hmvc 12; fmvn 40" &&
+           board.fen() == "r3k2r/8/8/8/8/8/8/R3K2R b Kq - 12 40" &&
+           board.try_set_epd("8/8/8/8/8/8/8/4K2k w - e9") == Chess::FenError::en_passant;
+}
+
+auto test_san_round_trip() {
+    // every legal move must survive san() -> parse_san().
+    for (auto& fen : FENS) {
+        auto board = Chess::Board(fen);
+        for (auto move : board.generate_legal_moves()) {
+            auto san = board.san(move);
+            if (board.parse_san(san) != move) {
+                std::cout << fen << " " << san << " ";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto test_san_notation() {
+    auto board = Chess::Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    auto checks = std::vector<std::pair<std::string, std::string>>{
+        {"e1g1", "O-O"}, {"e1c1", "O-O-O"}, {"e5f7", "Nxf7"}, {"d5e6", "dxe6"}, {"f3f6", "Qxf6"},
+        {"c3b1", "Nb1"}, {"e2a6", "Bxa6"}, {"h1g1", "Rg1"},
+    };
+    for (auto& [uci, expected] : checks) {
+        auto san = board.san(Chess::Move::from_uci(uci));
+        if (san != expected) {
+            std::cout << uci << " gave " << san << " ";
+            return false;
+        }
+    }
+    // disambiguation, promotion and mate.
+    auto rooks = Chess::Board("4k3/8/8/8/8/8/4K3/R6R w - - 0 1");
+    auto promo = Chess::Board("8/1P4k1/8/8/8/8/8/K7 w - - 0 1");
+    auto mate = Chess::Board("6k1/5ppp/8/8/8/8/8/K3R3 w - - 0 1");
+    return rooks.san(Chess::Move::from_uci("a1d1")) == "Rad1" &&
+           promo.san(Chess::Move::from_uci("b7b8n")) == "b8=N" &&
+           mate.san(Chess::Move::from_uci("e1e8")) == "Re8#" &&
+           Chess::Board().variation_san({Chess::Move::from_uci("e2e4"), Chess::Move::from_uci("e7e5")}) == "1. e4 e5";
+}
+
+auto test_parse_san_errors() {
+    auto board = Chess::Board();
+    for (auto bad : {"Ke2", "e5", "Nd2", "O-O", "xyz", "Qh9"}) {
+        try {
+            board.parse_san(bad);
+            std::cout << bad << " ";
+            return false;
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    return !board.parse_san("--").__bool__() && board.parse_san("Nf3") == Chess::Move::from_uci("g1f3");
+}
+
+auto test_san_buffer() {
+    // every SAN fits the fixed buffer, and the two parsers agree with san().
+    char buffer[Chess::MAX_SAN_LENGTH];
+    for (auto& fen : FENS) {
+        auto board = Chess::Board(fen);
+        for (auto move : board.generate_legal_moves()) {
+            auto length = board.write_san(move, buffer);
+            auto parsed = Chess::Move::null();
+            if (std::string(buffer) != board.san(move) || length != board.san(move).size() ||
+                board.try_parse_san(std::string_view(buffer, length), parsed) != Chess::SanError::ok || parsed != move) {
+                std::cout << fen << " " << move.uci() << " ";
+                return false;
+            }
+        }
+    }
+    auto promo = Chess::Board("3r2k1/4P3/8/8/8/8/8/K7 w - - 0 1");
+    return promo.write_san(Chess::Move::from_uci("e7d8q"), buffer) == 7 && std::string(buffer) == "exd8=Q+";
+}
+
+auto test_san_error_codes() {
+    using Chess::SanError;
+    auto board = Chess::Board("4k3/8/8/8/8/8/4K3/R6R w - - 0 1");
+    auto cases = std::vector<std::pair<std::string, SanError>>{
+        {"Rd1", SanError::ambiguous}, {"O-O", SanError::illegal}, {"Rb2", SanError::illegal},
+        {"Ra1d1", SanError::ok}, {"Rh9", SanError::invalid}, {"Ra1-d1,Rh1-f1", SanError::multi_leg},
+        {"", SanError::invalid}, {"=Q", SanError::invalid},
+    };
+    auto move = Chess::Move::null();
+    for (auto& [san, expected] : cases) {
+        if (board.try_parse_san(san, move) != expected) {
+            std::cout << san << " ";
+            return false;
+        }
+    }
+    auto pawn = Chess::Board("8/4P1k1/8/8/8/8/8/K7 w - - 0 1");
+    return pawn.try_parse_san("e7e8", move) == SanError::missing_promotion &&
+           pawn.try_parse_san("e8=N", move) == SanError::ok && move == Chess::Move::from_uci("e7e8n");
+}
+
+int main() {
+    std::cout << "test_fen_round_trip:   " << (test_fen_round_trip() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_fen_fields:       " << (test_fen_fields() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_fen_errors:       " << (test_fen_errors() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_fen_buffer:       " << (test_fen_buffer() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_set_epd:          " << (test_set_epd() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_san_round_trip:   " << (test_san_round_trip() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_san_notation:     " << (test_san_notation() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_san_buffer:       " << (test_san_buffer() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_san_error_codes:  " << (test_san_error_codes() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_parse_san_errors: " << (test_parse_san_errors() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+#include "target.hpp"
+
+namespace Chess {
+
+// a position in 32 bytes, for training data: the occupancy bitboard, then one
+// nibble per occupied square in square order, then the clocks and a little
+// room for a label. castling rights and the en passant square are folded
+// into the piece nibbles, which also keeps chess960 castling rooks exact:
+//
+//   0..11  pawn, knight, bishop, rook, queen, king; white even, black odd
+//   12     a pawn that just made a double step (en passant is possible)
+//   13, 14 a white, black rook with a castling right
+//
+// the struct is trivially copyable and is written to disk as is, so files
+// are little-endian like the machines that write them.
+struct PackedPosition {
+    std::uint64_t occupied;
+    std::array<std::uint8_t, 16> pieces;
+    std::uint16_t halfmove_clock;
+    std::uint16_t fullmove_number;
+    // a training label, like an engine score in centipawns, and the game
+    // result from white's point of view: 1, 0 or -1.
+    std::int16_t score;
+    std::int8_t result;
+    std::uint8_t flags;
+
+    static constexpr std::uint8_t BLACK_TO_MOVE = 1;
+    static constexpr std::uint8_t CHESS960 = 2;
+
+    static constexpr std::uint8_t EN_PASSANT_PAWN = 12;
+    static constexpr std::uint8_t CASTLING_ROOK = 13;
+
+    // the nibbles hold four bit planes, one bit per occupied square: gather
+    // each plane down to the occupied squares and spread it to every fourth
+    // bit, or the other way around. with BMI2 that is one pext and two pdeps
+    // a plane; otherwise one pass over the occupied squares.
+    static constexpr Bitboard _NIBBLE_LOW_BITS = 0x1111111111111111ULL;
+
+    static auto _pack_planes(const std::array<Bitboard, 4>& planes, Bitboard occupied) -> std::array<std::uint8_t, 16> {
+        std::uint64_t words[2] = {0, 0};
+#if CHESS_USE_PEXT
+        for (auto k = 0; k < 4; ++k) {
+            auto bits = _pext_u64(planes[k], occupied);
+            words[0] |= _pdep_u64(bits & 0xffff, _NIBBLE_LOW_BITS) << k;
+            words[1] |= _pdep_u64(bits >> 16, _NIBBLE_LOW_BITS) << k;
+        }
+#else
+        auto i = 0;
+        for (auto bb = occupied; bb; bb &= bb - 1, ++i) {
+            auto square = lsb(bb);
+            std::uint64_t nibble = ((planes[0] >> square) & 1) | ((planes[1] >> square) & 1) << 1 |
+                                   ((planes[2] >> square) & 1) << 2 | ((planes[3] >> square) & 1) << 3;
+            words[i >> 4] |= nibble << ((i & 15) * 4);
+        }
+#endif
+        std::array<std::uint8_t, 16> pieces;
+        std::memcpy(pieces.data(), words, sizeof(words));
+        return pieces;
+    }
+
+    static auto _unpack_planes(const std::array<std::uint8_t, 16>& pieces, Bitboard occupied) -> std::array<Bitboard, 4> {
+        std::uint64_t words[2];
+        std::memcpy(words, pieces.data(), sizeof(words));
+        std::array<Bitboard, 4> planes{};
+#if CHESS_USE_PEXT
+        for (auto k = 0; k < 4; ++k) {
+            auto bits = _pext_u64(words[0], _NIBBLE_LOW_BITS << k) | _pext_u64(words[1], _NIBBLE_LOW_BITS << k) << 16;
+            planes[k] = _pdep_u64(bits, occupied);
+        }
+#else
+        auto i = 0;
+        for (auto bb = occupied; bb; bb &= bb - 1, ++i) {
+            auto square = lsb(bb);
+            auto nibble = words[i >> 4] >> ((i & 15) * 4);
+            planes[0] |= (nibble & 1) << square;
+            planes[1] |= ((nibble >> 1) & 1) << square;
+            planes[2] |= ((nibble >> 2) & 1) << square;
+            planes[3] |= ((nibble >> 3) & 1) << square;
+        }
+#endif
+        return planes;
+    }
+
+    static auto from_board(const Board& board, std::int16_t score = 0, std::int8_t result = 0) -> PackedPosition {
+        // """
+        // Packs the position of *board*. The move stack and promoted flags
+        // are not kept.
+
+        // :raises: :exc:`std::invalid_argument` if there are more than 32
+        //     pieces on the board.
+        // """
+        if (popcount(board.occupied) > 32)
+            throw std::invalid_argument("cannot pack more than 32 pieces: "s + board.board_fen());
+
+        PackedPosition packed{};
+        packed.occupied = board.occupied;
+        packed.halfmove_clock = (std::uint16_t)std::clamp(board.halfmove_clock, 0, 0xffff);
+        packed.fullmove_number = (std::uint16_t)std::clamp(board.fullmove_number, 0, 0xffff);
+        packed.score = score;
+        packed.result = result;
+        packed.flags = (board.turn == BLACK ? BLACK_TO_MOVE : 0) | (board.chess960 ? CHESS960 : 0);
+
+        auto castling = board.clean_castling_rights();
+        // # The pawn that can be taken en passant, if it is really there.
+        Bitboard ep_pawn = BB_EMPTY;
+        if (board.ep_square.has_value()) {
+            auto pawn = board.ep_square.value() + (board.turn == WHITE ? -8 : 8);
+            if (0 <= pawn && pawn < 64)
+                ep_pawn = BB_SQUARES[pawn] & board.pawns & board.occupied_co[!board.turn];
+        }
+
+        // # Four bit planes of the nibble codes, one bit per square.
+        auto black = board.occupied_co[BLACK];
+        auto special = castling | ep_pawn;
+        std::array<Bitboard, 4> planes = {
+            (black & ~special) | (castling & ~black),
+            ((board.knights | board.rooks | board.kings) & ~special) | (castling & black),
+            board.bishops | board.rooks | special,
+            board.queens | board.kings | special,
+        };
+        packed.pieces = _pack_planes(planes, board.occupied);
+        return packed;
+    }
+
+    void to_board(Board& board) const {
+        // """Sets *board* up with the packed position and clears its move stack."""
+        auto turn = (Color)!(flags & BLACK_TO_MOVE);
+        auto [b0, b1, b2, b3] = _unpack_planes(pieces, occupied);
+
+        // # Codes 12 to 14 have both high bits set, which no plain piece has.
+        auto special = b2 & b3;
+        auto plain = occupied & ~special;
+        auto ep_pawn = special & ~b0 & ~b1;
+        auto castling = special & (b0 | b1);
+        // # The en passant pawn belongs to the side that just moved.
+        auto black = (plain & b0) | (castling & b1) | (turn == WHITE ? ep_pawn : BB_EMPTY);
+
+        board.pawns = (plain & ~b1 & ~b2 & ~b3) | ep_pawn;
+        board.knights = plain & b1 & ~b2 & ~b3;
+        board.bishops = plain & ~b1 & b2 & ~b3;
+        board.rooks = (plain & b1 & b2 & ~b3) | castling;
+        board.queens = plain & ~b1 & ~b2 & b3;
+        board.kings = plain & b1 & ~b2 & b3;
+        board.occupied_co[BLACK] = black;
+        board.occupied_co[WHITE] = occupied & ~black;
+        board.occupied = occupied;
+        board.promoted = BB_EMPTY;
+
+        std::uint64_t key = 0;
+        board._mailbox.fill(0);
+        Bitboard by_type[] = {board.pawns, board.knights, board.bishops, board.rooks, board.queens, board.kings};
+        for (auto piece_type = 1; piece_type <= 6; ++piece_type) {
+            for (auto bb = by_type[piece_type - 1]; bb; bb &= bb - 1) {
+                auto square = lsb(bb);
+                auto color = (Color)!((black >> square) & 1);
+                key ^= zobrist::piece_key(piece_type, color, square);
+                board._mailbox[square] = Board::_mailbox_code((PieceType)piece_type, color);
+            }
+        }
+        board._zobrist_pieces = key;
+
+        board.turn = turn;
+        board.castling_rights = castling;
+        board.ep_square = ep_pawn ? std::optional<Square>((Square)(lsb(ep_pawn) + (turn == WHITE ? 8 : -8))) : std::nullopt;
+        board.halfmove_clock = halfmove_clock;
+        board.fullmove_number = std::max<int>(fullmove_number, 1);
+        board.chess960 = flags & CHESS960;
+        board.clear_stack();
+    }
+
+    auto board() const -> Board {
+        auto board = Board(std::nullopt);
+        to_board(board);
+        return board;
+    }
+
+    auto transform(Dihedral symmetry) const -> PackedPosition {
+        // """
+        // Gets the position under one of the eight symmetries of the board,
+        // with the same side to move. Castling rights do not survive any
+        // symmetry but the identity, and an en passant pawn only survives a
+        // horizontal flip; otherwise they become plain rooks and pawns.
+        // """
+        auto planes = _unpack_planes(pieces, occupied);
+        auto& [b0, b1, b2, b3] = planes;
+        auto special = b2 & b3;
+        auto ep_pawn = special & ~b0 & ~b1;
+        auto white_castling = special & b0;
+        auto black_castling = special & b1;
+        Bitboard demoted = BB_EMPTY;
+        if (symmetry != Dihedral::IDENTITY)
+            demoted |= white_castling | black_castling;
+        if (symmetry != Dihedral::IDENTITY && symmetry != Dihedral::FLIP_HORIZONTAL)
+            demoted |= ep_pawn;
+        if (demoted) {
+            // # The en passant pawn belongs to the side that just moved.
+            auto black_pawn = flags & BLACK_TO_MOVE ? BB_EMPTY : ep_pawn;
+            auto rooks = (white_castling | black_castling) & demoted;
+            b0 = (b0 & ~demoted) | (black_castling & demoted) | (black_pawn & demoted);
+            b1 = (b1 & ~demoted) | rooks;
+            b2 = (b2 & ~demoted) | rooks;
+            b3 &= ~demoted;
+        }
+
+        auto transformed = *this;
+        transformed.occupied = dihedral_transform(symmetry, occupied);
+        for (auto& plane : planes)
+            plane = dihedral_transform(symmetry, plane);
+        transformed.pieces = _pack_planes(planes, transformed.occupied);
+        return transformed;
+    }
+
+    static void apply_symmetry(PackedPosition* positions, std::size_t count, Dihedral symmetry) {
+        // """Maps *count* positions in place, like :func:`transform()`."""
+        for (std::size_t i = 0; i < count; ++i)
+            positions[i] = positions[i].transform(symmetry);
+    }
+};
+
+static_assert(sizeof(PackedPosition) == 32, "a packed position must stay 32 bytes");
+static_assert(std::is_trivially_copyable_v<PackedPosition>, "packed positions are written to disk as is");
+
+}  // namespace Chess
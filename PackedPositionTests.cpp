@@ -0,0 +1,159 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PackedPosition.hpp"
+#include "PositionFile.hpp"
+
+const std::vector<std::string> FENS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+};
+
+auto same_position(Chess::Board& a, Chess::Board& b) {
+    return a.fen(false, Chess::_EnPassantSpec::fen) == b.fen(false, Chess::_EnPassantSpec::fen) &&
+           a.zobrist_hash() == b.zobrist_hash();
+}
+
+// every position two plies deep from each FEN survives a pack and unpack.
+auto test_round_trip() {
+    auto unpacked = Chess::Board(std::nullopt);
+    for (auto& fen : FENS) {
+        auto board = Chess::Board(fen);
+        for (auto first : board.generate_legal_moves()) {
+            board.push(first);
+            for (auto second : board.generate_legal_moves()) {
+                board.push(second);
+                Chess::PackedPosition::from_board(board, 17, -1).to_board(unpacked);
+                if (!same_position(board, unpacked)) {
+                    std::cout << board.fen() << " != " << unpacked.fen() << " ";
+                    return false;
+                }
+                board.pop();
+            }
+            board.pop();
+        }
+    }
+    auto packed = Chess::PackedPosition::from_board(Chess::Board(FENS[5]), 17, -1);
+    return packed.score == 17 && packed.result == -1 && packed.board().ep_square == F6;
+}
+
+auto test_chess960() {
+    // # The castling rooks are not on the corners, so the rights must be
+    // # kept per rook.
+    auto board = Chess::Board("1r2k1r1/pppppppp/8/8/8/8/PPPPPPPP/RR2K3 w Bg - 0 1", true);
+    auto unpacked = Chess::PackedPosition::from_board(board).board();
+    return unpacked.chess960 && unpacked.castling_rights == (BB_B1 | BB_G8) &&
+           same_position(board, unpacked);
+}
+
+auto test_too_many_pieces() {
+    auto board = Chess::Board("qqqqkqqq/qqqqqqqq/8/8/4P3/8/QQQQQQQQ/QQQQKQQQ w - - 0 1");
+    try {
+        Chess::PackedPosition::from_board(board);
+        return false;
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+}
+
+auto test_position_file() {
+    // # A game's worth of positions, like a training data dump.
+    std::vector<Chess::PackedPosition> positions;
+    auto board = Chess::Board();
+    std::uint64_t seed = 7;
+    for (auto i = 0; i < 1000; ++i) {
+        auto moves = board.generate_legal_moves();
+        if (moves.empty() || board.halfmove_clock > 50)
+            board.reset();
+        else {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            board.push(moves[(seed >> 33) % moves.size()]);
+        }
+        positions.push_back(Chess::PackedPosition::from_board(board, (std::int16_t)i));
+    }
+
+    std::vector<long> sizes;
+    auto path = std::string("packed_position_tests.bin");
+    for (auto compression : {Chess::PositionCompression::none, Chess::PositionCompression::delta_rle}) {
+        {
+            Chess::PositionFileWriter writer(path, compression, 300);
+            for (auto& position : positions)
+                writer.write(position);
+        }
+        std::vector<Chess::PackedPosition> read;
+        Chess::PositionFileReader reader(path);
+        Chess::PackedPosition position;
+        while (reader.read(position))
+            read.push_back(position);
+        if (read.size() != positions.size())
+            return false;
+        for (std::size_t i = 0; i < read.size(); ++i) {
+            if (std::memcmp(&read[i], &positions[i], sizeof(position)) != 0)
+                return false;
+        }
+        auto file = std::fopen(path.c_str(), "rb");
+        std::fseek(file, 0, SEEK_END);
+        sizes.push_back(std::ftell(file));
+        std::fclose(file);
+    }
+    std::remove(path.c_str());
+    if (sizes[0] != 16 + 4 * 16 + 1000 * 32 || sizes[1] * 3 > sizes[0] * 2)
+        return false;
+
+    try {
+        Chess::PositionFileReader missing("no/such/file.bin");
+        return false;
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+}
+
+// each symmetry moves every piece, and keeps only the castling rights and en
+// passant pawns that are still meaningful.
+auto test_symmetries() {
+    for (auto& fen : FENS) {
+        auto board = Chess::Board(fen);
+        auto packed = Chess::PackedPosition::from_board(board, 5, 1);
+        for (auto symmetry : DIHEDRALS) {
+            auto transformed = packed.transform(symmetry);
+            auto unpacked = transformed.board();
+            auto f = [=](Bitboard bb) { return dihedral_transform(symmetry, bb); };
+            auto keeps_ep = symmetry == Dihedral::IDENTITY || symmetry == Dihedral::FLIP_HORIZONTAL;
+            auto ep_kept = board.ep_square && keeps_ep
+                               ? unpacked.ep_square && BB_SQUARES[*unpacked.ep_square] == f(BB_SQUARES[*board.ep_square])
+                               : !unpacked.ep_square;
+            if (unpacked.pawns != f(board.pawns) || unpacked.knights != f(board.knights) ||
+                unpacked.bishops != f(board.bishops) || unpacked.rooks != f(board.rooks) ||
+                unpacked.queens != f(board.queens) || unpacked.kings != f(board.kings) ||
+                unpacked.occupied_co[Chess::BLACK] != f(board.occupied_co[Chess::BLACK]) ||
+                unpacked.turn != board.turn || transformed.score != 5 || !ep_kept ||
+                (symmetry != Dihedral::IDENTITY && unpacked.castling_rights) ||
+                (symmetry == Dihedral::IDENTITY && !same_position(board, unpacked))) {
+                std::cout << fen << " " << (int)symmetry << " ";
+                return false;
+            }
+        }
+    }
+    std::vector<Chess::PackedPosition> positions;
+    for (auto& fen : FENS)
+        positions.push_back(Chess::PackedPosition::from_board(Chess::Board(fen)));
+    auto expected = positions[2].transform(Dihedral::ROTATE_CLOCKWISE);
+    Chess::PackedPosition::apply_symmetry(positions.data(), positions.size(), Dihedral::ROTATE_CLOCKWISE);
+    return std::memcmp(&positions[2], &expected, sizeof(expected)) == 0;
+}
+
+int main() {
+    std::cout << "test_round_trip:      " << (test_round_trip() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_chess960:        " << (test_chess960() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_too_many_pieces: " << (test_too_many_pieces() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_position_file:   " << (test_position_file() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_symmetries:      " << (test_symmetries() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
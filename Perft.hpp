@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "target.hpp"
+
+namespace Chess {
+
+// a shared cache of subtree node counts, keyed by zobrist hash and depth.
+// entries are two relaxed atomics, written with the xor trick: the first word
+// holds key ^ data, so a torn write from two threads racing on one slot
+// never verifies and just reads as a miss. no locks are taken.
+class PerftTable {
+    struct Entry {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    std::size_t mask;
+
+    // node counts get the top 56 bits, the depth the low 8.
+    static constexpr auto pack(int depth, std::uint64_t nodes) -> std::uint64_t {
+        return (nodes << 8) | (std::uint64_t)depth;
+    }
+
+   public:
+    explicit PerftTable(std::size_t megabytes) {
+        // round down to a power of two number of entries.
+        auto count = std::size_t{1};
+        while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024)
+            count *= 2;
+        entries = std::make_unique<Entry[]>(count);
+        mask = count - 1;
+    }
+
+    auto probe(std::uint64_t key, int depth, std::uint64_t& nodes) const -> bool {
+        auto& entry = entries[key & mask];
+        auto data = entry.data.load(std::memory_order_relaxed);
+        auto check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || (data & 0xff) != (std::uint64_t)depth)
+            return false;
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(std::uint64_t key, int depth, std::uint64_t nodes) {
+        auto& entry = entries[key & mask];
+        auto data = pack(depth, nodes);
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+};
+
+// the key a perft subtree is cached under. in chess960 the zobrist key only
+// sees castling rights on the corner files, so the full rights are mixed in.
+inline auto _perft_key(const Board& board) -> std::uint64_t {
+    auto key = board.zobrist_hash();
+    if (board.chess960)
+        key ^= (board.castling_rights + 1) * 0x9e3779b97f4a7c15ULL;
+    return key;
+}
+
+inline auto _perft(Board& board, int depth, PerftTable* table) -> std::uint64_t {
+    if (depth == 0)
+        return 1;
+
+    std::uint64_t nodes = 0;
+    auto key = _perft_key(board);
+    if (depth > 1 && table && table->probe(key, depth, nodes))
+        return nodes;
+
+    MoveList moves;
+    board.generate_legal_moves_into(moves);
+    if (depth == 1)
+        return moves.size();
+
+    UndoRecord undo;
+    for (auto move : moves) {
+        board.push_fast(move, undo);
+        nodes += _perft(board, depth - 1, table);
+        board.pop_fast(undo);
+    }
+
+    if (table)
+        table->store(key, depth, nodes);
+    return nodes;
+}
+
+// """
+// Counts the leaf nodes of the legal move tree *depth* plies deep, and returns
+// the count below each root move.
+
+// The root moves, or the second ply when there are fewer root moves than
+// workers can chew on, are spread over *threads* workers. Each task works on
+// its own copy of the board. Subtree counts are shared between threads
+// through a table of *hash_mb* megabytes; pass ``0`` to disable it.
+// """
+inline auto perft_divide(const Board& board, int depth, unsigned threads = 1, std::size_t hash_mb = 16) -> std::vector<std::pair<Move, std::uint64_t>> {
+    auto root = board.copy(false);
+    std::vector<std::pair<Move, std::uint64_t>> result;
+    for (auto move : root.generate_legal_moves())
+        result.emplace_back(move, 0);
+    if (depth <= 1) {
+        for (auto& entry : result)
+            entry.second = depth == 1 ? 1 : 0;
+        return result;
+    }
+
+    auto table = hash_mb ? std::make_unique<PerftTable>(hash_mb) : nullptr;
+    std::vector<std::atomic<std::uint64_t>> counts(result.size());
+
+    // a few tasks per worker lets stealing smooth over uneven subtrees.
+    auto split = depth >= 3 && result.size() < 4 * (std::size_t)std::max(threads, 1u);
+
+    tpool::ThreadPool pool(std::max(threads, 1u));
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        auto first = result[i].first;
+        if (!split) {
+            pool.submit([&, i, first] {
+                auto local = root.copy(false);
+                UndoRecord undo;
+                local.push_fast(first, undo);
+                counts[i] += _perft(local, depth - 1, table.get());
+            });
+            continue;
+        }
+        auto child = root.copy(false);
+        UndoRecord child_undo;
+        child.push_fast(first, child_undo);
+        for (auto second : child.generate_legal_moves()) {
+            pool.submit([&, i, first, second] {
+                auto local = root.copy(false);
+                UndoRecord undo[2];
+                local.push_fast(first, undo[0]);
+                local.push_fast(second, undo[1]);
+                counts[i] += _perft(local, depth - 2, table.get());
+            });
+        }
+    }
+    pool.wait();
+
+    for (std::size_t i = 0; i < result.size(); ++i)
+        result[i].second = counts[i].load();
+    return result;
+}
+
+inline auto perft(const Board& board, int depth, unsigned threads = 1, std::size_t hash_mb = 16) -> std::uint64_t {
+    // """Counts the leaf nodes of the legal move tree *depth* plies deep."""
+    if (depth == 0)
+        return 1;
+    std::uint64_t nodes = 0;
+    for (auto& [move, count] : perft_divide(board, depth, threads, hash_mb))
+        nodes += count;
+    return nodes;
+}
+
+// """
+// Prints the node count below every root move in UCI notation, one per line,
+// followed by the total. Compare this against another engine to find the
+// move where two move generators disagree.
+// """
+inline auto print_divide(const Board& board, int depth, unsigned threads = 1, std::size_t hash_mb = 16, std::ostream& out = std::cout) -> std::uint64_t {
+    std::uint64_t nodes = 0;
+    for (auto& [move, count] : perft_divide(board, depth, threads, hash_mb)) {
+        out << move.uci() << ": " << count << '\n';
+        nodes += count;
+    }
+    out << "\nNodes searched: " << nodes << '\n';
+    return nodes;
+}
+
+}  // namespace Chess
@@ -0,0 +1,495 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "target.hpp"
+
+// a port of the reading half of python-chess's chess.pgn. games are not built
+// into trees: the reader walks the movetext once and reports what it finds to
+// a visitor, so a caller only pays for the parts it asks for.
+
+namespace Chess::pgn {
+
+enum class SkipType {
+    PROCEED,
+    SKIP
+};
+
+constexpr auto PROCEED = SkipType::PROCEED;
+constexpr auto SKIP = SkipType::SKIP;
+
+class Visitor {
+    // """
+    // Base class for visitors.
+
+    // Use with :func:`~chess.pgn.Reader.read_game()` to consume games
+    // without building a game tree. The methods are called in PGN order. All
+    // strings are slices of the input, and stay valid as long as it does;
+    // header values and comments are passed through raw, with escapes intact.
+    // """
+   public:
+    virtual ~Visitor() = default;
+
+    // """Called at the start of a game."""
+    virtual void begin_game() {}
+
+    // """Called before visiting game headers."""
+    virtual void begin_headers() {}
+
+    // """Called for each game header."""
+    virtual void visit_header(std::string_view /* tagname */, std::string_view /* tagvalue */) {}
+
+    // """
+    // Called after visiting game headers. Return ``SKIP`` to skip the
+    // movetext of this game without parsing it.
+    // """
+    virtual auto end_headers() -> SkipType { return PROCEED; }
+
+    // """
+    // Called for each move, with the board *before* the move is played.
+    // The board is advanced with push_fast(), so its move stack stays empty.
+    // """
+    virtual void visit_move(Board& /* board */, Move /* move */) {}
+
+    // """
+    // Called for each board, after its move has been played. The board
+    // stays valid until the next game starts, so keeping a pointer to it
+    // gives the final position of the main line in end_game().
+    // """
+    virtual void visit_board(Board& /* board */) {}
+
+    // """Called for each comment, without the braces."""
+    virtual void visit_comment(std::string_view /* comment */) {}
+
+    // """Called for each NAG, including ``!`` and ``?`` style annotations."""
+    virtual void visit_nag(int /* nag */) {}
+
+    // """
+    // Called at the start of a new variation. Return ``SKIP`` to skip it
+    // and everything nested inside without parsing.
+    // """
+    virtual auto begin_variation() -> SkipType { return PROCEED; }
+
+    // """Concludes a variation."""
+    virtual void end_variation() {}
+
+    // """Called at the end of the game with the result token, like ``1-0``."""
+    virtual void visit_result(std::string_view /* result */) {}
+
+    // """
+    // Called for an unparsable or illegal move, or a bad FEN header. After a
+    // bad move the rest of its variation is skipped.
+    // """
+    virtual void handle_error(std::string_view /* token */, std::string_view /* message */) {}
+
+    // """Called at the end of a game."""
+    virtual void end_game() {}
+};
+
+// NAGs for the traditional move suffixes.
+constexpr int NAG_GOOD_MOVE = 1;
+constexpr int NAG_MISTAKE = 2;
+constexpr int NAG_BRILLIANT_MOVE = 3;
+constexpr int NAG_BLUNDER = 4;
+constexpr int NAG_SPECULATIVE_MOVE = 5;
+constexpr int NAG_DUBIOUS_MOVE = 6;
+
+class Reader {
+    // """
+    // Reads games one after the other from PGN text held in memory, without
+    // copying it. Pair with :class:`~chess.pgn.MappedFile` for files.
+    // """
+    std::string_view text;
+    std::size_t pos = 0;
+
+    Board board;
+    // the moves of the line being read, so variations can be unwound.
+    std::vector<UndoRecord> undos;
+    struct Frame {
+        std::size_t undo_count;
+        Move branch;
+    };
+    std::vector<Frame> frames;
+
+    static constexpr auto is_space(char c) -> bool {
+        return c == ' ' || ('\t' <= c && c <= '\r');
+    }
+
+    static constexpr auto is_delimiter(char c) -> bool {
+        return is_space(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' ||
+               c == ';' || c == '$' || c == '!' || c == '?';
+    }
+
+    auto at_line_start() const -> bool {
+        return pos == 0 || text[pos - 1] == '\n';
+    }
+
+    void skip_line() {
+        while (pos < text.size() && text[pos] != '\n')
+            ++pos;
+    }
+
+    void skip_space() {
+        while (pos < text.size()) {
+            if (is_space(text[pos]))
+                ++pos;
+            else if (text[pos] == '%' && at_line_start())
+                // # Escape lines are ignored.
+                skip_line();
+            else
+                break;
+        }
+    }
+
+    auto read_comment() -> std::string_view {
+        // at a '{'. comments do not nest and run to the first '}'.
+        auto start = ++pos;
+        while (pos < text.size() && text[pos] != '}')
+            ++pos;
+        auto comment = text.substr(start, pos - start);
+        if (pos < text.size())
+            ++pos;
+        return comment;
+    }
+
+    void read_headers(Visitor& visitor) {
+        visitor.begin_headers();
+        std::string_view fen;
+        while (true) {
+            skip_space();
+            if (pos >= text.size() || text[pos] != '[')
+                break;
+            // # [Name "Value"]
+            ++pos;
+            while (pos < text.size() && is_space(text[pos]))
+                ++pos;
+            auto name_start = pos;
+            while (pos < text.size() && !is_space(text[pos]) && text[pos] != '"' && text[pos] != ']')
+                ++pos;
+            auto name = text.substr(name_start, pos - name_start);
+            while (pos < text.size() && text[pos] != '"' && text[pos] != ']' && text[pos] != '\n')
+                ++pos;
+            std::string_view value;
+            if (pos < text.size() && text[pos] == '"') {
+                auto value_start = ++pos;
+                while (pos < text.size() && text[pos] != '"' && text[pos] != '\n')
+                    pos += text[pos] == '\\' && pos + 1 < text.size() ? 2 : 1;
+                value = text.substr(value_start, pos - value_start);
+            }
+            skip_line();
+            visitor.visit_header(name, value);
+
+            if (name == "FEN") {
+                fen = value;
+            } else if (name == "Variant") {
+                for (auto chess960 : {"chess960"sv, "Chess960"sv, "Chess 960"sv, "fischerandom"sv, "Fischerandom"sv}) {
+                    if (value == chess960)
+                        board.chess960 = true;
+                }
+            }
+        }
+
+        // # The variant decides how the castling part of the FEN reads.
+        if (!fen.empty()) {
+            auto error = board.try_set_fen(fen);
+            if (error != FenError::ok)
+                visitor.handle_error(fen, fen_error_message(error));
+        }
+    }
+
+    void skip_movetext() {
+        // runs to the next game: a '[' at the start of a line, outside comments.
+        while (pos < text.size()) {
+            auto c = text[pos];
+            if (c == '{')
+                read_comment();
+            else if (c == ';')
+                skip_line();
+            else if (c == '[' && at_line_start())
+                return;
+            else
+                ++pos;
+        }
+    }
+
+    void skip_variation() {
+        // just past a '(': runs past its matching ')'.
+        auto depth = 0;
+        while (pos < text.size()) {
+            auto c = text[pos];
+            if (c == '{') {
+                read_comment();
+                continue;
+            } else if (c == ';') {
+                skip_line();
+                continue;
+            } else if (c == '[' && at_line_start()) {
+                return;
+            } else if (c == '(') {
+                ++depth;
+            } else if (c == ')') {
+                if (depth-- == 0) {
+                    ++pos;
+                    return;
+                }
+            }
+            ++pos;
+        }
+    }
+
+    void read_nag(Visitor& visitor) {
+        auto start = pos;
+        if (text[pos] == '$') {
+            ++pos;
+            auto nag = 0;
+            while (pos < text.size() && '0' <= text[pos] && text[pos] <= '9')
+                nag = nag * 10 + (text[pos++] - '0');
+            if (pos - start > 1)
+                visitor.visit_nag(nag);
+            return;
+        }
+        while (pos < text.size() && (text[pos] == '!' || text[pos] == '?'))
+            ++pos;
+        auto suffix = text.substr(start, pos - start);
+        if (suffix == "!")
+            visitor.visit_nag(NAG_GOOD_MOVE);
+        else if (suffix == "?")
+            visitor.visit_nag(NAG_MISTAKE);
+        else if (suffix == "!!")
+            visitor.visit_nag(NAG_BRILLIANT_MOVE);
+        else if (suffix == "??")
+            visitor.visit_nag(NAG_BLUNDER);
+        else if (suffix == "!?")
+            visitor.visit_nag(NAG_SPECULATIVE_MOVE);
+        else if (suffix == "?!")
+            visitor.visit_nag(NAG_DUBIOUS_MOVE);
+    }
+
+    auto line_start() const -> std::size_t {
+        return frames.empty() ? 0 : frames.back().undo_count;
+    }
+
+    void unwind(std::size_t undo_count) {
+        while (undos.size() > undo_count) {
+            board.pop_fast(undos.back());
+            undos.pop_back();
+        }
+    }
+
+    void read_movetext(Visitor& visitor) {
+        // set after an illegal move: the rest of that line is skipped.
+        auto broken = false;
+
+        while (true) {
+            skip_space();
+            if (pos >= text.size())
+                return;
+
+            auto c = text[pos];
+            if (c == '{') {
+                auto comment = read_comment();
+                if (!broken)
+                    visitor.visit_comment(comment);
+            } else if (c == ';') {
+                skip_line();
+            } else if (c == '$' || c == '!' || c == '?') {
+                if (broken)
+                    ++pos;
+                else
+                    read_nag(visitor);
+            } else if (c == '(') {
+                ++pos;
+                // # A variation replaces the last move of the current line.
+                if (broken || undos.size() == line_start() || visitor.begin_variation() == SKIP) {
+                    skip_variation();
+                    continue;
+                }
+                auto branch = undos.back().move.to_move();
+                board.pop_fast(undos.back());
+                undos.pop_back();
+                frames.push_back({undos.size(), branch});
+            } else if (c == ')') {
+                ++pos;
+                if (frames.empty())
+                    continue;
+                // # Back to the main line, with its last move played again.
+                auto frame = frames.back();
+                frames.pop_back();
+                unwind(frame.undo_count);
+                undos.emplace_back();
+                board.push_fast(frame.branch, undos.back());
+                broken = false;
+                visitor.end_variation();
+            } else if (c == '[') {
+                if (at_line_start())
+                    return;
+                ++pos;
+            } else {
+                auto start = pos;
+                while (pos < text.size() && !is_delimiter(text[pos]))
+                    ++pos;
+                auto token = text.substr(start, pos - start);
+                if (token.empty()) {
+                    // # A stray '}' or ']'.
+                    ++pos;
+                    continue;
+                }
+
+                // # Move numbers, possibly glued to the move like 1.e4.
+                auto digits = token.find_first_not_of("0123456789");
+                if (digits != 0 && digits != std::string_view::npos && token[digits] == '.') {
+                    auto dots = token.find_first_not_of('.', digits);
+                    if (dots == std::string_view::npos)
+                        continue;
+                    pos = start + dots;
+                    continue;
+                }
+
+                if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+                    if (frames.empty()) {
+                        visitor.visit_result(token);
+                        return;
+                    }
+                    continue;
+                }
+
+                if (broken)
+                    continue;
+                auto move = Move::null();
+                auto error = board.try_parse_san(token, move);
+                if (error != SanError::ok) {
+                    visitor.handle_error(token, san_error_message(error));
+                    broken = true;
+                    continue;
+                }
+                visitor.visit_move(board, move);
+                undos.emplace_back();
+                board.push_fast(move, undos.back());
+                visitor.visit_board(board);
+            }
+        }
+    }
+
+   public:
+    explicit Reader(std::string_view text) : text(text) {
+        // # Skip a UTF-8 byte order mark.
+        if (this->text.substr(0, 3) == "\xef\xbb\xbf")
+            pos = 3;
+    }
+
+    auto read_game(Visitor& visitor) -> bool {
+        // """
+        // Reads the next game and reports it to *visitor*. Returns ``false``
+        // once the input is exhausted.
+        // """
+        skip_space();
+        while (pos < text.size() && text[pos] == ';') {
+            skip_line();
+            skip_space();
+        }
+        if (pos >= text.size())
+            return false;
+
+        board.chess960 = false;
+        board.reset();
+        undos.clear();
+        frames.clear();
+
+        visitor.begin_game();
+        read_headers(visitor);
+        if (visitor.end_headers() == SKIP)
+            skip_movetext();
+        else
+            read_movetext(visitor);
+        visitor.end_game();
+        return true;
+    }
+
+    auto skip_game() -> bool {
+        // """
+        // Skips a game without reporting anything. Returns ``false`` once the
+        // input is exhausted.
+        // """
+        skip_space();
+        if (pos >= text.size())
+            return false;
+        while (pos < text.size() && text[pos] == '[') {
+            skip_line();
+            skip_space();
+        }
+        skip_movetext();
+        return true;
+    }
+
+    auto offset() const -> std::size_t {
+        // """The number of bytes of input consumed so far."""
+        return pos;
+    }
+};
+
+class MappedFile {
+    // """
+    // A read-only memory mapping of a whole file, advised for sequential
+    // reading, so multi-gigabyte PGN dumps can be read without copying.
+
+    // :raises: :exc:`std::runtime_error` if the file cannot be mapped.
+    // """
+    void* data = nullptr;
+    std::size_t size = 0;
+
+   public:
+    explicit MappedFile(const std::string& path) {
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + path);
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        size = (std::size_t)info.st_size;
+        if (size > 0) {
+            data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                data = nullptr;
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            ::madvise(data, size, MADV_SEQUENTIAL);
+        }
+        // the mapping keeps the file alive on its own.
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+    ~MappedFile() {
+        if (data)
+            ::munmap(data, size);
+    }
+
+    auto view() const -> std::string_view {
+        return data ? std::string_view((const char*)data, size) : std::string_view();
+    }
+};
+
+inline auto read_games(std::string_view text, Visitor& visitor) -> std::size_t {
+    // """Reads every game in *text*, and returns how many there were."""
+    Reader reader(text);
+    std::size_t games = 0;
+    while (reader.read_game(visitor))
+        ++games;
+    return games;
+}
+
+}  // namespace Chess::pgn
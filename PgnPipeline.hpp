@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Pgn.hpp"
+#include "ThreadPool.hpp"
+
+// bulk processing of PGN and EPD text on a thread pool. the input is cut into
+// chunks of whole games (or lines), each chunk is handed to a job on some
+// worker, and the job's results come back to the calling thread. workers
+// share nothing but the input, so throughput scales with the cores there are.
+
+namespace Chess::pgn {
+
+inline auto split_games(std::string_view text, std::size_t chunk_bytes = 1 << 20) -> std::vector<std::string_view> {
+    // """
+    // Cuts PGN text into chunks of roughly *chunk_bytes*, only ever at the
+    // ``[Event `` tag that starts a line, so every chunk holds whole games.
+    // A chunk runs long rather than split a game.
+    // """
+    std::vector<std::string_view> chunks;
+    std::size_t start = 0;
+    while (start < text.size()) {
+        auto end = text.size();
+        if (text.size() - start > chunk_bytes) {
+            auto boundary = text.find("\n[Event ", start + chunk_bytes - 1);
+            if (boundary != std::string_view::npos)
+                end = boundary + 1;
+        }
+        chunks.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return chunks;
+}
+
+inline auto split_lines(std::string_view text, std::size_t chunk_bytes = 1 << 20) -> std::vector<std::string_view> {
+    // """
+    // Cuts line-based text, like an EPD file, into chunks of roughly
+    // *chunk_bytes* that end on a newline.
+    // """
+    std::vector<std::string_view> chunks;
+    std::size_t start = 0;
+    while (start < text.size()) {
+        auto end = text.size();
+        if (text.size() - start > chunk_bytes) {
+            auto boundary = text.find('\n', start + chunk_bytes - 1);
+            if (boundary != std::string_view::npos)
+                end = boundary + 1;
+        }
+        chunks.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return chunks;
+}
+
+struct PipelineOptions {
+    // worker threads; 0 means one per hardware thread.
+    unsigned threads = 0;
+    // deliver results in chunk order, or as soon as each chunk is done.
+    bool ordered = true;
+    // how many chunks may be queued or waiting for delivery per worker. this
+    // bounds the memory held by results that have not been consumed yet.
+    std::size_t window_per_thread = 4;
+};
+
+template <typename Job, typename Consumer>
+void run_pipeline(const std::vector<std::string_view>& chunks, Job job, Consumer consume, PipelineOptions options = {}) {
+    // """
+    // Runs ``job(chunk)`` for every chunk on a pool of worker threads, and
+    // passes each result to ``consume(index, result)`` on the calling thread,
+    // in chunk order if ``options.ordered``.
+
+    // *job* is called concurrently and must only touch its own state; the
+    // usual job builds a :class:`~chess.pgn.Reader` and a visitor on the
+    // stack, so each worker plays the games on a board of its own.
+    // """
+    using Result = decltype(job(std::string_view()));
+
+    auto threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    auto window = std::max<std::size_t>(threads * options.window_per_thread, 1);
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::vector<std::optional<Result>> results(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    std::vector<char> ready(chunks.size(), false);
+    std::deque<std::size_t> finished;
+
+    tpool::ThreadPool pool(threads);
+    std::size_t submitted = 0;
+    auto submit = [&] {
+        auto index = submitted++;
+        pool.submit([&, index] {
+            std::optional<Result> result;
+            std::exception_ptr error;
+            try {
+                result = job(chunks[index]);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            {
+                std::lock_guard lock(mutex);
+                results[index] = std::move(result);
+                errors[index] = error;
+                ready[index] = true;
+                if (!options.ordered)
+                    finished.push_back(index);
+            }
+            done.notify_one();
+        });
+    };
+    while (submitted < chunks.size() && submitted < window)
+        submit();
+
+    std::size_t next = 0;
+    for (std::size_t delivered = 0; delivered < chunks.size(); ++delivered) {
+        std::size_t index;
+        std::optional<Result> result;
+        {
+            std::unique_lock lock(mutex);
+            if (options.ordered) {
+                done.wait(lock, [&] { return (bool)ready[next]; });
+                index = next++;
+            } else {
+                done.wait(lock, [&] { return !finished.empty(); });
+                index = finished.front();
+                finished.pop_front();
+            }
+            // # The pool drains the chunks still in flight before unwinding.
+            if (errors[index])
+                std::rethrow_exception(errors[index]);
+            result = std::move(results[index]);
+            results[index].reset();
+        }
+        // # A slot in the window is free again.
+        if (submitted < chunks.size())
+            submit();
+        consume(index, std::move(*result));
+    }
+}
+
+template <typename Job, typename Consumer>
+void run_pipeline(std::string_view pgn, Job job, Consumer consume, PipelineOptions options = {}, std::size_t chunk_bytes = 1 << 20) {
+    // """Splits *pgn* with :func:`~chess.pgn.split_games()` and runs the chunks."""
+    run_pipeline(split_games(pgn, chunk_bytes), std::move(job), std::move(consume), options);
+}
+
+}  // namespace Chess::pgn
@@ -0,0 +1,245 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Pgn.hpp"
+#include "PgnPipeline.hpp"
+
+const std::string PGN = R"PGN([Event "Casual Game"]
+[White "Anderssen, \"The Immortal\""]
+[Black "Kieseritzky"]
+[Result "1-0"]
+
+1.e4 e5 2. Qh5 {early queen} Nc6 (2... g6 3. Qf3 (3. Qxe5+ Qe7) Nf6) 3. Bc4!? Nf6?? $4
+% an escape line, ignored
+4. Qxf7# 1-0
+
+[Event "From a position"]
+[FEN "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1"]
+
+1. e4 Kd7 ; a rest of line comment
+2. e5 *
+
+[Event "Broken"]
+
+1. e4 e5 2. Ke3 Nc6 3. Nf3 0-1
+
+[Event "Skipped"]
+
+1. d4 {a comment with [brackets]
+[Event "not a header"] spread over lines} d5 1/2-1/2
+)PGN";
+
+struct Recorder : Chess::pgn::Visitor {
+    struct Game {
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::vector<std::string> mainline;
+        std::vector<std::string> variations;
+        std::vector<std::string> comments;
+        std::vector<int> nags;
+        std::vector<std::string> errors;
+        std::string result;
+    };
+    std::vector<Game> games;
+    int depth = 0;
+    bool skip_variations = false;
+
+    void begin_game() override {
+        games.emplace_back();
+        depth = 0;
+    }
+    void visit_header(std::string_view name, std::string_view value) override {
+        games.back().headers.emplace_back(name, value);
+    }
+    auto end_headers() -> Chess::pgn::SkipType override {
+        for (auto& [name, value] : games.back().headers) {
+            if (name == "Event" && value == "Skipped")
+                return Chess::pgn::SKIP;
+        }
+        return Chess::pgn::PROCEED;
+    }
+    void visit_move(Chess::Board& board, Chess::Move move) override {
+        (depth == 0 ? games.back().mainline : games.back().variations).push_back(board.san(move));
+    }
+    void visit_comment(std::string_view comment) override {
+        games.back().comments.emplace_back(comment);
+    }
+    void visit_nag(int nag) override {
+        games.back().nags.push_back(nag);
+    }
+    auto begin_variation() -> Chess::pgn::SkipType override {
+        if (skip_variations)
+            return Chess::pgn::SKIP;
+        ++depth;
+        return Chess::pgn::PROCEED;
+    }
+    void end_variation() override {
+        --depth;
+    }
+    void visit_result(std::string_view result) override {
+        games.back().result = result;
+    }
+    void handle_error(std::string_view token, std::string_view) override {
+        games.back().errors.emplace_back(token);
+    }
+};
+
+auto test_read_games() {
+    Recorder recorder;
+    if (Chess::pgn::read_games(PGN, recorder) != 4)
+        return false;
+    auto& games = recorder.games;
+
+    auto& immortal = games[0];
+    if (immortal.headers.size() != 4 || immortal.headers[1].second != "Anderssen, \\\"The Immortal\\\"")
+        return false;
+    if (immortal.mainline != std::vector<std::string>{"e4", "e5", "Qh5", "Nc6", "Bc4", "Nf6", "Qxf7#"})
+        return false;
+    if (immortal.variations != std::vector<std::string>{"g6", "Qf3", "Qxe5+", "Qe7", "Nf6"})
+        return false;
+    if (immortal.comments != std::vector<std::string>{"early queen"} || immortal.nags != std::vector<int>{5, 4, 4} ||
+        immortal.result != "1-0")
+        return false;
+
+    auto& endgame = games[1];
+    if (endgame.mainline != std::vector<std::string>{"e4", "Kd7", "e5"} || endgame.result != "*")
+        return false;
+
+    // the illegal king move is reported, and the rest of the game ignored.
+    auto& broken = games[2];
+    if (broken.mainline != std::vector<std::string>{"e4", "e5"} || broken.errors != std::vector<std::string>{"Ke3"} ||
+        broken.result != "0-1")
+        return false;
+
+    auto& skipped = games[3];
+    return skipped.headers.size() == 1 && skipped.mainline.empty() && skipped.comments.empty();
+}
+
+auto test_skip_variations() {
+    Recorder recorder;
+    recorder.skip_variations = true;
+    Chess::pgn::Reader reader(PGN);
+    if (!reader.read_game(recorder))
+        return false;
+    auto& game = recorder.games[0];
+    if (!game.variations.empty() || game.mainline.size() != 7)
+        return false;
+    // skip_game() passes over whole games without a visitor.
+    return reader.skip_game() && reader.skip_game() && reader.read_game(recorder) &&
+           recorder.games.back().headers.size() == 1 && !reader.read_game(recorder) && !reader.skip_game();
+}
+
+auto test_mapped_file() {
+    auto path = std::string("pgn_tests.pgn");
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "\xef\xbb\xbf" << PGN;
+    }
+    Recorder recorder;
+    std::size_t games = 0;
+    {
+        Chess::pgn::MappedFile file(path);
+        games = Chess::pgn::read_games(file.view(), recorder);
+    }
+    std::remove(path.c_str());
+    if (games != 4 || recorder.games[0].headers[0].first != "Event")
+        return false;
+    try {
+        Chess::pgn::MappedFile missing("no/such/file.pgn");
+        return false;
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+}
+
+// records the round of every game, and whether it ended in checkmate.
+struct OutcomeVisitor : Chess::pgn::Visitor {
+    std::vector<std::pair<int, bool>> games;
+    Chess::Board* board = nullptr;
+
+    void visit_header(std::string_view name, std::string_view value) override {
+        if (name == "Round")
+            games.emplace_back(std::stoi(std::string(value)), false);
+    }
+    void visit_board(Chess::Board& board) override {
+        this->board = &board;
+    }
+    void end_game() override {
+        if (board) {
+            auto outcome = board->outcome();
+            games.back().second = outcome.has_value() && outcome->termination == Chess::Termination::CHECKMATE;
+        }
+        board = nullptr;
+    }
+};
+
+auto test_pipeline() {
+    std::string pgn;
+    for (auto round = 0; round < 300; ++round) {
+        pgn += "[Event \"Pipeline\"]\n[Round \"" + std::to_string(round) + "\"]\n\n";
+        pgn += round % 3 ? "1. f3 e5 2. g4 Qh4# 0-1\n\n" : "1. e4 e5 2. Nf3 *\n\n";
+    }
+    auto chunks = Chess::pgn::split_games(pgn, 200);
+    if (chunks.size() < 50)
+        return false;
+
+    auto job = [](std::string_view chunk) {
+        OutcomeVisitor visitor;
+        Chess::pgn::read_games(chunk, visitor);
+        return visitor.games;
+    };
+    for (auto ordered : {true, false}) {
+        std::vector<std::pair<int, bool>> games;
+        std::vector<std::size_t> indices;
+        Chess::pgn::PipelineOptions options;
+        options.threads = 4;
+        options.ordered = ordered;
+        Chess::pgn::run_pipeline(chunks, job, [&](std::size_t index, std::vector<std::pair<int, bool>> result) {
+            indices.push_back(index);
+            games.insert(games.end(), result.begin(), result.end());
+        }, options);
+        if (ordered && !std::is_sorted(indices.begin(), indices.end()))
+            return false;
+        std::sort(games.begin(), games.end());
+        if (games.size() != 300)
+            return false;
+        for (auto round = 0; round < 300; ++round) {
+            if (games[round] != std::make_pair(round, round % 3 != 0))
+                return false;
+        }
+    }
+    return true;
+}
+
+auto test_pipeline_epd() {
+    std::string epd;
+    for (auto i = 0; i < 1000; ++i)
+        epd += i % 10 ? "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq -\n" : "not an epd\n";
+    std::size_t valid = 0;
+    Chess::pgn::PipelineOptions options;
+    options.threads = 3;
+    options.ordered = false;
+    Chess::pgn::run_pipeline(Chess::pgn::split_lines(epd, 1000), [](std::string_view chunk) {
+        auto board = Chess::Board();
+        std::size_t valid = 0;
+        while (!chunk.empty()) {
+            auto end = chunk.find('\n');
+            valid += board.try_set_epd(chunk.substr(0, end)) == Chess::FenError::ok;
+            chunk.remove_prefix(end == std::string_view::npos ? chunk.size() : end + 1);
+        }
+        return valid;
+    }, [&](std::size_t, std::size_t count) { valid += count; }, options);
+    return valid == 900;
+}
+
+int main() {
+    std::cout << "test_read_games:      " << (test_read_games() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_skip_variations: " << (test_skip_variations() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_mapped_file:     " << (test_mapped_file() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_pipeline:        " << (test_pipeline() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_pipeline_epd:    " << (test_pipeline_epd() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "target.hpp"
+
+// a port of chess.polyglot's reader. a book is a file of 16 byte big-endian
+// entries sorted by key: the zobrist key, the move, its weight and a learn
+// word. the file is mapped rather than read, so opening even a huge book
+// costs nothing, and a lookup touches only the pages its binary search lands
+// on.
+//
+// the keys are Board::zobrist_hash(), which is the Polyglot key, so any
+// published book works as is.
+
+namespace Chess::polyglot {
+
+constexpr std::size_t ENTRY_SIZE = 16;
+
+struct Entry {
+    // """An entry from a Polyglot opening book."""
+
+    std::uint64_t key;
+    // """The Zobrist hash of the position."""
+
+    std::uint16_t raw_move;
+    // """
+    // The raw binary representation of the move. Use
+    // :data:`~chess.polyglot.Entry.move` instead.
+    // """
+
+    std::uint16_t weight;
+    // """An integer value that can be used as the weight for this entry."""
+
+    std::uint32_t learn;
+    // """Another integer value that can be used for extra information."""
+
+    Move move;
+    // """The :class:`~chess.Move`."""
+};
+
+class MemoryMappedReader {
+    // """Maps a Polyglot opening book to memory."""
+    const unsigned char* data = nullptr;
+    std::size_t mapped_bytes = 0;
+    std::size_t entries = 0;
+
+    static auto _be(const unsigned char* p, int bytes) -> std::uint64_t {
+        std::uint64_t value = 0;
+        for (auto i = 0; i < bytes; ++i)
+            value = value << 8 | p[i];
+        return value;
+    }
+
+    auto _key_at(std::size_t index) const -> std::uint64_t {
+        return _be(data + index * ENTRY_SIZE, 8);
+    }
+
+    void close() {
+        if (data)
+            munmap((void*)data, mapped_bytes);
+        data = nullptr;
+        mapped_bytes = 0;
+        entries = 0;
+    }
+
+   public:
+    explicit MemoryMappedReader(const std::string& filename) {
+        // """:raises: :exc:`std::runtime_error` if the file cannot be opened or mapped."""
+        auto fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + filename);
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + filename);
+        }
+        // # A trailing partial entry is ignored.
+        auto size = (std::size_t)info.st_size;
+        if (size >= ENTRY_SIZE) {
+            auto memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + filename);
+            }
+            // # Lookups are binary searches, so reading ahead only wastes
+            // # page cache.
+            madvise(memory, size, MADV_RANDOM);
+            data = (const unsigned char*)memory;
+            mapped_bytes = size;
+            entries = size / ENTRY_SIZE;
+        }
+        ::close(fd);
+    }
+
+    MemoryMappedReader(const MemoryMappedReader&) = delete;
+    auto operator=(const MemoryMappedReader&) -> MemoryMappedReader& = delete;
+
+    ~MemoryMappedReader() {
+        close();
+    }
+
+    auto size() const -> std::size_t {
+        // """Gets the number of entries in the book."""
+        return entries;
+    }
+
+    auto operator[](std::size_t index) const -> Entry {
+        // """
+        // Gets the entry at *index*. The move is decoded as stored, with
+        // castling as the king taking its own rook.
+        // """
+        auto p = data + index * ENTRY_SIZE;
+        auto raw_move = (std::uint16_t)_be(p + 8, 2);
+        auto to_square = (Square)(raw_move & 0x3f);
+        auto from_square = (Square)((raw_move >> 6) & 0x3f);
+        auto promotion_part = (raw_move >> 12) & 0x7;
+        auto promotion = promotion_part ? std::optional<PieceType>((PieceType)(promotion_part + 1)) : std::nullopt;
+        // # Null moves are stored as a1a1.
+        auto move = from_square == to_square && !promotion ? Move::null() : Move(from_square, to_square, promotion);
+        return Entry{_key_at(index), raw_move, (std::uint16_t)_be(p + 10, 2), (std::uint32_t)_be(p + 12, 4), move};
+    }
+
+    auto bisect_key_left(std::uint64_t key) const -> std::size_t {
+        // """Gets the index of the first entry with a key not below *key*."""
+        std::size_t lo = 0, hi = entries;
+        while (lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            if (_key_at(mid) < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    auto find_all(Board& board, int minimum_weight = 1, const std::vector<Move>& exclude_moves = {}) const -> std::vector<Entry> {
+        // """
+        // Gets all entries for the position of *board*, in the order they are
+        // stored. Entries below *minimum_weight* and moves in *exclude_moves*
+        // are skipped. Castling moves are converted to the encoding of the
+        // board, so standard boards get e1g1 for e1h1.
+        // """
+        std::vector<Entry> found;
+        auto key = board.zobrist_hash();
+        for (auto i = bisect_key_left(key); i < entries && _key_at(i) == key; ++i) {
+            auto entry = (*this)[i];
+            if (entry.weight < minimum_weight)
+                continue;
+            auto& move = entry.move;
+            if (move.__bool__())
+                move = board._from_chess960(board.chess960, move.from_square, move.to_square, move.promotion, move.drop);
+            if (std::find(exclude_moves.begin(), exclude_moves.end(), move) != exclude_moves.end())
+                continue;
+            found.push_back(entry);
+        }
+        return found;
+    }
+
+    auto get(Board& board, int minimum_weight = 1, const std::vector<Move>& exclude_moves = {}) const -> std::optional<Entry> {
+        // """
+        // Gets the entry with the highest weight, the first stored among
+        // equals, or ``std::nullopt`` if there is none.
+        // """
+        std::optional<Entry> best;
+        for (auto& entry : find_all(board, minimum_weight, exclude_moves)) {
+            if (!best || entry.weight > best->weight)
+                best = entry;
+        }
+        return best;
+    }
+
+    auto find(Board& board, int minimum_weight = 1, const std::vector<Move>& exclude_moves = {}) const -> Entry {
+        // """
+        // Like :func:`~chess.polyglot.MemoryMappedReader.get()`.
+
+        // :raises: :exc:`std::out_of_range` if no entries are found.
+        // """
+        auto entry = get(board, minimum_weight, exclude_moves);
+        if (!entry)
+            throw std::out_of_range("no book entry for " + board.fen());
+        return *entry;
+    }
+
+    template <typename Random>
+    auto choice(Board& board, Random& random, int minimum_weight = 1, const std::vector<Move>& exclude_moves = {}) const -> Entry {
+        // """
+        // Picks one of the entries for the position uniformly at random.
+
+        // :raises: :exc:`std::out_of_range` if no entries are found.
+        // """
+        auto found = find_all(board, minimum_weight, exclude_moves);
+        if (found.empty())
+            throw std::out_of_range("no book entry for " + board.fen());
+        return found[std::uniform_int_distribution<std::size_t>(0, found.size() - 1)(random)];
+    }
+
+    template <typename Random>
+    auto weighted_choice(Board& board, Random& random, const std::vector<Move>& exclude_moves = {}) const -> Entry {
+        // """
+        // Picks one of the entries for the position at random, with the
+        // probability of each proportional to its weight.
+
+        // :raises: :exc:`std::out_of_range` if no entries are found.
+        // """
+        auto found = find_all(board, 1, exclude_moves);
+        if (found.empty())
+            throw std::out_of_range("no book entry for " + board.fen());
+        std::uint64_t total = 0;
+        for (auto& entry : found)
+            total += entry.weight;
+        auto pick = std::uniform_int_distribution<std::uint64_t>(0, total - 1)(random);
+        for (auto& entry : found) {
+            if (pick < entry.weight)
+                return entry;
+            pick -= entry.weight;
+        }
+        return found.back();
+    }
+};
+
+inline auto open_reader(const std::string& path) -> std::unique_ptr<MemoryMappedReader> {
+    // """Creates a reader for the file at the given path."""
+    return std::make_unique<MemoryMappedReader>(path);
+}
+
+}  // namespace Chess::polyglot
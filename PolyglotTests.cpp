@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Polyglot.hpp"
+
+struct RawEntry {
+    std::uint64_t key;
+    std::uint16_t move;
+    std::uint16_t weight;
+};
+
+auto raw_move(Square from, Square to, int promotion = 0) -> std::uint16_t {
+    return (std::uint16_t)(promotion << 12 | from << 6 | to);
+}
+
+auto write_book(const std::string& path, std::vector<RawEntry> entries) {
+    // # Books are sorted by key, big-endian.
+    std::stable_sort(entries.begin(), entries.end(), [](auto& a, auto& b) { return a.key < b.key; });
+    auto file = std::fopen(path.c_str(), "wb");
+    for (auto& entry : entries) {
+        unsigned char bytes[16] = {};
+        for (auto i = 0; i < 8; ++i)
+            bytes[i] = (unsigned char)(entry.key >> (56 - 8 * i));
+        bytes[8] = (unsigned char)(entry.move >> 8);
+        bytes[9] = (unsigned char)entry.move;
+        bytes[10] = (unsigned char)(entry.weight >> 8);
+        bytes[11] = (unsigned char)entry.weight;
+        bytes[15] = 7;
+        std::fwrite(bytes, 1, sizeof(bytes), file);
+    }
+    std::fclose(file);
+}
+
+const std::string CASTLING_FEN = "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1";
+
+auto make_book(const std::string& path) {
+    auto start = Chess::Board();
+    auto castling = Chess::Board(CASTLING_FEN);
+    auto promotion = Chess::Board("8/4P3/8/8/8/8/k7/4K3 w - - 0 1");
+    std::vector<RawEntry> entries = {
+        {start.zobrist_hash(), raw_move(E2, E4), 10},
+        {start.zobrist_hash(), raw_move(D2, D4), 30},
+        {start.zobrist_hash(), raw_move(G1, F3), 0},
+        {castling.zobrist_hash(), raw_move(E1, H1), 5},
+        {castling.zobrist_hash(), raw_move(E1, A1), 5},
+        {promotion.zobrist_hash(), raw_move(E7, E8, 4), 1},
+        // # Keyed like a real book: the published keys after 1. e4 and 1. e4 d5.
+        {0x823c9b50fd114196ULL, raw_move(E7, E5), 12},
+        {0x0756b94461c50fb0ULL, raw_move(E4, D5), 8},
+    };
+    // # Unrelated keys around the real ones, for the binary search.
+    std::uint64_t seed = 5;
+    for (auto i = 0; i < 1000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        entries.push_back({seed, raw_move(A2, A3), 1});
+    }
+    write_book(path, entries);
+}
+
+auto test_find() {
+    auto path = std::string("polyglot_tests.bin");
+    make_book(path);
+    Chess::polyglot::MemoryMappedReader book(path);
+    auto start = Chess::Board();
+    auto all = book.find_all(start);
+    auto best = book.find(start);
+    auto ok = book.size() == 1008 && all.size() == 2 && all[0].move == Chess::Move(E2, E4) &&
+              all[0].learn == 7 && best.move == Chess::Move(D2, D4) && best.weight == 30 &&
+              book.find_all(start, 0).size() == 3 && book.get(start, 31) == std::nullopt &&
+              book.find(start, 1, {Chess::Move(D2, D4)}).move == Chess::Move(E2, E4);
+
+    auto promotion = Chess::Board("8/4P3/8/8/8/8/k7/4K3 w - - 0 1");
+    ok = ok && book.find(promotion).move == Chess::Move(E7, E8, Chess::PieceType::QUEEN);
+
+    try {
+        auto empty = Chess::Board(std::nullopt);
+        book.find(empty);
+        ok = false;
+    } catch (const std::out_of_range&) {
+    }
+    std::remove(path.c_str());
+    return ok;
+}
+
+auto test_published_keys() {
+    auto path = std::string("polyglot_tests.bin");
+    make_book(path);
+    Chess::polyglot::MemoryMappedReader book(path);
+    auto board = Chess::Board();
+    board.push(Chess::Move(E2, E4));
+    auto reply = book.find(board);
+    board.push(Chess::Move(D7, D5));
+    auto capture = book.find(board);
+    std::remove(path.c_str());
+    return reply.move == Chess::Move(E7, E5) && reply.weight == 12 && capture.move == Chess::Move(E4, D5);
+}
+
+auto test_castling() {
+    // # Books store castling as the king taking its rook.
+    auto path = std::string("polyglot_tests.bin");
+    make_book(path);
+    Chess::polyglot::MemoryMappedReader book(path);
+    auto standard = Chess::Board(CASTLING_FEN);
+    auto chess960 = Chess::Board(CASTLING_FEN, true);
+    auto moves = book.find_all(standard);
+    auto moves960 = book.find_all(chess960);
+    std::remove(path.c_str());
+    return moves.size() == 2 && moves[0].move == Chess::Move(E1, G1) && moves[1].move == Chess::Move(E1, C1) &&
+           standard.is_castling(moves[0].move) && moves960[0].move == Chess::Move(E1, H1) &&
+           book[book.bisect_key_left(standard.zobrist_hash())].move == Chess::Move(E1, H1);
+}
+
+auto test_weighted_choice() {
+    auto path = std::string("polyglot_tests.bin");
+    make_book(path);
+    Chess::polyglot::MemoryMappedReader book(path);
+    auto start = Chess::Board();
+    std::mt19937_64 random(1);
+    auto d4 = 0;
+    for (auto i = 0; i < 4000; ++i)
+        d4 += book.weighted_choice(start, random).move == Chess::Move(D2, D4);
+    auto e4 = 0;
+    for (auto i = 0; i < 4000; ++i)
+        e4 += book.choice(start, random).move == Chess::Move(E2, E4);
+    std::remove(path.c_str());
+    // # Weights 30 and 10 against a fair coin.
+    return d4 > 2800 && d4 < 3200 && e4 > 1800 && e4 < 2200;
+}
+
+auto test_open_errors() {
+    try {
+        Chess::polyglot::MemoryMappedReader missing("no/such/book.bin");
+        return false;
+    } catch (const std::runtime_error&) {
+    }
+    auto path = std::string("polyglot_tests.bin");
+    write_book(path, {});
+    Chess::polyglot::MemoryMappedReader empty(path);
+    auto board = Chess::Board();
+    auto ok = empty.size() == 0 && empty.find_all(board).empty();
+    std::remove(path.c_str());
+    return ok;
+}
+
+int main() {
+    std::cout << "test_find:            " << (test_find() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_published_keys:  " << (test_published_keys() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_castling:        " << (test_castling() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_weighted_choice: " << (test_weighted_choice() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_open_errors:     " << (test_open_errors() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
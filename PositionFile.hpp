@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "PackedPosition.hpp"
+
+// files of packed positions, for training data. a 16 byte header is followed
+// by blocks of up to a few thousand positions. each block starts with 16 bytes
+// of its own: the position count, the compression, the stored size of the
+// payload and a reserved word.
+//
+// the one codec, delta_rle, xors every position with the one before it in
+// the block and run-length encodes the zero bytes that leaves. positions
+// dumped from the same game differ in a handful of nibbles, so this removes
+// most of the bulk at a fraction of the cost of a general purpose compressor.
+
+namespace Chess {
+
+enum class PositionCompression : std::uint32_t {
+    none = 0,
+    delta_rle = 1,
+};
+
+namespace posfile {
+
+constexpr char MAGIC[8] = {'C', 'P', 'O', 'S', 'P', 'A', 'C', 'K'};
+constexpr std::uint32_t VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+};
+
+struct BlockHeader {
+    std::uint32_t count;
+    std::uint32_t compression;
+    std::uint32_t stored_bytes;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 16 && sizeof(BlockHeader) == 16);
+
+// tokens below 128 are followed by token + 1 literal bytes; the rest stand
+// for token - 127 zero bytes.
+inline void compress(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out) {
+    std::size_t i = 0;
+    while (i < size) {
+        auto zeros = std::size_t{0};
+        while (i + zeros < size && zeros < 128 && data[i + zeros] == 0)
+            ++zeros;
+        if (zeros >= 2) {
+            out.push_back((std::uint8_t)(127 + zeros));
+            i += zeros;
+            continue;
+        }
+        // # Literals, up to the next run of two zeros.
+        auto start = i;
+        while (i < size && i - start < 128 && !(data[i] == 0 && i + 1 < size && data[i + 1] == 0))
+            ++i;
+        out.push_back((std::uint8_t)(i - start - 1));
+        out.insert(out.end(), data + start, data + i);
+    }
+}
+
+inline auto decompress(const std::uint8_t* data, std::size_t size, std::uint8_t* out, std::size_t out_size) -> bool {
+    std::size_t i = 0, o = 0;
+    while (i < size) {
+        auto token = data[i++];
+        if (token >= 128) {
+            std::size_t zeros = token - 127;
+            if (o + zeros > out_size)
+                return false;
+            std::memset(out + o, 0, zeros);
+            o += zeros;
+        } else {
+            std::size_t literals = token + 1;
+            if (i + literals > size || o + literals > out_size)
+                return false;
+            std::memcpy(out + o, data + i, literals);
+            i += literals;
+            o += literals;
+        }
+    }
+    return o == out_size;
+}
+
+// xors each 32 byte record with the one before it, or undoes that.
+inline void delta_encode(std::uint8_t* data, std::size_t count) {
+    for (auto i = count; i-- > 1;) {
+        for (std::size_t j = 0; j < sizeof(PackedPosition); ++j)
+            data[i * sizeof(PackedPosition) + j] ^= data[(i - 1) * sizeof(PackedPosition) + j];
+    }
+}
+
+inline void delta_decode(std::uint8_t* data, std::size_t count) {
+    for (std::size_t i = 1; i < count; ++i) {
+        for (std::size_t j = 0; j < sizeof(PackedPosition); ++j)
+            data[i * sizeof(PackedPosition) + j] ^= data[(i - 1) * sizeof(PackedPosition) + j];
+    }
+}
+
+}  // namespace posfile
+
+class PositionFileWriter {
+    // """
+    // Writes packed positions to a file in blocks of *block_size*.
+    // Positions are buffered until a block fills up; call
+    // :func:`~chess.PositionFileWriter.close()` to write the last one and
+    // see any error.
+
+    // :raises: :exc:`std::runtime_error` if the file cannot be written.
+    // """
+    std::ofstream out;
+    std::string path;
+    PositionCompression compression;
+    std::size_t block_size;
+    std::vector<PackedPosition> block;
+    std::vector<std::uint8_t> buffer;
+
+    void write_bytes(const void* data, std::size_t size) {
+        out.write((const char*)data, (std::streamsize)size);
+        if (!out)
+            throw std::runtime_error("cannot write " + path);
+    }
+
+   public:
+    explicit PositionFileWriter(const std::string& path, PositionCompression compression = PositionCompression::delta_rle, std::size_t block_size = 4096)
+        : out(path, std::ios::binary | std::ios::trunc), path(path), compression(compression), block_size(std::max<std::size_t>(block_size, 1)) {
+        if (!out)
+            throw std::runtime_error("cannot open " + path);
+        posfile::FileHeader header{};
+        std::memcpy(header.magic, posfile::MAGIC, sizeof(header.magic));
+        header.version = posfile::VERSION;
+        header.record_size = sizeof(PackedPosition);
+        write_bytes(&header, sizeof(header));
+        block.reserve(this->block_size);
+    }
+
+    PositionFileWriter(const PositionFileWriter&) = delete;
+    auto operator=(const PositionFileWriter&) -> PositionFileWriter& = delete;
+
+    ~PositionFileWriter() {
+        try {
+            close();
+        } catch (const std::exception&) {
+        }
+    }
+
+    void write(const PackedPosition& position) {
+        block.push_back(position);
+        if (block.size() == block_size)
+            flush();
+    }
+
+    void write(const Board& board, std::int16_t score = 0, std::int8_t result = 0) {
+        write(PackedPosition::from_board(board, score, result));
+    }
+
+    void flush() {
+        // """Writes the positions buffered so far as a block of their own."""
+        if (block.empty() || !out.is_open())
+            return;
+        posfile::BlockHeader header{};
+        header.count = (std::uint32_t)block.size();
+        header.compression = (std::uint32_t)compression;
+
+        auto raw = (std::uint8_t*)block.data();
+        auto raw_bytes = block.size() * sizeof(PackedPosition);
+        if (compression == PositionCompression::delta_rle) {
+            posfile::delta_encode(raw, block.size());
+            buffer.clear();
+            posfile::compress(raw, raw_bytes, buffer);
+            header.stored_bytes = (std::uint32_t)buffer.size();
+            write_bytes(&header, sizeof(header));
+            write_bytes(buffer.data(), buffer.size());
+        } else {
+            header.stored_bytes = (std::uint32_t)raw_bytes;
+            write_bytes(&header, sizeof(header));
+            write_bytes(raw, raw_bytes);
+        }
+        block.clear();
+    }
+
+    void close() {
+        if (!out.is_open())
+            return;
+        flush();
+        out.close();
+        if (!out)
+            throw std::runtime_error("cannot write " + path);
+    }
+};
+
+class PositionFileReader {
+    // """
+    // Reads back a file written by :class:`~chess.PositionFileWriter`,
+    // a block at a time.
+
+    // :raises: :exc:`std::runtime_error` if the file cannot be read or is
+    //     not a packed position file.
+    // """
+    std::ifstream in;
+    std::string path;
+    std::vector<PackedPosition> block;
+    std::size_t next = 0;
+    std::vector<std::uint8_t> buffer;
+
+   public:
+    explicit PositionFileReader(const std::string& path) : in(path, std::ios::binary), path(path) {
+        if (!in)
+            throw std::runtime_error("cannot open " + path);
+        posfile::FileHeader header{};
+        in.read((char*)&header, sizeof(header));
+        if (!in || std::memcmp(header.magic, posfile::MAGIC, sizeof(header.magic)) != 0)
+            throw std::runtime_error("not a packed position file: " + path);
+        if (header.version != posfile::VERSION || header.record_size != sizeof(PackedPosition))
+            throw std::runtime_error("unsupported packed position file version: " + path);
+    }
+
+    auto read_block(std::vector<PackedPosition>& positions) -> bool {
+        // """
+        // Replaces the contents of *positions* with the next block. Returns
+        // ``false`` at the end of the file.
+        // """
+        posfile::BlockHeader header{};
+        in.read((char*)&header, sizeof(header));
+        if (in.gcount() == 0)
+            return false;
+        if (!in)
+            throw std::runtime_error("truncated block header in " + path);
+
+        positions.resize(header.count);
+        auto raw = (std::uint8_t*)positions.data();
+        auto raw_bytes = positions.size() * sizeof(PackedPosition);
+        if (header.compression == (std::uint32_t)PositionCompression::delta_rle) {
+            buffer.resize(header.stored_bytes);
+            in.read((char*)buffer.data(), (std::streamsize)buffer.size());
+            if (!in || !posfile::decompress(buffer.data(), buffer.size(), raw, raw_bytes))
+                throw std::runtime_error("corrupt block in " + path);
+            posfile::delta_decode(raw, positions.size());
+        } else if (header.compression == (std::uint32_t)PositionCompression::none) {
+            if (header.stored_bytes != raw_bytes)
+                throw std::runtime_error("corrupt block in " + path);
+            in.read((char*)raw, (std::streamsize)raw_bytes);
+            if (!in)
+                throw std::runtime_error("truncated block in " + path);
+        } else {
+            throw std::runtime_error("unknown block compression in " + path);
+        }
+        return true;
+    }
+
+    auto read(PackedPosition& position) -> bool {
+        // """Reads the next position. Returns ``false`` at the end of the file."""
+        while (next == block.size()) {
+            next = 0;
+            if (!read_block(block))
+                return false;
+        }
+        position = block[next++];
+        return true;
+    }
+};
+
+}  // namespace Chess
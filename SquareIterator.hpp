@@ -9,6 +9,10 @@ namespace sqgen {
 constexpr auto Forward = true;
 constexpr auto Reverse = false;
 
+// the iterator is just the bits still to visit: dereferencing is one tzcnt
+// (or lzcnt), stepping clears that bit (blsr going forward), and reaching
+// the end is the bitboard running out, so a range-for over a Range compiles
+// to the same loop as one written out by hand.
 template <typename Square, bool Direction>
 class SquareIterator {
     unsigned long long bb;
@@ -19,14 +23,10 @@ class SquareIterator {
     using pointer = value_type*;
     using reference = value_type&;
 
-    SquareIterator(unsigned long long bb) {
-        this->bb = bb;
-    }
-    SquareIterator() {
-        this->bb = BB_EMPTY;
-    }
+    constexpr SquareIterator(unsigned long long bb) noexcept : bb(bb) {}
+    constexpr SquareIterator() noexcept : bb(BB_EMPTY) {}
 
-    auto operator*() -> value_type {
+    constexpr auto operator*() const noexcept -> value_type {
         if constexpr (Direction == Forward) {
             return (Square)__builtin_ctzll(bb);
         } else {
@@ -34,42 +34,41 @@ class SquareIterator {
         }
     }
 
-    auto peek() -> value_type {
+    constexpr auto peek() const noexcept -> value_type {
         return operator*();
     }
 
     // Prefix increment
-    inline SquareIterator& operator++() {
+    constexpr SquareIterator& operator++() noexcept {
         if constexpr (Direction == Forward) {
             bb &= bb - 1;
         } else {
-            bb ^= BB_SQUARES[63 - __builtin_clzll(bb)];
+            bb ^= 1ULL << (63 - __builtin_clzll(bb));
         }
-        
         return *this;
     }
 
     // Postfix increment
-    inline SquareIterator operator++(int) {
+    constexpr SquareIterator operator++(int) noexcept {
         auto tmp = *this;
         ++(*this);
         return tmp;
     }
 
-    auto next() {
+    constexpr auto next() noexcept {
         ++(*this);
         return peek();
     }
 
-    friend bool operator==(const SquareIterator& a, const SquareIterator& b) {
+    friend constexpr bool operator==(const SquareIterator& a, const SquareIterator& b) noexcept {
         return a.bb == b.bb;
     };
 
-    friend bool operator!=(const SquareIterator& a, const SquareIterator& b) {
+    friend constexpr bool operator!=(const SquareIterator& a, const SquareIterator& b) noexcept {
         return a.bb != b.bb;
     };
 
-    static SquareIterator sentinel() {
+    static constexpr SquareIterator sentinel() noexcept {
         return SquareIterator(BB_EMPTY);
     }
 };
@@ -78,27 +77,44 @@ template <typename Square, bool Direction>
 class Range {
     unsigned long long bb;
    public:
-    Range(unsigned long long bb) {
-        this->bb = bb;
-    }
+    constexpr Range(unsigned long long bb) noexcept : bb(bb) {}
 
-    auto begin() {
+    constexpr auto begin() const noexcept {
         return SquareIterator<Square, Direction>(bb);
     }
 
-    auto end() {
+    constexpr auto end() const noexcept {
         return SquareIterator<Square, Direction>::sentinel();
     }
 
-    auto cbegin() const {
+    constexpr auto cbegin() const noexcept {
         return SquareIterator<Square, Direction>(bb);
     }
 
-    auto cend() const {
+    constexpr auto cend() const noexcept {
         return SquareIterator<Square, Direction>::sentinel();
     }
 };
 
+// calls f(square) for every square of bb. this is a plain loop with no
+// iterator objects in it at all, for the hot paths of move generation.
+template <typename Square, bool Direction, typename Function>
+[[gnu::always_inline]] constexpr void for_each(unsigned long long bb, Function&& f) {
+    while (bb) {
+        if constexpr (Direction == Forward) {
+            f((Square)__builtin_ctzll(bb));
+            bb &= bb - 1;
+        } else {
+            auto square = 63 - __builtin_clzll(bb);
+            f((Square)square);
+            bb ^= 1ULL << square;
+        }
+    }
+}
+
+// visits every subset of a mask, the empty set first and the mask itself
+// last. the end is marked by a flag rather than a value, because the empty
+// subset the walk wraps around to is also the first one visited.
 class CRGenerator {
     unsigned long long subset;
     unsigned long long mask;
@@ -110,50 +126,46 @@ class CRGenerator {
     using pointer = value_type*;
     using reference = value_type&;
 
-    CRGenerator(unsigned long long mask) {
-        this->subset = BB_EMPTY;
-        this->mask = mask;
-    }
+    constexpr CRGenerator(unsigned long long mask) noexcept : subset(BB_EMPTY), mask(mask) {}
 
-    auto operator*() -> value_type {
+    constexpr auto operator*() const noexcept -> value_type {
         return subset;
     }
 
-    auto peek() -> value_type {
+    constexpr auto peek() const noexcept -> value_type {
         return operator*();
     }
 
     // Prefix increment
-    inline CRGenerator& operator++() {
+    constexpr CRGenerator& operator++() noexcept {
         subset = (subset - mask) & mask;
-        if (!subset)
-            END_SENTINEL = true;
+        END_SENTINEL = !subset;
         return *this;
     }
 
     // Postfix increment
-    inline CRGenerator operator++(int) {
+    constexpr CRGenerator operator++(int) noexcept {
         auto tmp = *this;
         ++(*this);
         return tmp;
     }
 
-    auto next() {
+    constexpr auto next() noexcept {
         ++(*this);
         return peek();
     }
 
-    static auto end_sentinel() {
+    static constexpr auto end_sentinel() noexcept {
         auto out = CRGenerator(BB_EMPTY);
         out.END_SENTINEL = true;
         return out;
     }
 
-    friend bool operator==(const CRGenerator& a, const CRGenerator& b) {
+    friend constexpr bool operator==(const CRGenerator& a, const CRGenerator& b) noexcept {
         return a.END_SENTINEL == b.END_SENTINEL;
     };
 
-    friend bool operator!=(const CRGenerator& a, const CRGenerator& b) {
+    friend constexpr bool operator!=(const CRGenerator& a, const CRGenerator& b) noexcept {
         return a.END_SENTINEL != b.END_SENTINEL;
     };
 };
@@ -161,16 +173,14 @@ class CRGenerator {
 class CRRange {
     unsigned long long mask;
    public:
-    CRRange(unsigned long long mask) {
-        this->mask = mask;
-    }
+    constexpr CRRange(unsigned long long mask) noexcept : mask(mask) {}
 
-    auto begin() {
+    constexpr auto begin() const noexcept {
         return CRGenerator(mask);
     }
 
-    auto end() {
+    constexpr auto end() const noexcept {
         return CRGenerator::end_sentinel();
     }
 };
-}  // namespace sqgen
\ No newline at end of file
+}  // namespace sqgen
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <vector>
 #include <iostream>
@@ -42,9 +43,43 @@ auto test_carry_rippler() {
     return (subsets == expected);
 }
 
+auto test_for_each_square() {
+    std::vector<int> forward, reverse, scanned;
+    auto bb = BB_A1 | BB_E4 | BB_H8 | BB_C7;
+    for_each_square(bb, [&](Square square) { forward.push_back(square); });
+    for_each_square_reversed(bb, [&](Square square) { reverse.push_back(square); });
+    for (auto square : scan_reversed(bb))
+        scanned.push_back(square);
+    std::vector expected = {0, 28, 50, 63};
+    auto none = 0;
+    for_each_square(BB_EMPTY, [&](Square) { ++none; });
+    return forward == expected && reverse == scanned && std::equal(reverse.rbegin(), reverse.rend(), expected.begin()) && !none;
+}
+
+// both kinds of loop run at compile time, as in table generation.
+constexpr auto subset_sum(Bitboard mask) {
+    Bitboard sum = 0;
+    for (auto subset : _carry_rippler(mask))
+        sum += subset;
+    return sum;
+}
+
+constexpr auto square_sum(Bitboard bb) {
+    auto sum = 0;
+    for (auto square : scan_forward(bb))
+        sum += square;
+    for_each_square_reversed(bb, [&](Square square) { sum -= 2 * square; });
+    return sum;
+}
+
+static_assert(subset_sum(0b1011) == (0 + 1 + 2 + 3 + 8 + 9 + 10 + 11));
+static_assert(subset_sum(BB_EMPTY) == 0);
+static_assert(square_sum(BB_A1 | BB_B1 | BB_H8) == -(0 + 1 + 63));
+
 int main() {
-    std::cout << "test_scan_forward:  " << (test_scan_forward() ? "PASS ✅" : "FAIL ❌") << '\n';
-    std::cout << "test_scan_reverse:  " << (test_scan_reverse() ? "PASS ✅" : "FAIL ❌") << '\n';
-    std::cout << "test_carry_rippler: " << (test_carry_rippler() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_scan_forward:    " << (test_scan_forward() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_scan_reverse:    " << (test_scan_reverse() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_carry_rippler:   " << (test_carry_rippler() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_for_each_square: " << (test_for_each_square() ? "PASS ✅" : "FAIL ❌") << '\n';
     return 0;
 }
@@ -27,11 +27,11 @@ constexpr auto unsafe_upper_to_lower(char c) noexcept {
 
 constexpr auto toupper(char c) noexcept -> char {
     using namespace _chartools;
-    return is_not_lowercase(c) ? unsafe_lower_to_upper(c) : c;
+    return is_not_lowercase(c) ? c : unsafe_lower_to_upper(c);
 }
 constexpr auto tolower(char c) noexcept -> char {
     using namespace _chartools;
-    return is_not_uppercase(c) ? unsafe_upper_to_lower(c) : c;
+    return is_not_uppercase(c) ? c : unsafe_upper_to_lower(c);
 }
 // parsing the characters '0' to '9' to the integers 0 to 9
 constexpr auto to_int(char c) -> int {
@@ -75,32 +75,30 @@ bool islower(const std::string& s) {
 }
 
 auto join(const std::vector<std::string>& ss, const std::string& calator) {
-    std::stringstream collector;
-    collector << ss.front();
-    std::accumulate(
-        ++ss.begin(),
-        ss.end(),
-        [calator](std::stringstream acc, std::string str) {
-            acc << calator << str;
-        });
-    return collector.str();
+    std::string out;
+    for (auto it = ss.begin(); it != ss.end(); ++it) {
+        if (it != ss.begin())
+            out += calator;
+        out += *it;
+    }
+    return out;
 }
 
 auto strip(const std::string& s) {
     auto not_a_space = [](char c) { return c != ' '; };
     using it = std::string::const_iterator;
-    it start = std::find(
+    it start = std::find_if(
         s.begin(),
         s.end(),
         not_a_space);
-    it end = std::find(
+    it end = std::find_if(
                  s.rbegin(),
                  s.rend(),
                  not_a_space)
                  .base();
-    std::string out;
-    std::copy(start, end, std::back_inserter(out));
-    return out;
+    if (start >= end)
+        return std::string();
+    return std::string(start, end);
 }
 
 auto contains(const std::string& str, const std::string& tgt) {
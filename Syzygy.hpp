@@ -0,0 +1,1099 @@
+#pragma once
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "target.hpp"
+
+// a port of chess.syzygy's prober, with the table decoding done the way
+// Stockfish's tbprobe.cpp does it. tables are found by name when a directory
+// is added, but a file is only mapped the first time a position with its
+// material is probed. the mapping is read-only and shared, so any number of
+// threads can probe one Tablebase at once, each with its own Board.
+//
+// positions are encoded straight from the bitboards and the mailbox of the
+// board, and the material of a position is a packed count of its pieces
+// rather than a name, so a probe builds no strings.
+
+namespace Chess::syzygy {
+
+constexpr int TBPIECES = 7;
+
+struct MissingTableError : std::out_of_range {
+    // """Can not probe position due to missing table."""
+    using std::out_of_range::out_of_range;
+};
+
+// # Pieces as stored in the tables: white pawn to king are 1 to 6, black
+// # pawn to king 9 to 14.
+using _Counts = std::array<std::array<int, 7>, 2>;
+
+constexpr auto _piece_code(PieceType piece_type, Color color) -> int {
+    return (int)piece_type | (color == WHITE ? 0 : 8);
+}
+
+constexpr auto _material_key(const _Counts& counts) -> std::uint64_t {
+    // four bits per piece type and side, white in the low half.
+    std::uint64_t key = 0;
+    for (auto side = 0; side < 2; ++side) {
+        for (auto piece_type = 1; piece_type <= 6; ++piece_type)
+            key |= (std::uint64_t)counts[side][piece_type] << (4 * (6 * side + piece_type - 1));
+    }
+    return key;
+}
+
+inline auto _board_counts(const BaseBoard& board, bool mirror) -> _Counts {
+    const std::array<Bitboard, 7> by_type = {
+        BB_EMPTY, board.pawns, board.knights, board.bishops, board.rooks, board.queens, board.kings};
+    _Counts counts{};
+    for (auto side = 0; side < 2; ++side) {
+        auto us = board.occupied_co[(side == 0) != mirror ? WHITE : BLACK];
+        for (auto piece_type = 1; piece_type <= 6; ++piece_type)
+            counts[side][piece_type] = __builtin_popcountll(by_type[piece_type] & us);
+    }
+    return counts;
+}
+
+inline auto _board_key(const BaseBoard& board) -> std::uint64_t {
+    return _material_key(_board_counts(board, false));
+}
+
+inline auto calc_key(const BaseBoard& board, bool mirror = false) -> std::string {
+    // """
+    // Gets the name of the table for the material of *board*, like
+    // ``KRPvKR``, with white first unless *mirror* is set.
+    // """
+    constexpr const char* SYMBOLS = "KQRBNP";
+    constexpr std::array<int, 6> ORDER = {6, 5, 4, 3, 2, 1};
+    auto counts = _board_counts(board, mirror);
+    std::string key;
+    for (auto side = 0; side < 2; ++side) {
+        if (side)
+            key += 'v';
+        for (auto i = 0; i < 6; ++i)
+            key.append(counts[side][ORDER[i]], SYMBOLS[i]);
+    }
+    return key;
+}
+
+inline auto _parse_table_name(const std::string& name) -> std::optional<_Counts> {
+    // the counts of a name like ``KQvKR``, if it is one: each side has one
+    // king, which comes first, and there are at most TBPIECES pieces.
+    auto v = name.find('v');
+    if (v == std::string::npos || name.find('v', v + 1) != std::string::npos)
+        return std::nullopt;
+    _Counts counts{};
+    auto total = 0;
+    for (auto side = 0; side < 2; ++side) {
+        auto part = side ? name.substr(v + 1) : name.substr(0, v);
+        if (part.empty() || part[0] != 'K')
+            return std::nullopt;
+        for (auto c : part) {
+            auto piece_type = 0;
+            switch (c) {
+                case 'P': piece_type = 1; break;
+                case 'N': piece_type = 2; break;
+                case 'B': piece_type = 3; break;
+                case 'R': piece_type = 4; break;
+                case 'Q': piece_type = 5; break;
+                case 'K': piece_type = 6; break;
+                default: return std::nullopt;
+            }
+            ++counts[side][piece_type];
+            ++total;
+        }
+        if (counts[side][6] != 1)
+            return std::nullopt;
+    }
+    if (total > TBPIECES)
+        return std::nullopt;
+    return counts;
+}
+
+constexpr auto _off_a1h8(int square) -> int {
+    return (square >> 3) - (square & 7);
+}
+
+// the index tables of the encoding, built at compile time. see
+// Tablebases::init() in Stockfish for how each is derived.
+struct _Encoding {
+    // a2-h7 to 0..47, highest for the pawn that leads: nearest the edge,
+    // then lowest rank
+    int map_pawns[64] = {};
+    // squares below the a1-h8 diagonal to 0..27
+    int map_b1h1h7[64] = {};
+    // the a1-d1-d4 triangle to 0..9, the diagonal last
+    int map_a1d1d4[64] = {};
+    // the 462 placements of two kings with the first in the triangle
+    int map_kk[10][64] = {};
+    // binomial[k][n] ways to choose k of n
+    int binomial[6][64] = {};
+    int lead_pawn_idx[6][64] = {};
+    int lead_pawns_size[6][4] = {};
+
+    constexpr _Encoding() {
+        auto code = 0;
+        for (auto s = 0; s < 64; ++s) {
+            if (_off_a1h8(s) < 0)
+                map_b1h1h7[s] = code++;
+        }
+
+        code = 0;
+        int diagonal[4] = {};
+        auto diagonal_count = 0;
+        for (auto s = 0; s <= 27; ++s) {
+            if (_off_a1h8(s) < 0 && (s & 7) <= 3)
+                map_a1d1d4[s] = code++;
+            else if (!_off_a1h8(s) && (s & 7) <= 3)
+                diagonal[diagonal_count++] = s;
+        }
+        for (auto i = 0; i < diagonal_count; ++i)
+            map_a1d1d4[diagonal[i]] = code++;
+
+        // # If the first king is on the a1-d4 diagonal, the other one shall
+        // # not be above the a1-h8 diagonal.
+        int both_on_diagonal[64][2] = {};
+        auto both_count = 0;
+        code = 0;
+        for (auto idx = 0; idx < 10; ++idx) {
+            for (auto s1 = 0; s1 <= 27; ++s1) {
+                if (map_a1d1d4[s1] != idx || (!idx && s1 != 1))
+                    continue;
+                for (auto s2 = 0; s2 < 64; ++s2) {
+                    auto file_distance = (s1 & 7) - (s2 & 7);
+                    auto rank_distance = (s1 >> 3) - (s2 >> 3);
+                    if (file_distance >= -1 && file_distance <= 1 && rank_distance >= -1 && rank_distance <= 1)
+                        continue;
+                    else if (!_off_a1h8(s1) && _off_a1h8(s2) > 0)
+                        continue;
+                    else if (!_off_a1h8(s1) && !_off_a1h8(s2)) {
+                        both_on_diagonal[both_count][0] = idx;
+                        both_on_diagonal[both_count++][1] = s2;
+                    } else
+                        map_kk[idx][s2] = code++;
+                }
+            }
+        }
+        for (auto i = 0; i < both_count; ++i)
+            map_kk[both_on_diagonal[i][0]][both_on_diagonal[i][1]] = code++;
+
+        binomial[0][0] = 1;
+        for (auto n = 1; n < 64; ++n) {
+            for (auto k = 0; k < 6 && k <= n; ++k)
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+        }
+
+        auto available_squares = 47;
+        for (auto lead_pawns_count = 1; lead_pawns_count <= 5; ++lead_pawns_count) {
+            for (auto file = 0; file <= 3; ++file) {
+                auto idx = 0;
+                for (auto rank = 1; rank <= 6; ++rank) {
+                    auto square = 8 * rank + file;
+                    if (lead_pawns_count == 1) {
+                        map_pawns[square] = available_squares--;
+                        map_pawns[square ^ 7] = available_squares--;
+                    }
+                    lead_pawn_idx[lead_pawns_count][square] = idx;
+                    idx += binomial[lead_pawns_count - 1][map_pawns[square]];
+                }
+                lead_pawns_size[lead_pawns_count][file] = idx;
+            }
+        }
+    }
+};
+
+inline constexpr _Encoding _ENCODING{};
+
+inline auto _le16(const std::uint8_t* p) -> std::uint32_t {
+    return (std::uint32_t)p[0] | (std::uint32_t)p[1] << 8;
+}
+
+inline auto _le32(const std::uint8_t* p) -> std::uint32_t {
+    return _le16(p) | _le16(p + 2) << 16;
+}
+
+inline auto _be32(const std::uint8_t* p) -> std::uint32_t {
+    return (std::uint32_t)p[0] << 24 | (std::uint32_t)p[1] << 16 | (std::uint32_t)p[2] << 8 | p[3];
+}
+
+inline auto _be64(const std::uint8_t* p) -> std::uint64_t {
+    return (std::uint64_t)_be32(p) << 32 | _be32(p + 4);
+}
+
+enum _Flag : std::uint8_t {
+    STM = 1,
+    MAPPED = 2,
+    WIN_PLIES = 4,
+    LOSS_PLIES = 8,
+    WIDE = 16,
+    SINGLE_VALUE = 128,
+};
+
+// one compressed table: a canonical huffman code over symbols that expand,
+// by recursive pairing, into runs of values. the pointers are into the
+// mapped file and the vectors are derived from it when it is opened.
+struct _PairsData {
+    std::uint8_t flags = 0;
+    std::uint64_t block_size = 0;
+    std::uint64_t span = 0;  // about every span values there is a sparse index entry
+    std::uint32_t num_blocks = 0;
+    int max_sym_len = 0;
+    int min_sym_len = 0;  // the value itself for SINGLE_VALUE tables
+    const std::uint8_t* lowest_sym = nullptr;  // little-endian 16-bit, per symbol length
+    const std::uint8_t* btree = nullptr;  // two 12-bit symbols per 3 bytes
+    const std::uint8_t* block_length = nullptr;  // little-endian 16-bit, values in a block minus one
+    std::uint64_t block_length_size = 0;
+    const std::uint8_t* sparse_index = nullptr;  // 6 bytes: 32-bit block, 16-bit offset
+    std::uint64_t sparse_index_size = 0;
+    const std::uint8_t* data = nullptr;
+    std::vector<std::uint64_t> base64;
+    std::vector<std::uint8_t> symlen;
+    int pieces[TBPIECES] = {};
+    std::uint64_t group_idx[TBPIECES + 1] = {};
+    int group_len[TBPIECES + 1] = {};
+    std::uint16_t map_idx[4] = {};
+
+    auto left(int sym) const -> int {
+        auto p = btree + 3 * sym;
+        return (p[1] & 0xf) << 8 | p[0];
+    }
+
+    auto right(int sym) const -> int {
+        auto p = btree + 3 * sym;
+        return p[2] << 4 | p[1] >> 4;
+    }
+
+    auto set_symlen(int sym, std::vector<bool>& visited) -> int {
+        visited[sym] = true;
+        auto sr = right(sym);
+        if (sr == 0xfff)
+            return 0;
+        auto sl = left(sym);
+        if (!visited[sl])
+            symlen[sl] = (std::uint8_t)set_symlen(sl, visited);
+        if (!visited[sr])
+            symlen[sr] = (std::uint8_t)set_symlen(sr, visited);
+        return symlen[sl] + symlen[sr] + 1;
+    }
+
+    auto set_sizes(const std::uint8_t* p) -> const std::uint8_t* {
+        flags = *p++;
+        if (flags & SINGLE_VALUE) {
+            min_sym_len = *p++;
+            return p;
+        }
+
+        auto groups = 0;
+        while (group_len[groups])
+            ++groups;
+        auto tb_size = group_idx[groups];
+
+        block_size = 1ULL << *p++;
+        span = 1ULL << *p++;
+        sparse_index_size = (tb_size + span - 1) / span;
+        auto padding = *p++;
+        num_blocks = _le32(p);
+        p += 4;
+        // # Padded so that the sparse index does not point out of range.
+        block_length_size = (std::uint64_t)num_blocks + padding;
+        max_sym_len = *p++;
+        min_sym_len = *p++;
+        lowest_sym = p;
+        base64.assign(max_sym_len - min_sym_len + 1, 0);
+
+        // # Longer codes have lower values, so base64[] is left-aligned and
+        // # decreasing: a symbol of length l padded to 64 bits lies between
+        // # base64[l - 1] and base64[l].
+        for (auto i = (int)base64.size() - 2; i >= 0; --i)
+            base64[i] = (base64[i + 1] + _le16(lowest_sym + 2 * i) - _le16(lowest_sym + 2 * (i + 1))) / 2;
+        for (std::size_t i = 0; i < base64.size(); ++i)
+            base64[i] <<= 64 - i - min_sym_len;
+
+        p += base64.size() * 2;
+        symlen.assign(_le16(p), 0);
+        p += 2;
+        btree = p;
+
+        std::vector<bool> visited(symlen.size());
+        for (std::size_t sym = 0; sym < symlen.size(); ++sym) {
+            if (!visited[sym])
+                symlen[sym] = (std::uint8_t)set_symlen((int)sym, visited);
+        }
+        return p + symlen.size() * 3 + (symlen.size() & 1);
+    }
+
+    auto decompress(std::uint64_t idx) const -> int {
+        if (flags & SINGLE_VALUE)
+            return min_sym_len;
+
+        // # Sparse index entry k points at the value k * span + span / 2;
+        // # walk the block lengths from there to the block of idx.
+        auto k = (std::uint32_t)(idx / span);
+        auto block = _le32(sparse_index + 6 * k);
+        auto offset = (int)_le16(sparse_index + 6 * k + 4);
+        offset += (int)(idx % span) - (int)(span / 2);
+        while (offset < 0)
+            offset += (int)_le16(block_length + 2 * --block) + 1;
+        while (offset > (int)_le16(block_length + 2 * block))
+            offset -= (int)_le16(block_length + 2 * block++) + 1;
+
+        auto ptr = data + (std::uint64_t)block * block_size;
+        auto buf64 = _be64(ptr);
+        ptr += 8;
+        auto buf64_size = 64;
+        auto sym = 0;
+
+        while (true) {
+            auto len = 0;
+            while (buf64 < base64[len])
+                ++len;
+            sym = (int)((buf64 - base64[len]) >> (64 - len - min_sym_len));
+            sym += (int)_le16(lowest_sym + 2 * len);
+            if (offset < symlen[sym] + 1)
+                break;
+            offset -= symlen[sym] + 1;
+            len += min_sym_len;
+            buf64 <<= len;
+            buf64_size -= len;
+            if (buf64_size <= 32) {
+                buf64_size += 32;
+                buf64 |= (std::uint64_t)_be32(ptr) << (64 - buf64_size);
+                ptr += 4;
+            }
+        }
+
+        // # Expand the symbol until the one value at offset is left.
+        while (symlen[sym]) {
+            auto l = left(sym);
+            if (offset < symlen[l] + 1) {
+                sym = l;
+            } else {
+                offset -= symlen[l] + 1;
+                sym = right(sym);
+            }
+        }
+        return left(sym);
+    }
+};
+
+class _Table {
+    static constexpr std::array<std::uint8_t, 4> WDL_MAGIC = {0x71, 0xe8, 0x23, 0x5d};
+    static constexpr std::array<std::uint8_t, 4> DTZ_MAGIC = {0xd7, 0x66, 0x0c, 0xa5};
+
+    std::atomic<bool> ready{false};
+    std::mutex mutex;
+    void* memory = nullptr;
+    std::size_t mapped_bytes = 0;
+    const std::uint8_t* map = nullptr;
+    _PairsData items[2][4];
+
+    auto get(int stm, int file) -> _PairsData& {
+        return items[dtz ? 0 : stm][has_pawns ? file : 0];
+    }
+
+    void set_groups(_PairsData& d, const int order[2], int file) {
+        auto n = 0;
+        auto first_len = has_pawns ? 0 : has_unique_pieces ? 3 : 2;
+        d.group_len[n] = 1;
+        // # KRKN is encoded as (KRK)(N): the leading group, then runs of
+        // # equal pieces.
+        for (auto i = 1; i < piece_count; ++i) {
+            if (--first_len > 0 || d.pieces[i] == d.pieces[i - 1])
+                d.group_len[n]++;
+            else
+                d.group_len[++n] = 1;
+        }
+        d.group_len[++n] = 0;
+
+        auto pp = has_pawns && pawn_count[1];
+        auto next = pp ? 2 : 1;
+        auto free_squares = 64 - d.group_len[0] - (pp ? d.group_len[1] : 0);
+        std::uint64_t idx = 1;
+        auto& e = _ENCODING;
+
+        for (auto k = 0; next < n || k == order[0] || k == order[1]; ++k) {
+            if (k == order[0]) {
+                d.group_idx[0] = idx;
+                idx *= has_pawns ? e.lead_pawns_size[d.group_len[0]][file] : has_unique_pieces ? 31332 : 462;
+            } else if (k == order[1]) {
+                d.group_idx[1] = idx;
+                idx *= e.binomial[d.group_len[1]][48 - d.group_len[0]];
+            } else {
+                d.group_idx[next] = idx;
+                idx *= e.binomial[d.group_len[next]][free_squares];
+                free_squares -= d.group_len[next++];
+            }
+        }
+        d.group_idx[n] = idx;
+    }
+
+    auto set_dtz_map(const std::uint8_t* p, int max_file) -> const std::uint8_t* {
+        map = p;
+        for (auto f = 0; f <= max_file; ++f) {
+            auto& d = get(0, f);
+            if (!(d.flags & MAPPED))
+                continue;
+            if (d.flags & WIDE) {
+                p += (std::uintptr_t)p & 1;
+                for (auto i = 0; i < 4; ++i) {
+                    d.map_idx[i] = (std::uint16_t)((p - map) / 2 + 1);
+                    p += 2 * _le16(p) + 2;
+                }
+            } else {
+                for (auto i = 0; i < 4; ++i) {
+                    d.map_idx[i] = (std::uint16_t)(p - map + 1);
+                    p += *p + 1;
+                }
+            }
+        }
+        return p + ((std::uintptr_t)p & 1);
+    }
+
+    void init(const std::uint8_t* p) {
+        // # The first byte holds flags: split sides and pawns.
+        ++p;
+        auto sides = !dtz && key != key2 ? 2 : 1;
+        auto max_file = has_pawns ? 3 : 0;
+        auto pp = has_pawns && pawn_count[1];
+
+        for (auto f = 0; f <= max_file; ++f) {
+            for (auto i = 0; i < sides; ++i)
+                get(i, f) = _PairsData();
+            int order[2][2] = {{*p & 0xf, pp ? p[1] & 0xf : 0xf}, {*p >> 4, pp ? p[1] >> 4 : 0xf}};
+            p += 1 + pp;
+            for (auto k = 0; k < piece_count; ++k, ++p) {
+                for (auto i = 0; i < sides; ++i)
+                    get(i, f).pieces[k] = i ? *p >> 4 : *p & 0xf;
+            }
+            for (auto i = 0; i < sides; ++i)
+                set_groups(get(i, f), order[i], f);
+        }
+        p += (std::uintptr_t)p & 1;
+
+        for (auto f = 0; f <= max_file; ++f) {
+            for (auto i = 0; i < sides; ++i)
+                p = get(i, f).set_sizes(p);
+        }
+        if (dtz)
+            p = set_dtz_map(p, max_file);
+        for (auto f = 0; f <= max_file; ++f) {
+            for (auto i = 0; i < sides; ++i) {
+                get(i, f).sparse_index = p;
+                p += get(i, f).sparse_index_size * 6;
+            }
+        }
+        for (auto f = 0; f <= max_file; ++f) {
+            for (auto i = 0; i < sides; ++i) {
+                get(i, f).block_length = p;
+                p += get(i, f).block_length_size * 2;
+            }
+        }
+        for (auto f = 0; f <= max_file; ++f) {
+            for (auto i = 0; i < sides; ++i) {
+                p = (const std::uint8_t*)(((std::uintptr_t)p + 0x3f) & ~(std::uintptr_t)0x3f);
+                get(i, f).data = p;
+                p += (std::uint64_t)get(i, f).num_blocks * get(i, f).block_size;
+            }
+        }
+    }
+
+    void open() {
+        // maps and parses the file the first time, once across threads.
+        if (ready.load(std::memory_order_acquire))
+            return;
+        std::lock_guard lock(mutex);
+        if (ready.load(std::memory_order_relaxed))
+            return;
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + path);
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        auto size = (std::size_t)info.st_size;
+        // # Tables are padded to 64 bytes, plus the magic and 12 more bytes.
+        if (size % 64 != 16) {
+            ::close(fd);
+            throw std::runtime_error("corrupt tablebase file " + path);
+        }
+        auto mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("cannot map " + path);
+        madvise(mapped, size, MADV_RANDOM);
+        auto bytes = (const std::uint8_t*)mapped;
+        auto& magic = dtz ? DTZ_MAGIC : WDL_MAGIC;
+        if (!std::equal(magic.begin(), magic.end(), bytes)) {
+            munmap(mapped, size);
+            throw std::runtime_error("invalid magic header in " + path);
+        }
+        memory = mapped;
+        mapped_bytes = size;
+        init(bytes + 4);
+        ready.store(true, std::memory_order_release);
+    }
+
+   public:
+    const bool dtz;
+    const std::string path;
+    std::uint64_t key;
+    std::uint64_t key2;
+    int piece_count = 0;
+    bool has_pawns = false;
+    bool has_unique_pieces = false;
+    int pawn_count[2] = {};  // the side with the leading pawns first
+
+    _Table(bool dtz, std::string path, const _Counts& counts) : dtz(dtz), path(std::move(path)) {
+        key = _material_key(counts);
+        key2 = _material_key({counts[1], counts[0]});
+        for (auto side = 0; side < 2; ++side) {
+            for (auto piece_type = 1; piece_type <= 6; ++piece_type) {
+                piece_count += counts[side][piece_type];
+                if (piece_type < 6 && counts[side][piece_type] == 1)
+                    has_unique_pieces = true;
+            }
+        }
+        auto white_pawns = counts[0][1], black_pawns = counts[1][1];
+        has_pawns = white_pawns || black_pawns;
+        auto white_leads = !black_pawns || (white_pawns && black_pawns >= white_pawns);
+        pawn_count[0] = white_leads ? white_pawns : black_pawns;
+        pawn_count[1] = white_leads ? black_pawns : white_pawns;
+    }
+
+    _Table(const _Table&) = delete;
+    auto operator=(const _Table&) -> _Table& = delete;
+
+    ~_Table() {
+        if (memory)
+            munmap(memory, mapped_bytes);
+    }
+
+    auto probe(const BaseBoard& board, Color turn, int wdl, bool& change_stm) -> int {
+        // """
+        // Looks up the position, which must have the material of the table.
+        // WDL tables give -2 to 2; DTZ tables give plies as stored before
+        // the tablebase prober adds the zeroing move, or set *change_stm*
+        // if only the other side to move is stored.
+        // """
+        open();
+        auto& e = _ENCODING;
+        auto pawns_comp = [&](int a, int b) { return e.map_pawns[a] < e.map_pawns[b]; };
+        int squares[TBPIECES] = {};
+        int pieces[TBPIECES] = {};
+        auto size = 0;
+        auto lead_pawns_count = 0;
+        Bitboard lead_pawns = BB_EMPTY;
+        auto tb_file = 0;
+
+        // # Tables are stored with the stronger side as white, and with
+        // # white to move only when both sides have the same pieces.
+        auto black_to_move = turn == BLACK;
+        auto flip = (key == key2 && black_to_move) || _board_key(board) != key;
+        auto flip_color = flip ? 8 : 0;
+        auto flip_squares = flip ? 56 : 0;
+        auto stm = (int)(flip != black_to_move);
+
+        if (has_pawns) {
+            // # Pawns lead every piece sequence.
+            auto pawn = get(0, 0).pieces[0] ^ flip_color;
+            lead_pawns = board.pawns & board.occupied_co[pawn & 8 ? BLACK : WHITE];
+            for_each_square(lead_pawns, [&](Square square) { squares[size++] = square ^ flip_squares; });
+            lead_pawns_count = size;
+            std::swap(squares[0], *std::max_element(squares, squares + lead_pawns_count, pawns_comp));
+            tb_file = std::min(squares[0] & 7, 7 - (squares[0] & 7));
+        }
+
+        if (dtz && (get(stm, tb_file).flags & STM) != stm && !(key == key2 && !has_pawns)) {
+            change_stm = true;
+            return 0;
+        }
+
+        for_each_square(board.occupied ^ lead_pawns, [&](Square square) {
+            auto code = board._mailbox[square];
+            squares[size] = square ^ flip_squares;
+            pieces[size++] = _piece_code((PieceType)(code & 7), (Color)(code >> 3)) ^ flip_color;
+        });
+
+        auto& d = get(stm, tb_file);
+
+        // # Order the pieces like the table does.
+        for (auto i = lead_pawns_count; i < size - 1; ++i) {
+            for (auto j = i + 1; j < size; ++j) {
+                if (d.pieces[i] == pieces[j]) {
+                    std::swap(pieces[i], pieces[j]);
+                    std::swap(squares[i], squares[j]);
+                    break;
+                }
+            }
+        }
+
+        // # Bring the leading piece to files a-d.
+        if ((squares[0] & 7) > 3) {
+            for (auto i = 0; i < size; ++i)
+                squares[i] ^= 7;
+        }
+
+        std::uint64_t idx = 0;
+        if (has_pawns) {
+            idx = e.lead_pawn_idx[lead_pawns_count][squares[0]];
+            std::stable_sort(squares + 1, squares + lead_pawns_count, pawns_comp);
+            for (auto i = 1; i < lead_pawns_count; ++i)
+                idx += e.binomial[i][e.map_pawns[squares[i]]];
+        } else {
+            // # Then to ranks 1-4, and below the a1-h8 diagonal.
+            if ((squares[0] >> 3) > 3) {
+                for (auto i = 0; i < size; ++i)
+                    squares[i] ^= 56;
+            }
+            for (auto i = 0; i < d.group_len[0]; ++i) {
+                if (!_off_a1h8(squares[i]))
+                    continue;
+                if (_off_a1h8(squares[i]) > 0) {
+                    for (auto j = i; j < size; ++j)
+                        squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+                break;
+            }
+
+            if (has_unique_pieces) {
+                // # Three unique pieces, kings included, are encoded
+                // # together; each later square skips the earlier ones.
+                auto adjust1 = (int)(squares[1] > squares[0]);
+                auto adjust2 = (int)(squares[2] > squares[0]) + (int)(squares[2] > squares[1]);
+                if (_off_a1h8(squares[0]))
+                    idx = ((std::uint64_t)e.map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+                else if (_off_a1h8(squares[1]))
+                    idx = (6 * 63 + (squares[0] >> 3) * 28 + e.map_b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+                else if (_off_a1h8(squares[2]))
+                    idx = 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] >> 3) * 7 * 28 + ((squares[1] >> 3) - adjust1) * 28 +
+                          e.map_b1h1h7[squares[2]];
+                else
+                    idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (squares[0] >> 3) * 7 * 6 +
+                          ((squares[1] >> 3) - adjust1) * 6 + ((squares[2] >> 3) - adjust2);
+            } else {
+                idx = e.map_kk[e.map_a1d1d4[squares[0]]][squares[1]];
+            }
+        }
+
+        // # The remaining groups, each by its squares in ascending order,
+        // # less the squares taken by earlier groups.
+        idx *= d.group_idx[0];
+        auto group_sq = squares + d.group_len[0];
+        auto remaining_pawns = has_pawns && pawn_count[1];
+        for (auto next = 1; d.group_len[next]; ++next) {
+            std::stable_sort(group_sq, group_sq + d.group_len[next]);
+            std::uint64_t n = 0;
+            for (auto i = 0; i < d.group_len[next]; ++i) {
+                auto adjust = (int)std::count_if(squares, group_sq, [&](int square) { return group_sq[i] > square; });
+                n += e.binomial[i + 1][group_sq[i] - adjust - 8 * remaining_pawns];
+            }
+            remaining_pawns = false;
+            idx += n * d.group_idx[next];
+            group_sq += d.group_len[next];
+        }
+
+        auto value = d.decompress(idx);
+        if (!dtz)
+            return value - 2;
+
+        constexpr int WDL_TO_MAP[] = {1, 3, 0, 2, 0};
+        auto& first = get(0, tb_file);
+        if (first.flags & MAPPED) {
+            auto offset = first.map_idx[WDL_TO_MAP[wdl + 2]] + value;
+            value = first.flags & WIDE ? (int)_le16(map + 2 * offset) : map[offset];
+        }
+        // # Values are in moves unless the flags say plies.
+        if ((wdl == 2 && !(first.flags & WIN_PLIES)) || (wdl == -2 && !(first.flags & LOSS_PLIES)) || wdl == 1 || wdl == -1)
+            value *= 2;
+        return value;
+    }
+};
+
+class _Pushed {
+    // plays a move for the lifetime of the object.
+    Board& board;
+    UndoRecord undo;
+
+   public:
+    _Pushed(Board& board, Move move) : board(board) {
+        board.push_fast(move, undo);
+    }
+
+    _Pushed(const _Pushed&) = delete;
+    auto operator=(const _Pushed&) -> _Pushed& = delete;
+
+    ~_Pushed() {
+        board.pop_fast(undo);
+    }
+};
+
+constexpr auto dtz_before_zeroing(int wdl) -> int {
+    return ((wdl > 0) - (wdl < 0)) * (wdl == 2 || wdl == -2 ? 1 : 101);
+}
+
+class Tablebase {
+    // """
+    // Manages a collection of tablebase files for probing.
+
+    // Directories are added with add_directory(), before probing starts.
+    // After that, probing is safe from any number of threads.
+    // """
+    std::vector<std::unique_ptr<_Table>> tables;
+    std::unordered_map<std::uint64_t, _Table*> wdl;
+    std::unordered_map<std::uint64_t, _Table*> dtz;
+
+    auto table_for(const std::unordered_map<std::uint64_t, _Table*>& hashtable, const BaseBoard& board, const char* kind) const -> _Table& {
+        auto it = hashtable.find(_board_key(board));
+        if (it == hashtable.end())
+            throw MissingTableError(std::string("did not find ") + kind + " table " + calc_key(board));
+        return *it->second;
+    }
+
+   public:
+    Tablebase() = default;
+
+    Tablebase(const Tablebase&) = delete;
+    auto operator=(const Tablebase&) -> Tablebase& = delete;
+
+    auto add_directory(const std::string& directory, bool load_wdl = true, bool load_dtz = true) -> int {
+        // """
+        // Adds tables from a directory.
+
+        // By default all available tables with the correct file names
+        // (e.g. WDL files like ``KQvKN.rtbw`` and DTZ files like ``KRBvK.rtbz``)
+        // are added. Files are opened lazily, on first probe.
+
+        // Returns the number of table files that were found.
+
+        // :raises: :exc:`std::runtime_error` if the directory cannot be read.
+        // """
+        auto dir = opendir(directory.c_str());
+        if (!dir)
+            throw std::runtime_error("cannot open directory " + directory);
+        auto num = 0;
+        while (auto entry = readdir(dir)) {
+            std::string filename = entry->d_name;
+            auto dot = filename.rfind('.');
+            if (dot == std::string::npos)
+                continue;
+            auto extension = filename.substr(dot);
+            auto is_dtz = extension == ".rtbz";
+            if (!(extension == ".rtbw" && load_wdl) && !(is_dtz && load_dtz))
+                continue;
+            auto counts = _parse_table_name(filename.substr(0, dot));
+            if (!counts)
+                continue;
+            auto& hashtable = is_dtz ? dtz : wdl;
+            auto table = std::make_unique<_Table>(is_dtz, directory + "/" + filename, *counts);
+            // # Later directories take precedence.
+            hashtable[table->key] = table.get();
+            hashtable[table->key2] = table.get();
+            tables.push_back(std::move(table));
+            ++num;
+        }
+        closedir(dir);
+        return num;
+    }
+
+    auto probe_wdl_table(Board& board) -> int {
+        // # Test for KvK.
+        if (board.kings == board.occupied)
+            return 0;
+        bool change_stm = false;
+        return table_for(wdl, board, "wdl").probe(board, board.turn, 0, change_stm);
+    }
+
+    auto probe_ab(Board& board, int alpha, int beta) -> std::pair<int, int> {
+        // """
+        // Searches captures (but not en passant) with alpha-beta, down to
+        // the smaller tables. Returns the value and 2 if it came from a
+        // capture, otherwise 1.
+        // """
+        for (auto move : board.generate_legal_moves(BB_ALL, board.occupied_co[!board.turn])) {
+            auto v = 0;
+            {
+                _Pushed pushed(board, move);
+                v = -probe_ab(board, -beta, -alpha).first;
+            }
+            if (v > alpha) {
+                if (v >= beta)
+                    return {v, 2};
+                alpha = v;
+            }
+        }
+
+        auto v = probe_wdl_table(board);
+        if (alpha >= v)
+            return {alpha, 1 + (alpha > 0)};
+        return {v, 1};
+    }
+
+    auto probe_wdl(Board& board) -> int {
+        // """
+        // Probes WDL tables for win/draw/loss information under the 50-move rule,
+        // assuming the position has been reached directly after a capture or
+        // pawn move.
+
+        // Probing is thread-safe when done with different *board* objects and
+        // if *board* objects are not modified during probing.
+
+        // Returns ``2`` if the side to move is winning, ``0`` if the position is
+        // a draw and ``-2`` if the side to move is losing.
+
+        // Returns ``1`` in case of a cursed win and ``-1`` in case of a blessed
+        // loss. Mate can be forced but the position can be drawn due to the
+        // fifty-move rule.
+
+        // :raises: :exc:`MissingTableError` (a :exc:`std::out_of_range`) if the
+        //     position could not be found in the tablebase, and
+        //     :exc:`std::out_of_range` if the position has castling rights or
+        //     too many pieces.
+        // """
+        // # Positions with castling rights are not in the tablebase.
+        if (board.castling_rights)
+            throw std::out_of_range("syzygy tables do not contain positions with castling rights: " + board.fen());
+        // # Validate piece count.
+        if (__builtin_popcountll(board.occupied) > TBPIECES)
+            throw std::out_of_range("syzygy tables support up to " + std::to_string(TBPIECES) + " pieces, not " +
+                                    std::to_string(__builtin_popcountll(board.occupied)) + ": " + board.fen());
+
+        auto v = probe_ab(board, -2, 2).first;
+
+        // # If en passant is not possible, we are done.
+        if (!board.ep_square)
+            return v;
+
+        // # Now handle en passant.
+        auto v1 = -3;
+        for (auto move : board.generate_legal_ep()) {
+            _Pushed pushed(board, move);
+            v1 = std::max(v1, -probe_ab(board, -2, 2).first);
+        }
+        if (v1 > -3) {
+            if (v1 >= v) {
+                v = v1;
+            } else if (v == 0) {
+                // # If there is not at least one legal non-en-passant move we are
+                // # forced to play the losing en passant cature.
+                auto moves = board.generate_legal_moves();
+                if (std::all_of(moves.begin(), moves.end(), [&](Move move) { return board.is_en_passant(move); }))
+                    v = v1;
+            }
+        }
+        return v;
+    }
+
+    auto get_wdl(Board& board) -> std::optional<int> {
+        // """Like probe_wdl(), but ``std::nullopt`` instead of raising ``std::out_of_range``."""
+        try {
+            return probe_wdl(board);
+        } catch (const std::out_of_range&) {
+            return std::nullopt;
+        }
+    }
+
+    auto probe_dtz_table(Board& board, int wdl) -> std::pair<int, int> {
+        // # The second value is -1 if the table stores the other side to move.
+        bool change_stm = false;
+        auto res = table_for(dtz, board, "dtz").probe(board, board.turn, wdl, change_stm);
+        if (change_stm)
+            return {0, -1};
+        return {res, 1};
+    }
+
+    auto probe_dtz_no_ep(Board& board) -> int {
+        auto [wdl, success] = probe_ab(board, -2, 2);
+
+        if (wdl == 0)
+            return 0;
+
+        if (success == 2)
+            return dtz_before_zeroing(wdl);
+
+        if (wdl > 0) {
+            // # Generate all legal non-capturing pawn moves.
+            for (auto move : board.generate_legal_moves(board.pawns, ~board.occupied)) {
+                if (board.is_capture(move))
+                    // # En passant.
+                    continue;
+                _Pushed pushed(board, move);
+                auto v = -probe_wdl(board);
+                if (v == wdl)
+                    return v == 2 ? 1 : 101;
+            }
+        }
+
+        auto [res, res_success] = probe_dtz_table(board, wdl);
+        if (res_success >= 0)
+            return dtz_before_zeroing(wdl) + (wdl > 0 ? res : -res);
+
+        if (wdl > 0) {
+            auto best = 0xffff;
+            for (auto move : board.generate_legal_moves(~board.pawns, ~board.occupied)) {
+                _Pushed pushed(board, move);
+                auto v = -probe_dtz(board);
+                if (v == 1 && board.is_checkmate())
+                    best = 1;
+                else if (v > 0 && v + 1 < best)
+                    best = v + 1;
+            }
+            return best;
+        } else {
+            auto best = -1;
+            for (auto move : board.generate_legal_moves()) {
+                _Pushed pushed(board, move);
+                auto v = 0;
+                if (board.halfmove_clock == 0) {
+                    if (wdl == -2)
+                        v = -1;
+                    else
+                        v = probe_ab(board, 1, 2).first == 2 ? 0 : -101;
+                } else {
+                    v = -probe_dtz(board) - 1;
+                }
+                best = std::min(best, v);
+            }
+            return best;
+        }
+    }
+
+    auto probe_dtz(Board& board) -> int {
+        // """
+        // Probes DTZ tables for
+        // `DTZ50'' information with rounding <https://syzygy-tables.info/metrics#dtz>`_.
+
+        // Minmaxing the DTZ50'' values guarantees winning a won position
+        // (and drawing a drawn position), because it makes progress keeping the
+        // win in hand.
+        // However, the lines are not always the most straightforward ways to win.
+        // Engines like Stockfish can use the tablebases more effectively.
+
+        // Probing is thread-safe when done with different *board* objects and
+        // if *board* objects are not modified during probing.
+
+        // Both DTZ and WDL tables are required in order to probe for DTZ.
+
+        // Returns a positive value if the side to move is winning, ``0`` if the
+        // position is a draw, and a negative value if the side to move is
+        // losing. More precisely:
+
+        // +-----+------------------+--------------------------------------------+
+        // | WDL | DTZ              |                                            |
+        // +=====+==================+============================================+
+        // |  -2 | -100 <= n <= -1  | Unconditional loss (assuming 50-move       |
+        // |     |                  | counter is zero), where a zeroing move can |
+        // |     |                  | be forced in -n plies.                     |
+        // +-----+------------------+--------------------------------------------+
+        // |  -1 |         n < -100 | Loss, but draw under the 50-move rule.     |
+        // |     |                  | A zeroing move can be forced in -n plies   |
+        // |     |                  | or -n - 100 plies (if a later phase is     |
+        // |     |                  | responsible for the blessed loss).         |
+        // +-----+------------------+--------------------------------------------+
+        // |   0 |         0        | Draw.                                      |
+        // +-----+------------------+--------------------------------------------+
+        // |   1 |   100 < n        | Win, but draw under the 50-move rule.      |
+        // |     |                  | A zeroing move can be forced in n plies or |
+        // |     |                  | n - 100 plies (if a later phase is         |
+        // |     |                  | responsible for the cursed win).           |
+        // +-----+------------------+--------------------------------------------+
+        // |   2 |    1 <= n <= 100 | Unconditional win (assuming 50-move        |
+        // |     |                  | counter is zero), where a zeroing move can |
+        // |     |                  | be forced in n plies.                      |
+        // +-----+------------------+--------------------------------------------+
+
+        // The return value can be off by one: a return value -n can mean a
+        // losing zeroing move in in n + 1 plies and a return value +n can mean a
+        // winning zeroing move in n + 1 plies.
+        // This implies some primary tablebase lines may waste up to 1 ply.
+        // Rounding is never used for endgame phases where it would change the
+        // game theoretical outcome.
+
+        // This means users need to be careful in positions that are nearly drawn
+        // under the 50-move rule! Carelessly wasting 1 more ply by not following
+        // the tablebase recommendation, for a total of 101 plies, can change the
+        // outcome of the game.
+
+        // :raises: :exc:`MissingTableError` (a :exc:`std::out_of_range`) if the
+        //     position could not be found in the tablebase, and
+        //     :exc:`std::out_of_range` if the position has castling rights or
+        //     too many pieces.
+        // """
+        auto v = probe_dtz_no_ep(board);
+
+        if (!board.ep_square)
+            return v;
+
+        auto v1 = -3;
+
+        // # Generate all en passant captures.
+        for (auto move : board.generate_legal_ep()) {
+            _Pushed pushed(board, move);
+            v1 = std::max(v1, -probe_ab(board, -2, 2).first);
+        }
+
+        if (v1 > -3) {
+            constexpr int WDL_TO_DTZ[] = {-1, -101, 0, 101, 1};
+            v1 = WDL_TO_DTZ[v1 + 2];
+            if (v < -100) {
+                if (v1 >= 0)
+                    v = v1;
+            } else if (v < 0) {
+                if (v1 >= 0 || v1 < -100)
+                    v = v1;
+            } else if (v > 100) {
+                if (v1 > 0)
+                    v = v1;
+            } else if (v > 0) {
+                if (v1 == 1)
+                    v = v1;
+            } else if (v1 >= 0) {
+                v = v1;
+            } else {
+                auto moves = board.generate_legal_moves();
+                if (std::all_of(moves.begin(), moves.end(), [&](Move move) { return board.is_en_passant(move); }))
+                    v = v1;
+            }
+        }
+        return v;
+    }
+
+    auto get_dtz(Board& board) -> std::optional<int> {
+        // """Like probe_dtz(), but ``std::nullopt`` instead of raising ``std::out_of_range``."""
+        try {
+            return probe_dtz(board);
+        } catch (const std::out_of_range&) {
+            return std::nullopt;
+        }
+    }
+};
+
+inline auto open_tablebase(const std::string& directory, bool load_wdl = true, bool load_dtz = true) -> std::unique_ptr<Tablebase> {
+    // """
+    // Opens a collection of tables for probing. See
+    // :class:`~chess.syzygy.Tablebase`.
+    // """
+    auto tables = std::make_unique<Tablebase>();
+    tables->add_directory(directory, load_wdl, load_dtz);
+    return tables;
+}
+
+}  // namespace Chess::syzygy
@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Syzygy.hpp"
+
+// the tables here are written by the tests. the KQvK ones store one value
+// for every position, which is enough for the file parsing, the material keys
+// and the search over captures. the KRvK and KPvK ones are compressed like
+// real tables, with a different value at neighbouring indexes, so a probe
+// only finds the value it expects through the right index and decoding.
+
+auto write_single_value_table(const std::string& directory, const std::string& name, bool dtz, std::vector<int> values) {
+    // # KQvK: the flags, the piece order, the pieces, then one size record
+    // # per side, padded to 64 bytes plus 16.
+    std::vector<unsigned char> bytes = dtz ? std::vector<unsigned char>{0xd7, 0x66, 0x0c, 0xa5}
+                                           : std::vector<unsigned char>{0x71, 0xe8, 0x23, 0x5d};
+    bytes.insert(bytes.end(), {dtz ? (unsigned char)0 : (unsigned char)1, 0x00, 0x66, 0x55, 0xee, 0x00});
+    for (auto value : values)
+        bytes.insert(bytes.end(), {0x80, (unsigned char)value});
+    bytes.resize(80);
+    auto file = std::fopen((directory + "/" + name).c_str(), "wb");
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+}
+
+auto make_tables() -> std::string {
+    char path[] = "/tmp/syzygy_tests_XXXXXX";
+    std::string directory = mkdtemp(path);
+    // # White to move wins, black to move loses.
+    write_single_value_table(directory, "KQvK.rtbw", false, {4, 0});
+    // # White to move zeroes in 5 moves.
+    write_single_value_table(directory, "KQvK.rtbz", true, {5});
+    // # Not tables.
+    write_single_value_table(directory, "KQvQ.rtbw", false, {4, 0});
+    write_single_value_table(directory, "KQvK.txt", false, {4, 0});
+    return directory;
+}
+
+auto remove_tables(const std::string& directory) {
+    for (auto name : {"KQvK.rtbw", "KQvK.rtbz", "KQvQ.rtbw", "KQvK.txt", "KRvK.rtbw", "KRvK.rtbz", "KPvK.rtbw",
+                      "KPvK.rtbz"})
+        std::remove((directory + "/" + name).c_str());
+    std::remove(directory.c_str());
+}
+
+// # Pairs-compressed tables: each value is a leaf symbol, neighbouring symbols
+// # are paired up twice into runs of up to four values, and the symbols a
+// # block is made of get a canonical huffman code, longest codes lowest.
+
+struct PairsData {
+    // one table of a file as the prober reads it: its size record, its
+    // sparse index, its block lengths and its blocks.
+    std::vector<unsigned char> sizes, sparse_index, block_lengths, blocks;
+};
+
+auto put16(std::vector<unsigned char>& bytes, std::uint64_t value) {
+    bytes.insert(bytes.end(), {(unsigned char)value, (unsigned char)(value >> 8)});
+}
+
+auto put32(std::vector<unsigned char>& bytes, std::uint64_t value) {
+    put16(bytes, value);
+    put16(bytes, value >> 16);
+}
+
+auto compress(const std::vector<int>& values, unsigned char flags) -> PairsData {
+    // # Blocks of uneven lengths, so that the sparse index is walked both ways.
+    constexpr std::size_t BLOCK_LENGTHS[] = {37, 90, 64, 111};
+    constexpr int SPAN_LOG = 6;
+    std::vector<std::array<int, 2>> children;  // a value and -1 for a leaf
+    std::map<std::array<int, 2>, int> ids;
+    auto symbol = [&](int left, int right) {
+        auto [it, inserted] = ids.try_emplace({left, right}, (int)children.size());
+        if (inserted)
+            children.push_back({left, right});
+        return it->second;
+    };
+    std::vector<std::size_t> starts;
+    std::vector<std::vector<int>> block_symbols;
+    for (std::size_t start = 0; start < values.size(); start += BLOCK_LENGTHS[starts.size() % 4]) {
+        auto end = std::min(values.size(), start + BLOCK_LENGTHS[starts.size() % 4]);
+        starts.push_back(start);
+        std::vector<int> symbols;
+        for (auto i = start; i < end; ++i)
+            symbols.push_back(symbol(values[i], -1));
+        for (auto round = 0; round < 2; ++round) {
+            std::vector<int> paired;
+            for (std::size_t i = 0; i < symbols.size(); i += 2)
+                paired.push_back(i + 1 < symbols.size() ? symbol(symbols[i], symbols[i + 1]) : symbols[i]);
+            symbols = paired;
+        }
+        block_symbols.push_back(symbols);
+    }
+    starts.push_back(values.size());
+
+    // # Code lengths by merging the two rarest nodes until one is left.
+    std::vector<std::uint64_t> counts(children.size());
+    for (auto& symbols : block_symbols) {
+        for (auto sym : symbols)
+            ++counts[sym];
+    }
+    std::vector<int> parent(children.size(), -1);
+    using Node = std::pair<std::uint64_t, int>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<>> queue;
+    for (std::size_t sym = 0; sym < children.size(); ++sym) {
+        if (counts[sym])
+            queue.push({counts[sym], (int)sym});
+    }
+    while (queue.size() > 1) {
+        auto a = queue.top();
+        queue.pop();
+        auto b = queue.top();
+        queue.pop();
+        parent[a.second] = parent[b.second] = (int)parent.size();
+        parent.push_back(-1);
+        queue.push({a.first + b.first, parent[a.second]});
+    }
+    std::vector<int> length(children.size());
+    for (std::size_t sym = 0; sym < children.size(); ++sym) {
+        for (auto node = (int)sym; counts[sym] && parent[node] >= 0; node = parent[node])
+            ++length[sym];
+    }
+
+    // # Symbols are numbered longest code first; the ones only found inside
+    // # other symbols have no code and come last.
+    std::vector<int> order(children.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return length[a] > length[b]; });
+    std::vector<int> number(children.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+        number[order[i]] = (int)i;
+    auto max_len = length[order[0]];
+    auto min_len = max_len;
+    for (auto len : length) {
+        if (len)
+            min_len = std::min(min_len, len);
+    }
+    std::vector<std::uint64_t> lowest(max_len - min_len + 1), base(lowest.size()), per_length(lowest.size());
+    for (auto len : length) {
+        if (len)
+            ++per_length[len - min_len];
+    }
+    for (auto i = (int)lowest.size() - 2; i >= 0; --i) {
+        lowest[i] = lowest[i + 1] + per_length[i + 1];
+        base[i] = (base[i + 1] + per_length[i + 1]) / 2;
+    }
+
+    // # The blocks are written big-endian, with room for the decoder to read
+    // # ahead in 32-bit words.
+    std::vector<std::vector<unsigned char>> encoded;
+    std::size_t block_size = 64;
+    for (auto& symbols : block_symbols) {
+        std::vector<unsigned char> bytes;
+        auto bits = 0;
+        for (auto sym : symbols) {
+            auto i = length[sym] - min_len;
+            auto code = base[i] + number[sym] - lowest[i];
+            for (auto bit = length[sym] - 1; bit >= 0; --bit, ++bits) {
+                if (bits % 8 == 0)
+                    bytes.push_back(0);
+                bytes.back() |= (unsigned char)((code >> bit & 1) << (7 - bits % 8));
+            }
+        }
+        while (block_size < bytes.size() + 12)
+            block_size *= 2;
+        encoded.push_back(bytes);
+    }
+
+    PairsData d;
+    d.sizes = {flags, (unsigned char)__builtin_ctzll(block_size), SPAN_LOG, 0};
+    put32(d.sizes, encoded.size());
+    d.sizes.insert(d.sizes.end(), {(unsigned char)max_len, (unsigned char)min_len});
+    for (auto sym : lowest)
+        put16(d.sizes, sym);
+    put16(d.sizes, children.size());
+    for (auto sym : order) {
+        auto leaf = children[sym][1] < 0;
+        auto left = leaf ? children[sym][0] : number[children[sym][0]];
+        auto right = leaf ? 0xfff : number[children[sym][1]];
+        d.sizes.insert(d.sizes.end(), {(unsigned char)left, (unsigned char)(left >> 8 | (right & 0xf) << 4),
+                                       (unsigned char)(right >> 4)});
+    }
+    if (children.size() & 1)
+        d.sizes.push_back(0);
+
+    // # Entry k points at value k * span + span / 2, which for the last entry
+    // # can be past the end of the table.
+    std::size_t span = 1 << SPAN_LOG;
+    for (std::size_t k = 0; k * span < values.size(); ++k) {
+        auto value = k * span + span / 2;
+        auto block = std::upper_bound(starts.begin(), starts.end(), std::min(value, values.size() - 1)) - starts.begin() - 1;
+        put32(d.sparse_index, block);
+        put16(d.sparse_index, value - starts[block]);
+    }
+    for (std::size_t block = 0; block < encoded.size(); ++block) {
+        put16(d.block_lengths, starts[block + 1] - starts[block] - 1);
+        encoded[block].resize(block_size);
+        d.blocks.insert(d.blocks.end(), encoded[block].begin(), encoded[block].end());
+    }
+    return d;
+}
+
+auto write_pairs_table(const std::string& path, bool dtz, std::vector<unsigned char> header,
+                       const std::vector<PairsData>& tables, const std::vector<unsigned char>& dtz_map) {
+    // # The header, the size records, the dtz maps, the sparse indexes, the
+    // # block lengths and the blocks, aligned the way the prober reads them.
+    std::vector<unsigned char> bytes = dtz ? std::vector<unsigned char>{0xd7, 0x66, 0x0c, 0xa5}
+                                           : std::vector<unsigned char>{0x71, 0xe8, 0x23, 0x5d};
+    bytes.insert(bytes.end(), header.begin(), header.end());
+    bytes.resize(bytes.size() + (bytes.size() & 1));
+    for (auto& d : tables)
+        bytes.insert(bytes.end(), d.sizes.begin(), d.sizes.end());
+    if (dtz) {
+        bytes.insert(bytes.end(), dtz_map.begin(), dtz_map.end());
+        bytes.resize(bytes.size() + (bytes.size() & 1));
+    }
+    for (auto& d : tables)
+        bytes.insert(bytes.end(), d.sparse_index.begin(), d.sparse_index.end());
+    for (auto& d : tables)
+        bytes.insert(bytes.end(), d.block_lengths.begin(), d.block_lengths.end());
+    for (auto& d : tables) {
+        bytes.resize((bytes.size() + 63) / 64 * 64);
+        bytes.insert(bytes.end(), d.blocks.begin(), d.blocks.end());
+    }
+    bytes.resize((bytes.size() + 63) / 64 * 64 + 16);
+    auto file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+}
+
+// # The values stored at *idx* in the table of the file of the leading pawn
+// # and the side to move: short runs, different in every table.
+auto wdl_value(int file, int side, std::uint64_t idx) -> int {
+    return (int)((idx / 3 + idx / 41 + file + 2 * side) % 5);
+}
+
+auto dtz_value(int file, std::uint64_t idx) -> int {
+    return (int)((idx / 2 + idx / 29 + file) % 6);
+}
+
+auto dtz_map(int file, int map, int value) -> int {
+    return 3 * value + map + file + 1;
+}
+
+auto make_pairs_tables() -> std::string {
+    char path[] = "/tmp/syzygy_tests_XXXXXX";
+    std::string directory = mkdtemp(path);
+    auto table = [](std::uint64_t size, auto value, unsigned char flags) {
+        std::vector<int> values;
+        for (std::uint64_t idx = 0; idx < size; ++idx)
+            values.push_back(value(idx));
+        return compress(values, flags);
+    };
+
+    // # KRvK: one piece order and the pieces, K R k, with 31332 placements
+    // # of three unique pieces.
+    std::vector<PairsData> wdl, dtz;
+    for (auto side = 0; side < 2; ++side)
+        wdl.push_back(table(31332, [&](std::uint64_t idx) { return wdl_value(0, side, idx); }, 0));
+    dtz.push_back(table(31332, [&](std::uint64_t idx) { return dtz_value(0, idx); }, 0));
+    write_pairs_table(directory + "/KRvK.rtbw", false, {1, 0x00, 0x66, 0x44, 0xee}, wdl, {});
+    write_pairs_table(directory + "/KRvK.rtbz", true, {0, 0x00, 0x66, 0x44, 0xee}, dtz, {});
+
+    // # KPvK: per file of the pawn, P K k with 6 ranks for the pawn and 63
+    // # and 62 squares for the kings. The dtz tables are mapped, and wins are
+    // # in plies.
+    std::vector<unsigned char> wdl_header = {3}, dtz_header = {2}, map;
+    wdl.clear();
+    dtz.clear();
+    for (auto file = 0; file < 4; ++file) {
+        for (auto header : {&wdl_header, &dtz_header})
+            header->insert(header->end(), {0x00, 0x11, 0x66, 0xee});
+        for (auto side = 0; side < 2; ++side)
+            wdl.push_back(table(23436, [&](std::uint64_t idx) { return wdl_value(file, side, idx); }, 0));
+        dtz.push_back(table(23436, [&](std::uint64_t idx) { return dtz_value(file, idx); },
+                            Chess::syzygy::MAPPED | Chess::syzygy::WIN_PLIES));
+        for (auto i = 0; i < 4; ++i) {
+            map.push_back(6);
+            for (auto value = 0; value < 6; ++value)
+                map.push_back((unsigned char)dtz_map(file, i, value));
+        }
+    }
+    write_pairs_table(directory + "/KPvK.rtbw", false, wdl_header, wdl, {});
+    write_pairs_table(directory + "/KPvK.rtbz", true, dtz_header, dtz, map);
+    return directory;
+}
+
+auto test_calc_key() {
+    auto board = Chess::Board("8/8/8/5k2/3R4/2K1P3/6r1/8 w - - 0 1");
+    auto& e = Chess::syzygy::_ENCODING;
+    std::set<int> kk;
+    auto max_kk = 0;
+    for (auto& row : e.map_kk) {
+        for (auto code : row) {
+            kk.insert(code);
+            max_kk = std::max(max_kk, code);
+        }
+    }
+    // # 462 placements of two kings, a lead pawn on file a has 6 ranks.
+    return Chess::syzygy::calc_key(board) == "KRPvKR" && Chess::syzygy::calc_key(board, true) == "KRvKRP" &&
+           max_kk == 461 && kk.size() == 462 && e.lead_pawns_size[1][0] == 6 && e.binomial[2][4] == 6 &&
+           e.map_pawns[A2] == 47 && e.map_pawns[H2] == 46;
+}
+
+auto test_probe_wdl() {
+    auto directory = make_tables();
+    Chess::syzygy::Tablebase tablebase;
+    auto found = tablebase.add_directory(directory);
+    auto white = Chess::Board("4k3/8/8/8/8/8/8/3QK3 w - - 0 1");
+    auto black = Chess::Board("4k3/8/8/8/8/8/8/3QK3 b - - 0 1");
+    // # The king takes the queen: KvK is a draw.
+    auto capture = Chess::Board("4k3/3Q4/8/8/8/8/8/4K3 b - - 0 1");
+    // # Colors reversed.
+    auto mirrored = Chess::Board("3qk3/8/8/8/8/8/8/4K3 w - - 0 1");
+    auto kings = Chess::Board("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    auto fen = white.fen();
+    auto ok = found == 2 && tablebase.probe_wdl(white) == 2 && tablebase.probe_wdl(black) == -2 &&
+              tablebase.probe_wdl(capture) == 0 && tablebase.probe_wdl(mirrored) == -2 &&
+              tablebase.probe_wdl(kings) == 0 && white.fen() == fen;
+    remove_tables(directory);
+    return ok;
+}
+
+auto test_probe_dtz() {
+    auto directory = make_tables();
+    auto tablebase = Chess::syzygy::open_tablebase(directory);
+    auto white = Chess::Board("8/8/8/4k3/8/8/8/K6Q w - - 0 1");
+    auto black = Chess::Board("8/8/8/4k3/8/8/8/K6Q b - - 0 1");
+    auto capture = Chess::Board("4k3/3Q4/8/8/8/8/8/4K3 b - - 0 1");
+    // # Stored in moves, so 10 plies plus the zeroing move. Black to move
+    // # is stored on the other side, found by a search one ply deeper.
+    auto ok = tablebase->probe_dtz(white) == 11 && tablebase->probe_dtz(black) == -12 &&
+              tablebase->probe_dtz(capture) == 0;
+    remove_tables(directory);
+    return ok;
+}
+
+auto test_pairs() {
+    auto directory = make_pairs_tables();
+    auto tablebase = Chess::syzygy::open_tablebase(directory);
+    // # Kb1 Rh1 ka5 is (0 * 63 + 7 - 1) * 62 + 32 - 2 = 402, as b1 is the
+    // # first square of the a1-d1-d4 triangle. Then mirrored, and with the
+    // # colors reversed.
+    auto rook = Chess::Board("8/8/8/k7/8/8/8/1K5R w - - 0 1");
+    auto rook_mirrored = Chess::Board("8/8/8/7k/8/8/8/R5K1 w - - 0 1");
+    auto rook_flipped = Chess::Board("1k5r/8/8/8/K7/8/8/8 b - - 0 1");
+    // # Kc3 Ra6 kh7 is on the diagonal, so it is flipped to Kc3 Rf1 kg8:
+    // # (6 * 63 + 2 * 28 + 4) * 62 + 62 - 2 = 27216.
+    auto diagonal = Chess::Board("8/7k/R7/8/8/2K5/8/8 b - - 0 1");
+    // # Pc4 Ka1 kc5 is rank 2 of the pawn, then the kings less the squares
+    // # before them: 2 + 0 * 6 + 32 * 378 = 12098 on file c.
+    auto pawn = Chess::Board("8/8/8/2k5/2P5/8/8/K7 w - - 0 1");
+    auto pawn_mirrored = Chess::Board("8/8/8/5k2/5P2/8/8/7K w - - 0 1");
+    auto pawn_flipped = Chess::Board("k7/8/8/2p5/2K5/8/8/8 b - - 0 1");
+    // # Pb2 Kh1 kf6 is 0 + 7 * 6 + 43 * 378 = 16296 on file b.
+    auto black = Chess::Board("8/8/5k2/8/8/8/1P6/7K b - - 0 1");
+    // # Pa7 Kb1 kh8 is 5 + 1 * 6 + 61 * 378 = 23069 on file a.
+    auto seventh = Chess::Board("7k/P7/8/8/8/8/8/1K6 w - - 0 1");
+
+    auto ok = tablebase->probe_wdl(rook) == wdl_value(0, 0, 402) - 2 &&
+              tablebase->probe_wdl(rook_mirrored) == wdl_value(0, 0, 402) - 2 &&
+              tablebase->probe_wdl(rook_flipped) == wdl_value(0, 0, 402) - 2 &&
+              tablebase->probe_wdl(diagonal) == wdl_value(0, 1, 27216) - 2 &&
+              tablebase->probe_wdl(pawn) == wdl_value(2, 0, 12098) - 2 &&
+              tablebase->probe_wdl(pawn_mirrored) == wdl_value(2, 0, 12098) - 2 &&
+              tablebase->probe_wdl(pawn_flipped) == wdl_value(2, 0, 12098) - 2 &&
+              tablebase->probe_wdl(black) == wdl_value(1, 1, 16296) - 2 &&
+              tablebase->probe_wdl(seventh) == wdl_value(0, 0, 23069) - 2;
+    // # A cursed win, stored in moves, and a win that is mapped and in plies.
+    ok = ok && tablebase->probe_dtz(rook) == 101 + 2 * dtz_value(0, 402) &&
+         tablebase->probe_dtz(pawn) == 1 + dtz_map(2, 0, dtz_value(2, 12098)) &&
+         tablebase->probe_dtz(pawn_flipped) == 1 + dtz_map(2, 0, dtz_value(2, 12098));
+    remove_tables(directory);
+    return ok;
+}
+
+auto test_errors() {
+    auto directory = make_tables();
+    Chess::syzygy::Tablebase tablebase;
+    tablebase.add_directory(directory, true, false);
+    auto rook = Chess::Board("4k3/8/8/8/8/8/8/3RK3 w - - 0 1");
+    auto castling = Chess::Board("4k3/8/8/8/8/8/8/R3K3 w Q - 0 1");
+    auto queen = Chess::Board("4k3/8/8/8/8/8/8/3QK3 w - - 0 1");
+    auto ok = !tablebase.get_wdl(rook) && !tablebase.get_wdl(castling) && !tablebase.get_dtz(queen) &&
+              tablebase.get_wdl(queen) == 2;
+    try {
+        tablebase.probe_wdl(rook);
+        ok = false;
+    } catch (const Chess::syzygy::MissingTableError& error) {
+        ok = ok && std::string(error.what()) == "did not find wdl table KRvK";
+    }
+    try {
+        tablebase.add_directory("no/such/directory");
+        ok = false;
+    } catch (const std::runtime_error&) {
+    }
+    remove_tables(directory);
+    return ok;
+}
+
+auto test_threads() {
+    // # Every thread races to open the same table first.
+    auto directory = make_tables();
+    auto tablebase = Chess::syzygy::open_tablebase(directory);
+    std::vector<std::thread> threads;
+    std::vector<int> wins(8);
+    for (auto t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            auto board = Chess::Board("4k3/8/8/8/8/8/8/3QK3 w - - 0 1");
+            for (auto i = 0; i < 200; ++i)
+                wins[t] += tablebase->probe_wdl(board) == 2;
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    remove_tables(directory);
+    for (auto count : wins) {
+        if (count != 200)
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "test_calc_key:  " << (test_calc_key() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_probe_wdl: " << (test_probe_wdl() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_probe_dtz: " << (test_probe_dtz() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_pairs:     " << (test_pairs() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_errors:    " << (test_errors() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_threads:   " << (test_threads() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
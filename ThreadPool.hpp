@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tpool {
+
+// a fixed set of workers, each with its own task deque. a worker takes work
+// from the back of its own deque and, once that runs dry, steals from the
+// front of the others, so uneven tasks (perft subtrees, big PGN chunks) even
+// out without a central queue everyone contends on.
+class ThreadPool {
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::atomic<std::size_t> pending{0};
+    std::atomic<std::size_t> next_queue{0};
+    bool stopping = false;
+
+    auto try_pop(std::size_t self, std::function<void()>& task) -> bool {
+        {
+            auto& own = *queues[self];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < queues.size(); ++i) {
+            auto& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(std::size_t self) {
+        std::function<void()> task;
+        while (true) {
+            if (try_pop(self, task)) {
+                task();
+                task = nullptr;
+                if (pending.fetch_sub(1) == 1) {
+                    std::lock_guard lock(sleep_mutex);
+                    idle.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock lock(sleep_mutex);
+            if (stopping)
+                return;
+            // re-check under the lock so a submit() between try_pop() and here is not missed.
+            wake.wait(lock, [&] { return stopping || has_work(); });
+        }
+    }
+
+    auto has_work() -> bool {
+        for (auto& queue : queues) {
+            std::lock_guard lock(queue->mutex);
+            if (!queue->tasks.empty())
+                return true;
+        }
+        return false;
+    }
+
+   public:
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency()) {
+        if (threads == 0)
+            threads = 1;
+        for (std::size_t i = 0; i < threads; ++i)
+            queues.push_back(std::make_unique<Queue>());
+        for (std::size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this, i] { run(i); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+    ~ThreadPool() {
+        wait();
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    auto size() const -> std::size_t {
+        return workers.size();
+    }
+
+    // queue a task. tasks are dealt round-robin and rebalanced by stealing.
+    void submit(std::function<void()> task) {
+        pending.fetch_add(1);
+        auto& queue = *queues[next_queue.fetch_add(1) % queues.size()];
+        {
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        std::lock_guard lock(sleep_mutex);
+        wake.notify_one();
+    }
+
+    // block until every submitted task has finished.
+    void wait() {
+        std::unique_lock lock(sleep_mutex);
+        idle.wait(lock, [&] { return pending.load() == 0; });
+    }
+};
+
+}  // namespace tpool
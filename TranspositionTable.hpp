@@ -0,0 +1,230 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "target.hpp"
+
+// a transposition table for alpha-beta search, shared by any number of
+// threads without locks. the table is an array of 64 byte buckets, one cache
+// line each, holding four entries. every entry is two relaxed atomic words,
+// and the first holds key ^ data: an entry torn by two threads writing at
+// once never verifies against its key, so it reads as a miss instead of as
+// a wrong result. this is the same trick PerftTable uses.
+
+namespace Chess {
+
+enum class Bound : std::uint8_t {
+    NONE = 0,
+    // the score is at most this (the search failed low)
+    UPPER = 1,
+    // the score is at least this (the search failed high)
+    LOWER = 2,
+    EXACT = 3,
+};
+
+// what a probe finds. scores are stored as given: a search that stores mate
+// scores relative to the root should make them relative to the node first.
+struct TTEntry {
+    PackedMove move;
+    std::int16_t score = 0;
+    std::int16_t eval = 0;
+    int depth = 0;
+    Bound bound = Bound::NONE;
+};
+
+class TranspositionTable {
+    struct Slot {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[4];
+    };
+
+    static_assert(sizeof(Bucket) == 64);
+
+    // data bits: move 0-15, score 16-31, eval 32-47, depth 48-55, bound
+    // 56-57, generation 58-63. depth is offset so quiescence plies fit.
+    static constexpr int DEPTH_OFFSET = 8;
+    static constexpr unsigned GENERATIONS = 64;
+
+    Bucket* buckets = nullptr;
+    std::size_t bucket_count = 0;
+    std::size_t mapped_bytes = 0;
+    std::uint8_t generation = 0;
+
+    static constexpr auto pack(PackedMove move, int score, int eval, int depth, Bound bound, unsigned generation) -> std::uint64_t {
+        return (std::uint64_t)move.data | (std::uint64_t)(std::uint16_t)score << 16 | (std::uint64_t)(std::uint16_t)eval << 32 |
+               (std::uint64_t)(std::uint8_t)(depth + DEPTH_OFFSET) << 48 | (std::uint64_t)bound << 56 | (std::uint64_t)generation << 58;
+    }
+
+    static constexpr auto depth_of(std::uint64_t data) -> int {
+        return (int)((data >> 48) & 0xff) - DEPTH_OFFSET;
+    }
+
+    static constexpr auto generation_of(std::uint64_t data) -> unsigned {
+        return (unsigned)(data >> 58);
+    }
+
+    auto bucket(std::uint64_t key) const -> Bucket& {
+        return buckets[key & (bucket_count - 1)];
+    }
+
+    void release() {
+        if (buckets)
+            munmap(buckets, mapped_bytes);
+        buckets = nullptr;
+        bucket_count = 0;
+        mapped_bytes = 0;
+    }
+
+   public:
+    explicit TranspositionTable(std::size_t megabytes = 16) {
+        resize(megabytes);
+    }
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    auto operator=(const TranspositionTable&) -> TranspositionTable& = delete;
+
+    ~TranspositionTable() {
+        release();
+    }
+
+    void resize(std::size_t megabytes) {
+        // """
+        // Reallocates the table with the largest power of two number of
+        // buckets that fits in *megabytes*, and clears it. The memory is
+        // backed by transparent huge pages where the system has them. Not
+        // safe while other threads use the table.
+
+        // :raises: :exc:`std::bad_alloc` if the memory cannot be mapped.
+        // """
+        release();
+        auto count = std::size_t{1};
+        while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024)
+            count *= 2;
+        auto bytes = count * sizeof(Bucket);
+        // # Anonymous mappings are page aligned and come zeroed.
+        auto memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+        madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+        buckets = new (memory) Bucket[count];
+        bucket_count = count;
+        mapped_bytes = bytes;
+        generation = 0;
+    }
+
+    void clear() {
+        // """Forgets every entry. Not safe while other threads use the table."""
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            for (auto& slot : buckets[i].slots) {
+                slot.check.store(0, std::memory_order_relaxed);
+                slot.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        generation = 0;
+    }
+
+    void new_search() {
+        // """
+        // Ages the entries of earlier searches, so they are replaced first.
+        // Call it between searches, not during one.
+        // """
+        generation = (std::uint8_t)((generation + 1) % GENERATIONS);
+    }
+
+    void prefetch(std::uint64_t key) const {
+        // """Starts loading the bucket of *key* into the cache, ahead of a probe."""
+        __builtin_prefetch(&bucket(key));
+    }
+
+    auto probe(std::uint64_t key, TTEntry& entry) const -> bool {
+        // """
+        // Looks up *key*, usually :func:`~chess.Board.zobrist_hash()`, and
+        // fills in *entry* if it is there.
+        // """
+        for (auto& slot : bucket(key).slots) {
+            auto data = slot.data.load(std::memory_order_relaxed);
+            auto check = slot.check.load(std::memory_order_relaxed);
+            if ((check ^ data) != key || !data)
+                continue;
+            PackedMove move;
+            move.data = (std::uint16_t)data;
+            entry.move = move;
+            entry.score = (std::int16_t)(data >> 16);
+            entry.eval = (std::int16_t)(data >> 32);
+            entry.depth = depth_of(data);
+            entry.bound = (Bound)((data >> 56) & 3);
+            return true;
+        }
+        return false;
+    }
+
+    void store(std::uint64_t key, PackedMove move, int depth, Bound bound, int score, int eval = 0) {
+        // """
+        // Stores a search result for *key*. The entry for the same key is
+        // overwritten, keeping its move if *move* is null; otherwise the
+        // shallowest and oldest entry of the bucket makes room. *depth* must
+        // be within -7 and 247; *score* and *eval* must fit in 16 bits.
+        // """
+        auto& slots = bucket(key).slots;
+        Slot* victim = nullptr;
+        auto victim_worth = 0;
+        for (auto& slot : slots) {
+            auto data = slot.data.load(std::memory_order_relaxed);
+            auto check = slot.check.load(std::memory_order_relaxed);
+            if ((check ^ data) == key && data) {
+                if (!move.__bool__())
+                    move.data = (std::uint16_t)data;
+                victim = &slot;
+                break;
+            }
+            // # Older entries lose eight plies of depth per generation.
+            auto age = (GENERATIONS + generation - generation_of(data)) % GENERATIONS;
+            auto worth = data ? depth_of(data) - 8 * (int)age : -1000;
+            if (!victim || worth < victim_worth) {
+                victim = &slot;
+                victim_worth = worth;
+            }
+        }
+        auto data = pack(move, score, eval, depth, bound, generation);
+        victim->check.store(key ^ data, std::memory_order_relaxed);
+        victim->data.store(data, std::memory_order_relaxed);
+    }
+
+    void store(std::uint64_t key, Move move, int depth, Bound bound, int score, int eval = 0) {
+        store(key, PackedMove(move), depth, bound, score, eval);
+    }
+
+    auto hashfull() const -> int {
+        // """
+        // Estimates how full the table is with entries of the current search,
+        // in permille, from the first thousand entries, as in UCI.
+        // """
+        auto sampled = 0, used = 0;
+        for (std::size_t i = 0; i < bucket_count && sampled < 1000; ++i) {
+            for (auto& slot : buckets[i].slots) {
+                auto data = slot.data.load(std::memory_order_relaxed);
+                used += data && generation_of(data) == generation;
+                ++sampled;
+            }
+        }
+        return sampled ? used * 1000 / sampled : 0;
+    }
+
+    auto size() const -> std::size_t {
+        // """Gets the number of entries."""
+        return bucket_count * 4;
+    }
+};
+
+}  // namespace Chess
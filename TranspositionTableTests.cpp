@@ -0,0 +1,91 @@
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "TranspositionTable.hpp"
+
+auto test_store_probe() {
+    Chess::TranspositionTable table(1);
+    auto board = Chess::Board("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    auto key = board.zobrist_hash();
+    Chess::TTEntry entry;
+    if (table.probe(key, entry))
+        return false;
+
+    table.store(key, Chess::Move::from_uci("a7b8q"), -2, Chess::Bound::LOWER, -31000, 55);
+    if (!table.probe(key, entry) || entry.move.to_move() != Chess::Move::from_uci("a7b8q") || entry.depth != -2 ||
+        entry.bound != Chess::Bound::LOWER || entry.score != -31000 || entry.eval != 55)
+        return false;
+
+    // # Storing the same position again without a move keeps the old one.
+    table.store(key, Chess::PackedMove::null(), 12, Chess::Bound::EXACT, 7);
+    return table.probe(key, entry) && entry.move.to_move() == Chess::Move::from_uci("a7b8q") && entry.depth == 12 &&
+           entry.score == 7 && !table.probe(key ^ 1, entry);
+}
+
+auto test_replacement() {
+    Chess::TranspositionTable table(1);
+    auto buckets = table.size() / 4;
+    // # Five keys in one bucket: the shallowest of the first four goes.
+    for (std::uint64_t i = 0; i < 5; ++i)
+        table.store(i * buckets, Chess::PackedMove::null(), i == 4 ? 1 : 10 + (int)i, Chess::Bound::EXACT, 0);
+    Chess::TTEntry entry;
+    if (table.probe(0, entry) || !table.probe(4 * buckets, entry))
+        return false;
+
+    // # After a new search, old entries give way even to shallower ones.
+    table.new_search();
+    table.store(5 * buckets, Chess::PackedMove::null(), 2, Chess::Bound::EXACT, 0);
+    auto kept = 0;
+    for (std::uint64_t i = 0; i < 6; ++i)
+        kept += table.probe(i * buckets, entry);
+    return kept == 4 && table.probe(5 * buckets, entry) && !table.probe(4 * buckets, entry);
+}
+
+auto test_hashfull() {
+    Chess::TranspositionTable table(1);
+    if (table.hashfull() != 0)
+        return false;
+    for (std::uint64_t i = 0; i < table.size(); ++i)
+        table.store(i * 0x9e3779b97f4a7c15ULL, Chess::PackedMove::null(), 1, Chess::Bound::EXACT, 0);
+    auto full = table.hashfull();
+    table.new_search();
+    auto aged = table.hashfull();
+    table.clear();
+    return full > 500 && aged == 0 && table.hashfull() == 0;
+}
+
+auto test_concurrent() {
+    // threads hammer a small table with entries whose contents follow from
+    // their key. a probe must never see a mix of two writes.
+    Chess::TranspositionTable table(1);
+    std::atomic<bool> bad{false};
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            std::uint64_t seed = t + 1;
+            Chess::TTEntry entry;
+            for (auto i = 0; i < 200000; ++i) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                auto key = seed % 4096 * 0x9e3779b97f4a7c15ULL;
+                table.prefetch(key);
+                if (table.probe(key, entry) && entry.score != (std::int16_t)(key >> 40))
+                    bad = true;
+                table.store(key, Chess::PackedMove::null(), (int)(key >> 60) + 1, Chess::Bound::EXACT, (std::int16_t)(key >> 40));
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    return !bad;
+}
+
+int main() {
+    std::cout << "test_store_probe: " << (test_store_probe() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_replacement: " << (test_replacement() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_hashfull:    " << (test_hashfull() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_concurrent:  " << (test_concurrent() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "HashCounter.hpp"
+#include "target.hpp"
+
+auto full_hash(const Chess::Board& board) {
+    return board._compute_zobrist_pieces() ^ board._compute_zobrist_state(board.clean_castling_rights());
+}
+
+auto walk(Chess::Board& board, int depth) -> bool {
+    // the incremental key must match a full recomputation at every node, and pop() must restore it.
+    if (board.zobrist_hash() != full_hash(board))
+        return false;
+    if (depth == 0)
+        return true;
+
+    Chess::MoveList moves;
+    board.generate_legal_moves_into(moves);
+    for (auto move : moves) {
+        auto before = board.zobrist_hash();
+        board.push(move);
+        auto ok = walk(board, depth - 1);
+        board.pop();
+        if (!ok || board.zobrist_hash() != before) {
+            std::cout << move.uci() << " ";
+            return false;
+        }
+    }
+    return true;
+}
+
+auto test_incremental_matches_full() {
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    };
+    for (auto& fen : fens) {
+        auto board = Chess::Board(fen);
+        if (!walk(board, 3)) {
+            std::cout << fen << " ";
+            return false;
+        }
+    }
+    return true;
+}
+
+auto test_transpositions() {
+    // knights out and back again is the starting position.
+    auto board = Chess::Board();
+    auto start = board.zobrist_hash();
+    for (auto uci : {"g1f3", "g8f6", "f3g1", "f6g8"})
+        board.push(Chess::Move::from_uci(uci));
+    if (board.zobrist_hash() != start)
+        return false;
+
+    // different move orders reaching the same position.
+    auto a = Chess::Board();
+    for (auto uci : {"e2e3", "e7e6", "d2d3", "d7d6"})
+        a.push(Chess::Move::from_uci(uci));
+    auto b = Chess::Board();
+    for (auto uci : {"d2d3", "d7d6", "e2e3", "e7e6"})
+        b.push(Chess::Move::from_uci(uci));
+    if (a.zobrist_hash() != b.zobrist_hash())
+        return false;
+
+    // the side to move is part of the key.
+    auto white = Chess::Board("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    auto black = Chess::Board("4k3/8/8/8/8/8/8/4K3 b - - 0 1");
+    return white.zobrist_hash() != black.zobrist_hash();
+}
+
+auto test_en_passant_rule() {
+    // after 1. e4 no black pawn can capture, so the ep square is not hashed.
+    auto board = Chess::Board();
+    board.push(Chess::Move::from_uci("e2e4"));
+    auto without_ep = Chess::Board("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    if (board.zobrist_hash() != without_ep.zobrist_hash())
+        return false;
+
+    // with a pawn on d4 it is, even though the capture would be illegal here.
+    auto pinned = Chess::Board("8/8/8/8/k2pP2R/8/8/4K3 b - e3 0 1");
+    auto no_ep = Chess::Board("8/8/8/8/k2pP2R/8/8/4K3 b - - 0 1");
+    return pinned.zobrist_hash() != no_ep.zobrist_hash() && !pinned.has_legal_en_passant();
+}
+
+auto test_castling_rights() {
+    // losing a castling right changes the key, and a missing rook means no right at all.
+    auto full = Chess::Board("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    auto partial = Chess::Board("r3k2r/8/8/8/8/8/8/R3K2R w Kkq - 0 1");
+    auto phantom = Chess::Board("r3k3/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    auto cleaned = Chess::Board("r3k3/8/8/8/8/8/8/R3K2R w KQq - 0 1");
+    return full.zobrist_hash() != partial.zobrist_hash() && phantom.zobrist_hash() == cleaned.zobrist_hash();
+}
+
+auto push_all(Chess::Board& board, std::initializer_list<const char*> moves) {
+    for (auto uci : moves)
+        board.push(Chess::Move::from_uci(uci));
+}
+
+auto test_polyglot_keys() {
+    // the published keys from the Polyglot book format, one move at a time.
+    auto board = Chess::Board();
+    if (board.zobrist_hash() != 0x463b96181691fc9cULL)
+        return false;
+    std::vector<std::pair<const char*, std::uint64_t>> line = {
+        {"e2e4", 0x823c9b50fd114196ULL}, {"d7d5", 0x0756b94461c50fb0ULL}, {"e4e5", 0x662fafb965db29d4ULL},
+        {"f7f5", 0x22a48b5a8e47ff78ULL}, {"e1e2", 0x652a607ca3f242c1ULL}, {"e8f7", 0x00fdd303c946bdd9ULL},
+    };
+    for (auto [uci, key] : line) {
+        board.push(Chess::Move::from_uci(uci));
+        if (board.zobrist_hash() != key)
+            return false;
+    }
+    board.reset();
+    push_all(board, {"a2a4", "b7b5", "h2h4", "b5b4", "c2c4"});
+    if (board.zobrist_hash() != 0x3c8123ea7b067637ULL)
+        return false;
+    push_all(board, {"b4c3", "a1a3"});
+    return board.zobrist_hash() == 0x5c3f9b829b279560ULL;
+}
+
+auto test_repetition() {
+    auto board = Chess::Board();
+    push_all(board, {"g1f3", "g8f6", "f3g1", "f6g8"});
+    if (!board.is_repetition(2) || board.is_repetition(3))
+        return false;
+
+    push_all(board, {"g1f3", "g8f6", "f3g1"});
+    if (board.is_repetition(3) || !board.can_claim_threefold_repetition())
+        return false;
+
+    board.push(Chess::Move::from_uci("f6g8"));
+    if (!board.is_repetition(3) || board.is_repetition(4) || board.move_stack.size() != 8)
+        return false;
+
+    // a pawn move cuts the history: nothing before it can come back.
+    push_all(board, {"e2e4", "e7e5", "g1f3", "g8f6", "f3g1", "f6g8"});
+    if (!board.is_repetition(2) || board.is_repetition(3))
+        return false;
+
+    // pop() takes the history back with it.
+    board.pop();
+    return !board.is_repetition(2) && !board.can_claim_threefold_repetition();
+}
+
+auto test_repetition_en_passant() {
+    // e3 is only a pseudo-legal ep square because the d4 pawn is pinned along
+    // the fourth rank, so the position after the king shuffle is the same.
+    auto pinned = Chess::Board("8/8/8/8/k2p3R/8/4P3/4K3 w - - 0 1");
+    push_all(pinned, {"e2e4", "a4a3", "e1e2", "a3a4", "e2e1"});
+    if (!pinned.is_repetition(2))
+        return false;
+
+    // without the rook dxe3 is legal, so giving it up is irreversible.
+    auto free = Chess::Board("8/8/8/8/k2p4/8/4P3/4K3 w - - 0 1");
+    push_all(free, {"e2e4", "a4a3", "e1e2", "a3a4", "e2e1"});
+    return !free.is_repetition(2);
+}
+
+auto test_hash_counter() {
+    // # Small inline capacity, so the table spills to the heap and grows.
+    hscnt::HashCounter<4> counter;
+    for (std::uint64_t key = 0; key < 100; ++key) {
+        for (std::uint64_t times = 0; times <= key % 3; ++times)
+            counter.add(key << 40);
+    }
+    if (counter.size() != 100 || counter.add(7ULL << 40) != 3 || counter.count(99ULL << 40) != 1 || counter.count(100ULL << 40))
+        return false;
+    for (std::uint64_t key = 0; key < 100; ++key) {
+        if (counter.count(key << 40) != (int)(key % 3) + 1 + (key == 7))
+            return false;
+    }
+    counter.clear();
+    return counter.size() == 0 && counter.count(0) == 0 && counter.add(0) == 1;
+}
+
+auto test_claim_threefold() {
+    // # Knights and kings wander about, so positions come back often.
+    auto board = Chess::Board("4k3/8/2n5/8/8/5N2/8/4K3 w - - 0 1");
+    std::uint64_t seed = 11;
+    auto claims = 0;
+    for (auto i = 0; i < 3000; ++i) {
+        auto moves = board.generate_legal_moves();
+        auto naive = board.is_repetition(3);
+        for (auto move : moves) {
+            board.push(move);
+            naive = naive || board.is_repetition(3);
+            board.pop();
+        }
+        if (board.can_claim_threefold_repetition() != naive)
+            return false;
+        claims += naive;
+        if (moves.empty() || board.move_stack.size() > 200) {
+            board.set_fen("4k3/8/2n5/8/8/5N2/8/4K3 w - - 0 1");
+            continue;
+        }
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        board.push(moves[(seed >> 33) % moves.size()]);
+    }
+    return claims > 10;
+}
+
+int main() {
+    std::cout << "test_incremental_matches_full: " << (test_incremental_matches_full() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_transpositions:           " << (test_transpositions() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_en_passant_rule:          " << (test_en_passant_rule() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_polyglot_keys:            " << (test_polyglot_keys() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_castling_rights:          " << (test_castling_rights() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_repetition:               " << (test_repetition() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_repetition_en_passant:    " << (test_repetition_en_passant() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_hash_counter:             " << (test_hash_counter() ? "PASS ✅" : "FAIL ❌") << '\n';
+    std::cout << "test_claim_threefold:          " << (test_claim_threefold() ? "PASS ✅" : "FAIL ❌") << '\n';
+    return 0;
+}
@@ -0,0 +1,382 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BoardArena.hpp"
+#include "BoardBatch.hpp"
+#include "MovePicker.hpp"
+#include "PackedPosition.hpp"
+#include "TranspositionTable.hpp"
+#include "Pgn.hpp"
+#include "target.hpp"
+
+// prints a single JSON object to stdout, so results can be diffed and gated on.
+// perft node counts are checked as well: a fast wrong move generator is no use.
+
+using Clock = std::chrono::steady_clock;
+
+// keeps the optimiser from throwing away the work being measured.
+volatile std::uint64_t sink = 0;
+
+template <typename T>
+void consume(T value) {
+    sink = sink ^ (std::uint64_t)value;
+}
+
+auto seconds_since(Clock::time_point start) -> double {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+auto perft(Chess::Board& board, int depth) -> long long {
+    Chess::MoveList moves;
+    board.generate_legal_moves_into(moves);
+    if (depth == 1)
+        return (long long)moves.size();
+
+    long long nodes = 0;
+    Chess::UndoRecord undo;
+    for (auto move : moves) {
+        board.push_fast(move, undo);
+        nodes += perft(board, depth - 1);
+        board.pop_fast(undo);
+    }
+    return nodes;
+}
+
+struct PerftCase {
+    std::string name;
+    std::string fen;
+    int depth;
+    long long expected;
+};
+
+struct Result {
+    std::string name;
+    long long ops;
+    double seconds;
+};
+
+// runs f(i) for i in [0, iterations) and reports how long it took.
+template <typename F>
+auto measure(const std::string& name, long long iterations, F f) -> Result {
+    auto start = Clock::now();
+    for (long long i = 0; i < iterations; ++i)
+        f(i);
+    return {name, iterations, seconds_since(start)};
+}
+
+const std::vector<std::string> FENS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+auto bench_perft(bool& ok) -> std::vector<Result> {
+    std::vector<PerftCase> cases = {
+        {"startpos", FENS[0], 6, 119060324},
+        {"kiwipete", FENS[1], 5, 193690690},
+        {"position3", FENS[2], 6, 11030083},
+        {"position4", FENS[3], 5, 15833292},
+        {"position5", FENS[4], 5, 89941194},
+        {"position6", FENS[5], 5, 164075551},
+    };
+    std::vector<Result> results;
+    for (auto& c : cases) {
+        auto board = Chess::Board(c.fen);
+        auto start = Clock::now();
+        auto nodes = perft(board, c.depth);
+        auto elapsed = seconds_since(start);
+        if (nodes != c.expected) {
+            std::cerr << c.name << ": perft(" << c.depth << ") = " << nodes << ", expected " << c.expected << '\n';
+            ok = false;
+        }
+        results.push_back({c.name, nodes, elapsed});
+    }
+    return results;
+}
+
+auto bench_micro() -> std::vector<Result> {
+    std::vector<Chess::Board> boards;
+    for (auto& fen : FENS)
+        boards.emplace_back(fen);
+
+    // all legal moves of every position, with their SAN, for the notation benchmarks.
+    struct Notation {
+        std::size_t board;
+        Chess::Move move;
+        std::string san;
+    };
+    std::vector<Notation> notation;
+    for (std::size_t b = 0; b < boards.size(); ++b) {
+        for (auto move : boards[b].generate_legal_moves())
+            notation.push_back({b, move, boards[b].san(move)});
+    }
+
+    // a long reversible game, so that is_repetition() has a full window to scan.
+    auto shuffle = Chess::Board();
+    for (auto i = 0; i < 49; ++i) {
+        for (auto uci : {"g1f3", "g8f6", "f3g1", "f6g8"})
+            shuffle.push(Chess::Move::from_uci(uci));
+    }
+    for (auto uci : {"b1c3", "b8c6"})
+        shuffle.push(Chess::Move::from_uci(uci));
+
+    auto n = (long long)boards.size();
+    std::vector<Result> results;
+
+    results.push_back(measure("attacks_mask", 2000000, [&](long long i) {
+        consume(boards[i % n].attacks_mask((Square)(i & 63)));
+    }));
+    results.push_back(measure("_attackers_mask", 2000000, [&](long long i) {
+        auto& board = boards[i % n];
+        consume(board._attackers_mask((Chess::Color)(bool)(i & 64), (Square)(i & 63), board.occupied));
+    }));
+    results.push_back(measure("pin_mask", 2000000, [&](long long i) {
+        consume(boards[i % n].pin_mask((Chess::Color)(bool)(i & 64), (Square)(i & 63)));
+    }));
+    results.push_back(measure("set_fen", 100000, [&](long long i) {
+        auto& board = boards[i % n];
+        board.set_fen(FENS[i % n]);
+        consume(board.occupied);
+    }));
+    results.push_back(measure("fen", 100000, [&](long long i) {
+        consume(boards[i % n].fen().size());
+    }));
+    results.push_back(measure("try_set_fen", 1000000, [&](long long i) {
+        auto& board = boards[i % n];
+        consume(board.try_set_fen(FENS[i % n]) == Chess::FenError::ok);
+    }));
+    results.push_back(measure("write_fen", 1000000, [&](long long i) {
+        char buffer[Chess::MAX_FEN_LENGTH];
+        consume(boards[i % n].write_fen(buffer, sizeof(buffer)));
+    }));
+    results.push_back(measure("fen_round_trip", 1000000, [&](long long i) {
+        // parse a FEN, then write it straight back out, with no allocation.
+        char buffer[Chess::MAX_FEN_LENGTH];
+        auto& board = boards[i % n];
+        board.try_set_fen(FENS[i % n]);
+        consume(board.write_fen(buffer, sizeof(buffer)));
+    }));
+    results.push_back(measure("pack_position", 1000000, [&](long long i) {
+        consume(Chess::PackedPosition::from_board(boards[i % n]).occupied);
+    }));
+    std::vector<Chess::PackedPosition> packed;
+    for (auto& board : boards)
+        packed.push_back(Chess::PackedPosition::from_board(board));
+    auto unpacked = Chess::Board(std::nullopt);
+    results.push_back(measure("unpack_position", 1000000, [&](long long i) {
+        packed[i % n].to_board(unpacked);
+        consume(unpacked._zobrist_pieces);
+    }));
+    results.push_back(measure("parse_san", 100000, [&](long long i) {
+        auto& entry = notation[i % notation.size()];
+        consume(boards[entry.board].parse_san(entry.san).to_square);
+    }));
+    results.push_back(measure("san", 100000, [&](long long i) {
+        auto& entry = notation[i % notation.size()];
+        consume(boards[entry.board].san(entry.move).size());
+    }));
+    results.push_back(measure("try_parse_san", 1000000, [&](long long i) {
+        auto& entry = notation[i % notation.size()];
+        auto move = Chess::Move::null();
+        boards[entry.board].try_parse_san(entry.san, move);
+        consume(move.to_square);
+    }));
+    results.push_back(measure("write_san", 1000000, [&](long long i) {
+        auto& entry = notation[i % notation.size()];
+        char buffer[Chess::MAX_SAN_LENGTH];
+        consume(boards[entry.board].write_san(entry.move, buffer));
+    }));
+    // a few hundred pseudo-random games, for the PGN reader. each iteration
+    // reads all of them, replaying every move on a board.
+    std::string pgn;
+    std::uint64_t seed = 1;
+    for (auto game = 0; game < 200; ++game) {
+        auto board = Chess::Board();
+        pgn += "[Event \"bench\"]\n[Round \"" + std::to_string(game) + "\"]\n\n";
+        for (auto ply = 0; ply < 120; ++ply) {
+            auto moves = board.generate_legal_moves();
+            if (moves.empty())
+                break;
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            if (board.turn == Chess::WHITE)
+                pgn += std::to_string(board.fullmove_number) + ". ";
+            pgn += board.san_and_push(moves[(seed >> 33) % moves.size()]) + " ";
+        }
+        pgn += "*\n\n";
+    }
+    struct CountMoves : Chess::pgn::Visitor {
+        std::uint64_t moves = 0;
+        void visit_move(Chess::Board&, Chess::Move) override { ++moves; }
+    } counter;
+    results.push_back(measure("pgn_read_200_games", 20, [&](long long) {
+        consume(Chess::pgn::read_games(pgn, counter));
+    }));
+    // the attack maps of both sides on a thousand boards, in bulk and one
+    // board at a time.
+    Chess::BoardBatch batch;
+    for (auto i = 0; i < 1024; ++i)
+        batch.push_back(boards[i % n]);
+    std::vector<Bitboard> batch_out(batch.size());
+    results.push_back(measure("batch_attacks_1024", 2000, [&](long long) {
+        batch.attacks(Chess::WHITE, batch_out.data());
+        batch.attacks(Chess::BLACK, batch_out.data());
+        consume(batch_out[0]);
+    }));
+    results.push_back(measure("scalar_attacks_1024", 200, [&](long long) {
+        for (auto i = 0; i < 1024; ++i) {
+            auto& board = boards[i % n];
+            for (auto color : {Chess::WHITE, Chess::BLACK}) {
+                Bitboard attacks = BB_EMPTY;
+                for (auto square : scan_forward(board.occupied_co[color]))
+                    attacks |= board.attacks_mask(square);
+                batch_out[i] = attacks;
+            }
+        }
+        consume(batch_out[0]);
+    }));
+    results.push_back(measure("batch_pinned_1024", 2000, [&](long long) {
+        batch.pinned(batch_out.data());
+        consume(batch_out[0]);
+    }));
+    results.push_back(measure("gives_check", 1000000, [&](long long i) {
+        auto& entry = notation[i % notation.size()];
+        consume(boards[entry.board].gives_check(entry.move));
+    }));
+    results.push_back(measure("see", 1000000, [&](long long i) {
+        auto& entry = notation[i % notation.size()];
+        consume(boards[entry.board].see(entry.move));
+    }));
+    results.push_back(measure("see_ge", 1000000, [&](long long i) {
+        auto& entry = notation[i % notation.size()];
+        consume(boards[entry.board].see_ge(entry.move));
+    }));
+    // a search that cuts off on the first capture only generates captures.
+    results.push_back(measure("move_picker_first_move", 1000000, [&](long long i) {
+        Chess::MovePicker picker(boards[i % n]);
+        auto move = Chess::Move::null();
+        picker.next(move);
+        consume(move.to_square);
+    }));
+    results.push_back(measure("generate_legal_moves", 1000000, [&](long long i) {
+        Chess::MoveList moves;
+        boards[i % n].generate_legal_moves_into(moves);
+        consume(moves.size());
+    }));
+    // random keys over a table much larger than the cache, as in a search.
+    Chess::TranspositionTable table(64);
+    results.push_back(measure("tt_store", 1000000, [&](long long i) {
+        table.store((std::uint64_t)i * 0x9e3779b97f4a7c15ULL, Chess::PackedMove::null(), (int)(i & 31), Chess::Bound::EXACT, (int)i & 0xfff);
+    }));
+    results.push_back(measure("tt_probe", 1000000, [&](long long i) {
+        Chess::TTEntry entry;
+        consume(table.probe((std::uint64_t)i * 0x9e3779b97f4a7c15ULL, entry));
+    }));
+    results.push_back(measure("scan_forward", 1000000, [&](long long i) {
+        auto sum = 0;
+        for (auto square : scan_forward(boards[i % n].occupied))
+            sum += square;
+        consume(sum);
+    }));
+    results.push_back(measure("for_each_square", 1000000, [&](long long i) {
+        auto sum = 0;
+        for_each_square(boards[i % n].occupied, [&](Square square) { sum += square; });
+        consume(sum);
+    }));
+    results.push_back(measure("is_repetition", 1000000, [&](long long i) {
+        consume(shuffle.is_repetition(2 + (int)(i & 1)));
+    }));
+    results.push_back(measure("can_claim_threefold", 100000, [&](long long) {
+        consume(shuffle.can_claim_threefold_repetition());
+    }));
+    // a short playout from a fresh copy, as a search worker would do it: the
+    // stacks grow from nothing, three times over.
+    auto playout = std::vector<Chess::Move>();
+    for (auto uci : {"g1f3", "g8f6", "f3g1", "f6g8"})
+        playout.push_back(Chess::Move::from_uci(uci));
+    auto start = Chess::Board();
+    auto played = start.copy(false);
+    results.push_back(measure("push_pop", 1000000, [&](long long) {
+        // every push saves a _BoardState, which every pop restores.
+        for (auto move : playout)
+            played.push(move);
+        for (std::size_t i = 0; i < playout.size(); ++i)
+            played.pop();
+        consume(played.zobrist_hash());
+    }));
+    results.push_back(measure("copy_and_push", 1000000, [&](long long) {
+        auto copy = start.copy(false);
+        for (auto move : playout)
+            copy.push(move);
+        consume(copy.zobrist_hash());
+    }));
+    Chess::BoardArena<> arena;
+    results.push_back(measure("arena_copy_and_push", 1000000, [&](long long) {
+        {
+            auto copy = arena.copy(start, false);
+            for (auto move : playout)
+                copy.push(move);
+            consume(copy.zobrist_hash());
+        }
+        arena.release();
+    }));
+    auto snapshot = start.snapshot();
+    results.push_back(measure("snapshot_and_push", 1000000, [&](long long) {
+        auto copy = snapshot;
+        for (auto move : playout)
+            copy.push(move);
+        consume(copy.zobrist_hash());
+    }));
+    results.push_back(measure("mirror", 1000000, [&](long long i) {
+        consume(boards[i % n].mirror()._zobrist_pieces);
+    }));
+    results.push_back(measure("batch_symmetries_1024", 2000, [&](long long) {
+        consume(batch.symmetries().pawns.back());
+    }));
+    return results;
+}
+
+void print_results(const std::string& key, const std::vector<Result>& results, const std::string& unit, bool rate) {
+    std::cout << "  \"" << key << "\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        auto& r = results[i];
+        std::cout << "    {\"name\": \"" << r.name << "\", \"" << unit << "\": " << r.ops
+                  << ", \"seconds\": " << r.seconds;
+        if (rate)
+            std::cout << ", \"nps\": " << (long long)(r.ops / r.seconds);
+        else
+            std::cout << ", \"ns_per_op\": " << r.seconds * 1e9 / r.ops;
+        std::cout << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    std::cout << "  ]";
+}
+
+int main() {
+    auto ok = true;
+    auto perft_results = bench_perft(ok);
+    auto micro_results = bench_micro();
+
+    long long total_nodes = 0;
+    double total_seconds = 0;
+    for (auto& r : perft_results) {
+        total_nodes += r.ops;
+        total_seconds += r.seconds;
+    }
+
+    std::cout << "{\n";
+    std::cout << "  \"perft_ok\": " << (ok ? "true" : "false") << ",\n";
+    std::cout << "  \"perft_total_nps\": " << (long long)(total_nodes / total_seconds) << ",\n";
+    print_results("perft", perft_results, "nodes", true);
+    std::cout << ",\n";
+    print_results("micro", micro_results, "iterations", false);
+    if constexpr (instr::ENABLED)
+        std::cout << ",\n  \"instrumentation\": " << instr::to_json(instr::snapshot());
+    std::cout << "\n}\n";
+
+    return ok ? 0 : 1;
+}
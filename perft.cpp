@@ -0,0 +1,46 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Perft.hpp"
+
+// usage: perft_runner <depth> [--threads N] [--hash MB] [--divide] [--chess960] [fen...]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <depth> [--threads N] [--hash MB] [--divide] [--chess960] [fen...]\n";
+        return 2;
+    }
+
+    auto depth = std::atoi(argv[1]);
+    auto threads = 1u;
+    std::size_t hash_mb = 64;
+    auto divide = false;
+    auto chess960 = false;
+    std::string fen;
+
+    for (auto i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            threads = (unsigned)std::atoi(argv[++i]);
+        else if (arg == "--hash" && i + 1 < argc)
+            hash_mb = (std::size_t)std::atoi(argv[++i]);
+        else if (arg == "--divide")
+            divide = true;
+        else if (arg == "--chess960")
+            chess960 = true;
+        else
+            fen += (fen.empty() ? "" : " ") + arg;
+    }
+
+    try {
+        auto board = Chess::Board(fen.empty() ? std::string(Chess::STARTING_FEN) : fen, chess960);
+        if (divide)
+            Chess::print_divide(board, depth, threads, hash_mb);
+        else
+            std::cout << Chess::perft(board, depth, threads, hash_mb) << '\n';
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -1,7 +1,20 @@
+#pragma once
+
 #include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory_resource>
 #include <optional>
-#include <regex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -11,9 +24,12 @@
 #include "ConstexprArrayGenerator.hpp"
 #include "HashCounter.hpp"
 #include "Index.hpp"
+#include "Instrumentation.hpp"
+#include "MoveList.hpp"
 #include "SquareIterator.hpp"
 #include "SquareSet.hpp"
 #include "StringTools.hpp"
+#include "Zobrist.hpp"
 #include "scan.hpp"
 
 namespace Chess {
@@ -27,11 +43,11 @@ enum class _EnPassantSpec {
 };
 
 enum Color : bool {
-    WHITE,
-    BLACK
+    BLACK,
+    WHITE
 };
 
-const std::string COLOR_NAMES[] = { "black", "white" };
+constexpr std::array<std::string_view, 2> COLOR_NAMES = { "black", "white" };
 
 enum class PieceType {
     PAWN = 1,
@@ -42,34 +58,34 @@ enum class PieceType {
     KING
 };
 
-const std::array<std::string, 7> PIECE_SYMBOLS = { "-", "p", "n", "b", "r", "q", "k" };
-const std::array<std::string, 7> PIECE_NAMES = { "-", "pawn", "knight", "bishop", "rook", "queen", "king" };
+constexpr std::array<std::string_view, 7> PIECE_SYMBOLS = { "-", "p", "n", "b", "r", "q", "k" };
+constexpr std::array<std::string_view, 7> PIECE_NAMES = { "-", "pawn", "knight", "bishop", "rook", "queen", "king" };
 
 auto piece_symbol(PieceType piece_type) -> std::string {
-    return PIECE_SYMBOLS[(size_t)piece_type];
+    return std::string(PIECE_SYMBOLS[(size_t)piece_type]);
 }
 
 auto piece_name(PieceType piece_type) -> std::string {
-    return PIECE_NAMES[(size_t)piece_type];
+    return std::string(PIECE_NAMES[(size_t)piece_type]);
 }
 
-const std::map<std::string, std::string> UNICODE_PIECE_SYMBOLS = {
+constexpr std::array<std::pair<std::string_view, std::string_view>, 12> UNICODE_PIECE_SYMBOLS = {{
     {"R", "♖"}, {"r", "♜"},
     {"N", "♘"}, {"n", "♞"},
     {"B", "♗"}, {"b", "♝"},
     {"Q", "♕"}, {"q", "♛"},
     {"K", "♔"}, {"k", "♚"},
     {"P", "♙"}, {"p", "♟"},
-};
+}};
 
 constexpr std::array<char, 8> FILE_NAMES = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h'};
 
 constexpr std::array<char, 8> RANK_NAMES = {'1', '2', '3', '4', '5', '6', '7', '8'};
 
-const std::string STARTING_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+constexpr std::string_view STARTING_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 // The FEN for the standard chess starting position.
 
-const std::string STARTING_BOARD_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR";
+constexpr std::string_view STARTING_BOARD_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR";
 // The board part of the FEN for the standard chess starting position.
 
 enum class Status : int {
@@ -154,15 +170,15 @@ struct Outcome {
     }
 };
 
-const std::array<std::string, 64> SQUARE_NAMES = {
-    "A1", "A2", "A3", "A4", "A5", "A6", "A7", "A8",
-    "B1", "B2", "B3", "B4", "B5", "B6", "B7", "B8",
-    "C1", "C2", "C3", "C4", "C5", "C6", "C7", "C8",
-    "D1", "D2", "D3", "D4", "D5", "D6", "D7", "D8",
-    "E1", "E2", "E3", "E4", "E5", "E6", "E7", "E8",
-    "F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8",
-    "G1", "G2", "G3", "G4", "G5", "G6", "G7", "G8",
-    "H1", "H2", "H3", "H4", "H5", "H6", "H7", "H8",
+constexpr std::array<std::string_view, 64> SQUARE_NAMES = {
+    "a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1",
+    "a2", "b2", "c2", "d2", "e2", "f2", "g2", "h2",
+    "a3", "b3", "c3", "d3", "e3", "f3", "g3", "h3",
+    "a4", "b4", "c4", "d4", "e4", "f4", "g4", "h4",
+    "a5", "b5", "c5", "d5", "e5", "f5", "g5", "h5",
+    "a6", "b6", "c6", "d6", "e6", "f6", "g6", "h6",
+    "a7", "b7", "c7", "d7", "e7", "f7", "g7", "h7",
+    "a8", "b8", "c8", "d8", "e8", "f8", "g8", "h8",
 };
 
 auto parse_square(std::string name) -> Square {
@@ -182,16 +198,212 @@ auto parse_square(std::string name) -> Square {
 
 auto square_name(Square square) -> std::string {
     // """Gets the name of the square, like ``a3``."""
-    return SQUARE_NAMES[(size_t)square];
+    return std::string(SQUARE_NAMES[(size_t)square]);
 }
 
 using Bitboard = unsigned long long;
+using ::Square;
 
 // most of the bitboard stuff is done in #include "BitboardNames.hpp";
 
-const auto SAN_REGEX = std::regex("^([NBKRQ])?([a-h])?([1-8])?[\\-x]?([a-h][1-8])(=?[nbrqkNBRQK])?[\\+#]?\\Z");
+// what went wrong when parsing a FEN or EPD. the try_ parsers return these
+// instead of throwing, so hot loops over position files never allocate.
+enum class FenError {
+    ok,
+    empty,
+    board_parts,
+    board_rows,
+    board_columns,
+    board_digits,
+    board_tilde,
+    board_character,
+    turn,
+    castling,
+    en_passant,
+    halfmove_clock,
+    negative_halfmove_clock,
+    fullmove_number,
+    negative_fullmove_number,
+    too_many_parts,
+};
+
+constexpr auto fen_error_message(FenError error) -> std::string_view {
+    switch (error) {
+        case FenError::ok: return "ok";
+        case FenError::empty: return "empty fen";
+        case FenError::board_parts: return "expected position part of fen, got multiple parts";
+        case FenError::board_rows: return "expected 8 rows in position part of fen";
+        case FenError::board_columns: return "expected 8 columns per row in position part of fen";
+        case FenError::board_digits: return "two subsequent digits in position part of fen";
+        case FenError::board_tilde: return "'~' not after piece in position part of fen";
+        case FenError::board_character: return "invalid character in position part of fen";
+        case FenError::turn: return "expected 'w' or 'b' for turn part of fen";
+        case FenError::castling: return "invalid castling part in fen";
+        case FenError::en_passant: return "invalid en passant part in fen";
+        case FenError::halfmove_clock: return "invalid half-move clock in fen";
+        case FenError::negative_halfmove_clock: return "half-move clock cannot be negative";
+        case FenError::fullmove_number: return "invalid fullmove number in fen";
+        case FenError::negative_fullmove_number: return "fullmove number cannot be negative";
+        case FenError::too_many_parts: return "fen string has more parts than expected";
+    }
+    return "unknown fen error";
+}
+
+// what went wrong when parsing a move in SAN, for the non-throwing parsers.
+enum class SanError {
+    ok,
+    invalid,
+    multi_leg,
+    illegal,
+    ambiguous,
+    missing_promotion,
+};
+
+constexpr auto san_error_message(SanError error) -> std::string_view {
+    switch (error) {
+        case SanError::ok: return "ok";
+        case SanError::invalid: return "invalid san";
+        case SanError::multi_leg: return "unsupported multi-leg move";
+        case SanError::illegal: return "illegal san";
+        case SanError::ambiguous: return "ambiguous san";
+        case SanError::missing_promotion: return "missing promotion piece type";
+    }
+    return "unknown san error";
+}
+
+// the longest SAN, like ``exd8=Q#`` or ``Qh4xe1+``, and its terminating NUL.
+constexpr std::size_t MAX_SAN_LENGTH = 8;
+
+// the fields of a SAN, matched by hand against
+// ``^([NBKRQ])?([a-h])?([1-8])?[\-x]?([a-h][1-8])(=?[nbrqkNBRQK])?[\+#]?$``.
+struct _SanFields {
+    int piece_type = 0;
+    int from_file = -1;
+    int from_rank = -1;
+    int to_square = -1;
+    int promotion = 0;
+};
+
+constexpr auto _san_piece_type(char c) -> int {
+    switch (c) {
+        case 'p': case 'P': return 1;
+        case 'n': case 'N': return 2;
+        case 'b': case 'B': return 3;
+        case 'r': case 'R': return 4;
+        case 'q': case 'Q': return 5;
+        case 'k': case 'K': return 6;
+        default: return 0;
+    }
+}
+
+constexpr auto _match_san(std::string_view san, _SanFields& fields) -> bool {
+    // the destination square is the last thing before an optional promotion
+    // and check suffix, so peel those off the end first.
+    if (!san.empty() && (san.back() == '+' || san.back() == '#'))
+        san.remove_suffix(1);
+    if (!san.empty() && san.back() != 'p' && san.back() != 'P' && _san_piece_type(san.back())) {
+        fields.promotion = _san_piece_type(san.back());
+        san.remove_suffix(1);
+        if (!san.empty() && san.back() == '=')
+            san.remove_suffix(1);
+    }
+    if (san.size() < 2)
+        return false;
+    auto file = san[san.size() - 2], rank = san[san.size() - 1];
+    if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+        return false;
+    fields.to_square = (rank - '1') * 8 + (file - 'a');
+    san.remove_suffix(2);
+    if (!san.empty() && (san.back() == '-' || san.back() == 'x'))
+        san.remove_suffix(1);
+
+    std::size_t i = 0;
+    if (i < san.size() && (san[i] == 'N' || san[i] == 'B' || san[i] == 'K' || san[i] == 'R' || san[i] == 'Q'))
+        fields.piece_type = _san_piece_type(san[i++]);
+    if (i < san.size() && 'a' <= san[i] && san[i] <= 'h')
+        fields.from_file = san[i++] - 'a';
+    if (i < san.size() && '1' <= san[i] && san[i] <= '8')
+        fields.from_rank = san[i++] - '1';
+    return i == san.size();
+}
+
+// the longest board part is 64 promoted pieces with their '~' and 7 slashes.
+constexpr std::size_t MAX_BOARD_FEN_LENGTH = 64 * 2 + 7;
+// board, turn, up to 4 castling flags, an ep square, and two 10 digit counters.
+constexpr std::size_t MAX_FEN_LENGTH = MAX_BOARD_FEN_LENGTH + 1 + 1 + 1 + 4 + 1 + 2 + 1 + 11 + 1 + 11 + 1;
+
+// checks the castling part against ``-|[KQABCDEFGH]{0,2}[kqabcdefgh]{0,2}``.
+constexpr auto _is_valid_castling_fen(std::string_view castling) -> bool {
+    if (castling == "-")
+        return true;
+    std::size_t i = 0;
+    auto white = 0, black = 0;
+    for (; i < castling.size() && (castling[i] == 'K' || castling[i] == 'Q' || ('A' <= castling[i] && castling[i] <= 'H')); ++i)
+        ++white;
+    for (; i < castling.size() && (castling[i] == 'k' || castling[i] == 'q' || ('a' <= castling[i] && castling[i] <= 'h')); ++i)
+        ++black;
+    return i == castling.size() && white <= 2 && black <= 2;
+}
+
+constexpr auto _is_fen_space(char c) -> bool {
+    // the characters python's ``str.split()`` splits on.
+    return c == ' ' || ('\t' <= c && c <= '\r');
+}
+
+// splits *text* on runs of whitespace into at most *count* fields, like
+// ``str.split()``. returns the number of fields, or ``count + 1`` if there
+// was more. *rest* is left pointing at whatever follows the last field.
+inline auto _split_fields(std::string_view text, std::string_view* fields, std::size_t count, std::string_view* rest = nullptr) -> std::size_t {
+    std::size_t n = 0, i = 0;
+    while (true) {
+        while (i < text.size() && _is_fen_space(text[i]))
+            ++i;
+        if (i == text.size())
+            break;
+        if (n == count) {
+            if (rest)
+                *rest = text.substr(i);
+            return count + 1;
+        }
+        auto start = i;
+        while (i < text.size() && !_is_fen_space(text[i]))
+            ++i;
+        fields[n++] = text.substr(start, i - start);
+    }
+    if (rest)
+        *rest = std::string_view();
+    return n;
+}
+
+// parses a whole field as a decimal integer, without allocating.
+inline auto _parse_fen_int(std::string_view field, int& value) -> bool {
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc() && end == field.data() + field.size() && !field.empty();
+}
 
-const auto FEN_CASTLING_REGEX = std::regex("^(?:-|[KQABCautoGH]{0,2}[kqabcautogh]{0,2})\\Z");
+// what each character means in the board part of a FEN: a piece type in the
+// low three bits with 8 set for white, or 16 plus the digit shifted up by 5.
+constexpr auto _FEN_BOARD_CHARS = cag::make_array<256>([](int c) {
+    constexpr std::string_view pieces = "pnbrqk";
+    for (auto i = 0; i < 6; ++i) {
+        if (c == pieces[i])
+            return i + 1;
+        if (c == pieces[i] - 'a' + 'A')
+            return i + 1 + 8;
+    }
+    if ('1' <= c && c <= '8')
+        return 16 | ((c - '0') << 5);
+    return 0;
+});
+
+// the pieces of a board FEN, parsed but not yet set up on a board.
+struct _BoardFenParse {
+    std::array<Bitboard, 7> by_type{};
+    std::array<Bitboard, 2> by_color{};
+    Bitboard promoted = 0;
+    std::uint64_t zobrist = 0;
+    std::array<std::uint8_t, 64> mailbox{};
+};
 
 struct Piece {
     
@@ -228,7 +440,11 @@ struct Piece {
         } else {
             symbol_cased = color ? strtools::toupper(symbol) : symbol;
         }
-        return UNICODE_PIECE_SYMBOLS.at(symbol_cased);
+        auto entry = std::find_if(
+            UNICODE_PIECE_SYMBOLS.begin(),
+            UNICODE_PIECE_SYMBOLS.end(),
+            [&](auto pair) { return pair.first == symbol_cased; });
+        return std::string(entry->second);
     }
 
     auto __hash__() -> int {
@@ -270,7 +486,7 @@ struct Piece {
 
         // :raises: :exc:`ValueError` if the symbol is invalid.
         // """
-        std::string str_symbol{1, symbol};
+        std::string str_symbol(1, symbol);
 
         auto key = strtools::tolower(str_symbol);
         PieceType ptype = (PieceType)std::distance(
@@ -321,11 +537,11 @@ struct Move {
         // The UCI representation of a null move is ``0000``.
         // """
         if (drop.has_value())
-            return strtools::toupper(piece_symbol(drop.value())) + "@" + SQUARE_NAMES[to_square];
+            return strtools::toupper(piece_symbol(drop.value())) + "@" + square_name(to_square);
         else if (promotion.has_value())
-            return SQUARE_NAMES[from_square] + SQUARE_NAMES[to_square] + piece_symbol(promotion.value());
+            return square_name(from_square) + square_name(to_square) + piece_symbol(promotion.value());
         else if (__bool__())
-            return SQUARE_NAMES[from_square] + SQUARE_NAMES[to_square];
+            return square_name(from_square) + square_name(to_square);
         else
             return "0000";
     }
@@ -357,7 +573,7 @@ struct Move {
         } else if (uci.size() == 4 && '@' == uci[1]) {
             auto drop = index(
                 PIECE_SYMBOLS,
-                std::tolower(uci[0]));
+                std::string(1, strtools::tolower(uci[0])));
             auto square = index(
                 SQUARE_NAMES,
                 uci.substr(2, std::string::npos));
@@ -377,7 +593,7 @@ struct Move {
             if (uci.size() == 5) {
                 promotion = (PieceType)index(
                     PIECE_SYMBOLS,
-                    uci[4]);
+                    std::string(1, uci[4]));
             } else {
                 promotion = std::nullopt;
             }
@@ -411,8 +627,96 @@ struct Move {
         // """
         return Move(A1, A1);
     }
+
+    friend bool operator==(const Move& a, const Move& b) {
+        return a.from_square == b.from_square &&
+               a.to_square == b.to_square &&
+               a.promotion == b.promotion &&
+               a.drop == b.drop;
+    }
+
+    friend bool operator!=(const Move& a, const Move& b) {
+        return !(a == b);
+    }
+};
+
+struct PackedMove {
+    // """
+    // A :class:`~chess.Move` packed into 16 bits, for move stacks, move
+    // lists and hash table entries.
+
+    // Bits 0-5 hold the source square and bits 6-11 the target square. The
+    // top nibble is ``0`` for a plain move, the piece type for a promotion
+    // and ``8`` plus the piece type for a drop. The null move packs to ``0``.
+    // """
+
+    std::uint16_t data = 0;
+
+    static constexpr std::uint16_t DROP_FLAG = 8;
+
+    PackedMove() = default;
+
+    explicit PackedMove(const Move& move) {
+        unsigned flag = 0;
+        if (move.drop.has_value())
+            flag = DROP_FLAG | (unsigned)move.drop.value();
+        else if (move.promotion.has_value())
+            flag = (unsigned)move.promotion.value();
+        data = (std::uint16_t)((unsigned)move.from_square | ((unsigned)move.to_square << 6) | (flag << 12));
+    }
+
+    auto from_square() const -> Square {
+        return (Square)(data & 63);
+    }
+
+    auto to_square() const -> Square {
+        return (Square)((data >> 6) & 63);
+    }
+
+    auto promotion() const -> std::optional<PieceType> {
+        auto flag = data >> 12;
+        if (flag && !(flag & DROP_FLAG))
+            return (PieceType)flag;
+        return std::nullopt;
+    }
+
+    auto drop() const -> std::optional<PieceType> {
+        auto flag = data >> 12;
+        if (flag & DROP_FLAG)
+            return (PieceType)(flag & 7);
+        return std::nullopt;
+    }
+
+    auto to_move() const -> Move {
+        return Move(from_square(), to_square(), promotion(), drop());
+    }
+
+    auto uci() const -> std::string {
+        return to_move().uci();
+    }
+
+    auto __bool__() const -> bool {
+        return data != 0;
+    }
+
+    static auto null() -> PackedMove {
+        return PackedMove();
+    }
+
+    friend bool operator==(const PackedMove& a, const PackedMove& b) {
+        return a.data == b.data;
+    }
+
+    friend bool operator!=(const PackedMove& a, const PackedMove& b) {
+        return a.data != b.data;
+    }
 };
 
+static_assert(sizeof(PackedMove) == 2);
+
+using MoveList = mvlist::MoveList<Move>;
+using PackedMoveList = mvlist::MoveList<PackedMove>;
+
 class BaseBoard {
    public:
     // """
@@ -434,7 +738,51 @@ class BaseBoard {
     Bitboard promoted;
     Bitboard occupied;
 
-    BaseBoard(std::optional<std::string> board_fen = STARTING_BOARD_FEN) {
+    // the piece-square part of the zobrist key, kept up to date by
+    // _set_piece_at() and _remove_piece_at().
+    std::uint64_t _zobrist_pieces = 0;
+
+    // the piece on each square, as _mailbox_code() packs it, so that
+    // piece_type_at() is a single load instead of a test per bitboard. kept
+    // in step with the bitboards wherever they change.
+    std::array<std::uint8_t, 64> _mailbox = {};
+
+    static constexpr auto _mailbox_code(PieceType piece_type, Color color) -> std::uint8_t {
+        // 0 is an empty square, otherwise the piece type with 8 added for white.
+        return (std::uint8_t)((int)piece_type | (color == WHITE ? 8 : 0));
+    }
+
+    void _rebuild_mailbox() {
+        // for when the bitboards are assigned wholesale.
+        _mailbox.fill(0);
+        Bitboard by_type[] = {pawns, knights, bishops, rooks, queens, kings};
+        for (auto piece_type = 1; piece_type <= 6; ++piece_type) {
+            for (auto square : scan_forward(by_type[piece_type - 1] & occupied))
+                _mailbox[square] = _mailbox_code((PieceType)piece_type, (Color)((occupied_co[WHITE] >> square) & 1));
+        }
+    }
+
+    void _update_mailbox(Bitboard changed) {
+        // for when the bitboards are assigned wholesale but only differ on
+        // *changed*: brings those squares and the piece key back in step.
+        Bitboard by_type[] = {pawns, knights, bishops, rooks, queens, kings};
+        for (auto square : scan_forward(changed)) {
+            auto old_code = _mailbox[square];
+            if (old_code)
+                _zobrist_pieces ^= zobrist::piece_key(old_code & 7, old_code & 8, square);
+            auto code = 0;
+            for (auto piece_type = 1; piece_type <= 6; ++piece_type)
+                code |= (int)((by_type[piece_type - 1] >> square) & 1) * piece_type;
+            if (code && (occupied & BB_SQUARES[square])) {
+                _mailbox[square] = _mailbox_code((PieceType)code, (Color)((occupied_co[WHITE] >> square) & 1));
+                _zobrist_pieces ^= zobrist::piece_key(code, _mailbox[square] & 8, square);
+            } else {
+                _mailbox[square] = 0;
+            }
+        }
+    }
+
+    BaseBoard(std::optional<std::string> board_fen = std::string(STARTING_BOARD_FEN)) {
         std::fill(
             occupied_co.begin(),
             occupied_co.end(),
@@ -461,6 +809,9 @@ class BaseBoard {
         occupied_co[WHITE] = BB_RANK_1 | BB_RANK_2;
         occupied_co[BLACK] = BB_RANK_7 | BB_RANK_8;
         occupied = BB_RANK_1 | BB_RANK_2 | BB_RANK_7 | BB_RANK_8;
+
+        _rebuild_mailbox();
+        _zobrist_pieces = _compute_zobrist_pieces();
     }
 
     void reset_board() {
@@ -481,6 +832,20 @@ class BaseBoard {
         occupied_co[WHITE] = BB_EMPTY;
         occupied_co[BLACK] = BB_EMPTY;
         occupied = BB_EMPTY;
+
+        _zobrist_pieces = 0;
+        _mailbox.fill(0);
+    }
+
+    auto _compute_zobrist_pieces() const -> std::uint64_t {
+        // full recomputation, for when the bitboards are assigned wholesale.
+        std::uint64_t key = 0;
+        for (auto square : scan_forward(occupied)) {
+            auto piece_type = piece_type_at(square);
+            if (piece_type.has_value())
+                key ^= zobrist::piece_key((int)piece_type.value(), occupied_co[WHITE] & BB_SQUARES[square], square);
+        }
+        return key;
     }
     void clear_board() {
         // """Clears the board."""
@@ -520,34 +885,18 @@ class BaseBoard {
 
     auto piece_at(Square square) -> std::optional<Piece> {
         // """Gets the :class:`piece <chess.Piece>` at the given square."""
-        auto piece_type = piece_type_at(square);
-        if (piece_type.has_value()) {
-            auto mask = BB_SQUARES[square];
-            auto color = (Color)(occupied_co[WHITE] & mask);
-            return Piece(piece_type.value(), color);
-        } else {
+        auto code = _mailbox[square];
+        if (!code)
             return std::nullopt;
-        }
+        return Piece((PieceType)(code & 7), (Color)(code >> 3));
     }
 
-    auto piece_type_at(Square square) -> std::optional<PieceType> {
+    auto piece_type_at(Square square) const -> std::optional<PieceType> {
         // """Gets the piece type at the given square."""
-        auto mask = BB_SQUARES[square];
-
-        if (!(occupied & mask))
-            return std::nullopt;  // Early return
-        else if (pawns & mask)
-            return PieceType::PAWN;
-        else if (knights & mask)
-            return PieceType::KNIGHT;
-        else if (bishops & mask)
-            return PieceType::BISHOP;
-        else if (rooks & mask)
-            return PieceType::ROOK;
-        else if (queens & mask)
-            return PieceType::QUEEN;
-        else
-            return PieceType::KING;
+        auto code = _mailbox[square];
+        if (!code)
+            return std::nullopt;
+        return (PieceType)(code & 7);
     }
 
     auto color_at(Square square) -> std::optional<Color> {
@@ -561,7 +910,7 @@ class BaseBoard {
             return std::nullopt;
     }
 
-    auto king(Color color) -> std::optional<Square> {
+    auto king(Color color) const -> std::optional<Square> {
         // """
         // Finds the king square of the given side. Returns ``std::nullopt;`` if there
         // is no king of that color.
@@ -578,24 +927,22 @@ class BaseBoard {
     }
 
     auto attacks_mask(Square square) -> Bitboard {
-        auto bb_square = BB_SQUARES[square];
-
-        if (bb_square & pawns) {
-            auto color = (Color)(bb_square & occupied_co[WHITE]);
-            return BB_PAWN_ATTACKS[color][square];
-        } else if (bb_square & knights) {
-            return BB_KNIGHT_ATTACKS[square];
-        } else if (bb_square & kings) {
-            return BB_KING_ATTACKS[square];
-        } else {
-            Bitboard attacks = 0;
-            if (bb_square & bishops || bb_square & queens) {
-                attacks = BB_DIAG_ATTACKS[square].at(BB_DIAG_MASKS[square] & occupied);
-            }
-            if (bb_square & rooks || bb_square & queens) {
-                attacks |= (BB_RANK_ATTACKS[square].at(BB_RANK_MASKS[square] & occupied) | BB_FILE_ATTACKS[square].at(BB_FILE_MASKS[square] & occupied));
-            }
-            return attacks;
+        auto code = _mailbox[square];
+        switch ((PieceType)(code & 7)) {
+            case PieceType::PAWN:
+                return BB_PAWN_ATTACKS[code >> 3][square];
+            case PieceType::KNIGHT:
+                return BB_KNIGHT_ATTACKS[square];
+            case PieceType::BISHOP:
+                return bishop_attacks(square, occupied);
+            case PieceType::ROOK:
+                return rook_attacks(square, occupied);
+            case PieceType::QUEEN:
+                return queen_attacks(square, occupied);
+            case PieceType::KING:
+                return BB_KING_ATTACKS[square];
+            default:
+                return BB_EMPTY;
         }
     }
 
@@ -611,24 +958,32 @@ class BaseBoard {
         return SquareSet(attacks_mask(square));
     }
 
-    auto _attackers_mask(Color color, Square square, Bitboard occupied) -> Bitboard {
-        auto rank_pieces = BB_RANK_MASKS[square] & occupied;
-        auto file_pieces = BB_FILE_MASKS[square] & occupied;
-        auto diag_pieces = BB_DIAG_MASKS[square] & occupied;
-
+    auto _attackers_mask(Color color, Square square, Bitboard occupied) const -> Bitboard {
+        CHESS_PROBE(attackers_mask);
         auto queens_and_rooks = queens | rooks;
         auto queens_and_bishops = queens | bishops;
 
         auto attackers = ((BB_KING_ATTACKS[square] & kings) |
                               (BB_KNIGHT_ATTACKS[square] & knights) |
-                              (BB_RANK_ATTACKS[square].at(rank_pieces) & queens_and_rooks) |
-                              (BB_FILE_ATTACKS[square].at(file_pieces) & queens_and_rooks) |
-                              (BB_DIAG_ATTACKS[square].at(diag_pieces) & queens_and_bishops) |
+                              (rook_attacks(square, occupied) & queens_and_rooks) |
+                              (bishop_attacks(square, occupied) & queens_and_bishops) |
                               (BB_PAWN_ATTACKS[!color][square] & pawns));
 
         return attackers & occupied_co[color];
     }
 
+    template <Color C>
+    auto _attackers_mask(Square square, Bitboard occupied) const -> Bitboard {
+        // _attackers_mask() for a color known at compile time.
+        CHESS_PROBE(attackers_mask);
+        auto attackers = ((BB_KING_ATTACKS[square] & kings) |
+                          (BB_KNIGHT_ATTACKS[square] & knights) |
+                          (rook_attacks(square, occupied) & (queens | rooks)) |
+                          (bishop_attacks(square, occupied) & (queens | bishops)) |
+                          (BB_PAWN_ATTACKS[!C][square] & pawns));
+        return attackers & occupied_co[C];
+    }
+
     auto attackers_mask(Color color, Square square) -> Bitboard {
         return _attackers_mask(color, square, occupied);
     }
@@ -655,19 +1010,20 @@ class BaseBoard {
     }
 
     auto pin_mask(Color color, Square square) -> Bitboard {
+        CHESS_PROBE(pin_mask);
         auto king_square = king(color);
         if (!king_square.has_value())
             return BB_ALL;
 
         auto square_mask = BB_SQUARES[square];
+        auto king_rook_rays = rook_attacks(king_square.value(), BB_EMPTY);
 
         const std::array attacks_sliders = {
-            std::make_pair(BB_FILE_ATTACKS, rooks | queens),
-            std::make_pair(BB_RANK_ATTACKS, rooks | queens),
-            std::make_pair(BB_DIAG_ATTACKS, bishops | queens),
+            std::make_pair(king_rook_rays & BB_FILES[square_file(king_square.value())], rooks | queens),
+            std::make_pair(king_rook_rays & BB_RANKS[square_rank(king_square.value())], rooks | queens),
+            std::make_pair(bishop_attacks(king_square.value(), BB_EMPTY), bishops | queens),
         };
-        for (auto [attacks_vecmap, sliders_bb] : attacks_sliders) {
-            auto rays = attacks_vecmap[king_square.value()].at(0);
+        for (auto [rays, sliders_bb] : attacks_sliders) {
             if (rays & square_mask) {
                 auto snipers = rays & sliders_bb & occupied_co[!color];
                 for (auto sniper : scan_reversed(snipers)) {
@@ -738,21 +1094,52 @@ class BaseBoard {
         else
             return std::nullopt;
 
+        _zobrist_pieces ^= zobrist::piece_key((int)piece_type.value(), occupied_co[WHITE] & mask, square);
+
         occupied ^= mask;
         occupied_co[WHITE] &= ~mask;
         occupied_co[BLACK] &= ~mask;
+        _mailbox[square] = 0;
 
         promoted &= ~mask;
 
         return piece_type;
     }
 
+    void _toggle_piece(Square square, PieceType piece_type, Color color) {
+        // xor a piece of known type and color onto or off its square. unlike
+        // _set_piece_at() this neither looks at nor clears what was there,
+        // and leaves promoted alone.
+        auto mask = BB_SQUARES[square];
+        // # Pieces are taken off before others are put on, so a square that
+        // # is occupied now is being emptied.
+        _mailbox[square] = (occupied & mask) ? 0 : _mailbox_code(piece_type, color);
+
+        if (piece_type == PieceType::PAWN)
+            pawns ^= mask;
+        else if (piece_type == PieceType::KNIGHT)
+            knights ^= mask;
+        else if (piece_type == PieceType::BISHOP)
+            bishops ^= mask;
+        else if (piece_type == PieceType::ROOK)
+            rooks ^= mask;
+        else if (piece_type == PieceType::QUEEN)
+            queens ^= mask;
+        else
+            kings ^= mask;
+
+        occupied ^= mask;
+        occupied_co[color] ^= mask;
+
+        _zobrist_pieces ^= zobrist::piece_key((int)piece_type, color, square);
+    }
+
     auto remove_piece_at(Square square) -> std::optional<Piece> {
         // """
         // Removes the piece from the given square. Returns the
         // :class:`~chess.Piece` or ``std::nullopt;`` if the square was already empty.
         // """
-        auto color = (Color)(occupied_co[WHITE] & BB_SQUARES[square]);
+        auto color = (Color)(bool)(occupied_co[WHITE] & BB_SQUARES[square]);
         auto piece_type = _remove_piece_at(square);
         if (piece_type.has_value()) {
             return Piece(piece_type.value(), color);
@@ -783,6 +1170,9 @@ class BaseBoard {
 
         occupied ^= mask;
         occupied_co[color] ^= mask;
+        _mailbox[square] = _mailbox_code(piece_type, color);
+
+        _zobrist_pieces ^= zobrist::piece_key((int)piece_type, color, square);
 
         if (was_promoted)
             promoted ^= mask;
@@ -803,111 +1193,156 @@ class BaseBoard {
         }
     }
 
-    auto board_fen(std::optional<bool> was_promoted = false) -> std::string {
+    auto _write_board_fen(char* out, bool was_promoted) const -> char* {
+        // writes the board part of a FEN to *out*, which must have room for
+        // MAX_BOARD_FEN_LENGTH characters, and returns the end. *symbols* is
+        // indexed by _mailbox_code().
+        constexpr std::string_view symbols = "?pnbrqk??PNBRQK?";
+        auto tildes = was_promoted ? promoted : BB_EMPTY;
+        for (auto rank = 7; rank >= 0; --rank) {
+            // walk the occupied squares of the rank, writing the gaps between
+            // them. a gap digit is always written and only kept if the gap is
+            // not empty, as the piece overwrites it otherwise.
+            auto row = (unsigned)(occupied >> (rank * 8)) & 0xff;
+            auto file = 0;
+            for (; row; row &= row - 1) {
+                auto next = lsb(row);
+                *out = (char)('0' + next - file);
+                out += next != file;
+                auto square = rank * 8 + next;
+                *out++ = symbols[_mailbox[square]];
+                *out = '~';
+                out += (tildes >> square) & 1;
+                file = next + 1;
+            }
+            if (file != 8)
+                *out++ = (char)('0' + 8 - file);
+            if (rank)
+                *out++ = '/';
+        }
+        return out;
+    }
+
+    auto board_fen(std::optional<bool> was_promoted = false) const -> std::string {
         // """
         // Gets the board FEN (e.g.,
         // ``rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR``).
         // """
-        std::vector<std::string> builder;
-        auto empty = 0;
-
-        for (auto isquare : SQUARES_180) {
-            auto maybe_piece = piece_at((Square)isquare);
+        char buffer[MAX_BOARD_FEN_LENGTH];
+        auto end = _write_board_fen(buffer, was_promoted.value_or(false));
+        return std::string(buffer, end);
+    }
 
-            if (!maybe_piece.has_value()) {
-                empty += 1;
+    static auto _parse_board_fen(std::string_view fen, _BoardFenParse& parse, std::size_t* end = nullptr) -> FenError {
+        // validates the board part of a FEN and collects its pieces in one
+        // pass, without touching any board. with *end*, parsing stops at the
+        // first whitespace and *end* is set to its index, so a full FEN is
+        // only scanned once.
+        //
+        // the bitboards and the key are collected in locals and only copied
+        // into *parse* at the end: the byte stores into its mailbox may alias
+        // any of its fields, which would otherwise keep them all in memory,
+        // one store-to-load chain per piece.
+        parse.mailbox = {};
+        std::array<Bitboard, 7> by_type{};
+        std::array<Bitboard, 2> by_color{};
+        Bitboard promoted = 0;
+        std::uint64_t key = 0;
+        auto rank = 7, file = 0;
+        auto previous_was_digit = false;
+        auto previous_was_piece = false;
+
+        std::size_t i = 0;
+        for (; i < fen.size(); ++i) {
+            auto c = fen[i];
+            auto code = _FEN_BOARD_CHARS[(unsigned char)c];
+            if (code & 7) {
+                // # A piece.
+                if (file == 8)
+                    return FenError::board_columns;
+                auto white = (bool)(code & 8);
+                auto square = rank * 8 + file;
+                by_type[code & 7] |= BB_SQUARES[square];
+                by_color[white] |= BB_SQUARES[square];
+                key ^= zobrist::piece_key(code & 7, white, square);
+                parse.mailbox[square] = code & 15;
+                ++file;
+                previous_was_digit = false;
+                previous_was_piece = true;
+            } else if (code & 16) {
+                if (previous_was_digit)
+                    return FenError::board_digits;
+                file += code >> 5;
+                if (file > 8)
+                    return FenError::board_columns;
+                previous_was_digit = true;
+                previous_was_piece = false;
+            } else if (c == '/') {
+                if (file != 8)
+                    return FenError::board_columns;
+                if (rank == 0)
+                    return FenError::board_rows;
+                --rank;
+                file = 0;
+                previous_was_digit = false;
+                previous_was_piece = false;
+            } else if (c == '~') {
+                if (!previous_was_piece)
+                    return FenError::board_tilde;
+                promoted |= BB_SQUARES[rank * 8 + file - 1];
+                previous_was_digit = false;
+                previous_was_piece = false;
+            } else if (_is_fen_space(c)) {
+                if (!end)
+                    return FenError::board_parts;
+                break;
             } else {
-                auto piece = maybe_piece.value();
-                if (empty) {
-                    builder.push_back(std::to_string(empty));
-                    empty = 0;
-                }
-                builder.push_back(piece.symbol());
-                if (was_promoted && BB_SQUARES[isquare] & promoted) {
-                    builder.push_back("~");
-                }
-            }
-
-            if (BB_SQUARES[isquare] & BB_FILE_H) {
-                if (empty) {
-                    builder.push_back(std::to_string(empty));
-                    empty = 0;
-                }
-
-                if (isquare != H1) {
-                    builder.push_back("/");
-                }
+                return FenError::board_character;
             }
         }
+        if (rank != 0)
+            return FenError::board_rows;
+        if (file != 8)
+            return FenError::board_columns;
+        parse.by_type = by_type;
+        parse.by_color = by_color;
+        parse.promoted = promoted;
+        parse.zobrist = key;
+        if (end)
+            *end = i;
+        return FenError::ok;
+    }
 
-        return strtools::join(builder, "");
+    void _apply_board_fen(const _BoardFenParse& parse) {
+        pawns = parse.by_type[1];
+        knights = parse.by_type[2];
+        bishops = parse.by_type[3];
+        rooks = parse.by_type[4];
+        queens = parse.by_type[5];
+        kings = parse.by_type[6];
+        occupied_co[WHITE] = parse.by_color[WHITE];
+        occupied_co[BLACK] = parse.by_color[BLACK];
+        occupied = parse.by_color[WHITE] | parse.by_color[BLACK];
+        promoted = parse.promoted;
+        _zobrist_pieces = parse.zobrist;
+        _mailbox = parse.mailbox;
+    }
+
+    auto _try_set_board_fen(std::string_view fen) -> FenError {
+        // on error the board is left as it was.
+        _BoardFenParse parse;
+        auto error = _parse_board_fen(fen, parse);
+        if (error == FenError::ok)
+            _apply_board_fen(parse);
+        return error;
     }
 
     void _set_board_fen(std::string fen) {
         // # Compatibility with set_fen().
         fen = strtools::strip(fen);
-        if (strtools::contains(fen, " ")) {
-            auto msg = "expected position part of fen, got multiple parts: "s + fen;
-            throw std::invalid_argument(msg);
-        }
-        // # Ensure the FEN is valid.
-        auto rows = strtools::split(fen, '/');
-        if (rows.size() != 8) {
-            auto msg = "expected 8 rows in position part of fen: "s + fen;
-            throw std::invalid_argument(msg);
-        }
-        // # Validate each row.
-        for (auto row : rows){
-            auto field_sum = 0;
-            auto previous_was_digit = false;
-            auto previous_was_piece = false;
-
-            for (auto c : row){
-                if (strtools::contains("12345678", c)){
-                    if (previous_was_digit) {
-                        auto msg = "two subsequent digits in position part of fen: "s + fen;
-                        throw std::invalid_argument(msg);
-                    }
-                    field_sum += strtools::to_int(c); // char parse to int
-                    previous_was_digit = true;
-                    previous_was_piece = false;
-                } else if (c == '~') {
-                    if (!previous_was_piece) {
-                        auto msg = "'~' not after piece in position part of fen: "s + fen;
-                        throw std::invalid_argument(msg);
-                    }
-                    previous_was_digit = false;
-                    previous_was_piece = false;
-                } else if (std::find(PIECE_SYMBOLS.begin(), PIECE_SYMBOLS.end(), strtools::tolower(c)) != PIECE_SYMBOLS.end()) {
-                    field_sum += 1;
-                    previous_was_digit = false;
-                    previous_was_piece = true;
-                } else {
-                    auto msg = "invalid character in position part of fen: "s + fen;
-                    throw std::invalid_argument(msg);
-                }
-            }
-            if (field_sum != 8) {
-                auto msg = "expected 8 columns per row in position part of fen: "s + fen;
-                throw std::invalid_argument(msg);
-            }
-        }
-        // Clear the board.
-        _clear_board();
-
-        // Put pieces on the board.
-        auto square_index = 0;
-        for (auto c : fen) {
-            if (strtools::contains("12345678", c)) {
-                square_index += strtools::to_int(c);
-            } else if (std::find(PIECE_SYMBOLS.begin(), PIECE_SYMBOLS.end(), strtools::tolower(c)) != PIECE_SYMBOLS.end()) {
-                auto piece = Piece::from_symbol(c);
-                _set_piece_at((Square)SQUARES_180[square_index], piece.piece_type, piece.color);
-                square_index += 1;
-            } else if (c == '~') {
-                promoted |= BB_SQUARES[SQUARES_180[square_index - 1]];
-            }
-        }
+        auto error = _try_set_board_fen(fen);
+        if (error != FenError::ok)
+            throw std::invalid_argument(std::string(fen_error_message(error)) + ": " + fen);
     }
 
     auto set_board_fen(std::string fen) {
@@ -927,7 +1362,7 @@ class BaseBoard {
         std::unordered_map<Square, Piece> result;
         for (auto square : scan_reversed(occupied & mask)) {
             assert(piece_at(square).has_value());
-            result[square] = piece_at(square).value();
+            result.insert_or_assign(square, piece_at(square).value());
         }
         return result;
     }
@@ -1020,6 +1455,9 @@ class BaseBoard {
         occupied_co[BLACK] = BB_RANK_7 | BB_RANK_8;
         occupied = BB_RANK_1 | BB_RANK_2 | BB_RANK_7 | BB_RANK_8;
         promoted = BB_EMPTY;
+
+        _rebuild_mailbox();
+        _zobrist_pieces = _compute_zobrist_pieces();
     }
 
     auto set_chess960_pos(int scharnagl) {
@@ -1035,11 +1473,11 @@ class BaseBoard {
         // Gets the Chess960 starting position index between 0 and 959,
         // or ``std::nullopt;``.
         // """
-        if (occupied_co[WHITE] != BB_RANK_1 | BB_RANK_2)
+        if (occupied_co[WHITE] != (BB_RANK_1 | BB_RANK_2))
             return std::nullopt;
-        if (occupied_co[BLACK] != BB_RANK_7 | BB_RANK_8)
+        if (occupied_co[BLACK] != (BB_RANK_7 | BB_RANK_8))
             return std::nullopt;
-        if (pawns != BB_RANK_2 | BB_RANK_7)
+        if (pawns != (BB_RANK_2 | BB_RANK_7))
             return std::nullopt;
         if (promoted)
             return std::nullopt;
@@ -1162,8 +1600,6 @@ class BaseBoard {
     }
 
     auto unicode(bool invert_color = false, bool borders = false, std::string empty_square = "⭘") -> std::string {
-        // TODO
-        return __str__();
         // """
         // Returns a string representation of the board with Unicode pieces.
         // Useful for pretty-printing to a terminal.
@@ -1171,44 +1607,48 @@ class BaseBoard {
         // :param invert_color: Invert color of the Unicode pieces.
         // :param borders: Show borders and a coordinate margin.
         // """
-        // builder = []
-        // for rank_index in range(7, -1, -1):
-        //     if borders:
-        //         builder.append("  ")
-        //         builder.append("-" * 17)
-        //         builder.append("\n")
-
-        //         builder.append(RANK_NAMES[rank_index])
-        //         builder.append(" ")
+        std::string builder;
+        for (auto rank_index = 7; rank_index >= 0; --rank_index) {
+            if (borders) {
+                builder += "  ";
+                builder += std::string(17, '-');
+                builder += "\n";
+
+                builder += RANK_NAMES[rank_index];
+                builder += " ";
+            }
 
-        //     for file_index in range(8):
-        //         square_index = square(file_index, rank_index)
+            for (auto file_index = 0; file_index < 8; ++file_index) {
+                auto square_index = square(file_index, rank_index);
 
-        //         if borders:
-        //             builder.append("|")
-        //         elif file_index > 0:
-        //             builder.append(" ")
+                if (borders)
+                    builder += "|";
+                else if (file_index > 0)
+                    builder += " ";
 
-        //         piece = piece_at(square_index)
+                auto piece = piece_at(square_index);
 
-        //         if piece:
-        //             builder.append(piece.unicode_symbol(invert_color=invert_color))
-        //         else:
-        //             builder.append(empty_square)
+                if (piece.has_value())
+                    builder += piece.value().unicode_symbol(invert_color);
+                else
+                    builder += empty_square;
+            }
 
-        //     if borders:
-        //         builder.append("|")
+            if (borders)
+                builder += "|";
 
-        //     if borders or rank_index > 0:
-        //         builder.append("\n")
+            if (borders || rank_index > 0)
+                builder += "\n";
+        }
 
-        // if borders:
-        //     builder.append("  ")
-        //     builder.append("-" * 17)
-        //     builder.append("\n")
-        //     builder.append("   a b c d e f g h")
+        if (borders) {
+            builder += "  ";
+            builder += std::string(17, '-');
+            builder += "\n";
+            builder += "   a b c d e f g h";
+        }
 
-        // return "".join(builder)
+        return builder;
     }
 
     auto _repr_svg_() -> std::string {
@@ -1233,7 +1673,10 @@ class BaseBoard {
         return !(a == b);
     }
 
-    auto apply_transform(std::function<Bitboard(Bitboard)> f) {
+    template <typename Transform>
+    auto apply_transform(Transform&& f) {
+        // the transform is a template argument, not a std::function, so a
+        // plain function like flip_vertical() is inlined into the ten calls.
         pawns = f(pawns);
         knights = f(knights);
         bishops = f(bishops);
@@ -1245,9 +1688,12 @@ class BaseBoard {
         occupied_co[BLACK] = f(occupied_co[BLACK]);
         occupied = f(occupied);
         promoted = f(promoted);
+        _rebuild_mailbox();
+        _zobrist_pieces = _compute_zobrist_pieces();
     }
 
-    auto transform(std::function<Bitboard(Bitboard)> f) -> BaseBoard {
+    template <typename Transform>
+    auto transform(Transform&& f) -> BaseBoard {
         // """
         // Returns a transformed copy of the board by applying a bitboard
         // transformation function.
@@ -1267,8 +1713,24 @@ class BaseBoard {
     }
 
     auto apply_mirror() {
-        apply_transform(flip_vertical);
-        std::swap(occupied_co[WHITE], occupied_co[BLACK]);
+        // the ranks are the bytes of a bitboard and the rows of the mailbox,
+        // so mirroring is a bswap of each bitboard and the rows of the
+        // mailbox in reverse, with the color bit of every piece toggled.
+        for (auto bb : {&pawns, &knights, &bishops, &rooks, &queens, &kings, &occupied, &promoted})
+            *bb = flip_vertical(*bb);
+        auto white = flip_vertical(occupied_co[WHITE]);
+        occupied_co[WHITE] = flip_vertical(occupied_co[BLACK]);
+        occupied_co[BLACK] = white;
+
+        std::uint64_t rows[8];
+        std::memcpy(rows, _mailbox.data(), sizeof(rows));
+        for (auto rank = 0; rank < 8; ++rank) {
+            auto row = rows[7 - rank];
+            // # Occupied squares have a piece type in their low three bits.
+            row ^= ((row & 0x0707070707070707) + 0x0707070707070707) & 0x0808080808080808;
+            std::memcpy(_mailbox.data() + 8 * rank, &row, sizeof(row));
+        }
+        _zobrist_pieces = _compute_zobrist_pieces();
     }
 
     auto mirror() -> BaseBoard {
@@ -1321,6 +1783,19 @@ class BaseBoard {
     }
 };
 
+struct _TranspositionKey {
+    // the position part of a board, as compared by the repetition rules.
+    std::array<Bitboard, 8> bitboards;
+    Color turn;
+    Bitboard castling_rights;
+    std::optional<Square> ep_square;
+
+    friend bool operator==(const _TranspositionKey& a, const _TranspositionKey& b) = default;
+};
+
+// _BoardState only ever sees a complete Board type: its members are
+// instantiated from inside Board, just like the Generic[BoardT] original.
+template <typename BoardT>
 struct _BoardState {
     Bitboard occupied_w;
     Bitboard occupied_b;
@@ -1333,12 +1808,14 @@ struct _BoardState {
     Bitboard promoted;
     Bitboard occupied;
     Bitboard castling_rights;
+    std::uint64_t zobrist_state;
+    int reversible_plies;
     int halfmove_clock;
     int fullmove_number;
     std::optional<Square> ep_square;
     Color turn;
 
-    _BoardState(const Board& board) {
+    _BoardState(const BoardT& board) {
         this->pawns = board.pawns;
         this->knights = board.knights;
         this->bishops = board.bishops;
@@ -1351,6 +1828,8 @@ struct _BoardState {
         this->occupied = board.occupied;
 
         this->promoted = board.promoted;
+        this->zobrist_state = board._zobrist_state;
+        this->reversible_plies = board._reversible_plies;
 
         this->turn = board.turn;
         this->castling_rights = board.castling_rights;
@@ -1359,7 +1838,13 @@ struct _BoardState {
         this->fullmove_number = board.fullmove_number;
     }
 
-    auto restore(Board& board) {
+    auto restore(BoardT& board) const {
+        // the mailbox and the piece key are not saved: they are repaired on
+        // the squares whose bitboards change, which for a pop are the few
+        // the move touched.
+        auto changed = (board.pawns ^ this->pawns) | (board.knights ^ this->knights) | (board.bishops ^ this->bishops) |
+                       (board.rooks ^ this->rooks) | (board.queens ^ this->queens) | (board.kings ^ this->kings) |
+                       (board.occupied_co[WHITE] ^ this->occupied_w) | (board.occupied_co[BLACK] ^ this->occupied_b);
         board.pawns = this->pawns;
         board.knights = this->knights;
         board.bishops = this->bishops;
@@ -1372,6 +1857,9 @@ struct _BoardState {
         board.occupied = this->occupied;
 
         board.promoted = this->promoted;
+        board._update_mailbox(changed);
+        board._zobrist_state = this->zobrist_state;
+        board._reversible_plies = this->reversible_plies;
 
         board.turn = this->turn;
         board.castling_rights = this->castling_rights;
@@ -1381,6 +1869,164 @@ struct _BoardState {
     }
 };
 
+// what push_fast() needs to take a move back: everything else is recovered
+// by xor-ing the moved pieces off again.
+struct UndoRecord {
+    Bitboard castling_rights;
+    Bitboard promoted;
+    std::uint64_t zobrist_state;
+    int halfmove_clock;
+    int reversible_plies;
+    PackedMove move;  // as played, in the internal king-takes-rook encoding
+    std::uint8_t captured;  // PieceType, or 0 if nothing was captured
+    std::uint8_t flags;
+    std::int8_t ep_square;  // -1 if there was none
+
+    static constexpr std::uint8_t EN_PASSANT = 1;
+    static constexpr std::uint8_t CASTLING = 2;
+};
+
+// the position without its history, for forking boards between workers:
+// the bitboards, the side to move, castling, en passant, the clocks and the
+// zobrist key, in 112 trivially copyable bytes. the mailbox is not saved:
+// restoring repairs it on the squares where the board's bitboards differ.
+template <typename BoardT>
+struct _Snapshot {
+    Bitboard occupied_w;
+    Bitboard occupied_b;
+    Bitboard pawns;
+    Bitboard knights;
+    Bitboard bishops;
+    Bitboard rooks;
+    Bitboard queens;
+    Bitboard kings;
+    Bitboard promoted;
+    Bitboard castling_rights;
+    std::uint64_t zobrist_pieces;
+    std::uint64_t zobrist_state;
+    std::int32_t halfmove_clock;
+    std::int32_t fullmove_number;
+    std::int8_t ep_square;  // -1 if there is none
+    Color turn;
+    bool chess960;
+
+    _Snapshot() = default;
+
+    explicit _Snapshot(const BoardT& board)
+        : occupied_w(board.occupied_co[WHITE]),
+          occupied_b(board.occupied_co[BLACK]),
+          pawns(board.pawns),
+          knights(board.knights),
+          bishops(board.bishops),
+          rooks(board.rooks),
+          queens(board.queens),
+          kings(board.kings),
+          promoted(board.promoted),
+          castling_rights(board.castling_rights),
+          zobrist_pieces(board._zobrist_pieces),
+          zobrist_state(board._zobrist_state),
+          halfmove_clock(board.halfmove_clock),
+          fullmove_number(board.fullmove_number),
+          ep_square(board.ep_square.has_value() ? (std::int8_t)board.ep_square.value() : -1),
+          turn(board.turn),
+          chess960(board.chess960) {}
+
+    void restore(BoardT& board) const {
+        // """
+        // Sets up the position on *board*, as a new root: its move stack is
+        // cleared, keeping the memory it has.
+        // """
+        // the scratch board is usually one push away from this position, so
+        // this touches a handful of squares rather than all 64.
+        auto changed = (board.pawns ^ pawns) | (board.knights ^ knights) | (board.bishops ^ bishops) |
+                       (board.rooks ^ rooks) | (board.queens ^ queens) | (board.kings ^ kings) |
+                       (board.occupied_co[WHITE] ^ occupied_w) | (board.occupied_co[BLACK] ^ occupied_b);
+        board.pawns = pawns;
+        board.knights = knights;
+        board.bishops = bishops;
+        board.rooks = rooks;
+        board.queens = queens;
+        board.kings = kings;
+        board.occupied_co[WHITE] = occupied_w;
+        board.occupied_co[BLACK] = occupied_b;
+        board.occupied = occupied_w | occupied_b;
+        board.promoted = promoted;
+        board._update_mailbox(changed);
+        board._zobrist_pieces = zobrist_pieces;
+        board._zobrist_state = zobrist_state;
+
+        board.turn = turn;
+        board.castling_rights = castling_rights;
+        board.ep_square = ep_square < 0 ? std::nullopt : std::optional<Square>((Square)ep_square);
+        board.halfmove_clock = halfmove_clock;
+        board.fullmove_number = fullmove_number;
+        board.chess960 = chess960;
+
+        board.move_stack.clear();
+        board._stack.clear();
+        board._hash_history.clear();
+        board._reversible_plies = 0;
+    }
+
+    auto to_board(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const -> BoardT {
+        // """Creates a board with this position and an empty move stack."""
+        return BoardT(*this, resource);
+    }
+
+    auto zobrist_hash() const -> std::uint64_t {
+        return zobrist_pieces ^ zobrist_state;
+    }
+
+    auto generate_legal_moves(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) const {
+        return _scratch().generate_legal_moves(from_mask, to_mask);
+    }
+
+    auto is_legal(Move move) const -> bool {
+        return _scratch().is_legal(move);
+    }
+
+    auto is_check() const -> bool {
+        return _scratch().is_check();
+    }
+
+    void push(Move move) {
+        // """
+        // Makes *move*, which must be at least pseudo-legal, like
+        // :func:`~chess.Board.push_fast()`. There is no history to undo it
+        // or to detect repetitions with.
+        // """
+        auto& board = _scratch();
+        UndoRecord undo;
+        board.push_fast(move, undo);
+        *this = _Snapshot(board);
+    }
+
+    friend bool operator==(const _Snapshot& a, const _Snapshot& b) = default;
+
+   private:
+    // queries and pushes run on one board per thread, set up with this
+    // position: a fresh board each time would allocate its stacks every
+    // time, this one keeps them.
+    auto _scratch() const -> BoardT& {
+        thread_local BoardT board(std::nullopt);
+        restore(board);
+        return board;
+    }
+};
+
+// what gives_check() needs to know about the opposing king, worked out once
+// per position: the squares each piece type would give check from, and our
+// pieces that would uncover a check by moving off their line.
+struct CheckInfo {
+    Bitboard king = BB_EMPTY;
+    std::array<Bitboard, 7> check_squares = {};
+    Bitboard discoverers = BB_EMPTY;
+};
+
+// piece values for static exchange evaluation, in centipawns. the king is
+// worth more than everything else together, so it is only ever traded last.
+constexpr std::array<int, 7> SEE_VALUES = {0, 100, 300, 300, 500, 900, 20000};
+
 class Board : public BaseBoard {
    public:
     Bitboard castling_rights;
@@ -1419,19 +2065,19 @@ class Board : public BaseBoard {
     //     Use :func:`~chess.Board.is_valid()` to detect invalid positions.
     // """
 
-    static inline const std::vector<std::string> aliases = {"Standard"s, "Chess"s, "Classical"s, "Normal"s, "Illegal"s, "From Position"s};
-    static inline const std::optional<std::string> uci_variant = "chess";
-    static inline const std::optional<std::string> xboard_variant = "normal";
-    static inline const std::string starting_fen = STARTING_FEN;
-
-    static inline const std::optional<std::string> tbw_suffix = ".rtbw"s;
-    static inline const std::optional<std::string> tbz_suffix = ".rtbz"s;
-    static inline const std::optional<const char*> tbw_magic = std::make_optional("\x71\xe8\x23\x5d");
-    static inline const std::optional<const char*> tbz_magic = std::make_optional("\xd7\x66\x0c\xa5");
-    static inline const std::optional<std::string> pawnless_tbw_suffix = std::nullopt;
-    static inline const std::optional<std::string> pawnless_tbz_suffix = std::nullopt;
-    static inline const std::optional<const char*> pawnless_tbw_magic = std::nullopt;
-    static inline const std::optional<const char*> pawnless_tbz_magic = std::nullopt;
+    static constexpr std::array aliases = {"Standard"sv, "Chess"sv, "Classical"sv, "Normal"sv, "Illegal"sv, "From Position"sv};
+    static constexpr std::optional<std::string_view> uci_variant = "chess";
+    static constexpr std::optional<std::string_view> xboard_variant = "normal";
+    static constexpr std::string_view starting_fen = STARTING_FEN;
+
+    static constexpr std::optional<std::string_view> tbw_suffix = ".rtbw"sv;
+    static constexpr std::optional<std::string_view> tbz_suffix = ".rtbz"sv;
+    static constexpr std::optional<const char*> tbw_magic = "\x71\xe8\x23\x5d";
+    static constexpr std::optional<const char*> tbz_magic = "\xd7\x66\x0c\xa5";
+    static constexpr std::optional<std::string_view> pawnless_tbw_suffix = std::nullopt;
+    static constexpr std::optional<std::string_view> pawnless_tbz_suffix = std::nullopt;
+    static constexpr std::optional<const char*> pawnless_tbw_magic = std::nullopt;
+    static constexpr std::optional<const char*> pawnless_tbz_magic = std::nullopt;
     static inline const bool connected_kings = false;
     static inline const bool one_king = true;
     static inline const bool captures_compulsory = false;
@@ -1489,20 +2135,35 @@ class Board : public BaseBoard {
     // represented as king moves to the corresponding rook square.
     // """
 
-    std::vector<Move> move_stack; //: List[Move]
+    std::pmr::vector<PackedMove> move_stack; //: List[Move]
     // """
-    // The move stack. Use :func:`Board.push() <chess.Board.push()>`,
+    // The move stack, stored as :class:`~chess.PackedMove`. Use
+    // :func:`Board.push() <chess.Board.push()>`,
     // :func:`Board.pop() <chess.Board.pop()>`,
     // :func:`Board.peek() <chess.Board.peek()>` and
     // :func:`Board.clear_stack() <chess.Board.clear_stack()>` for
-    // manipulation.
+    // manipulation; pop() and peek() hand back full moves.
     // """
-    std::vector<_BoardState> _stack;
-
-    Board(std::optional<std::string> fen = STARTING_FEN, bool chess960 = false) {
-        BaseBoard(std::nullopt);
-
-        chess960 = chess960;
+    std::pmr::vector<_BoardState<Board>> _stack;
+
+    // the castling, en passant and turn part of the zobrist key. push() keeps
+    // it current, and every method that sets up a new root recomputes it.
+    std::uint64_t _zobrist_state = 0;
+
+    // the repetition key of the position before each move on the stack, and
+    // how many of the most recent ones are reachable again, i.e. were played
+    // after the last irreversible move.
+    std::pmr::vector<std::uint64_t> _hash_history;
+    int _reversible_plies = 0;
+
+    // the three stacks above take their memory from *resource*, the global
+    // heap unless given, e.g. a per-thread arena (see BoardArena.hpp).
+    // copy() and root() hand out boards on the same resource; the copy
+    // constructor, like any pmr container, goes back to the default one.
+    Board(std::optional<std::string> fen = std::string(STARTING_FEN), bool chess960 = false,
+          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : BaseBoard(std::nullopt), move_stack(resource), _stack(resource), _hash_history(resource) {
+        this->chess960 = chess960;
 
         ep_square = std::nullopt;
         move_stack.clear();
@@ -1513,7 +2174,53 @@ class Board : public BaseBoard {
         else if (fen == this->starting_fen)
             reset();
         else
-            set_fen(fen);
+            set_fen(fen.value());
+    }
+
+    Board(const Board& board) = default;
+    Board(Board&& board) = default;
+    auto operator=(const Board& board) -> Board& = default;
+    auto operator=(Board&& board) -> Board& = default;
+
+    Board(const Board& board, std::pmr::memory_resource* resource, bool stack = true)
+        : BaseBoard(board),
+          castling_rights(board.castling_rights),
+          halfmove_clock(board.halfmove_clock),
+          fullmove_number(board.fullmove_number),
+          ep_square(board.ep_square),
+          turn(board.turn),
+          chess960(board.chess960),
+          move_stack(resource),
+          _stack(resource),
+          _zobrist_state(board._zobrist_state),
+          _hash_history(resource),
+          _reversible_plies(board._reversible_plies) {
+        if (stack) {
+            move_stack.assign(board.move_stack.begin(), board.move_stack.end());
+            _stack.assign(board._stack.begin(), board._stack.end());
+            _hash_history.assign(board._hash_history.begin(), board._hash_history.end());
+        } else {
+            clear_stack();
+        }
+    }
+
+    explicit Board(const _Snapshot<Board>& snapshot, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : BaseBoard(std::nullopt), move_stack(resource), _stack(resource), _hash_history(resource) {
+        snapshot.restore(*this);
+    }
+
+    auto snapshot() const -> _Snapshot<Board> {
+        // """
+        // Gets the current position without the move stack, as a
+        // :class:`~chess.Snapshot`: about a hundred trivially copyable bytes
+        // that can be passed between threads as is.
+        // """
+        return _Snapshot<Board>(*this);
+    }
+
+    auto memory_resource() const -> std::pmr::memory_resource* {
+        // """Gets the memory resource the move stack is allocated from."""
+        return move_stack.get_allocator().resource();
     }
 
     auto legal_moves() {
@@ -1600,12 +2307,59 @@ class Board : public BaseBoard {
         // """Clears the move stack."""
         move_stack.clear();
         _stack.clear();
+        _hash_history.clear();
+        _reversible_plies = 0;
+        // the current position becomes the new root, so bring its key up to date.
+        _zobrist_state = _compute_zobrist_state(clean_castling_rights());
+    }
+
+    auto zobrist_hash() const -> std::uint64_t {
+        // """
+        // Returns the 64-bit zobrist key of the current position, following
+        // Polyglot's scheme: en passant is only hashed if a pawn of the side
+        // to move could capture, and castling rights are the cleaned rights of
+        // the standard corner rooks.
+
+        // The key is maintained incrementally by :func:`~chess.Board.push()`
+        // and :func:`~chess.Board.pop()`. After assigning
+        // :data:`~chess.Board.turn`, :data:`~chess.Board.castling_rights` or
+        // :data:`~chess.Board.ep_square` directly, call
+        // :func:`~chess.Board.clear_stack()` to resynchronise it.
+        // """
+        return _zobrist_pieces ^ _zobrist_state;
+    }
+
+    auto _compute_zobrist_state(Bitboard castling) const -> std::uint64_t {
+        std::uint64_t key = 0;
+        if (castling & BB_H1) key ^= zobrist::castling_key(0);
+        if (castling & BB_A1) key ^= zobrist::castling_key(1);
+        if (castling & BB_H8) key ^= zobrist::castling_key(2);
+        if (castling & BB_A8) key ^= zobrist::castling_key(3);
+
+        key ^= _zobrist_ep();
+
+        if (turn == WHITE)
+            key ^= zobrist::TURN_KEY;
+        return key;
+    }
+
+    auto _zobrist_ep() const -> std::uint64_t {
+        // # Only hash the ep square if a pawn is ready to capture, legal or not.
+        if (_ep_capturers())
+            return zobrist::ep_key(square_file(ep_square.value()));
+        return 0;
+    }
+
+    auto _repetition_key(std::uint64_t ep_key, bool legal_ep) const -> std::uint64_t {
+        // positions that differ only by an en passant capture that cannot
+        // legally be played are the same position for repetition purposes.
+        return legal_ep ? zobrist_hash() : zobrist_hash() ^ ep_key;
     }
 
     auto root() -> Board {
         // """Returns a copy of the root position."""
         if (_stack.size()) {
-            auto board = Board(std::nullopt, chess960);
+            auto board = Board(std::nullopt, chess960, memory_resource());
             _stack[0].restore(board);
             return board;
         } else {
@@ -1656,7 +2410,7 @@ class Board : public BaseBoard {
 
         EPIterator(const Board& board, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) : board(board) {
             // guard for null generator
-            if (!board.ep_square.has_value() || !BB_SQUARES[(size_t)board.ep_square.value()] & to_mask) {
+            if (!board.ep_square.has_value() || !(BB_SQUARES[(size_t)board.ep_square.value()] & to_mask)) {
                 capturer = SqIt::sentinel();
                 return;
             }
@@ -1677,7 +2431,7 @@ class Board : public BaseBoard {
                 return;
             }
             // guard for null generator
-            if (!board.ep_square.has_value() || !BB_SQUARES[(size_t)board.ep_square.value()] & BB_ALL) {
+            if (!board.ep_square.has_value()) {
                 capturer = SqIt::sentinel();
                 return;
             }
@@ -1732,7 +2486,7 @@ class Board : public BaseBoard {
         // STATE INFO
         const Board& board;
         SqIt candidates;
-        Bitboard bb_c, bb_d, bb_f, bb_g, king, rook, king_path, rook_path, king_to, rook_to;
+        Bitboard bb_c{}, bb_d{}, bb_f{}, bb_g{}, king{}, rook{}, king_path{}, rook_path{}, king_to{}, rook_to{};
 
        public:
         using iterator_category = std::forward_iterator_tag;
@@ -1763,25 +2517,30 @@ class Board : public BaseBoard {
             candidates = SqIt(
                 board.clean_castling_rights() & backrank & to_mask);
 
-            // LOOP RUN-UP #1
+            settle();
+        }
 
-            auto cand1 = candidates.peek();
+        // load the rook under the cursor, skipping candidates that cannot castle.
+        void settle() {
+            while (!stop_iteration()) {
+                auto candidate = candidates.peek();
 
-            rook = BB_SQUARES[cand1];
+                rook = BB_SQUARES[candidate];
 
-            auto a_side = rook < king;
-            king_to = a_side ? bb_c : bb_g;
-            rook_to = a_side ? bb_d : bb_f;
+                auto a_side = rook < king;
+                king_to = a_side ? bb_c : bb_g;
+                rook_to = a_side ? bb_d : bb_f;
 
-            king_path = between(
-                (Square)msb(king), 
-                (Square)msb(king_to));
-            rook_path = between(
-                (Square)cand1, 
-                (Square)msb(rook_to));
+                king_path = between(
+                    (Square)msb(king),
+                    (Square)msb(king_to));
+                rook_path = between(
+                    (Square)candidate,
+                    (Square)msb(rook_to));
 
-            while (!is_yield_legal() && !stop_iteration()) {
-                ++(*this);
+                if (is_yield_legal())
+                    return;
+                ++candidates;
             }
         }
 
@@ -1790,7 +2549,7 @@ class Board : public BaseBoard {
         }
 
         auto operator*() -> value_type {
-            return board._from_chess960(board.chess960, msb(king), candidates.peek());
+            return board._from_chess960(board.chess960, (Square)msb(king), (Square)candidates.peek());
         }
 
         auto stop_iteration() -> bool {
@@ -1800,29 +2559,9 @@ class Board : public BaseBoard {
         // Prefix increment
         inline CastleIterator& operator++() {
             ++candidates;
-            auto candidate = candidates.peek();
-
-            rook = BB_SQUARES[candidate];
-
-            auto a_side = rook < king;
-            king_to = a_side ? bb_c : bb_g;
-            rook_to = a_side ? bb_d : bb_f;
-
-            king_path = between(
-                (Square)msb(king), 
-                (Square)msb(king_to));
-            rook_path = between(
-                (Square)candidate, 
-                (Square)msb(rook_to));
-
-            // recurse till we have a safe yield
-            while (!is_yield_legal() && !stop_iteration()) {
-                ++(*this);
-            }
-
-            // advance to next move
-            return *this;
-        }
+            settle();
+            return *this;
+        }
 
         // Postfix increment
         inline CastleIterator operator++(int) {
@@ -1846,83 +2585,160 @@ class Board : public BaseBoard {
         }
     };
 
-    class PseudoLegalMoveIterator {
-        using Bitboard = unsigned long long;
-        using SquareGenerator = sqgen::SquareIterator<int, sqgen::Reverse>;
-        enum GENERATION_STAGE {
-            PIECE_MOVES,
-            CASTLING_MOVES,
-            PAWN_CAPTURE,
-            PAWN_ADVANCE_SINGLE,
-            PAWN_ADVANCE_DOUBLE,
-            EN_PASSANT,
-        };
-        // STATE INFO
-        const Board& board;
-        Bitboard our_pieces;
-        Bitboard non_pawns;
-        SquareGenerator from_square;
-        SquareGenerator to_square;
-        CastleIterator castle_move;
-        EPIterator ep_move;
-        GENERATION_STAGE stage;
+    class PseudoLegalMoveGenerator {
+        // """
+        // The pseudo-legal moves of a position, generated into a
+        // :class:`MoveList` when the view is created.
+        // """
+        Board& board;
+        MoveList moves;
 
        public:
-        using iterator_category = std::forward_iterator_tag;
-        using difference_type = std::ptrdiff_t;
-        using value_type = Move;
-        using pointer = value_type*;
-        using reference = value_type&;
+        PseudoLegalMoveGenerator(Board& board) : board(board), moves(board.generate_pseudo_legal_moves()) {}
 
-        PseudoLegalMoveIterator(const Board& board, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) : board(board), castle_move(board), ep_move(board) {
-            our_pieces = board.occupied_co[board.turn];
+        auto __bool__() -> bool {
+            return !moves.empty();
+        }
 
-            non_pawns = our_pieces & ~board.pawns & from_mask;
-            from_square = SquareGenerator(non_pawns);
-            
+        auto count() -> int {
+            return (int)moves.size();
         }
 
-        auto operator*() -> value_type {
-            // return current move
+        auto contains(Move move) -> bool {
+            return board.is_pseudo_legal(move);
         }
 
-        // Prefix increment
-        inline PseudoLegalMoveIterator& operator++() {
-            // advance to next move
-            return *this;
+        auto begin() { return moves.begin(); }
+        auto end() { return moves.end(); }
+    };
+
+    class LegalMoveGenerator {
+        // """
+        // The legal moves of a position, generated into a :class:`MoveList`
+        // when the view is created.
+        // """
+        Board& board;
+        MoveList moves;
+
+       public:
+        LegalMoveGenerator(Board& board) : board(board), moves(board.generate_legal_moves()) {}
+
+        auto __bool__() -> bool {
+            return !moves.empty();
         }
 
-        // Postfix increment
-        inline PseudoLegalMoveIterator operator++(int) {
-            auto tmp = *this;
-            ++(*this);
-            return tmp;
+        auto count() -> int {
+            return (int)moves.size();
         }
 
-        friend bool operator==(const PseudoLegalMoveIterator& a, const PseudoLegalMoveIterator& b) {
-            return COMP_WITH_SENTINEL;
-        };
+        auto contains(Move move) -> bool {
+            return board.is_legal(move);
+        }
 
-        friend bool operator!=(const PseudoLegalMoveIterator& a, const PseudoLegalMoveIterator& b) {
-            return COMP_WITH_SENTINEL;
-        };
+        auto begin() { return moves.begin(); }
+        auto end() { return moves.end(); }
+    };
+
+    void _generate_piece_moves_into(MoveList& moves, Bitboard from_mask, Bitboard to_mask) {
+        auto our_pieces = occupied_co[turn];
 
-        static PseudoLegalMoveIterator sentinel() {
-            return SENTINEL;
+        auto non_pawns = our_pieces & ~pawns & from_mask;
+        for (auto from_square : scan_reversed(non_pawns)) {
+            auto targets = attacks_mask(from_square) & ~our_pieces & to_mask;
+            for (auto to_square : scan_reversed(targets))
+                moves.emplace_back(from_square, to_square);
         }
-    };
+    }
 
-    class PseudoLegalMoveGenerator {
-        const Board& board;
-       public:
-        PseudoLegalMoveGenerator(const Board& board) : board(board) {}
-        auto begin() {
-            return PseudoLegalMoveIterator(board);
+    static void _push_pawn_move(MoveList& moves, Square from_square, Square to_square) {
+        if (BB_SQUARES[to_square] & BB_BACKRANKS) {
+            moves.emplace_back(from_square, to_square, PieceType::QUEEN);
+            moves.emplace_back(from_square, to_square, PieceType::ROOK);
+            moves.emplace_back(from_square, to_square, PieceType::BISHOP);
+            moves.emplace_back(from_square, to_square, PieceType::KNIGHT);
+        } else {
+            moves.emplace_back(from_square, to_square);
+        }
+    }
+
+    void _generate_pawn_moves_into(MoveList& moves, Bitboard from_mask, Bitboard to_mask) {
+        // Captures and advances; en passant is generated separately.
+        auto our_pawns = pawns & occupied_co[turn] & from_mask;
+        if (!our_pawns)
+            return;
+
+        // # Generate pawn captures.
+        for (auto from_square : scan_reversed(our_pawns)) {
+            auto targets = BB_PAWN_ATTACKS[turn][from_square] & occupied_co[!turn] & to_mask;
+            for (auto to_square : scan_reversed(targets))
+                _push_pawn_move(moves, from_square, to_square);
         }
-        auto end() {
-            return PseudoLegalMoveIterator::sentinel();
+
+        // # Prepare pawn advance generation.
+        Bitboard single_moves, double_moves;
+        if (turn == WHITE) {
+            single_moves = our_pawns << 8 & ~occupied;
+            double_moves = single_moves << 8 & ~occupied & (BB_RANK_3 | BB_RANK_4);
+        } else {
+            single_moves = our_pawns >> 8 & ~occupied;
+            double_moves = single_moves >> 8 & ~occupied & (BB_RANK_6 | BB_RANK_5);
         }
-    };
+
+        single_moves &= to_mask;
+        double_moves &= to_mask;
+
+        // # Generate single pawn moves.
+        for (auto to_square : scan_reversed(single_moves)) {
+            auto from_square = (Square)(to_square + (turn == BLACK ? 8 : -8));
+            _push_pawn_move(moves, from_square, to_square);
+        }
+
+        // # Generate double pawn moves.
+        for (auto to_square : scan_reversed(double_moves)) {
+            auto from_square = (Square)(to_square + (turn == BLACK ? 16 : -16));
+            moves.emplace_back(from_square, to_square);
+        }
+    }
+
+    void generate_pseudo_legal_moves_into(MoveList& moves, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) {
+        // # Generate piece moves.
+        _generate_piece_moves_into(moves, from_mask, to_mask);
+
+        // # Generate castling moves.
+        if (from_mask & kings)
+            generate_castling_moves_into(moves, from_mask, to_mask);
+
+        // # The remaining moves are all pawn moves.
+        _generate_pawn_moves_into(moves, from_mask, to_mask);
+
+        // # Generate en passant captures.
+        if (ep_square.has_value())
+            generate_pseudo_legal_ep_into(moves, from_mask, to_mask);
+    }
+
+    auto generate_pseudo_legal_moves(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        generate_pseudo_legal_moves_into(moves, from_mask, to_mask);
+        return moves;
+    }
+
+    void generate_pseudo_legal_ep_into(MoveList& moves, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) {
+        for (auto it = EPIterator(*this, from_mask, to_mask); it != EPIterator::sentinel(*this); ++it)
+            moves.push_back(*it);
+    }
+
+    auto generate_pseudo_legal_ep(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        generate_pseudo_legal_ep_into(moves, from_mask, to_mask);
+        return moves;
+    }
+
+    auto generate_pseudo_legal_captures(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        generate_pseudo_legal_moves_into(moves, from_mask, to_mask & occupied_co[!turn]);
+        generate_pseudo_legal_ep_into(moves, from_mask, to_mask);
+        return moves;
+    }
 
     auto checkers_mask() -> Bitboard {
         auto kingpos = king(turn);
@@ -1943,15 +2759,235 @@ class Board : public BaseBoard {
         return (bool)checkers_mask();
     }
 
+    auto check_info() const -> CheckInfo {
+        // """
+        // Works out the check squares and discovered check candidates against
+        // the opposing king, for :func:`~chess.Board.gives_check()`.
+        // """
+        CheckInfo info;
+        auto their_king = kings & occupied_co[!turn];
+        if (!their_king)
+            return info;
+        auto king = (Square)msb(their_king);
+        info.king = BB_SQUARES[king];
+        info.check_squares[(int)PieceType::PAWN] = BB_PAWN_ATTACKS[!turn][king];
+        info.check_squares[(int)PieceType::KNIGHT] = BB_KNIGHT_ATTACKS[king];
+        info.check_squares[(int)PieceType::BISHOP] = bishop_attacks(king, occupied);
+        info.check_squares[(int)PieceType::ROOK] = rook_attacks(king, occupied);
+        info.check_squares[(int)PieceType::QUEEN] = info.check_squares[(int)PieceType::BISHOP] | info.check_squares[(int)PieceType::ROOK];
+
+        // # Our pieces standing alone between the king and one of our sliders.
+        auto ours = occupied_co[turn];
+        auto snipers = ((rook_attacks(king, BB_EMPTY) & (rooks | queens)) | (bishop_attacks(king, BB_EMPTY) & (bishops | queens))) & ours;
+        for (auto sniper : scan_reversed(snipers)) {
+            auto b = between(king, sniper) & occupied;
+            if (b && !(b & (b - 1)))
+                info.discoverers |= b & ours;
+        }
+        return info;
+    }
+
     auto gives_check(Move move) -> bool {
         // """
         // Probes if the given move would put the opponent in check. The move
         // must be at least pseudo-legal.
         // """
-        push(move);
-        auto ischeck = is_check();
-        pop();
-        return ischeck;
+        return gives_check(move, check_info());
+    }
+
+    auto gives_check(Move move, const CheckInfo& info) -> bool {
+        // """
+        // Like :func:`~chess.Board.gives_check()`, with the
+        // :func:`~chess.Board.check_info()` of this position, so that a search
+        // can work it out once for all the moves of a node.
+        // """
+        if (!info.king)
+            return false;
+        if (move.drop.has_value() || !move.__bool__()) {
+            push(move);
+            auto ischeck = is_check();
+            pop();
+            return ischeck;
+        }
+
+        auto from_bb = BB_SQUARES[move.from_square];
+        auto to_bb = BB_SQUARES[move.to_square];
+        auto king = (Square)msb(info.king);
+        auto piece_type = piece_type_at(move.from_square);
+        if (!piece_type.has_value())
+            return false;
+
+        // # Castling, en passant and promotions change the board alone or
+        // # more than one square at once, so look afresh.
+        if (*piece_type == PieceType::KING && is_castling(move)) {
+            auto rook_from = _to_chess960(move).to_square;
+            auto kingside = rook_from > move.from_square;
+            auto rank = square_rank(move.from_square) * 8;
+            auto king_to = (Square)(rank + (kingside ? 6 : 2));
+            auto rook_to = (Square)(rank + (kingside ? 5 : 3));
+            auto after = (occupied & ~from_bb & ~BB_SQUARES[rook_from]) | BB_SQUARES[king_to] | BB_SQUARES[rook_to];
+            auto sliders = occupied_co[turn] & ~BB_SQUARES[rook_from];
+            return (bool)(rook_attacks(rook_to, after) & info.king) ||
+                   (bool)((rook_attacks(king, after) & (rooks | queens) & sliders) | (bishop_attacks(king, after) & (bishops | queens) & sliders));
+        }
+        if (move.promotion.has_value() || is_en_passant(move)) {
+            auto after = (occupied & ~from_bb) | to_bb;
+            if (!move.promotion.has_value())
+                after &= ~BB_SQUARES[move.to_square + (turn == WHITE ? -8 : 8)];
+            if (move.promotion.has_value() && attacks_for(*move.promotion, turn, move.to_square, after) & info.king)
+                return true;
+            if (!move.promotion.has_value() && BB_PAWN_ATTACKS[turn][move.to_square] & info.king)
+                return true;
+            auto ours = occupied_co[turn] & ~from_bb;
+            return (bool)((rook_attacks(king, after) & (rooks | queens) & ours) | (bishop_attacks(king, after) & (bishops | queens) & ours));
+        }
+
+        // # A direct check from the destination, or a discovered check by
+        // # stepping off the line to the king.
+        if (info.check_squares[(int)*piece_type] & to_bb)
+            return true;
+        return (bool)(info.discoverers & from_bb) && !(ray(move.from_square, move.to_square) & info.king);
+    }
+
+    static auto attacks_for(PieceType piece_type, Color color, Square square, Bitboard occupied) -> Bitboard {
+        // """Gets the squares a piece of the given type would attack from *square*."""
+        switch (piece_type) {
+            case PieceType::PAWN: return BB_PAWN_ATTACKS[color][square];
+            case PieceType::KNIGHT: return BB_KNIGHT_ATTACKS[square];
+            case PieceType::BISHOP: return bishop_attacks(square, occupied);
+            case PieceType::ROOK: return rook_attacks(square, occupied);
+            case PieceType::QUEEN: return queen_attacks(square, occupied);
+            default: return BB_KING_ATTACKS[square];
+        }
+    }
+
+    auto _least_valuable(Bitboard attackers) const -> PieceType {
+        if (attackers & pawns) return PieceType::PAWN;
+        if (attackers & knights) return PieceType::KNIGHT;
+        if (attackers & bishops) return PieceType::BISHOP;
+        if (attackers & rooks) return PieceType::ROOK;
+        if (attackers & queens) return PieceType::QUEEN;
+        return PieceType::KING;
+    }
+
+    auto _pieces_of(PieceType piece_type) const -> Bitboard {
+        switch (piece_type) {
+            case PieceType::PAWN: return pawns;
+            case PieceType::KNIGHT: return knights;
+            case PieceType::BISHOP: return bishops;
+            case PieceType::ROOK: return rooks;
+            case PieceType::QUEEN: return queens;
+            default: return kings;
+        }
+    }
+
+    auto see(Move move) -> int {
+        // """
+        // Statically evaluates the exchange of pieces started by the given
+        // pseudo-legal move on its destination square, in centipawns of
+        // :data:`~chess.SEE_VALUES` for the side to move. Both sides capture
+        // with their least valuable piece and stop when that loses material.
+        // Sliders behind the capturing pieces join in as the occupancy
+        // changes. Pins are not taken into account.
+        // """
+        if (!move.__bool__() || move.drop.has_value() || is_castling(move))
+            return 0;
+
+        auto to = move.to_square;
+        auto occupancy = occupied & ~BB_SQUARES[move.from_square];
+        auto captured = piece_type_at(to);
+        std::array<int, 32> gain{};
+        gain[0] = captured ? SEE_VALUES[(int)*captured] : 0;
+        if (is_en_passant(move)) {
+            gain[0] = SEE_VALUES[(int)PieceType::PAWN];
+            occupancy &= ~BB_SQUARES[to + (turn == WHITE ? -8 : 8)];
+        }
+        auto on_square = *piece_type_at(move.from_square);
+        if (move.promotion.has_value()) {
+            gain[0] += SEE_VALUES[(int)*move.promotion] - SEE_VALUES[(int)PieceType::PAWN];
+            on_square = *move.promotion;
+        }
+        occupancy |= BB_SQUARES[to];
+
+        auto side = (Color)!turn;
+        auto depth = 0;
+        while (depth < 31) {
+            auto attackers = _attackers_mask(side, to, occupancy) & occupancy & ~BB_SQUARES[to];
+            if (!attackers)
+                break;
+            auto piece_type = _least_valuable(attackers);
+            auto attacker = attackers & _pieces_of(piece_type);
+            attacker &= -attacker;
+            // # The king cannot capture into a defended square.
+            if (piece_type == PieceType::KING && _attackers_mask((Color)!side, to, occupancy ^ attacker) & (occupancy ^ attacker) & ~BB_SQUARES[to])
+                break;
+            ++depth;
+            gain[depth] = SEE_VALUES[(int)on_square] - gain[depth - 1];
+            on_square = piece_type;
+            occupancy ^= attacker;
+            side = (Color)!side;
+        }
+        while (depth > 0) {
+            gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+            --depth;
+        }
+        return gain[0];
+    }
+
+    auto see_ge(Move move, int threshold = 0) -> bool {
+        // """
+        // Checks if the static exchange evaluation of the given move is at
+        // least *threshold*. Stops as soon as the outcome is certain, so it is
+        // cheaper than comparing :func:`~chess.Board.see()`.
+        // """
+        if (!move.__bool__() || move.drop.has_value() || is_castling(move))
+            return 0 >= threshold;
+
+        auto to = move.to_square;
+        auto captured = piece_type_at(to);
+        auto occupancy = (occupied & ~BB_SQUARES[move.from_square]) | BB_SQUARES[to];
+        auto swap = captured ? SEE_VALUES[(int)*captured] : 0;
+        if (is_en_passant(move)) {
+            swap = SEE_VALUES[(int)PieceType::PAWN];
+            occupancy &= ~BB_SQUARES[to + (turn == WHITE ? -8 : 8)];
+        }
+        auto on_square = *piece_type_at(move.from_square);
+        if (move.promotion.has_value()) {
+            swap += SEE_VALUES[(int)*move.promotion] - SEE_VALUES[(int)PieceType::PAWN];
+            on_square = *move.promotion;
+        }
+
+        // # *swap* is what the side that just captured is ahead of the
+        // # threshold, if the other side stops here.
+        swap -= threshold;
+        if (swap < 0)
+            return false;
+        swap = SEE_VALUES[(int)on_square] - swap;
+        if (swap <= 0)
+            return true;
+
+        auto side = turn;
+        auto result = true;
+        while (true) {
+            side = (Color)!side;
+            auto attackers = _attackers_mask(side, to, occupancy) & occupancy & ~BB_SQUARES[to];
+            if (!attackers)
+                break;
+            auto piece_type = _least_valuable(attackers);
+            auto attacker = attackers & _pieces_of(piece_type);
+            attacker &= -attacker;
+            if (piece_type == PieceType::KING) {
+                // # The king only captures if nothing can take it back.
+                auto defended = _attackers_mask((Color)!side, to, occupancy ^ attacker) & (occupancy ^ attacker) & ~BB_SQUARES[to];
+                return defended ? result : !result;
+            }
+            result = !result;
+            swap = SEE_VALUES[(int)piece_type] - swap;
+            if (swap < (int)result)
+                break;
+            occupancy ^= attacker;
+        }
+        return result;
     }
 
     auto is_into_check(Move move) -> bool {
@@ -1961,9 +2997,8 @@ class Board : public BaseBoard {
 
         auto king_sq = maybe_king_sq.value();
         // # If already in check, look if it is an evasion.
-        auto checkers_bb = attackers_mask(not self.turn, king_sq);
-        auto evasions = _generate_evasions(king_sq, checkers_bb, BB_SQUARES[move.from_square], BB_SQUARES[move.to_square]);
-        if (checkers_bb && std::find(evasions.begin(), evasions.end(), move) != evasions.end())
+        auto checkers_bb = attackers_mask((Color)!turn, king_sq);
+        if (checkers_bb && !_generate_evasions(king_sq, checkers_bb, BB_SQUARES[move.from_square], BB_SQUARES[move.to_square]).contains(move))
             return true;
 
         return !_is_safe(king_sq, _slider_blockers(king_sq), move);
@@ -1975,6 +3010,7 @@ class Board : public BaseBoard {
     }
 
     auto is_pseudo_legal(Move move) -> bool {
+        CHESS_PROBE(is_pseudo_legal);
         // # Null moves are not pseudo-legal.
         if (!move.__bool__())
             return false;
@@ -1993,7 +3029,7 @@ class Board : public BaseBoard {
         auto to_mask = BB_SQUARES[move.to_square];
 
         // # Check turn.
-        if (!occupied_co[turn] & from_mask)
+        if (!(occupied_co[turn] & from_mask))
             return false;
 
         // # Only pawns can promote and only on the backrank.
@@ -2009,9 +3045,7 @@ class Board : public BaseBoard {
         // # Handle castling.
         if (piece == PieceType::KING) {
             auto cmove = _from_chess960(chess960, move.from_square, move.to_square);
-
-            auto cmoves = generate_castling_moves();
-            if (std::find(cmoves.begin(), cmoves.end(), move) != cmoves.end())
+            if (generate_castling_moves().contains(cmove))
                 return true;
         }
         // # Destination square can not be occupied.
@@ -2019,19 +3053,18 @@ class Board : public BaseBoard {
             return false;
 
         // # Handle pawn moves.
-        if (piece == PieceType::PAWN){
-            auto pmoves = generate_pseudo_legal_moves(from_mask, to_mask);
-            return std::find(pmoves.begin(), pmoves.end(), move) != pmoves.end();
-        }
+        if (piece == PieceType::PAWN)
+            return generate_pseudo_legal_moves(from_mask, to_mask).contains(move);
         // # Handle all other pieces.
         return (bool)(attacks_mask(move.from_square) & to_mask);
     }
 
     auto is_legal(Move move) -> bool {
+        CHESS_PROBE(is_legal);
         return !is_variant_end() && is_pseudo_legal(move) && !is_into_check(move);
     }
 
-    auto is_variant_end() -> bool {
+    auto is_variant_end() const -> bool {
         // """
         // Checks if the game is over due to a special variant end condition.
 
@@ -2069,17 +3102,16 @@ class Board : public BaseBoard {
         }
 
     auto is_game_over(bool claim_draw = false) -> bool {
-        return outcome(claim_draw=claim_draw).has_value();
+        return outcome(claim_draw).has_value();
     }
 
     auto result(bool claim_draw = false) -> std::string {
-        auto m_outcome = outcome(claim_draw=claim_draw);
+        auto m_outcome = outcome(claim_draw);
         return m_outcome.has_value() ? m_outcome.value().result() : "*"s;
     }
 
-    auto no_legal_moves() {
-        auto lmoves = generate_legal_moves();
-        return lmoves.begin() == lmoves.end();
+    auto no_legal_moves() -> bool {
+        return generate_legal_moves().empty();
     }
 
     auto outcome(bool claim_draw = false) -> std::optional<Outcome> {
@@ -2266,44 +3298,33 @@ class Board : public BaseBoard {
         // board occured for the third time or if such a repetition is reached
         // with one of the possible legal moves.
 
-        // Note that checking this can be slow: In the worst case
-        // scenario, every legal move has to be tested and the entire game has to
-        // be replayed because there is no incremental transposition table.
+        // Only the hash history back to the last irreversible move is scanned,
+        // once, into a counter on the stack. Every legal move is then tried
+        // with push_fast(), so the whole check does no heap allocation.
         // """
-        auto transposition_key = _transposition_key();
-        using HashType = decltype(transposition_key);
-        auto transpositions = hscnt::HashCounter<HashType>();
-        transpositions.add(transposition_key);
-
-        // # Count positions.
-        auto switchyard = std::vector<Move>();
-        while (!move_stack.empty()) {
-            auto move = pop();
-            switchyard.push_back(move);
-
-            if (is_irreversible(move))
-                break;
-
-            transpositions.add(_transposition_key());
-        }
-        while (!switchyard.empty()) {
-            auto m = switchyard.back();
-            push(m);
-            switchyard.pop_back();
-        }
-        // # Threefold repetition occured.
-        if (transpositions.count(transposition_key) >= 3)
+        if (is_repetition(3))
             return true;
 
+        // # After our move the opponent is to move, as in every other
+        // # position of the history counting back from the last one.
+        hscnt::HashCounter<> counter;
+        auto plies = std::min<std::size_t>(_reversible_plies, _hash_history.size());
+        for (auto back = (std::size_t)1; back <= plies; back += 2)
+            counter.add(_hash_history[_hash_history.size() - back]);
+        if (!counter.size())
+            return false;
+
         // # The next legal move is a threefold repetition.
-        auto lmoves = generate_legal_moves();
-        for (auto move : lmoves) {
-            self.push(move);
-            auto key = _transposition_key();
-            auto ret = transpositions.count(key) >= 2;
-            self.pop();
+        MoveList moves;
+        generate_legal_moves_into(moves);
+        UndoRecord undo;
+        for (auto move : moves) {
+            push_fast(move, undo);
+            auto ep_key = _zobrist_ep();
+            auto ret = _reversible_plies && counter.count(_repetition_key(ep_key, !ep_key || has_legal_en_passant())) >= 2;
+            pop_fast(undo);
             if (ret)
-                return ret;
+                return true;
         }
         return false;
     }
@@ -2317,59 +3338,1663 @@ class Board : public BaseBoard {
         // this does not consider a repetition that can be played on the next
         // move.
 
-        // Note that checking this can be slow: In the worst case, the entire
-        // game has to be replayed because there is no incremental transposition
-        // table.
+        // Compares zobrist keys from the hash history, going back no further
+        // than the last irreversible move. The board is not modified.
         // """
-        // # Fast check, based on occupancy only.
-        auto maybe_repetitions = 1;
+        if (count <= 1)
+            return true;
 
-        for (auto it = _stack.rbegin(); it != _stack.rend(); ++it) {
-            auto state = *it;
-            if (state.occupied == occupied) {
-                maybe_repetitions += 1;
-                if (maybe_repetitions >= count) {
-                    break;
-                }
+        auto ep_key = _zobrist_ep();
+        auto key = _repetition_key(ep_key, !ep_key || has_legal_en_passant());
+
+        // # Only positions with the same side to move can match.
+        auto plies = std::min<std::size_t>(_reversible_plies, _hash_history.size());
+        for (auto back = (std::size_t)2; back <= plies; back += 2) {
+            if (_hash_history[_hash_history.size() - back] == key) {
+                if (--count <= 1)
+                    return true;
             }
         }
-        if (maybe_repetitions < count){
-            return false;
+        return false;
+    }
+
+    auto _board_state() -> _BoardState<Board> {
+        return _BoardState<Board>(*this);
+    }
+
+    void _push_capture(Move move, Square capture_square, PieceType piece_type, bool was_promoted) {
+        (void)move;
+        (void)capture_square;
+        (void)piece_type;
+        (void)was_promoted;
+    }
+
+    void push(Move move) {
+        // """
+        // Updates the position with the given *move* and puts it onto the
+        // move stack.
+
+        // Null moves just increment the move counters, switch turns and forfeit
+        // en passant capturing.
+
+        // .. warning::
+        //     Moves are not checked for legality. It is the caller's
+        //     responsibility to ensure that the move is at least pseudo-legal or
+        //     a null move.
+        // """
+        CHESS_PROBE(push);
+        // # Push move and remember board state.
+        move = _to_chess960(move);
+        auto board_state = _board_state();
+        castling_rights = clean_castling_rights();  // # Before pushing stack
+        move_stack.push_back(PackedMove(_from_chess960(chess960, move.from_square, move.to_square, move.promotion, move.drop)));
+        _stack.push_back(board_state);
+
+        // # Remember the repetition key, and whether this move can be undone
+        // # by later moves (see is_irreversible()).
+        auto prev_castling_rights = castling_rights;
+        auto ep_key = _zobrist_ep();
+        auto legal_ep = ep_key && has_legal_en_passant();
+        auto zeroing = is_zeroing(move);
+        _hash_history.push_back(_repetition_key(ep_key, legal_ep));
+
+        auto finish = [&]() {
+            _zobrist_state = _compute_zobrist_state(castling_rights);
+            auto irreversible = zeroing || legal_ep || castling_rights != prev_castling_rights;
+            _reversible_plies = irreversible ? 0 : _reversible_plies + 1;
+        };
+
+        // # Reset en passant square.
+        auto prev_ep_square = ep_square;
+        ep_square = std::nullopt;
+
+        // # Increment move counters.
+        halfmove_clock += 1;
+        if (turn == BLACK)
+            fullmove_number += 1;
+
+        // # On a null move, simply swap turns and reset the en passant square.
+        if (!move.__bool__()) {
+            turn = (Color)!turn;
+            finish();
+            return;
         }
-        // # Check full replay.
-        auto transposition_key = _transposition_key();
-        auto switchyard = std::vector<Move>();
 
-        while (true) {
-            if (count <= 1) {
-                while (!switchyard.empty()) {
-                    auto m = switchyard.back();
-                    self.push(m);
-                    switchyard.pop_back();
-                }
-                return true;
+        // # Drops.
+        if (move.drop.has_value()) {
+            _set_piece_at(move.to_square, move.drop.value(), turn);
+            turn = (Color)!turn;
+            finish();
+            return;
+        }
+
+        // # Zero the half-move clock.
+        if (zeroing)
+            halfmove_clock = 0;
+
+        auto from_bb = BB_SQUARES[move.from_square];
+        auto to_bb = BB_SQUARES[move.to_square];
+
+        auto was_promoted = (bool)(promoted & from_bb);
+        auto piece_type = _remove_piece_at(move.from_square);
+        assert(piece_type.has_value() && "push() expects move to be pseudo-legal");
+        auto capture_square = move.to_square;
+        auto captured_piece_type = piece_type_at(capture_square);
+
+        // # Update castling rights.
+        castling_rights &= ~to_bb & ~from_bb;
+        if (piece_type == PieceType::KING && !was_promoted) {
+            if (turn == WHITE)
+                castling_rights &= ~BB_RANK_1;
+            else
+                castling_rights &= ~BB_RANK_8;
+        } else if (captured_piece_type == PieceType::KING && !(promoted & to_bb)) {
+            if (turn == WHITE && square_rank(move.to_square) == 7)
+                castling_rights &= ~BB_RANK_8;
+            else if (turn == BLACK && square_rank(move.to_square) == 0)
+                castling_rights &= ~BB_RANK_1;
+        }
+
+        // # Handle special pawn moves.
+        if (piece_type == PieceType::PAWN) {
+            auto diff = move.to_square - move.from_square;
+
+            if (diff == 16 && square_rank(move.from_square) == 1) {
+                ep_square = (Square)(move.from_square + 8);
+            } else if (diff == -16 && square_rank(move.from_square) == 6) {
+                ep_square = (Square)(move.from_square - 8);
+            } else if (move.to_square == prev_ep_square && (std::abs(diff) == 7 || std::abs(diff) == 9) && !captured_piece_type.has_value()) {
+                // # Remove pawns captured en passant.
+                auto down = turn == WHITE ? -8 : 8;
+                capture_square = (Square)(prev_ep_square.value() + down);
+                captured_piece_type = _remove_piece_at(capture_square);
             }
-            if (move_stack.size() < count - 1) {
-                break;
+        }
+
+        // # Promotion.
+        if (move.promotion.has_value()) {
+            was_promoted = true;
+            piece_type = move.promotion;
+        }
+
+        // # Castling.
+        auto castling = piece_type == PieceType::KING && (occupied_co[turn] & to_bb);
+        if (castling) {
+            auto a_side = square_file(move.to_square) < square_file(move.from_square);
+
+            _remove_piece_at(move.from_square);
+            _remove_piece_at(move.to_square);
+
+            if (a_side) {
+                _set_piece_at(turn == WHITE ? C1 : C8, PieceType::KING, turn);
+                _set_piece_at(turn == WHITE ? D1 : D8, PieceType::ROOK, turn);
+            } else {
+                _set_piece_at(turn == WHITE ? G1 : G8, PieceType::KING, turn);
+                _set_piece_at(turn == WHITE ? F1 : F8, PieceType::ROOK, turn);
             }
+        }
 
-            auto move = pop();
-            switchyard.push_back(move);
+        // # Put the piece on the target square.
+        if (!castling) {
+            auto capture_was_promoted = (bool)(promoted & to_bb);
+            _set_piece_at(move.to_square, piece_type.value(), turn, was_promoted);
 
-            if (is_irreversible(move)) {
-                break;
+            if (captured_piece_type.has_value())
+                _push_capture(move, capture_square, captured_piece_type.value(), capture_was_promoted);
+        }
+
+        // # Swap turn.
+        turn = (Color)!turn;
+
+        // castling_rights was cleaned before the move and push() only ever
+        // removes rights, so it is still clean here.
+        finish();
+    }
+
+    auto pop() -> Move {
+        // """
+        // Restores the previous position and returns the last move from the stack.
+
+        // The move stack must not be empty.
+        // """
+        CHESS_PROBE(pop);
+        assert(!move_stack.empty());
+        auto move = move_stack.back().to_move();
+        move_stack.pop_back();
+        _stack.back().restore(*this);
+        _stack.pop_back();
+        _hash_history.pop_back();
+        return move;
+    }
+
+    auto peek() -> Move {
+        // """
+        // Gets the last move from the move stack.
+
+        // The move stack must not be empty.
+        // """
+        return move_stack.back().to_move();
+    }
+
+    void push_fast(Move move, UndoRecord& undo) {
+        // """
+        // Makes *move* like :func:`~chess.Board.push()`, but saves only a
+        // compact :class:`~chess.UndoRecord` into *undo* instead of a full
+        // board state, and leaves :data:`~chess.Board.move_stack` alone.
+        // The zobrist key and repetition history are kept up to date.
+
+        // Take the move back with :func:`~chess.Board.pop_fast()`, in strict
+        // last-in first-out order. Do not mix this with push()/pop() on
+        // the same moves.
+
+        // .. warning::
+        //     Moves are not checked for legality. It is the caller's
+        //     responsibility to ensure that the move is at least pseudo-legal or
+        //     a null move.
+        // """
+        CHESS_PROBE(push_fast);
+        move = _to_chess960(move);
+        undo.castling_rights = castling_rights;
+        undo.promoted = promoted;
+        undo.zobrist_state = _zobrist_state;
+        undo.halfmove_clock = halfmove_clock;
+        undo.reversible_plies = _reversible_plies;
+        undo.move = PackedMove(move);
+        undo.captured = 0;
+        undo.flags = 0;
+        undo.ep_square = ep_square.has_value() ? (std::int8_t)ep_square.value() : -1;
+
+        castling_rights = clean_castling_rights();
+        auto prev_castling_rights = castling_rights;
+        auto ep_key = _zobrist_ep();
+        auto legal_ep = ep_key && has_legal_en_passant();
+        auto zeroing = is_zeroing(move);
+        _hash_history.push_back(_repetition_key(ep_key, legal_ep));
+
+        auto prev_ep_square = ep_square;
+        ep_square = std::nullopt;
+        halfmove_clock += 1;
+        if (turn == BLACK)
+            fullmove_number += 1;
+
+        auto finish = [&]() {
+            turn = (Color)!turn;
+            _zobrist_state = _compute_zobrist_state(castling_rights);
+            auto irreversible = zeroing || legal_ep || castling_rights != prev_castling_rights;
+            _reversible_plies = irreversible ? 0 : _reversible_plies + 1;
+        };
+
+        if (!move.__bool__()) {
+            finish();
+            return;
+        }
+
+        if (move.drop.has_value()) {
+            _toggle_piece(move.to_square, move.drop.value(), turn);
+            finish();
+            return;
+        }
+
+        if (zeroing)
+            halfmove_clock = 0;
+
+        auto from_bb = BB_SQUARES[move.from_square];
+        auto to_bb = BB_SQUARES[move.to_square];
+        auto was_promoted = (bool)(promoted & from_bb);
+        auto piece_type = piece_type_at(move.from_square);
+        assert(piece_type.has_value() && "push_fast() expects move to be pseudo-legal");
+        auto castling = piece_type == PieceType::KING && (occupied_co[turn] & to_bb);
+        auto capture_square = move.to_square;
+        auto captured_piece_type = castling ? std::nullopt : piece_type_at(capture_square);
+
+        // # Update castling rights.
+        castling_rights &= ~to_bb & ~from_bb;
+        if (piece_type == PieceType::KING && !was_promoted) {
+            castling_rights &= turn == WHITE ? ~BB_RANK_1 : ~BB_RANK_8;
+        } else if (captured_piece_type == PieceType::KING && !(promoted & to_bb)) {
+            if (turn == WHITE && square_rank(move.to_square) == 7)
+                castling_rights &= ~BB_RANK_8;
+            else if (turn == BLACK && square_rank(move.to_square) == 0)
+                castling_rights &= ~BB_RANK_1;
+        }
+
+        if (castling) {
+            undo.flags = UndoRecord::CASTLING;
+            auto a_side = square_file(move.to_square) < square_file(move.from_square);
+            auto [king_to, rook_to] = _castling_targets(a_side);
+            _toggle_piece(move.from_square, PieceType::KING, turn);
+            _toggle_piece(move.to_square, PieceType::ROOK, turn);
+            _toggle_piece(king_to, PieceType::KING, turn);
+            _toggle_piece(rook_to, PieceType::ROOK, turn);
+            promoted &= ~from_bb & ~to_bb;
+            finish();
+            return;
+        }
+
+        // # Handle special pawn moves.
+        if (piece_type == PieceType::PAWN) {
+            auto diff = move.to_square - move.from_square;
+
+            if (diff == 16 && square_rank(move.from_square) == 1) {
+                ep_square = (Square)(move.from_square + 8);
+            } else if (diff == -16 && square_rank(move.from_square) == 6) {
+                ep_square = (Square)(move.from_square - 8);
+            } else if (move.to_square == prev_ep_square && (std::abs(diff) == 7 || std::abs(diff) == 9) && !captured_piece_type.has_value()) {
+                capture_square = (Square)(prev_ep_square.value() + (turn == WHITE ? -8 : 8));
+                captured_piece_type = PieceType::PAWN;
+                undo.flags = UndoRecord::EN_PASSANT;
             }
-            if (_transposition_key() == transposition_key) {
-                count--;
+        }
+
+        if (captured_piece_type.has_value()) {
+            undo.captured = (std::uint8_t)captured_piece_type.value();
+            _toggle_piece(capture_square, captured_piece_type.value(), (Color)!turn);
+            promoted &= ~BB_SQUARES[capture_square];
+        }
+
+        _toggle_piece(move.from_square, piece_type.value(), turn);
+        _toggle_piece(move.to_square, move.promotion.value_or(piece_type.value()), turn);
+        promoted &= ~from_bb;
+        if (was_promoted || move.promotion.has_value())
+            promoted |= to_bb;
+
+        finish();
+    }
+
+    void pop_fast(const UndoRecord& undo) {
+        // """
+        // Takes back the move made by the matching
+        // :func:`~chess.Board.push_fast()`.
+        // """
+        CHESS_PROBE(pop_fast);
+        turn = (Color)!turn;
+        if (turn == BLACK)
+            fullmove_number -= 1;
+        _hash_history.pop_back();
+
+        auto move = undo.move.to_move();
+        if (move.drop.has_value()) {
+            _toggle_piece(move.to_square, move.drop.value(), turn);
+        } else if (undo.flags & UndoRecord::CASTLING) {
+            auto a_side = square_file(move.to_square) < square_file(move.from_square);
+            auto [king_to, rook_to] = _castling_targets(a_side);
+            _toggle_piece(king_to, PieceType::KING, turn);
+            _toggle_piece(rook_to, PieceType::ROOK, turn);
+            _toggle_piece(move.from_square, PieceType::KING, turn);
+            _toggle_piece(move.to_square, PieceType::ROOK, turn);
+        } else if (move.__bool__()) {
+            auto piece_type = move.promotion.has_value() ? PieceType::PAWN : piece_type_at(move.to_square).value();
+            _toggle_piece(move.to_square, move.promotion.value_or(piece_type), turn);
+            _toggle_piece(move.from_square, piece_type, turn);
+            if (undo.captured) {
+                auto capture_square = move.to_square;
+                if (undo.flags & UndoRecord::EN_PASSANT)
+                    capture_square = (Square)(move.to_square + (turn == WHITE ? -8 : 8));
+                _toggle_piece(capture_square, (PieceType)undo.captured, (Color)!turn);
             }
         }
-        while (!switchyard.empty()) {
-            auto m = switchyard.back();
-            self.push(m);
-            switchyard.pop_back();
+
+        castling_rights = undo.castling_rights;
+        promoted = undo.promoted;
+        _zobrist_state = undo.zobrist_state;
+        halfmove_clock = undo.halfmove_clock;
+        _reversible_plies = undo.reversible_plies;
+        ep_square = undo.ep_square >= 0 ? std::optional<Square>((Square)undo.ep_square) : std::nullopt;
+    }
+
+    auto _castling_targets(bool a_side) const -> std::pair<Square, Square> {
+        // where the king and rook of the side to move end up after castling.
+        if (a_side)
+            return {turn == WHITE ? C1 : C8, turn == WHITE ? D1 : D8};
+        return {turn == WHITE ? G1 : G8, turn == WHITE ? F1 : F8};
+    }
+
+    auto _try_set_fen_fields(const _BoardFenParse& board, std::string_view turn_part, std::string_view castling_part,
+                             std::string_view ep_part, std::string_view halfmove_part, std::string_view fullmove_part) -> FenError {
+        // the shared tail of try_set_fen() and try_set_epd(). empty fields take
+        // their defaults. nothing is touched unless every field is valid.
+
+        // # Turn.
+        auto turn = WHITE;
+        if (turn_part == "b")
+            turn = BLACK;
+        else if (!turn_part.empty() && turn_part != "w")
+            return FenError::turn;
+
+        // # Validate castling part.
+        if (castling_part.empty())
+            castling_part = "-";
+        if (!_is_valid_castling_fen(castling_part))
+            return FenError::castling;
+
+        // # En passant square.
+        std::optional<Square> ep_square = std::nullopt;
+        if (!ep_part.empty() && ep_part != "-") {
+            if (ep_part.size() != 2 || ep_part[0] < 'a' || ep_part[0] > 'h' || ep_part[1] < '1' || ep_part[1] > '8')
+                return FenError::en_passant;
+            ep_square = (Square)((ep_part[1] - '1') * 8 + (ep_part[0] - 'a'));
+        }
+
+        // # Check that the half-move part is valid.
+        auto halfmove_clock = 0;
+        if (!halfmove_part.empty()) {
+            if (!_parse_fen_int(halfmove_part, halfmove_clock))
+                return FenError::halfmove_clock;
+            if (halfmove_clock < 0)
+                return FenError::negative_halfmove_clock;
         }
-        return false;
+
+        // # Check that the full-move number part is valid.
+        // # 0 is allowed for compatibility, but later replaced with 1.
+        auto fullmove_number = 1;
+        if (!fullmove_part.empty()) {
+            if (!_parse_fen_int(fullmove_part, fullmove_number))
+                return FenError::fullmove_number;
+            if (fullmove_number < 0)
+                return FenError::negative_fullmove_number;
+            fullmove_number = std::max(fullmove_number, 1);
+        }
+
+        // # Apply.
+        _apply_board_fen(board);
+        this->turn = turn;
+        _set_castling_fen(castling_part);
+        this->ep_square = ep_square;
+        this->halfmove_clock = halfmove_clock;
+        this->fullmove_number = fullmove_number;
+        clear_stack();
+        return FenError::ok;
     }
-};
+
+    static auto _parse_leading_board_fen(std::string_view text, _BoardFenParse& board, std::string_view& rest) -> FenError {
+        // parses the board field at the start of a FEN or EPD and points *rest*
+        // past it, so the board is not scanned twice.
+        std::size_t start = 0;
+        while (start < text.size() && _is_fen_space(text[start]))
+            ++start;
+        // # Board part.
+        if (start == text.size())
+            return FenError::empty;
+        std::size_t end = 0;
+        auto error = _parse_board_fen(text.substr(start), board, &end);
+        rest = text.substr(start + end);
+        return error;
+    }
+
+    auto try_set_fen(std::string_view fen) -> FenError {
+        // """
+        // Parses a FEN and sets the position from it, like
+        // :func:`~chess.Board.set_fen()`, but reports a syntax error by return
+        // value instead of throwing. Nothing is allocated, and on error the
+        // board is left unchanged.
+        // """
+        CHESS_PROBE(set_fen);
+        _BoardFenParse board;
+        std::string_view rest;
+        auto error = _parse_leading_board_fen(fen, board, rest);
+        if (error != FenError::ok)
+            return error;
+
+        std::array<std::string_view, 5> parts;
+        // # All parts should be consumed now.
+        if (_split_fields(rest, parts.data(), parts.size()) > parts.size())
+            return FenError::too_many_parts;
+
+        return _try_set_fen_fields(board, parts[0], parts[1], parts[2], parts[3], parts[4]);
+    }
+
+    void set_fen(const std::string& fen) {
+        // """
+        // Parses a FEN and sets the position from it.
+
+        // :raises: :exc:`std::invalid_argument` if syntactically invalid. Use
+        //     :func:`~chess.Board.is_valid()` to detect invalid positions.
+        // """
+        auto error = try_set_fen(fen);
+        if (error == FenError::empty)
+            throw std::invalid_argument(std::string(fen_error_message(error)));
+        if (error != FenError::ok)
+            throw std::invalid_argument(std::string(fen_error_message(error)) + ": " + fen);
+    }
+
+    auto try_set_epd(std::string_view epd, std::string_view* operations = nullptr) -> FenError {
+        // """
+        // Parses the given EPD string and uses it to set the position.
+
+        // The first four fields are the position. The ``hmvc`` (half-move
+        // clock) and ``fmvn`` (fullmove number) operations are applied if
+        // present, and the raw operations text is stored in *operations*; it
+        // is a view into *epd*. Like :func:`~chess.Board.try_set_fen()`, this
+        // does not allocate or throw.
+        // """
+        _BoardFenParse board;
+        std::string_view rest;
+        auto error = _parse_leading_board_fen(epd, board, rest);
+        if (error != FenError::ok)
+            return error;
+
+        std::array<std::string_view, 3> parts;
+        _split_fields(rest, parts.data(), parts.size(), &rest);
+
+        // # Parse ops.
+        while (!rest.empty() && (rest.back() == ';' || _is_fen_space(rest.back())))
+            rest.remove_suffix(1);
+        if (operations)
+            *operations = rest;
+
+        std::string_view halfmove_part, fullmove_part;
+        while (!rest.empty()) {
+            // one operation: an opcode and operands up to an unquoted ';'.
+            std::size_t end = 0;
+            for (auto quoted = false; end < rest.size() && (quoted || rest[end] != ';'); ++end) {
+                if (rest[end] == '"')
+                    quoted = !quoted;
+                else if (quoted && rest[end] == '\\')
+                    ++end;
+            }
+            std::array<std::string_view, 2> operation;
+            if (_split_fields(rest.substr(0, std::min(end, rest.size())), operation.data(), operation.size()) == 2) {
+                if (operation[0] == "hmvc")
+                    halfmove_part = operation[1];
+                else if (operation[0] == "fmvn")
+                    fullmove_part = operation[1];
+            }
+            rest = end < rest.size() ? rest.substr(end + 1) : std::string_view();
+        }
+
+        return _try_set_fen_fields(board, parts[0], parts[1], parts[2], halfmove_part, fullmove_part);
+    }
+
+    auto set_epd(const std::string& epd) -> std::string {
+        // """
+        // Parses the given EPD string and uses it to set the position.
+
+        // Returns the operations part of the EPD, unparsed apart from the
+        // ``hmvc`` and ``fmvn`` operations that are applied to the board.
+
+        // :raises: :exc:`std::invalid_argument` if the EPD string is invalid.
+        // """
+        std::string_view operations;
+        auto error = try_set_epd(epd, &operations);
+        if (error != FenError::ok)
+            throw std::invalid_argument(std::string(fen_error_message(error)) + ": " + epd);
+        return std::string(operations);
+    }
+
+    void set_board_fen(std::string fen) {
+        BaseBoard::set_board_fen(fen);
+        clear_stack();
+    }
+
+    void _set_castling_fen(std::string_view castling_fen) {
+        if (castling_fen.empty() || castling_fen == "-") {
+            castling_rights = BB_EMPTY;
+            return;
+        }
+
+        if (!_is_valid_castling_fen(castling_fen))
+            throw std::invalid_argument("invalid castling fen: "s + std::string(castling_fen));
+
+        castling_rights = BB_EMPTY;
+
+        for (auto flag : castling_fen) {
+            auto color = ('A' <= flag && flag <= 'Z') ? WHITE : BLACK;
+            flag = strtools::tolower(flag);
+            auto backrank = color == WHITE ? BB_RANK_1 : BB_RANK_8;
+            auto rooks = occupied_co[color] & this->rooks & backrank;
+            auto king = this->king(color);
+
+            if (flag == 'q') {
+                // # Select the leftmost rook.
+                if (king.has_value() && (!rooks || lsb(rooks) < king.value()))
+                    castling_rights |= rooks & -rooks;
+                else
+                    castling_rights |= BB_FILE_A & backrank;
+            } else if (flag == 'k') {
+                // # Select the rightmost rook.
+                if (king.has_value() && rooks && king.value() < msb(rooks))
+                    castling_rights |= BB_SQUARES[msb(rooks)];
+                else
+                    castling_rights |= BB_FILE_H & backrank;
+            } else {
+                castling_rights |= BB_FILES[flag - 'a'] & backrank;
+            }
+        }
+    }
+
+    void set_castling_fen(const std::string& castling_fen) {
+        // """
+        // Sets castling rights from a string in FEN notation like ``Qqk``.
+
+        // :raises: :exc:`std::invalid_argument` if the castling FEN is
+        //     syntactically invalid.
+        // """
+        _set_castling_fen(castling_fen);
+        clear_stack();
+    }
+
+    auto _ep_capturers() const -> Bitboard {
+        // the pawns beside the en passant square, if any. without one, neither
+        // check generates moves, which is what writing most FENs comes to.
+        if (!ep_square.has_value())
+            return BB_EMPTY;
+        return pawns & occupied_co[turn] & BB_PAWN_ATTACKS[!turn][ep_square.value()];
+    }
+
+    auto has_pseudo_legal_en_passant() -> bool {
+        // """Checks if there is a pseudo-legal en passant capture."""
+        return _ep_capturers() && !generate_pseudo_legal_ep().empty();
+    }
+
+    auto has_legal_en_passant() -> bool {
+        // """Checks if there is a legal en passant capture."""
+        return _ep_capturers() && !generate_legal_ep().empty();
+    }
+
+    auto find_move(Square from_square, Square to_square, std::optional<PieceType> promotion = std::nullopt) -> Move {
+        // """
+        // Finds a matching legal move for an origin square, a target square, and
+        // an optional promotion piece type.
+
+        // For pawn moves to the backrank, the promotion piece type defaults to
+        // :data:`chess.QUEEN`, unless otherwise specified.
+
+        // Castling moves are normalized to king moves by two steps, except in
+        // Chess960.
+
+        // :raises: :exc:`std::invalid_argument` if no matching legal move is found.
+        // """
+        if (!promotion.has_value() && (pawns & BB_SQUARES[from_square]) && (BB_SQUARES[to_square] & BB_BACKRANKS))
+            promotion = PieceType::QUEEN;
+
+        auto move = _from_chess960(chess960, from_square, to_square, promotion);
+        if (!is_legal(move))
+            throw std::invalid_argument("no matching legal move for "s + move.uci() + " in " + fen());
+
+        return move;
+    }
+
+    auto _write_castling_shredder_fen(char* out) const -> char* {
+        auto castling_rights = clean_castling_rights();
+        if (!castling_rights) {
+            *out++ = '-';
+            return out;
+        }
+
+        for (auto square : scan_reversed(castling_rights & BB_RANK_1))
+            *out++ = (char)('A' + square_file(square));
+
+        for (auto square : scan_reversed(castling_rights & BB_RANK_8))
+            *out++ = (char)('a' + square_file(square));
+
+        return out;
+    }
+
+    auto castling_shredder_fen() const -> std::string {
+        char buffer[4];
+        return std::string(buffer, _write_castling_shredder_fen(buffer));
+    }
+
+    auto _write_castling_xfen(char* out) const -> char* {
+        auto start = out;
+        auto castling_rights = clean_castling_rights();
+
+        if (!chess960) {
+            // clean rights outside Chess960 are corner rooks with the king on
+            // its file, which never need a file letter.
+            for (auto [mask, ch] : {std::pair{BB_H1, 'K'}, {BB_A1, 'Q'}, {BB_H8, 'k'}, {BB_A8, 'q'}}) {
+                *out = ch;
+                out += (bool)(castling_rights & mask);
+            }
+            if (out == start)
+                *out++ = '-';
+            return out;
+        }
+
+        for (auto color : {WHITE, BLACK}) {
+            auto king = this->king(color);
+            if (!king.has_value())
+                continue;
+
+            auto king_file = square_file(king.value());
+            auto backrank = color == WHITE ? BB_RANK_1 : BB_RANK_8;
+
+            for (auto rook_square : scan_reversed(castling_rights & backrank)) {
+                auto rook_file = square_file(rook_square);
+                auto a_side = rook_file < king_file;
+
+                auto other_rooks = occupied_co[color] & rooks & backrank & ~BB_SQUARES[rook_square];
+
+                auto ch = a_side ? 'q' : 'k';
+                for (auto other : scan_reversed(other_rooks)) {
+                    if ((square_file(other) < rook_file) == a_side) {
+                        ch = FILE_NAMES[rook_file];
+                        break;
+                    }
+                }
+
+                *out++ = color == WHITE ? (char)(ch - 'a' + 'A') : ch;
+            }
+        }
+
+        if (out == start)
+            *out++ = '-';
+        return out;
+    }
+
+    auto castling_xfen() const -> std::string {
+        char buffer[4];
+        return std::string(buffer, _write_castling_xfen(buffer));
+    }
+
+    auto _write_epd(char* out, bool shredder, _EnPassantSpec en_passant, std::optional<bool> promoted) -> char* {
+        // writes the four position fields, which always fit in MAX_FEN_LENGTH.
+        std::optional<Square> ep_square;
+        if (en_passant == _EnPassantSpec::fen)
+            ep_square = this->ep_square;
+        else if (en_passant == _EnPassantSpec::xfen)
+            ep_square = has_pseudo_legal_en_passant() ? this->ep_square : std::nullopt;
+        else
+            ep_square = has_legal_en_passant() ? this->ep_square : std::nullopt;
+
+        out = _write_board_fen(out, promoted.value_or(false));
+        *out++ = ' ';
+        *out++ = turn == WHITE ? 'w' : 'b';
+        *out++ = ' ';
+        out = shredder ? _write_castling_shredder_fen(out) : _write_castling_xfen(out);
+        *out++ = ' ';
+        if (ep_square.has_value()) {
+            *out++ = (char)('a' + square_file(ep_square.value()));
+            *out++ = (char)('1' + square_rank(ep_square.value()));
+        } else {
+            *out++ = '-';
+        }
+        return out;
+    }
+
+    auto _write_fen(char* out, bool shredder, _EnPassantSpec en_passant, std::optional<bool> promoted) -> char* {
+        out = _write_epd(out, shredder, en_passant, promoted);
+        *out++ = ' ';
+        out = std::to_chars(out, out + 11, halfmove_clock).ptr;
+        *out++ = ' ';
+        return std::to_chars(out, out + 11, fullmove_number).ptr;
+    }
+
+    auto write_fen(char* buffer, std::size_t size, bool shredder = false, _EnPassantSpec en_passant = _EnPassantSpec::legal, std::optional<bool> promoted = std::nullopt) -> std::size_t {
+        // """
+        // Writes :func:`~chess.Board.fen()` into *buffer* without allocating,
+        // followed by a terminating NUL.
+
+        // Returns the length of the FEN, or ``0`` if it does not fit into
+        // *size* bytes; a buffer of ``MAX_FEN_LENGTH`` bytes always does.
+        // """
+        if (size >= MAX_FEN_LENGTH) {
+            auto end = _write_fen(buffer, shredder, en_passant, promoted);
+            *end = '\0';
+            return (std::size_t)(end - buffer);
+        }
+        char scratch[MAX_FEN_LENGTH];
+        auto length = (std::size_t)(_write_fen(scratch, shredder, en_passant, promoted) - scratch);
+        if (length >= size)
+            return 0;
+        std::copy(scratch, scratch + length, buffer);
+        buffer[length] = '\0';
+        return length;
+    }
+
+    auto write_epd(char* buffer, std::size_t size, bool shredder = false, _EnPassantSpec en_passant = _EnPassantSpec::legal, std::optional<bool> promoted = std::nullopt) -> std::size_t {
+        // """
+        // Writes :func:`~chess.Board.epd()` into *buffer*, like
+        // :func:`~chess.Board.write_fen()`.
+        // """
+        char scratch[MAX_FEN_LENGTH];
+        auto out = size >= MAX_FEN_LENGTH ? buffer : scratch;
+        auto length = (std::size_t)(_write_epd(out, shredder, en_passant, promoted) - out);
+        if (length >= size)
+            return 0;
+        if (out == scratch)
+            std::copy(scratch, scratch + length, buffer);
+        buffer[length] = '\0';
+        return length;
+    }
+
+    auto fen(bool shredder = false, _EnPassantSpec en_passant = _EnPassantSpec::legal, std::optional<bool> promoted = std::nullopt) -> std::string {
+        // """
+        // Gets a FEN representation of the position.
+
+        // A FEN string (e.g.,
+        // ``rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1``) consists
+        // of the board part :func:`~chess.Board.board_fen()`, the
+        // :data:`~chess.Board.turn`, the castling part
+        // (:data:`~chess.Board.castling_rights`),
+        // the en passant square (:data:`~chess.Board.ep_square`),
+        // the :data:`~chess.Board.halfmove_clock`
+        // and the :data:`~chess.Board.fullmove_number`.
+
+        // :param shredder: Use :func:`~chess.Board.castling_shredder_fen()`
+        //     and encode castling rights by the file of the rook
+        //     (like ``HAha``) instead of the default
+        //     :func:`~chess.Board.castling_xfen()` (like ``KQkq``).
+        // :param en_passant: By default, only fully legal en passant squares
+        //     are included (:func:`~chess.Board.has_legal_en_passant()`).
+        //     Pass ``fen`` to strictly follow the FEN specification
+        //     (always include the en passant square after a two-step pawn move)
+        //     or ``xfen`` to follow the X-FEN specification
+        //     (:func:`~chess.Board.has_pseudo_legal_en_passant()`).
+        // :param promoted: Mark promoted pieces like ``Q~``. By default, this is
+        //     only enabled in chess variants where this is relevant.
+        // """
+        char buffer[MAX_FEN_LENGTH];
+        return std::string(buffer, _write_fen(buffer, shredder, en_passant, promoted));
+    }
+
+    auto shredder_fen(_EnPassantSpec en_passant = _EnPassantSpec::legal, std::optional<bool> promoted = std::nullopt) -> std::string {
+        return fen(true, en_passant, promoted);
+    }
+
+    auto epd(bool shredder = false, _EnPassantSpec en_passant = _EnPassantSpec::legal, std::optional<bool> promoted = std::nullopt) -> std::string {
+        // """
+        // Gets an EPD representation of the current position.
+
+        // See :func:`~chess.Board.fen()` for FEN formatting options (*shredder*,
+        // *ep_square* and *promoted*).
+
+        // EPD operations are not supported yet, so this is the first four
+        // fields of the FEN.
+        // """
+        char buffer[MAX_FEN_LENGTH];
+        return std::string(buffer, _write_epd(buffer, shredder, en_passant, promoted));
+    }
+
+    auto san(Move move) -> std::string {
+        // """
+        // Gets the standard algebraic notation of the given move in the context
+        // of the current position.
+        // """
+        return _algebraic(move);
+    }
+
+    auto write_san(Move move, char (&buffer)[MAX_SAN_LENGTH]) -> std::size_t {
+        // """
+        // Writes :func:`~chess.Board.san()` into *buffer*, followed by a
+        // terminating NUL, and returns its length. Nothing is allocated.
+        // """
+        auto end = _write_algebraic(move, false, buffer);
+        *end = '\0';
+        return (std::size_t)(end - buffer);
+    }
+
+    auto lan(Move move) -> std::string {
+        // """
+        // Gets the long algebraic notation of the given move in the context of
+        // the current position.
+        // """
+        return _algebraic(move, true);
+    }
+
+    auto san_and_push(Move move) -> std::string {
+        return _algebraic_and_push(move);
+    }
+
+    auto _algebraic(Move move, bool long_ = false) -> std::string {
+        // long algebraic notation has room for the from square, one more than SAN.
+        char buffer[MAX_SAN_LENGTH + 2];
+        return std::string(buffer, _write_algebraic(move, long_, buffer));
+    }
+
+    auto _algebraic_and_push(Move move, bool long_ = false) -> std::string {
+        auto san = _algebraic(move, long_);
+        push(move);
+        return san;
+    }
+
+    auto _write_algebraic(Move move, bool long_, char* out) -> char* {
+        out = _write_algebraic_without_suffix(move, long_, out);
+        if (!move.__bool__())
+            return out;
+
+        // # Look ahead for check or checkmate.
+        UndoRecord undo;
+        push_fast(move, undo);
+        auto is_check = this->is_check();
+        auto is_checkmate = (is_check && this->is_checkmate()) || is_variant_loss() || is_variant_win();
+        pop_fast(undo);
+
+        // # Add check or checkmate suffix.
+        if (is_checkmate)
+            *out++ = '#';
+        else if (is_check)
+            *out++ = '+';
+        return out;
+    }
+
+    auto _san_from_mask(PieceType piece_type, Square to_square) -> Bitboard {
+        // the squares a piece of *piece_type* could reach *to_square* from,
+        // found by looking back from the target with the same attack tables.
+        // pawns are not symmetric, and kings also castle onto squares they do
+        // not attack, so both are left to the move generator.
+        switch (piece_type) {
+            case PieceType::KNIGHT: return BB_KNIGHT_ATTACKS[to_square];
+            case PieceType::BISHOP: return bishop_attacks(to_square, occupied);
+            case PieceType::ROOK: return rook_attacks(to_square, occupied);
+            case PieceType::QUEEN: return queen_attacks(to_square, occupied);
+            default: return BB_ALL;
+        }
+    }
+
+    auto _write_algebraic_without_suffix(Move move, bool long_, char* out) -> char* {
+        constexpr std::string_view symbols = "?PNBRQK";
+
+        // # Null move.
+        if (!move.__bool__()) {
+            *out++ = '-';
+            *out++ = '-';
+            return out;
+        }
+
+        // # Drops.
+        if (move.drop.has_value()) {
+            if (move.drop != PieceType::PAWN)
+                *out++ = symbols[(int)move.drop.value()];
+            *out++ = '@';
+            *out++ = (char)('a' + square_file(move.to_square));
+            *out++ = (char)('1' + square_rank(move.to_square));
+            return out;
+        }
+
+        // # Castling.
+        if (is_castling(move)) {
+            for (auto c : square_file(move.to_square) < square_file(move.from_square) ? "O-O-O"sv : "O-O"sv)
+                *out++ = c;
+            return out;
+        }
+
+        auto piece_type = piece_type_at(move.from_square);
+        assert(piece_type.has_value() && "san() and lan() expect move to be legal or null");
+        auto capture = is_capture(move);
+
+        if (piece_type != PieceType::PAWN)
+            *out++ = symbols[(int)piece_type.value()];
+
+        if (long_) {
+            *out++ = (char)('a' + square_file(move.from_square));
+            *out++ = (char)('1' + square_rank(move.from_square));
+        } else if (piece_type != PieceType::PAWN) {
+            // # Get ambiguous move candidates.
+            // # Relevant candidates: not exactly the current move,
+            // # but to the same square. Only pieces that attack the target
+            // # square are worth generating moves for.
+            Bitboard others = 0;
+            auto from_mask = pieces_mask(piece_type.value(), turn) & _san_from_mask(piece_type.value(), move.to_square);
+            from_mask &= ~BB_SQUARES[move.from_square];
+            if (from_mask) {
+                MoveList candidates;
+                generate_legal_moves_into(candidates, from_mask, BB_SQUARES[move.to_square]);
+                for (auto candidate : candidates)
+                    others |= BB_SQUARES[candidate.from_square];
+            }
+
+            // # Disambiguate.
+            if (others) {
+                auto row = false, column = false;
+
+                if (others & BB_RANKS[square_rank(move.from_square)])
+                    column = true;
+
+                if (others & BB_FILES[square_file(move.from_square)])
+                    row = true;
+                else
+                    column = true;
+
+                if (column)
+                    *out++ = (char)('a' + square_file(move.from_square));
+                if (row)
+                    *out++ = (char)('1' + square_rank(move.from_square));
+            }
+        } else if (capture) {
+            *out++ = (char)('a' + square_file(move.from_square));
+        }
+
+        // # Captures.
+        if (capture)
+            *out++ = 'x';
+        else if (long_)
+            *out++ = '-';
+
+        // # Destination square.
+        *out++ = (char)('a' + square_file(move.to_square));
+        *out++ = (char)('1' + square_rank(move.to_square));
+
+        // # Promotion.
+        if (move.promotion.has_value()) {
+            *out++ = '=';
+            *out++ = symbols[(int)move.promotion.value()];
+        }
+
+        return out;
+    }
+
+    auto variation_san(const std::vector<Move>& variation) -> std::string {
+        // """
+        // Given a sequence of moves, returns a string representing the sequence
+        // in standard algebraic notation (e.g., ``1. e4 e5 2. Nf3 Nc6`` or
+        // ``37...Bg6 38. fxg6``).
+
+        // The board will not be modified as a result of calling this.
+
+        // :raises: :exc:`std::invalid_argument` if any moves in the sequence are illegal.
+        // """
+        auto board = copy(false);
+        std::vector<std::string> san;
+
+        for (auto move : variation) {
+            if (!board.is_legal(move))
+                throw std::invalid_argument("illegal move "s + move.uci() + " in position " + board.fen());
+
+            if (board.turn == WHITE)
+                san.push_back(std::to_string(board.fullmove_number) + ". " + board.san_and_push(move));
+            else if (san.empty())
+                san.push_back(std::to_string(board.fullmove_number) + "..." + board.san_and_push(move));
+            else
+                san.push_back(board.san_and_push(move));
+        }
+
+        return strtools::join(san, " ");
+    }
+
+    auto try_parse_san(std::string_view san, Move& move) -> SanError {
+        // """
+        // Parses a move in standard algebraic notation like
+        // :func:`~chess.Board.parse_san()`, but stores it in *move* and reports
+        // errors by return value. Nothing is allocated.
+        // """
+        CHESS_PROBE(parse_san);
+        // # Castling.
+        auto is_one_of = [&](std::initializer_list<std::string_view> options) {
+            return std::find(options.begin(), options.end(), san) != options.end();
+        };
+        auto kingside = is_one_of({"O-O", "O-O+", "O-O#", "0-0", "0-0+", "0-0#"});
+        if (kingside || is_one_of({"O-O-O", "O-O-O+", "O-O-O#", "0-0-0", "0-0-0+", "0-0-0#"})) {
+            MoveList castling;
+            generate_castling_moves_into(castling);
+            for (auto candidate : castling) {
+                if (kingside ? is_kingside_castling(candidate) : is_queenside_castling(candidate)) {
+                    move = candidate;
+                    return SanError::ok;
+                }
+            }
+            return SanError::illegal;
+        }
+
+        // # Match normal moves.
+        _SanFields fields;
+        if (!_match_san(san, fields)) {
+            // # Null moves.
+            if (is_one_of({"--", "Z0", "0000", "@@@@"})) {
+                move = Move::null();
+                return SanError::ok;
+            }
+            return san.find(',') != std::string_view::npos ? SanError::multi_leg : SanError::invalid;
+        }
+
+        // # Get target square. Mask our own pieces to exclude castling moves.
+        auto to_square = (Square)fields.to_square;
+        auto to_mask = BB_SQUARES[to_square] & ~occupied_co[turn];
+
+        // # Get the promotion piece type.
+        std::optional<PieceType> promotion = std::nullopt;
+        if (fields.promotion)
+            promotion = (PieceType)fields.promotion;
+
+        // # Filter by original square.
+        auto from_mask = BB_ALL;
+        if (fields.from_file >= 0)
+            from_mask &= BB_FILES[fields.from_file];
+        if (fields.from_rank >= 0)
+            from_mask &= BB_RANKS[fields.from_rank];
+
+        // # Filter by piece type.
+        if (fields.piece_type) {
+            auto piece_type = (PieceType)fields.piece_type;
+            from_mask &= pieces_mask(piece_type, turn) & _san_from_mask(piece_type, to_square);
+        } else if (fields.from_file >= 0 && fields.from_rank >= 0) {
+            // # Allow fully specified moves, even if they are not pawn moves,
+            // # including castling moves.
+            auto from_square = square(fields.from_file, fields.from_rank);
+            auto found_promotion = promotion;
+            if (!found_promotion.has_value() && (pawns & BB_SQUARES[from_square]) && (BB_SQUARES[to_square] & BB_BACKRANKS))
+                found_promotion = PieceType::QUEEN;
+            auto found = _from_chess960(chess960, from_square, to_square, found_promotion);
+            if (!is_legal(found))
+                return SanError::illegal;
+            if (found.promotion != promotion)
+                return SanError::missing_promotion;
+            move = found;
+            return SanError::ok;
+        } else {
+            from_mask &= pawns;
+        }
+
+        // # Match legal moves.
+        MoveList candidates;
+        if (from_mask)
+            generate_legal_moves_into(candidates, from_mask, to_mask);
+        auto matched = false;
+        for (auto candidate : candidates) {
+            if (candidate.promotion != promotion)
+                continue;
+
+            if (matched)
+                return SanError::ambiguous;
+
+            move = candidate;
+            matched = true;
+        }
+
+        return matched ? SanError::ok : SanError::illegal;
+    }
+
+    auto parse_san(const std::string& san) -> Move {
+        // """
+        // Uses the current position as the context to parse a move in standard
+        // algebraic notation and returns the corresponding move object.
+
+        // Ambiguous moves are rejected. Overspecified moves (including long
+        // algebraic notation) are accepted.
+
+        // The returned move is guaranteed to be either legal or a null move.
+
+        // :raises: :exc:`std::invalid_argument` if the SAN is invalid, illegal or ambiguous.
+        // """
+        auto move = Move::null();
+        auto error = try_parse_san(san, move);
+        if (error == SanError::ok)
+            return move;
+        auto message = std::string(san_error_message(error)) + ": '" + san + "'";
+        if (error != SanError::invalid && error != SanError::multi_leg)
+            message += " in " + fen();
+        throw std::invalid_argument(message);
+    }
+
+    auto push_san(const std::string& san) -> Move {
+        // """
+        // Parses a move in standard algebraic notation, makes the move and puts
+        // it onto the move stack.
+
+        // Returns the move.
+
+        // :raises: :exc:`std::invalid_argument` if neither legal nor a null move.
+        // """
+        auto move = parse_san(san);
+        push(move);
+        return move;
+    }
+
+    auto is_en_passant(Move move) -> bool {
+        // """Checks if the given pseudo-legal move is an en passant capture."""
+        auto diff = std::abs(move.to_square - move.from_square);
+        return (ep_square == move.to_square &&
+                (bool)(pawns & BB_SQUARES[move.from_square]) &&
+                (diff == 7 || diff == 9) &&
+                !(occupied & BB_SQUARES[move.to_square]));
+    }
+
+    auto is_capture(Move move) -> bool {
+        // """Checks if the given pseudo-legal move is a capture."""
+        auto touched = BB_SQUARES[move.from_square] ^ BB_SQUARES[move.to_square];
+        return (bool)(touched & occupied_co[!turn]) || is_en_passant(move);
+    }
+
+    auto captured_piece(Move move) -> std::optional<Piece> {
+        // """
+        // Gets the piece the given pseudo-legal move captures, the pawn
+        // taken en passant included, or ``std::nullopt`` if it is not a
+        // capture. Runs in constant time.
+        // """
+        auto code = _mailbox[move.to_square];
+        if (code) {
+            // # Castling is encoded as the king taking its own rook.
+            if ((Color)(code >> 3) == turn)
+                return std::nullopt;
+            return Piece((PieceType)(code & 7), (Color)(code >> 3));
+        }
+        if (is_en_passant(move))
+            return Piece(PieceType::PAWN, (Color)!turn);
+        return std::nullopt;
+    }
+
+    auto is_zeroing(Move move) -> bool {
+        // """Checks if the given pseudo-legal move is a capture or pawn move."""
+        auto touched = BB_SQUARES[move.from_square] ^ BB_SQUARES[move.to_square];
+        return (bool)(touched & pawns || touched & occupied_co[!turn] || move.drop == PieceType::PAWN);
+    }
+
+    auto _reduces_castling_rights(Move move) -> bool {
+        auto cr = clean_castling_rights();
+        auto touched = BB_SQUARES[move.from_square] ^ BB_SQUARES[move.to_square];
+        return (bool)(touched & cr ||
+                      (cr & BB_RANK_1 && touched & kings & occupied_co[WHITE] & ~promoted) ||
+                      (cr & BB_RANK_8 && touched & kings & occupied_co[BLACK] & ~promoted));
+    }
+
+    auto is_irreversible(Move move) -> bool {
+        // """
+        // Checks if the given pseudo-legal move is irreversible.
+
+        // In standard chess, pawn moves, captures, moves that destroy castling
+        // rights and moves that cede en passant are irreversible.
+
+        // This method has false-negatives with forced lines. For example, a check
+        // that will force the king to lose castling rights is not considered
+        // irreversible. Only the actual king move is.
+        // """
+        return is_zeroing(move) || _reduces_castling_rights(move) || has_legal_en_passant();
+    }
+
+    auto is_castling(Move move) -> bool {
+        // """Checks if the given pseudo-legal move is a castling move."""
+        if (kings & BB_SQUARES[move.from_square]) {
+            auto diff = square_file(move.from_square) - square_file(move.to_square);
+            return std::abs(diff) > 1 || (bool)(rooks & occupied_co[turn] & BB_SQUARES[move.to_square]);
+        }
+        return false;
+    }
+
+    auto is_kingside_castling(Move move) -> bool {
+        // """
+        // Checks if the given pseudo-legal move is a kingside castling move.
+        // """
+        return is_castling(move) && square_file(move.to_square) > square_file(move.from_square);
+    }
+
+    auto is_queenside_castling(Move move) -> bool {
+        // """
+        // Checks if the given pseudo-legal move is a queenside castling move.
+        // """
+        return is_castling(move) && square_file(move.to_square) < square_file(move.from_square);
+    }
+
+    auto clean_castling_rights() const -> Bitboard {
+        // """
+        // Returns valid castling rights filtered from
+        // :data:`~chess.Board.castling_rights`.
+        // """
+        if (!_stack.empty()) {
+            // # No new castling rights are assigned in a game, so we can assume
+            // # they were filtered already.
+            return castling_rights;
+        }
+
+        auto castling = castling_rights & rooks;
+        auto white_castling = castling & BB_RANK_1 & occupied_co[WHITE];
+        auto black_castling = castling & BB_RANK_8 & occupied_co[BLACK];
+
+        if (!chess960) {
+            // # The rooks must be on a1, h1, a8 or h8.
+            white_castling &= (BB_A1 | BB_H1);
+            black_castling &= (BB_A8 | BB_H8);
+
+            // # The kings must be on e1 or e8.
+            if (!(occupied_co[WHITE] & kings & ~promoted & BB_E1))
+                white_castling = 0;
+            if (!(occupied_co[BLACK] & kings & ~promoted & BB_E8))
+                black_castling = 0;
+
+            return white_castling | black_castling;
+        } else {
+            // # The kings must be on the back rank.
+            auto white_king_mask = occupied_co[WHITE] & kings & BB_RANK_1 & ~promoted;
+            auto black_king_mask = occupied_co[BLACK] & kings & BB_RANK_8 & ~promoted;
+            if (!white_king_mask)
+                white_castling = 0;
+            if (!black_king_mask)
+                black_castling = 0;
+
+            // # There are only two ways of castling, a-side and h-side, and the
+            // # king must be between the rooks.
+            auto white_a_side = white_castling & -white_castling;
+            auto white_h_side = white_castling ? BB_SQUARES[msb(white_castling)] : BB_EMPTY;
+
+            if (white_a_side && msb(white_a_side) > msb(white_king_mask))
+                white_a_side = 0;
+            if (white_h_side && msb(white_h_side) < msb(white_king_mask))
+                white_h_side = 0;
+
+            auto black_a_side = black_castling & -black_castling;
+            auto black_h_side = black_castling ? BB_SQUARES[msb(black_castling)] : BB_EMPTY;
+
+            if (black_a_side && msb(black_a_side) > msb(black_king_mask))
+                black_a_side = 0;
+            if (black_h_side && msb(black_h_side) < msb(black_king_mask))
+                black_h_side = 0;
+
+            // # Done.
+            return black_a_side | black_h_side | white_a_side | white_h_side;
+        }
+    }
+
+    auto has_castling_rights(Color color) -> bool {
+        // """Checks if the given side has castling rights."""
+        auto backrank = color == WHITE ? BB_RANK_1 : BB_RANK_8;
+        return (bool)(clean_castling_rights() & backrank);
+    }
+
+    auto _ep_skewered(Square king, Square capturer) -> bool {
+        // # Handle the special case where the king would be in check if the
+        // # pawn and its capturer disappear from the rank.
+
+        // # Vertical skewers of the captured pawn are not possible. (Pins on
+        // # the capturer are not handled here.)
+        assert(ep_square.has_value());
+
+        auto last_double = (Square)(ep_square.value() + (turn == WHITE ? -8 : 8));
+
+        auto occupancy = (occupied & ~BB_SQUARES[last_double] &
+                          ~BB_SQUARES[capturer]) | BB_SQUARES[ep_square.value()];
+
+        // # Horizontal attack on the fifth or fourth rank.
+        auto horizontal_attackers = occupied_co[!turn] & (rooks | queens);
+        if (rook_attacks(king, occupancy) & BB_RANKS[square_rank(king)] & horizontal_attackers)
+            return true;
+
+        // # Diagonal skewers. These are not actually possible in a real game,
+        // # because if the latest double pawn move covers a diagonal attack,
+        // # then the other side would have been in check already.
+        auto diagonal_attackers = occupied_co[!turn] & (bishops | queens);
+        if (bishop_attacks(king, occupancy) & diagonal_attackers)
+            return true;
+
+        return false;
+    }
+
+    auto _slider_blockers(Square king) -> Bitboard {
+        auto rooks_and_queens = rooks | queens;
+        auto bishops_and_queens = bishops | queens;
+
+        auto snipers = ((rook_attacks(king, BB_EMPTY) & rooks_and_queens) |
+                        (bishop_attacks(king, BB_EMPTY) & bishops_and_queens));
+
+        Bitboard blockers = 0;
+
+        for (auto sniper : scan_reversed(snipers & occupied_co[!turn])) {
+            auto b = between(king, sniper) & occupied;
+
+            // # Add to blockers if exactly one piece in-between.
+            if (b && BB_SQUARES[msb(b)] == b)
+                blockers |= b;
+        }
+
+        return blockers & occupied_co[turn];
+    }
+
+    auto _is_safe(Square king, Bitboard blockers, Move move) -> bool {
+        if (move.from_square == king) {
+            if (is_castling(move))
+                return true;
+            else
+                return !is_attacked_by((Color)!turn, move.to_square);
+        } else if (is_en_passant(move)) {
+            return (bool)(pin_mask(turn, move.from_square) & BB_SQUARES[move.to_square]) &&
+                   !_ep_skewered(king, move.from_square);
+        } else {
+            return !(blockers & BB_SQUARES[move.from_square]) ||
+                   (bool)(ray(move.from_square, move.to_square) & BB_SQUARES[king]);
+        }
+    }
+
+    auto _generate_evasions(Square king, Bitboard checkers, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        auto sliders = checkers & (bishops | rooks | queens);
+
+        Bitboard attacked = 0;
+        for (auto checker : scan_reversed(sliders))
+            attacked |= ray(king, checker) & ~BB_SQUARES[checker];
+
+        if (BB_SQUARES[king] & from_mask) {
+            for (auto to_square : scan_reversed(BB_KING_ATTACKS[king] & ~occupied_co[turn] & ~attacked & to_mask))
+                moves.emplace_back(king, to_square);
+        }
+
+        auto checker = (Square)msb(checkers);
+        if (BB_SQUARES[checker] == checkers) {
+            // # Capture or block a single checker.
+            auto target = between(king, checker) | checkers;
+
+            generate_pseudo_legal_moves_into(moves, ~kings & from_mask, target & to_mask);
+
+            // # Capture the checking pawn en passant (but avoid yielding
+            // # duplicate moves).
+            if (ep_square.has_value() && !(BB_SQUARES[ep_square.value()] & target)) {
+                auto last_double = ep_square.value() + (turn == WHITE ? -8 : 8);
+                if (last_double == checker)
+                    generate_pseudo_legal_ep_into(moves, from_mask, to_mask);
+            }
+        }
+        return moves;
+    }
+
+    void _pin_masks(Square king, Bitboard& pin_hv, Bitboard& pin_diag) const {
+        // The lines from *king* to enemy sliders that pin exactly one of our
+        // pieces, including the pinning slider: rank and file pins in
+        // *pin_hv*, diagonal pins in *pin_diag*. Looking through only the
+        // enemy pieces finds every sniper with nothing but our pieces in
+        // the way.
+        auto them = occupied_co[!turn];
+        pin_hv = pin_diag = BB_EMPTY;
+        for (auto sniper : scan_reversed(rook_attacks(king, them) & them & (rooks | queens))) {
+            auto line = between(king, sniper);
+            auto b = line & occupied;
+            if (b && !(b & (b - 1)))
+                pin_hv |= line | BB_SQUARES[sniper];
+        }
+        for (auto sniper : scan_reversed(bishop_attacks(king, them) & them & (bishops | queens))) {
+            auto line = between(king, sniper);
+            auto b = line & occupied;
+            if (b && !(b & (b - 1)))
+                pin_diag |= line | BB_SQUARES[sniper];
+        }
+    }
+
+    template <Color Us>
+    void _generate_legal_pawn_moves_into(MoveList& moves, Bitboard our_pawns, Bitboard to_mask, Bitboard pin_hv, Bitboard pin_diag) {
+        // All pawn advances and captures at once, by shifting the pawns. A
+        // pawn pinned along a rank or file can only advance along its pin,
+        // one pinned diagonally can only capture along its pin.
+        auto theirs = occupied_co[!Us] & to_mask;
+        auto empty = ~occupied;
+
+        auto pushers = our_pawns & ~pin_diag;
+        auto capturers = our_pawns & ~pin_hv;
+        auto free_capturers = capturers & ~pin_diag;
+        auto pinned_capturers = capturers & pin_diag;
+
+        Bitboard single_moves, double_moves, west_captures, east_captures;
+        constexpr auto forward = Us == WHITE ? 8 : -8;
+        if constexpr (Us == WHITE) {
+            single_moves = ((pushers & ~pin_hv) << 8 | ((pushers & pin_hv) << 8 & pin_hv)) & empty;
+            double_moves = single_moves << 8 & empty & BB_RANK_4;
+            west_captures = ((free_capturers & ~BB_FILE_A) << 7 | ((pinned_capturers & ~BB_FILE_A) << 7 & pin_diag)) & theirs;
+            east_captures = ((free_capturers & ~BB_FILE_H) << 9 | ((pinned_capturers & ~BB_FILE_H) << 9 & pin_diag)) & theirs;
+        } else {
+            single_moves = ((pushers & ~pin_hv) >> 8 | ((pushers & pin_hv) >> 8 & pin_hv)) & empty;
+            double_moves = single_moves >> 8 & empty & BB_RANK_5;
+            west_captures = ((free_capturers & ~BB_FILE_A) >> 9 | ((pinned_capturers & ~BB_FILE_A) >> 9 & pin_diag)) & theirs;
+            east_captures = ((free_capturers & ~BB_FILE_H) >> 7 | ((pinned_capturers & ~BB_FILE_H) >> 7 & pin_diag)) & theirs;
+        }
+
+        for (auto to_square : scan_reversed(west_captures))
+            _push_pawn_move(moves, (Square)(to_square - forward + 1), to_square);
+        for (auto to_square : scan_reversed(east_captures))
+            _push_pawn_move(moves, (Square)(to_square - forward - 1), to_square);
+        for (auto to_square : scan_reversed(single_moves & to_mask))
+            _push_pawn_move(moves, (Square)(to_square - forward), to_square);
+        for (auto to_square : scan_reversed(double_moves & to_mask))
+            moves.emplace_back((Square)(to_square - 2 * forward), to_square);
+    }
+
+    void generate_legal_moves_into(MoveList& moves, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) {
+        // Appends the legal moves to *moves*. The checkers, the check mask
+        // of squares that resolve a check and the rank/file and diagonal pin
+        // masks are worked out once for the position, and every piece class
+        // is clipped to them up front, so no candidate needs a legality
+        // probe: the king only steps to unattacked squares, pinned pieces
+        // stay on their pin line, and in double check only the king moves.
+        CHESS_PROBE(generate_legal_moves);
+        if (is_variant_end())
+            return;
+
+        if (!(kings & occupied_co[turn])) {
+            generate_pseudo_legal_moves_into(moves, from_mask, to_mask);
+            return;
+        }
+
+        // # The side to move is the only runtime branch: below it, pawn
+        // # directions, promotion and en passant ranks are constants.
+        if (turn == WHITE)
+            _generate_legal_moves_into<WHITE>(moves, from_mask, to_mask);
+        else
+            _generate_legal_moves_into<BLACK>(moves, from_mask, to_mask);
+    }
+
+    template <Color Us>
+    void _generate_legal_moves_into(MoveList& moves, Bitboard from_mask, Bitboard to_mask) {
+        constexpr auto them = (Color)!Us;
+        auto king_sq = (Square)msb(kings & occupied_co[Us]);
+        auto king_bb = BB_SQUARES[king_sq];
+        auto checkers = _attackers_mask<them>(king_sq, occupied);
+
+        // # King moves. The king is lifted off the board for the attack test,
+        // # so it cannot step back along the line of a checking slider.
+        if (king_bb & from_mask) {
+            for (auto to_square : scan_reversed(BB_KING_ATTACKS[king_sq] & ~occupied_co[Us] & to_mask)) {
+                if (!_attackers_mask<them>(to_square, occupied ^ king_bb))
+                    moves.emplace_back(king_sq, to_square);
+            }
+            if (!checkers)
+                generate_castling_moves_into(moves, from_mask, to_mask);
+        }
+
+        // # In double check only the king can move.
+        if (checkers & (checkers - 1))
+            return;
+
+        auto checkmask = checkers ? between(king_sq, (Square)msb(checkers)) | checkers : BB_ALL;
+        Bitboard pin_hv, pin_diag;
+        _pin_masks(king_sq, pin_hv, pin_diag);
+
+        auto movers = occupied_co[Us] & from_mask & ~king_bb;
+        auto targets = ~occupied_co[Us] & to_mask & checkmask;
+
+        // # A pinned knight can never move, and a slider pinned on a line it
+        // # cannot move along is stuck as well. The other pinned sliders stay
+        // # on their pin mask: the other pin lines through the king do not
+        // # cross their moves.
+        for (auto from_square : scan_reversed(movers & knights & ~(pin_hv | pin_diag))) {
+            for (auto to_square : scan_reversed(BB_KNIGHT_ATTACKS[from_square] & targets))
+                moves.emplace_back(from_square, to_square);
+        }
+        for (auto from_square : scan_reversed(movers & (bishops | queens) & ~(pin_hv | pin_diag))) {
+            for (auto to_square : scan_reversed(bishop_attacks(from_square, occupied) & targets))
+                moves.emplace_back(from_square, to_square);
+        }
+        for (auto from_square : scan_reversed(movers & (rooks | queens) & ~(pin_hv | pin_diag))) {
+            for (auto to_square : scan_reversed(rook_attacks(from_square, occupied) & targets))
+                moves.emplace_back(from_square, to_square);
+        }
+        for (auto from_square : scan_reversed(movers & (rooks | queens) & pin_hv)) {
+            for (auto to_square : scan_reversed(rook_attacks(from_square, occupied) & targets & pin_hv))
+                moves.emplace_back(from_square, to_square);
+        }
+        for (auto from_square : scan_reversed(movers & (bishops | queens) & pin_diag)) {
+            for (auto to_square : scan_reversed(bishop_attacks(from_square, occupied) & targets & pin_diag))
+                moves.emplace_back(from_square, to_square);
+        }
+
+        _generate_legal_pawn_moves_into<Us>(moves, movers & pawns, to_mask & checkmask, pin_hv, pin_diag);
+
+        // # En passant also resolves a check by removing the checking pawn,
+        // # and takes two pawns off the rank of the king at once.
+        if (ep_square.has_value()) {
+            auto ep = ep_square.value();
+            auto captured = (Square)(ep + (Us == WHITE ? -8 : 8));
+            if (!(checkmask & (BB_SQUARES[ep] | BB_SQUARES[captured])) || !(BB_SQUARES[ep] & to_mask) || BB_SQUARES[ep] & occupied)
+                return;
+
+            constexpr auto capture_rank = BB_RANKS[Us == WHITE ? 4 : 3];
+            for (auto from_square : scan_reversed(movers & pawns & ~pin_hv & BB_PAWN_ATTACKS[them][ep] & capture_rank)) {
+                if (pin_diag & BB_SQUARES[from_square] && !(pin_diag & BB_SQUARES[ep]))
+                    continue;
+                if (!_ep_skewered(king_sq, from_square))
+                    moves.emplace_back(from_square, ep);
+            }
+        }
+    }
+
+    auto generate_legal_moves(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        generate_legal_moves_into(moves, from_mask, to_mask);
+        return moves;
+    }
+
+    void generate_legal_ep_into(MoveList& moves, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) {
+        if (is_variant_end())
+            return;
+
+        for (auto move : generate_pseudo_legal_ep(from_mask, to_mask)) {
+            if (!is_into_check(move))
+                moves.push_back(move);
+        }
+    }
+
+    auto generate_legal_ep(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        generate_legal_ep_into(moves, from_mask, to_mask);
+        return moves;
+    }
+
+    auto generate_legal_captures(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        generate_legal_moves_into(moves, from_mask, to_mask & occupied_co[!turn]);
+        generate_legal_ep_into(moves, from_mask, to_mask);
+        return moves;
+    }
+
+    auto _attacked_for_king(Bitboard path, Bitboard occupied) const -> bool {
+        for (auto square : scan_reversed(path)) {
+            if (_attackers_mask((Color)!turn, square, occupied))
+                return true;
+        }
+        return false;
+    }
+
+    void generate_castling_moves_into(MoveList& moves, Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) {
+        for (auto it = CastleIterator(*this, from_mask, to_mask); !it.stop_iteration(); ++it)
+            moves.push_back(*it);
+    }
+
+    auto generate_castling_moves(Bitboard from_mask = BB_ALL, Bitboard to_mask = BB_ALL) -> MoveList {
+        MoveList moves;
+        generate_castling_moves_into(moves, from_mask, to_mask);
+        return moves;
+    }
+
+    auto _from_chess960(bool chess960, Square from_square, Square to_square, std::optional<PieceType> promotion = std::nullopt, std::optional<PieceType> drop = std::nullopt) const -> Move {
+        if (!chess960 && !promotion.has_value() && !drop.has_value()) {
+            if (from_square == E1 && kings & BB_E1) {
+                if (to_square == H1)
+                    return Move(E1, G1);
+                else if (to_square == A1)
+                    return Move(E1, C1);
+            } else if (from_square == E8 && kings & BB_E8) {
+                if (to_square == H8)
+                    return Move(E8, G8);
+                else if (to_square == A8)
+                    return Move(E8, C8);
+            }
+        }
+
+        return Move(from_square, to_square, promotion, drop);
+    }
+
+    auto _to_chess960(Move move) const -> Move {
+        if (move.from_square == E1 && kings & BB_E1) {
+            if (move.to_square == G1 && !(rooks & BB_G1))
+                return Move(E1, H1);
+            else if (move.to_square == C1 && !(rooks & BB_C1))
+                return Move(E1, A1);
+        } else if (move.from_square == E8 && kings & BB_E8) {
+            if (move.to_square == G8 && !(rooks & BB_G8))
+                return Move(E8, H8);
+            else if (move.to_square == C8 && !(rooks & BB_C8))
+                return Move(E8, A8);
+        }
+
+        return move;
+    }
+
+    auto _transposition_key() -> _TranspositionKey {
+        return _TranspositionKey{
+            {pawns, knights, bishops, rooks, queens, kings, occupied_co[WHITE], occupied_co[BLACK]},
+            turn,
+            clean_castling_rights(),
+            has_legal_en_passant() ? ep_square : std::nullopt};
+    }
+
+    auto copy(bool stack = true, std::pmr::memory_resource* resource = nullptr) const -> Board {
+        // """
+        // Creates a copy of the board.
+
+        // Defaults to copying the entire move stack. Alternatively, *stack* can
+        // be ``false`` to copy only the current position.
+
+        // The copy allocates from *resource*, or from the same memory
+        // resource as this board if it is ``nullptr``.
+        // """
+        return Board(*this, resource ? resource : memory_resource(), stack);
+    }
+};
+
+using Snapshot = _Snapshot<Board>;
+static_assert(std::is_trivially_copyable_v<Snapshot>);
 
 }
\ No newline at end of file